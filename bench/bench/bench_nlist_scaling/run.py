@@ -0,0 +1,85 @@
+from pd import *
+import time
+cseed(4)
+info()
+timer()
+
+## Neighbour list rebuild scaling benchmark.
+## Creates water boxes of increasing size (1k to 200k atoms) and times a full
+## rebuild of the cell-based neighbour list. The time per atom should stay 
+## roughly constant, i.e. the rebuild should scale as O(N). For the smaller systems
+## the result is also compared against the brute force NeighbourList.
+
+ffps = FFParamSet("amber03aa.ff")
+ffps.readLib("tip3.ff")
+water = NewMolecule(ffps,"TIP3")
+
+cutoff     = float(after("-cutoff",10.0))
+maxatoms   = int(after("-maxatoms",200000))
+maxcompare = int(after("-maxcompare",20000))
+repeats    = 3
+
+def compareLists(wspace, a, b):
+  for i in range(wspace.nAtoms()):
+    if a.nNeighbours(i) != b.nNeighbours(i): return False
+    for nj in range(a.nNeighbours(i)):
+      if a.getNeighbourIndex(i,nj) != b.getNeighbourIndex(i,nj): return False
+      if a.getNeighbourBondOrder(i,nj) != b.getNeighbourBondOrder(i,nj): return False
+      if a.getNeighbourImageNumber(i,nj) != b.getNeighbourImageNumber(i,nj): return False
+  return True
+
+def timeRebuild(nlist):
+  nlist.calcNewList()         ## first call grows the memory as necessary
+  start = time.time()
+  for r in range(repeats):
+    nlist.calcNewList()
+  return (time.time() - start) / repeats
+
+results = []
+for natoms in [1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000]:
+  if natoms > maxatoms: break
+  nwater = natoms / 3
+  ## water has roughly 0.0334 molecules per cubic Angstrom 
+  boxsize = pow( float(nwater) / 0.0334, 1.0/3.0 )
+  box = PeriodicBox(boxsize)
+
+  sim = System(ffps)
+  sim.solvate_N(water, box, nwater, nwater)
+
+  for periodic in [False, True]:
+    wspace = WorkSpace( sim )
+    if periodic: wspace.setSpace(box)
+
+    cell = NeighbourList_CellBased()
+    wspace.setNeighbourList(cell)
+    cell.requestCutoff(cutoff)
+    tcell = timeRebuild(cell)
+
+    status = "not compared"
+    if wspace.nAtoms() <= maxcompare:
+      brute = NeighbourList()
+      wspace.setNeighbourList(brute)
+      brute.requestCutoff(cutoff)
+      brute.calcNewList()
+      if compareLists(wspace, cell, brute): status = "identical"
+      else:                                 status = "DIFFERENT"
+
+    results.append( (wspace.nAtoms(), periodic, tcell, status) )
+
+print ""
+print "%8s %9s %12s %14s %s"%("Atoms","Periodic","Rebuild(s)","us/atom","vs. NeighbourList")
+for (n, periodic, t, status) in results:
+  print "%8d %9s %12.4f %14.3f %s"%(n, str(periodic), t, 1E6 * t / n, status)
+
+## Check the scaling: time per atom of the largest system should not be
+## much worse than that of the smallest
+for periodic in [False, True]:
+  sel = [ r for r in results if r[1] == periodic ]
+  first = sel[0][2] / sel[0][0]
+  last  = sel[-1][2] / sel[-1][0]
+  ratio = last / first
+  if ratio < 3.0: verdict = "O(N) OK"
+  else:           verdict = "WORSE THAN O(N)"
+  print "Periodic=%s: per-atom cost ratio %d -> %d atoms: %.2f  %s"%(str(periodic), sel[0][0], sel[-1][0], ratio, verdict)
+
+timer()
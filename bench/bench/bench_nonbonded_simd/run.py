@@ -0,0 +1,75 @@
+from pd import *
+import time
+cseed(4)
+info()
+timer()
+
+## Vectorised nonbonded kernel benchmark.
+## Times FF_NonBonded force evaluations on a periodic water box with the 
+## SSE2/AVX kernel (UseSimd = True) and with the scalar kernel (UseSimd = False)
+## and in mixed precision (MixedPrecision = True) for all three electrostatics 
+## modes, and checks that energies agree within the documented tolerances 
+## (1E-10 relative in double precision, 1E-5 kcal/mol per atom in mixed precision).
+## Set the environment variable PD_SIMD=sse2 to force the SSE2 version on AVX machines.
+
+ffps = FFParamSet("amber03aa.ff")
+ffps.readLib("tip3.ff")
+water = NewMolecule(ffps,"TIP3")
+
+cutoff  = float(after("-cutoff",12.0))
+nwater  = int(after("-nwater",5000))
+repeats = int(after("-repeats",10))
+tolerance = 1E-10
+mixedtolerance = 1E-5
+
+## water has roughly 0.0334 molecules per cubic Angstrom 
+boxsize = pow( float(nwater) / 0.0334, 1.0/3.0 )
+box = PeriodicBox(boxsize)
+sim = System(ffps)
+sim.solvate_N(water, box, nwater, nwater)
+
+wspace = WorkSpace( sim )
+wspace.setSpace(box)
+nlist = NeighbourList_CellBased()
+wspace.setNeighbourList(nlist)
+nlist.requestCutoff(cutoff)
+
+def timeForces(mode, simd, mixed = False):
+  ff = Forcefield(wspace)
+  nb = FF_NonBonded(wspace)
+  nb.Cutoff =          cutoff 
+  nb.InnerCutoff =     cutoff - 2.0 
+  nb.VdwCutoff =       cutoff 
+  nb.VdwInnerCutoff =  cutoff - 2.0 
+  nb.EnergySwitch = (mode == "EnergySwitch")
+  nb.ForceSwitch  = (mode == "ForceSwitch")
+  nb.UseSimd = simd
+  nb.MixedPrecision = mixed
+  ff.add(nb)
+  ff.calcForces()          ## first call sets up the forcefield
+  nlist.calcNewList()
+  best = 1E10
+  for r in range(repeats):
+    start = time.time()
+    ff.calcForces()
+    best = min(best, time.time() - start)
+  return (best, nb.getEVdw() + nb.getEElec())
+
+kernel = FF_NonBonded(wspace)
+print ""
+print "Atoms: %d  Cutoff: %4.1f  SIMD kernel: %s"%(wspace.nAtoms(), cutoff, cpuSimdLevelName(kernel.simdKernelLevel()))
+print "%14s %10s %10s %8s %10s %10s %8s %14s"%("Mode","Scalar(s)","SIMD(s)","Speedup","dE/E","Mixed(s)","Speedup","dE/atom(kcal)")
+failed = False
+tokcal = 6.0221415E23 / 4184.0   ## Joule per molecule -> kcal/mol
+for mode in ["Normal", "EnergySwitch", "ForceSwitch"]:
+  (tscalar, escalar) = timeForces(mode, False)
+  (tsimd,   esimd)   = timeForces(mode, True)
+  (tmixed,  emixed)  = timeForces(mode, True, True)
+  rel = abs(esimd - escalar) / abs(escalar)
+  peratom = abs(emixed - escalar) * tokcal / wspace.nAtoms()
+  if rel > tolerance or peratom > mixedtolerance: failed = True
+  print "%14s %10.4f %10.4f %8.2f %10.2e %10.4f %8.2f %14.2e"%(mode, tscalar, tsimd, tscalar / tsimd, rel, tmixed, tscalar / tmixed, peratom)
+
+if failed: print "FAILED: energies differ by more than the tolerance"
+else:      print "OK"
+timer()
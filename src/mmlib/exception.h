@@ -48,6 +48,7 @@ public:
 	ExceptionBase(const std::string &_message = "");
 	virtual ~ExceptionBase() throw();
 	void Details();
+	const std::string& getMessage() const { return message; }
 protected:
 	std::string message;
 };
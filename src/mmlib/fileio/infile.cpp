@@ -479,16 +479,14 @@ namespace IO
 
 	bool FileMoleculeMaker::wouldAppendFileParticle( const FileParticle& _Particle ) const
 	{
-		static FileParticle part;
-		part = _Particle;
+		FileParticle part = _Particle;
 		m_Parent->ReinterpretName( part ); // Virtual call to the parent: controls renaming of residues either from alias definitions or from some sort of knowledge
 		return PassesFilter( part.resName );
 	}
 
 	bool FileMoleculeMaker::appendFileParticle( File_Molecule& _Mol, const FileParticle& _Particle ) const
 	{
-		static FileParticle part;
-		part = _Particle;
+		FileParticle part = _Particle;
 		m_Parent->ReinterpretName( part ); // Virtual call to the parent: controls renaming of residues either from alias definitions or from some sort of knowledge
 		if( PassesFilter( part.resName ) )
 		{
@@ -10,12 +10,12 @@
 #include "system/rebuilder.h"
 
 class MoleculeBase;
-class PD_API FileMoleculeMaker;
 
 class System;
 
 namespace IO
 {
+	class PD_API FileMoleculeMaker;
 
 	//-------------------------------------------------
 	//
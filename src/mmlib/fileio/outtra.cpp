@@ -79,6 +79,15 @@ namespace IO
 	}
 
 
+	void OutputTrajectoryContainer::flush()
+	{
+		for(unsigned i=0;i<size();i++) 
+		{
+			element(i).flush();
+		}
+	}
+
+
 
 
 
@@ -41,6 +41,10 @@ namespace IO
 		/// Append a frame to the trajectory
 		virtual int append() = 0;
 
+		/// Block until every appended frame has been written. Only trajectories that write 
+		/// asynchronously need to override this.
+		virtual void flush() {}
+
 	protected:
 
 		/// flags if the trajectory has been created already (in most cases this means
@@ -125,6 +129,9 @@ namespace IO
 		/// Append a frame to all trajectories currently stored
 		virtual int append();
 
+		/// Flush all trajectories currently stored
+		virtual void flush();
+
 	private:
 
 		/// Calc some stuff before subclasses are asked to append
@@ -7,6 +7,11 @@
 #include "fileio/infile.h"
 #include "pdb.h"
 
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
 using namespace std;
 using namespace Sequence;
 
@@ -18,13 +23,20 @@ namespace IO
 	// SEQRES tags in PDB files.
 	// -----------------------------------------------
 
-	PDB_SEQRES::PDB_SEQRES() : BioSequenceCollection<char>(), m_ParserNameMapper(NULL)
+	PDB_SEQRES::PDB_SEQRES() : BioSequenceCollection<char>(), 
+		m_ParserNameMapper(NULL),
+		m_LineParser(81), // 81 from: 1 + Zero Termination During Parsing + 80 is the normal length of a string in these files...
+		m_ResNameBuilder(3) // StringBuilder usable to temporarily hold the 3 residue chars
 	{
 		resetStatics();
 	}
 
 	void PDB_SEQRES::resetStatics()
 	{
+		m_SerNum = 1;
+		m_ChainID = CHAR_MAX;
+		m_FoundResCount = 0;
+		m_TotalResCount = INT_MAX;
 	}
 
 	void PDB_SEQRES::setAlias(const Library::AliasMapper& _ParserNameMapper)
@@ -40,6 +52,7 @@ namespace IO
 	void PDB_SEQRES::clear()
 	{
 		BioSequenceCollection<char>::clear();
+		resetStatics();
 	}
 
 	void PDB_SEQRES::loadFromFile( const std::string &_filename )
@@ -58,13 +71,13 @@ namespace IO
 
 	void PDB_SEQRES::parseLine( const std::string &_Line )
 	{
-		static StringBuilder lineParser(81); // 81 from: 1 + Zero Termination During Parsing + 80 is the normal length of a string in these files...
-		static StringBuilder resNameBuilder(3); // StringBuilder usable to temporarily hold the 3 residue chars
-
-		static int serNum = 1;
-		static char chainID = CHAR_MAX;
-		static int foundResCount = 0;
-		static int totalResCount = INT_MAX;
+		// The parse state lives in the instance (see resetStatics()) so that files can be read concurrently
+		StringBuilder& lineParser = m_LineParser;
+		StringBuilder& resNameBuilder = m_ResNameBuilder;
+		int& serNum = m_SerNum;
+		char& chainID = m_ChainID;
+		int& foundResCount = m_FoundResCount;
+		int& totalResCount = m_TotalResCount;
 
 		// get out line into a buffer
 		lineParser.setTo( _Line );
@@ -138,6 +151,16 @@ namespace IO
 	// PDB-Specific Parsing Helper Function
 	// -----------------------------------------------
 
+	/// The field with leading and trailing spaces removed, as trim() would
+	inline std::string trimmedField( const char* _Field, size_t _Width )
+	{
+		size_t first = 0;
+		while( first < _Width && _Field[first] == ' ' ) first++;
+		size_t last = _Width;
+		while( last > first && _Field[last-1] == ' ' ) last--;
+		return std::string( _Field + first, last - first );
+	}
+
 	inline bool getLineType(const std::string &line, std::string &lineType)
 	{
 		if( line.length() < 6 ) return false; // too short to be valid
@@ -205,32 +228,124 @@ namespace IO
 		return true;
 	}
 
+	// Fixed column field parsers for PDBAtomLine::loadLine(). They read the field in place and give the same
+	// result as sscanf("%d") / sscanf("%lf") on the field: leading whitespace is skipped and the number ends at
+	// the first character that cannot continue it. Plain decimals, i.e. all well formed PDB fields, are
+	// converted directly (mantissa / 10^n is correctly rounded, as is sscanf). Anything else falls back to sscanf.
+	inline bool parseFixedInt( const char* _Field, size_t _Width, int& _Value )
+	{
+		const char* c = _Field;
+		const char* end = _Field + _Width;
+		while( c < end && isspace((unsigned char)*c) ) c++;
+		bool negative = false;
+		if( c < end && (*c == '-' || *c == '+') )
+		{
+			negative = (*c == '-');
+			c++;
+		}
+		if( c == end || !isdigit((unsigned char)*c) ) return false;
+		int value = 0;
+		while( c < end && isdigit((unsigned char)*c) )
+		{
+			value = value * 10 + (*c - '0');
+			c++;
+		}
+		_Value = negative ? -value : value;
+		return true;
+	}
+
+	inline bool parseFixedDouble( const char* _Field, size_t _Width, double& _Value )
+	{
+		static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+		const char* c = _Field;
+		const char* end = _Field + _Width;
+		while( c < end && isspace((unsigned char)*c) ) c++;
+		const char* numberStart = c;
+		bool negative = false;
+		if( c < end && (*c == '-' || *c == '+') )
+		{
+			negative = (*c == '-');
+			c++;
+		}
+		long long mantissa = 0;
+		int digits = 0;
+		int fraction = 0;
+		while( c < end && isdigit((unsigned char)*c) )
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+			digits++;
+			c++;
+		}
+		if( c < end && *c == '.' )
+		{
+			c++;
+			while( c < end && isdigit((unsigned char)*c) )
+			{
+				mantissa = mantissa * 10 + (*c - '0');
+				digits++;
+				fraction++;
+				c++;
+			}
+		}
+		bool plain = digits <= 15 && ( c == end || 
+			( *c != 'e' && *c != 'E' && *c != 'x' && *c != 'X' && *c != 'i' && *c != 'I' && *c != 'n' && *c != 'N' ) );
+		if( plain )
+		{
+			if( digits == 0 ) return false;
+			double value = (double)mantissa / powersOfTen[fraction];
+			_Value = negative ? -value : value;
+			return true;
+		}
+
+		// exponents, long mantissas, inf/nan and hex: let the C library deal with it
+		char buffer[32];
+		size_t length = end - numberStart;
+		if( length >= sizeof(buffer) ) length = sizeof(buffer) - 1;
+		memcpy( buffer, numberStart, length );
+		buffer[length] = '\0';
+		double value;
+		if( sscanf(buffer,"%lf",&value) != 1 ) return false;
+		_Value = value;
+		return true;
+	}
+
 	bool PDBAtomLine::loadLine(const std::string& _Line)
+	{
+		return loadLine( _Line.c_str(), _Line.size() );
+	}
+
+	bool PDBAtomLine::loadLine(const char* _Line, size_t _Length)
 	{
 		bool error = false;
-		std::string line = _Line;
-		line.resize(80,' ');
+
+		// the line is treated as exactly 80 columns: truncated or padded with spaces
+		char line[81];
+		size_t length = _Length < 80 ? _Length : 80;
+		memcpy( line, _Line, length );
+		memset( line + length, ' ', 80 - length );
+		line[80] = '\0';
 
 		// Reinitialise the structure.
 		init();
 
 		// Line Type check
-		if( 0 == line.compare( 0,6,"ATOM  " ) ) 
+		if( 0 == memcmp( line, "ATOM  ", 6 ) ) 
 		{
 			lineType = ATOM;
 		}
-		else if( 0 == line.compare( 0,6,"HETATM" ) ) 
+		else if( 0 == memcmp( line, "HETATM", 6 ) ) 
 		{
 			lineType = HETATM;
 		}
-		else if( 0 == line.compare( 0,6,"TER   " ) ) 
+		else if( 0 == memcmp( line, "TER   ", 6 ) ) 
 		{
 			lineType = TER;
 			// These calls may fail, it doesnt matter, only 'TER' is important for parsing...
-			str2int( line.substr(6,5), atomNum );
-			resName = line.substr(17,3);
+			parseFixedInt( line + 6, 5, atomNum );
+			resName.assign( line + 17, 3 );
 			chainID = line[21];
-			str2int( line.substr(22,4), resNum ); 
+			parseFixedInt( line + 22, 4, resNum ); 
 			iCode = line[26];
 			return true;
 		}
@@ -239,21 +354,21 @@ namespace IO
 			return false; // Not an atom record type!
 		}
 
-		if( 0 != str2int( line.substr(6,5), atomNum ) ) error = true;
-		atomName = trim(line.substr(12,4));
+		if( !parseFixedInt( line + 6, 5, atomNum ) ) error = true;
+		atomName = trimmedField( line + 12, 4 );
 		altLoc = line[16];
-		resName = trim(line.substr(17,3));
+		resName = trimmedField( line + 17, 3 );
 		chainID = line[21];
-		if( 0 != str2int( line.substr(22,4), resNum ) ) error = true;
+		if( !parseFixedInt( line + 22, 4, resNum ) ) error = true;
 		iCode = line[26];
-		if( 0 != str2double( line.substr(30,8), x ) ) error = true;
-		if( 0 != str2double( line.substr(38,8), y ) ) error = true;
-		if( 0 != str2double( line.substr(46,8), z ) ) error = true;
-		if( 0 != str2double( line.substr(54,6), occupancy ) ) error = true;
-		if( 0 != str2double( line.substr(60,6), TempFactor ) ) error = true;
-		segID = line.substr(72,4);
-		element = line.substr(76,2);
-		charge = line.substr(78,2);
+		if( !parseFixedDouble( line + 30, 8, x ) ) error = true;
+		if( !parseFixedDouble( line + 38, 8, y ) ) error = true;
+		if( !parseFixedDouble( line + 46, 8, z ) ) error = true;
+		if( !parseFixedDouble( line + 54, 6, occupancy ) ) error = true;
+		if( !parseFixedDouble( line + 60, 6, TempFactor ) ) error = true;
+		segID.assign( line + 72, 4 );
+		element.assign( line + 76, 2 );
+		charge.assign( line + 78, 2 );
 
 		return true;
 	}
@@ -832,12 +947,16 @@ namespace IO
 	void PDB_ImportBase::ScanFile( const FileImportBase& _DerivedImporter )
 	{
 		const std::string& _filename = _DerivedImporter.getFileName();
-		printf("Perfoming Initial PDB File Scan of '%s' ...\n", _filename.c_str() );
+		if( getVerbose() ) printf("Perfoming Initial PDB File Scan of '%s' ...\n", _filename.c_str() );
 
 		bool errorCondition = false;
-		std::ifstream file(_filename.c_str(), ifstream::in);
+		if( !IO::fileExists(_filename) ) throw(IOException( "PDB File not found: '" + _filename + "'!" ));
 
-		if( !file.is_open() ) throw(IOException( "PDB File not found: '" + _filename + "'!" ));
+		// The whole file is mapped and walked line by line in place. Atom records are tokenised straight from
+		// the mapping, only the (far fewer) other records are copied into a std::string for their parsers.
+		MappedFile file(_filename);
+		const char* cursor = file.data();
+		const char* fileEnd = cursor + file.size();
 
 		std::string lineType(6,' '); // blank string, **MUST** be 6 in length
 		std::string line;
@@ -854,10 +973,21 @@ namespace IO
 		PDBAtomLine pdbLine;
 		PDB_Model modelMember(*this,_DerivedImporter);
 
-		while(std::getline(file,line))
+		while( cursor < fileEnd )
 		{
-			if( !getLineType(line,lineType) ) 
+			// the same lines std::getline() would give: up to, not including, the '\n'
+			const char* lineStart = cursor;
+			const char* lineEnd = (const char*) memchr( cursor, '\n', fileEnd - cursor );
+			if( lineEnd == NULL ) lineEnd = fileEnd;
+			cursor = lineEnd + 1;
+			size_t lineLength = lineEnd - lineStart;
+
+			if( lineLength < 6 ) 
 				continue; // line not long enough, ignore it!
+			for( size_t k = 0; k < 6; k++ )
+			{
+				lineType[k] = toupper(lineStart[k]);
+			}
 
 			// ---------------------------
 			// System Lines
@@ -867,7 +997,7 @@ namespace IO
 				atomImportStarted = true;
 				if( (int)m_Models.size() < MaxModelImport )
 				{
-					if( !pdbLine.loadLine(line) ) 
+					if( !pdbLine.loadLine(lineStart,lineLength) ) 
 					{
 						std::cout << "Failure parsing 'ATOM  ' line!" << std::endl;
 						errorCondition = true;
@@ -877,13 +1007,14 @@ namespace IO
 						modelMember.appendLine(pdbLine);
 					}
 				}
+				continue;
 			}
 			else if(0==lineType.compare("HETATM"))
 			{
 				atomImportStarted = true;
 				if( (int)m_Models.size() < MaxModelImport )
 				{
-					if( !pdbLine.loadLine(line) ) 
+					if( !pdbLine.loadLine(lineStart,lineLength) ) 
 					{
 						std::cout << "Failure parsing 'HETATM' line!" << std::endl;
 						errorCondition = true;
@@ -893,13 +1024,14 @@ namespace IO
 						modelMember.appendLine(pdbLine);
 					}
 				}
+				continue;
 			}
 			else if(0==lineType.compare("TER   "))
 			{
 				atomImportStarted = true;
 				if( (int)m_Models.size() < MaxModelImport )
 				{
-					if( !pdbLine.loadLine(line) ) 
+					if( !pdbLine.loadLine(lineStart,lineLength) ) 
 					{
 						std::cout << "Failure parsing 'TER   ' line!" << std::endl;
 						errorCondition = true;
@@ -909,8 +1041,13 @@ namespace IO
 						modelMember.appendLine(pdbLine);
 					}
 				}
+				continue;
 			}
-			else if(0==lineType.compare("MODEL "))
+
+			// all other records are handed to their parsers as a std::string
+			line.assign(lineStart,lineLength);
+
+			if(0==lineType.compare("MODEL "))
 			{
 				if( atomImportStarted && modelCount == 0 ) throw(ParseException("\nNew \"MODEL \" statements are not allowed following the import of the first atom of the PDB!\n"));
 				if( !expectingModelStatement ) throw(ParseException("\nUnexpected \"MODEL \" statement!\n"));
@@ -1070,7 +1207,7 @@ namespace IO
 		// Data Verification and Summary Phase ...
 		// -----------------------------------------
 
-		printf(" Done!\n\n");
+		if( getVerbose() ) printf(" Done!\n\n");
 
 		// print the header if we like ...
 		if( getVerbose() && m_PDBHeader.size() > 0 ) 
@@ -1086,6 +1223,8 @@ namespace IO
 			printf("----------------------------\n\n");
 		}
 
+		if( !getVerbose() ) return;
+
 		printf("PDB FileScan Summary:\n\t" );
 		printExpdata();// print the extracted exprimental resolution method
 		if( m_Resolution != NULL_RESLN )
@@ -1110,7 +1249,6 @@ namespace IO
 		printf("\t%d Modified Residue statements\n",m_MODRES.getCount());
 		printf("\t%d Uninterpreted lines\n\n",m_UnrecognisedLines);
 
-		file.close();
 		return;
 	}
 
@@ -1292,7 +1430,7 @@ namespace IO
 				{
 					char printChain = chains[i];
 					if( printChain == ' ' ) printChain = '_';
-					printf("Loading from chain '%c'\n",printChain);
+					if( PDB_ImportBase::getVerbose() ) printf("Loading from chain '%c'\n",printChain);
 					baseLoad(m_Models[modelIndex],chains[i]);
 				}
 			}
@@ -1307,7 +1445,7 @@ namespace IO
 			}
 			char printChain = chainID;
 			if( printChain == ' ' ) printChain = '_';
-			printf("Loading from chain '%c'\n",printChain);
+			if( PDB_ImportBase::getVerbose() ) printf("Loading from chain '%c'\n",printChain);
 			baseLoad(m_Models[modelIndex],chainID);
 		}
 	}
@@ -1364,6 +1502,118 @@ namespace IO
 
 
 
+	// -----------------------------------------------
+	// PDB_BatchIn
+	// -----------------------------------------------
+
+	PDB_BatchIn::PDB_BatchIn(const FFParamSet &_ffps )
+		: m_FFPS(&_ffps),
+		m_Verbose(Verbosity::Normal)
+	{
+	}
+
+	void PDB_BatchIn::addFile( const std::string& _filename )
+	{
+		m_Filenames.push_back(_filename);
+		m_Files.push_back(counted_ptr<PDB_In>());
+		m_Errors.push_back("");
+		m_Loaded.push_back(0);
+	}
+
+	void PDB_BatchIn::addFiles( const std::vector<std::string>& _filenames )
+	{
+		for( size_t i = 0; i < _filenames.size(); i++ )
+		{
+			addFile(_filenames[i]);
+		}
+	}
+
+	void PDB_BatchIn::clear()
+	{
+		m_Filenames.clear();
+		m_Files.clear();
+		m_Errors.clear();
+		m_Loaded.clear();
+	}
+
+	size_t PDB_BatchIn::load()
+	{
+		// The naming singleton is lazily constructed; do that here rather than racing for it inside the loop
+		Library::NamingConventions::getSingleton();
+
+		const int nFiles = (int)m_Filenames.size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic,1)
+#endif
+		for( int i = 0; i < nFiles; i++ )
+		{
+			m_Loaded[i] = 0;
+			m_Errors[i] = "";
+			try
+			{
+				counted_ptr<PDB_In> file( new PDB_In(*m_FFPS, m_Filenames[i]) );
+				file->setVerbosity(m_Verbose);
+				file->load();
+				m_Files[i] = file;
+				m_Loaded[i] = 1;
+			}
+			catch( const ExceptionBase &ex )
+			{
+				m_Files[i] = counted_ptr<PDB_In>();
+				m_Errors[i] = ex.getMessage();
+			}
+			catch( ... )
+			{
+				// nothing else may leave the parallel loop either (e.g. std::bad_alloc)
+				m_Files[i] = counted_ptr<PDB_In>();
+				m_Errors[i] = "Unknown exception while loading the file";
+			}
+		}
+
+		size_t loaded = 0;
+		for( int i = 0; i < nFiles; i++ )
+		{
+			if( m_Loaded[i] ) 
+			{
+				loaded++;
+			}
+			else if( m_Verbose )
+			{
+				printf("PDB_BatchIn: '%s' failed to load: %s\n", m_Filenames[i].c_str(), m_Errors[i].c_str() );
+			}
+		}
+		return loaded;
+	}
+
+	bool PDB_BatchIn::isLoaded( size_t _index ) const
+	{
+		ASSERT( _index < m_Filenames.size(), OutOfRangeException, "PDB_BatchIn::isLoaded() index out of range");
+		return m_Loaded[_index] != 0;
+	}
+
+	const std::string& PDB_BatchIn::getFilename( size_t _index ) const
+	{
+		ASSERT( _index < m_Filenames.size(), OutOfRangeException, "PDB_BatchIn::getFilename() index out of range");
+		return m_Filenames[_index];
+	}
+
+	const std::string& PDB_BatchIn::getError( size_t _index ) const
+	{
+		ASSERT( _index < m_Filenames.size(), OutOfRangeException, "PDB_BatchIn::getError() index out of range");
+		return m_Errors[_index];
+	}
+
+	PDB_In& PDB_BatchIn::getFile( size_t _index )
+	{
+		if( !isLoaded(_index) )
+		{
+			StringBuilder sb;
+			sb.setFormat("PDB_BatchIn::getFile(): '%s' was not loaded: %s")(m_Filenames[_index])(m_Errors[_index]);
+			throw ProcedureException(sb.toString());
+		}
+		return *m_Files[_index];
+	}
+
 	// -----------------------------------------------
 	// PDB_RawWriter
 	// -----------------------------------------------
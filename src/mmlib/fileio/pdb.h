@@ -9,6 +9,7 @@
 #include "library/residues.h"     // required as it provides a member variable
 #include "sequence/sequence.h"   // required as it provides a member variable
 #include "tools/streamwriter.h"
+#include "tools/counted_ptr.h"
 #include "fileio/outtra.h"       // required as it provides a base class
 #include "fileio/infile.h"       // required as it provides a base class
 #include "workspace/workspace.h" // required as it provides a base class
@@ -127,6 +128,12 @@ class File_Molecule;
 
 		// Per instance variable holders - saving the previous state of the parseLine() function call
 		void resetStatics(); ///< Reset the member state-variables to their original states for parsing
+		StringBuilder m_LineParser;
+		StringBuilder m_ResNameBuilder;
+		int m_SerNum;
+		char m_ChainID;
+		int m_FoundResCount;
+		int m_TotalResCount;
 	};
 
 
@@ -194,6 +201,7 @@ class File_Molecule;
 
 		bool loadAtom(const Particle &atom, int atomIndex);
 		bool loadLine(const std::string& _Line);
+		bool loadLine(const char* _Line, size_t _Length); ///< Parses the fixed columns in place, _Line need not be terminated
 		void saveLine(std::ostream &_file) const;
 	};
 
@@ -608,6 +616,51 @@ class File_Molecule;
 
 
 
+//-------------------------------------------------
+//
+/// \brief  
+/// Imports a whole batch of PDB files, one PDB_In per file, in parallel.
+///
+/// \details Each file is scanned and loaded on its own thread (OpenMP, when available). Parsing state
+/// is held per PDB_In instance, so files never share any mutable state. A file that fails to import
+/// does not abort the batch; its error message is retained and isLoaded() returns false.
+///
+///    PDB_BatchIn batch(ffps);
+///    batch.addFile("a.pdb"); batch.addFile("b.pdb");
+///    batch.load();
+///    for( size_t i = 0; i < batch.size(); i++ )
+///        if( batch.isLoaded(i) ) sys.add( batch.getFile(i) );
+///
+	class PD_API PDB_BatchIn
+	{
+	public:
+		PDB_BatchIn(const FFParamSet &_ffps);
+
+		void addFile( const std::string& _filename );
+		void addFiles( const std::vector<std::string>& _filenames );
+		void clear();
+
+		void setVerbosity( Verbosity::Type _BeVerbose ) { m_Verbose = _BeVerbose; }
+
+		size_t load(); ///< Loads the first model of every file, returns the number of files that loaded successfully
+
+		size_t size() const { return m_Filenames.size(); }
+		bool isLoaded( size_t _index ) const;
+		const std::string& getFilename( size_t _index ) const;
+		const std::string& getError( size_t _index ) const; ///< Empty unless the import of that file threw
+		PDB_In& getFile( size_t _index ); ///< Throws unless isLoaded(_index)
+
+	private:
+		const FFParamSet* m_FFPS;
+		Verbosity::Type m_Verbose;
+		std::vector<std::string> m_Filenames;
+		std::vector< counted_ptr<PDB_In> > m_Files;
+		std::vector<std::string> m_Errors;
+		std::vector<int> m_Loaded; // not std::vector<bool>, elements are written concurrently
+	};
+
+
+
 
 
 
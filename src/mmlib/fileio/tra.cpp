@@ -7,6 +7,9 @@
 #include "sequence/sequence.h"
 #include "fileio/pdb.h"
 #include "workspace/workspace.h"
+#include "maths/rmsbatch.h"
+
+#include <sstream>
 
 // Namespace Includes
 using namespace std;
@@ -15,7 +18,10 @@ using namespace Maths;
 namespace IO 
 {
 	OutTra_BTF::OutTra_BTF(const std::string &_filestem, WorkSpace& _wspace)
-		: OutputTrajectoryFile(_filestem, _wspace)
+		: OutputTrajectoryFile(_filestem, _wspace),
+		m_AsyncWrite(false),
+		m_MaxQueuedFrames(32),
+		m_Compress(false)
 	{
 		filename = _filestem + std::string(".tra");
 	}
@@ -58,6 +64,7 @@ namespace IO
 			}
 
 			// write Header
+			if( m_Compress ) _includes = (BFT_StandardIncludes)(_includes | CompressedPositions);
 			m_Header.save(traFile,&getWSpace(),_includes,additionalHeaderSize,additionalBlockSize);
 
 			// write System Definitions
@@ -85,9 +92,82 @@ namespace IO
 
 		if( traFile.is_open() ) traFile.close(); // release the file handle!
 		created = true; // flag this member in the base class PD_API to signal all is well
+
+		if( m_AsyncWrite )
+		{
+			m_Writer = counted_ptr<AsyncFileWriter>( new AsyncFileWriter( filename, m_MaxQueuedFrames ) );
+		}
 		return 0;
 	}
 
+	void OutTra_BTF::packFrame( std::string& _Frame )
+	{
+		std::ostringstream frame( ios::out | ios::binary );
+		frame.write("TRAE",4);
+
+		std::vector<float> buffer( 3 * m_Header.atoms );
+		for(int i = 0; i < m_Header.atoms; i++)
+		{
+			buffer[3*i]   = (float)getWSpace().cur.atom[i].p.x;
+			buffer[3*i+1] = (float)getWSpace().cur.atom[i].p.y;
+			buffer[3*i+2] = (float)getWSpace().cur.atom[i].p.z;
+		}
+		if( m_Compress )
+		{
+			std::string block;
+			m_Compressor.compress( buffer.size() > 0 ? &buffer[0] : NULL, m_Header.atoms, block );
+			int length = 0; // the length of the entry, patched in below
+			frame.write((char*)&length,sizeof(int));
+			frame.write(block.data(),(std::streamsize)block.size());
+		}
+		else if( buffer.size() > 0 ) 
+		{
+			frame.write((char*)&buffer[0],sizeof(float)*buffer.size());
+		}
+
+		if(0 != (m_Header.Type & PhiPsis))
+		{
+			double phi, psi;
+			buffer.resize( 2 * m_Header.residues );
+			for( int i = 0; i < m_Header.residues; i++ )
+			{
+				getWSpace().calcResiduePhiPsi(i,phi,psi);
+				buffer[2*i]   = (float)phi;
+				buffer[2*i+1] = (float)psi;
+			}
+			if( buffer.size() > 0 ) frame.write((char*)&buffer[0],sizeof(float)*buffer.size());
+		}
+		if(0 != (m_Header.Type & Energies))
+		{
+			m_Ene.save(frame,&getWSpace());
+		}
+		if(0 != (m_Header.Type & ForceVectors))
+		{
+			buffer.resize( 3 * m_Header.atoms );
+			for(int i = 0; i < m_Header.atoms; i++)
+			{
+				// 1E9 is a reasonable fudge factor to get a vector magnitude suitable for rendering
+				buffer[3*i]   = (float)(getWSpace().cur.atom[i].p.x + (getWSpace().cur.atom[i].f.x*5E8));
+				buffer[3*i+1] = (float)(getWSpace().cur.atom[i].p.y + (getWSpace().cur.atom[i].f.y*5E8));
+				buffer[3*i+2] = (float)(getWSpace().cur.atom[i].p.z + (getWSpace().cur.atom[i].f.z*5E8));
+			}
+			if( buffer.size() > 0 ) frame.write((char*)&buffer[0],sizeof(float)*buffer.size());
+		}
+
+		// Now also add all the extension blocks to the file
+		for( size_t i = 0; i < m_Blocks.size(); i++ )
+		{
+			m_Blocks[i].appendData( frame );
+		}
+
+		_Frame = frame.str();
+		if( m_Compress )
+		{
+			int length = (int)(_Frame.size() - 4 - sizeof(int)); // everything after the "TRAE" tag and the length itself
+			memcpy(&_Frame[4],&length,sizeof(int));
+		}
+	}
+
 	int OutTra_BTF::append()
 	{
 		if( !created )
@@ -105,6 +185,20 @@ namespace IO
 			THROW(ProcedureException,"OutTra_BTF::append() - wspace and TraHeader residue-counts do not match!");
 		}
 
+		std::string frame;
+		packFrame( frame );
+
+		if( m_AsyncWrite )
+		{
+			if( m_Writer.get() == NULL )
+			{
+				// re-opened after close()
+				m_Writer = counted_ptr<AsyncFileWriter>( new AsyncFileWriter( filename, m_MaxQueuedFrames ) );
+			}
+			m_Writer->write( frame );
+			return 0;
+		}
+
 		// Initiate file writing procedure...
 		ofstream traFile;
 		try
@@ -121,53 +215,7 @@ namespace IO
 			}
 			while( !traFile.is_open() );
 
-			traFile.write("TRAE",4);
-
-			float writeFloat;
-			for(int i = 0; i < m_Header.atoms; i++)
-			{
-				writeFloat = (float)getWSpace().cur.atom[i].p.x;
-				traFile.write((char*)&writeFloat,sizeof(float));
-				writeFloat = (float)getWSpace().cur.atom[i].p.y;
-				traFile.write((char*)&writeFloat,sizeof(float));
-				writeFloat = (float)getWSpace().cur.atom[i].p.z;
-				traFile.write((char*)&writeFloat,sizeof(float));
-			}
-			if(0 != (m_Header.Type & PhiPsis))
-			{
-				double phi, psi;
-				for( int i = 0; i < m_Header.residues; i++ )
-				{
-					getWSpace().calcResiduePhiPsi(i,phi,psi);
-					writeFloat = (float)phi;
-					traFile.write((char*)&writeFloat,sizeof(float));
-					writeFloat = (float)psi;
-					traFile.write((char*)&writeFloat,sizeof(float));
-				}
-			}
-			if(0 != (m_Header.Type & Energies))
-			{
-				m_Ene.save(traFile,&getWSpace());
-			}
-			if(0 != (m_Header.Type & ForceVectors))
-			{
-				for(int i = 0; i < m_Header.atoms; i++)
-				{
-					// 1E9 is a reasonable fudge factor to get a vector magnitude suitable for rendering
-					writeFloat = (float)(getWSpace().cur.atom[i].p.x + (getWSpace().cur.atom[i].f.x*5E8));
-					traFile.write((char*)&writeFloat,sizeof(float));
-					writeFloat = (float)(getWSpace().cur.atom[i].p.y + (getWSpace().cur.atom[i].f.y*5E8));
-					traFile.write((char*)&writeFloat,sizeof(float));
-					writeFloat = (float)(getWSpace().cur.atom[i].p.z + (getWSpace().cur.atom[i].f.z*5E8));
-					traFile.write((char*)&writeFloat,sizeof(float));
-				}
-			}
-
-			// Now also add all the extension blocks to the file
-			for( size_t i = 0; i < m_Blocks.size(); i++ )
-			{
-				m_Blocks[i].appendData( traFile );
-			}
+			traFile.write(frame.data(),(std::streamsize)frame.size());
 		}
 		catch(ExceptionBase ex)
 		{
@@ -179,6 +227,33 @@ namespace IO
 		return 0;
 	}
 
+	void OutTra_BTF::setAsyncWrite( bool _Async, size_t _MaxQueuedFrames )
+	{
+		if( !_Async ) close();
+		m_AsyncWrite = _Async;
+		m_MaxQueuedFrames = _MaxQueuedFrames;
+	}
+
+	void OutTra_BTF::setCompression( bool _Compress, float _Precision )
+	{
+		if( created ) THROW(ProcedureException,"OutTra_BTF::setCompression() cannot be called after the BristolTrajectoryFormat file is created on disk.");
+		m_Compressor.setPrecision( _Precision );
+		m_Compress = _Compress;
+	}
+
+	void OutTra_BTF::flush()
+	{
+		if( m_Writer.get() != NULL ) m_Writer->flush();
+	}
+
+	void OutTra_BTF::close()
+	{
+		if( m_Writer.get() == NULL ) return;
+		counted_ptr<AsyncFileWriter> writer = m_Writer;
+		m_Writer = counted_ptr<AsyncFileWriter>();
+		writer->close();
+	}
+
 	void OutTra_BTF::addBlock( BTF_Block& _Block )
 	{
 		if( created ) THROW(ProcedureException,"OutTra_BTF::addBlock() cannot be called after the BristolTrajectoryFormat file is created on disk.");
@@ -202,6 +277,12 @@ namespace IO
 		reOpen(_fileName,_FullFileValidation);
 	}
 
+	BTF_ImportBase::BTF_ImportBase(const std::string &_fileName)
+		: m_Filename(_fileName), m_Entries(0)
+	{
+		load();
+	}
+
 	void BTF_ImportBase::reOpen( const std::string &_fileName, bool _FullFileValidation)
 	{
 		m_Filename = _fileName;
@@ -305,8 +386,9 @@ namespace IO
 			assertTag(traFile,"SYSTDEFI"); // Internal Sanity check printed in the BristolTrajectoryFormat File
 			traFile.seekg(m_Header.trajectorystart);
 			assertTag(traFile,"TRASTART"); // Internal Sanity check printed in the BristolTrajectoryFormat File
+			// the tags of compressed entries have already been checked by recountEntries() while indexing them
 			long seekPos = (long)m_Header.trajectorystart + 8;
-			for(int i = 0; i < m_Entries; i++)
+			for(int i = 0; !isCompressed() && i < m_Entries; i++)
 			{
 				assertTag(traFile,"TRAE");
 				seekPos += (long)m_Header.blocksize;
@@ -326,6 +408,49 @@ namespace IO
 	int BTF_ImportBase::recountEntries()
 	{
 		long size = IO::getFileSize(m_Filename);
+
+		if( isCompressed() )
+		{
+			// The entries are of variable length, index them by following their length fields
+			ifstream traFile;
+			try
+			{
+				traFile.open(m_Filename.c_str(), ios::in | ios::binary);
+				if( !traFile.is_open() )
+				{
+					THROW(IOException,"'BTF_ImportBase' could not open the file '" + m_Filename + "' for indexing!");
+				}
+
+				m_EntryStart.clear();
+				long pos = (long)m_Header.trajectorystart + 8; // 8 bytes for "TRASTART"
+				while( pos < size )
+				{
+					int length = -1;
+					if( pos + 4 + (long)sizeof(int) <= size )
+					{
+						traFile.seekg(pos);
+						assertTag(traFile,"TRAE");
+						traFile.read((char*)&length,sizeof(int));
+					}
+					if( length < 0 || pos + 4 + (long)sizeof(int) + length > size )
+					{
+						THROW(ParseException,"BristolTrajectoryFormat file_size seems to be corrupted - a 'remainder of bytes' is present.");
+					}
+					m_EntryStart.push_back(pos);
+					pos += 4 + (long)sizeof(int) + length;
+				}
+			}
+			catch( ExceptionBase )
+			{
+				if( traFile.is_open() ) traFile.close();
+				throw; // Close the file handle and re-throw the exception.
+			}
+			if( traFile.is_open() ) traFile.close();
+
+			m_Entries = (int) m_EntryStart.size();
+			return m_Entries;
+		}
+
 		size = (size - (long)m_Header.trajectorystart - 8); // 8 bytes for "TRASTART"
 		if( (size % (long)m_Header.blocksize) != 0 ) THROW(ParseException,"BristolTrajectoryFormat file_size seems to be corrupted - a 'remainder of bytes' is present.");
 		size = size / (long)m_Header.blocksize;
@@ -382,6 +507,14 @@ namespace IO
 
 	void BTF_ImportBase::seekToEntry( std::ifstream &_stream, int _entry )
 	{
+		if( isCompressed() )
+		{
+			if( _entry < 0 || _entry >= (int)m_EntryStart.size() ) THROW(OutOfRangeException,"BTF_ImportBase::seekToEntry() entry is not within range!");
+			_stream.seekg(m_EntryStart[_entry]);
+			assertTag(_stream,"TRAE");
+			_stream.seekg(sizeof(int),ios::cur); // skip the entry length
+			return;
+		}
 		long seekPos = (long)m_Header.trajectorystart + 8 + (m_Header.blocksize * _entry);
 		_stream.seekg(seekPos);
 		assertTag(_stream,"TRAE");
@@ -435,6 +568,49 @@ namespace IO
 
 
 
+	void BTF_ImportBase::readPositions( std::ifstream &_traFile, std::vector<float>& _xyz )
+	{
+		_xyz.resize( 3 * m_Header.atoms );
+		float* dest = _xyz.size() > 0 ? &_xyz[0] : NULL;
+		if( isCompressed() )
+		{
+			BTF_CompressedCoords::decompress( _traFile, dest, m_Header.atoms );
+		}
+		else if( dest != NULL )
+		{
+			_traFile.read((char*)dest,sizeof(float)*_xyz.size());
+		}
+	}
+
+	void BTF_ImportBase::loadPositions( std::ifstream &_traFile, std::vector<Maths::dvector>& _storage, AtomFilter _filter, int _molNum )
+	{
+		std::vector<float> xyz;
+		readPositions( _traFile, xyz );
+
+		if( _molNum < 0 && _filter == All )
+		{
+			_storage.resize(m_Header.atoms);
+			for( int i = 0; i < m_Header.atoms; i++ )
+			{
+				_storage[i].setTo(xyz[3*i],xyz[3*i+1],xyz[3*i+2]);
+			}
+		}
+		else
+		{
+			_storage.clear();
+			for( int i = 0; i < m_Header.atoms; i++ )
+			{
+				if( passesFilter(i,_filter,_molNum) > 0 )
+				{
+					_storage.push_back( Maths::dvector(xyz[3*i],xyz[3*i+1],xyz[3*i+2]) );
+				}
+			}
+		}
+	}
+
+
+
+
 	InTra_BTF::InTra_BTF( const std::string &_fileName, bool _ValidateFile )
 		: BTF_ImportBase(_fileName,_ValidateFile), InputTrajectory_RandomAccess( _fileName )
 	{
@@ -465,7 +641,8 @@ namespace IO
 
 			seekToEntry(traFile,position); // make sure we import the correct frame!
 			Molecule newmolecule(sysspec.ffps()); // make ourselves a molecule to contain the imported system
-			Tvector<float> getpos; // A Temporary holder for float, required as the Particle uses doubles
+			std::vector<float> getpos; // A Temporary holder for floats, required as the Particle uses doubles
+			readPositions(traFile,getpos);
 
 			Sequence::BioSequence seq( sysspec.ffps() );
 			int prevIR = INT_MAX;
@@ -522,9 +699,8 @@ namespace IO
 				// residue number
 				newparticle.ir = sysDefs[i].parentnumber;
 
-				// read from our tra file
-				traFile.read((char*)&getpos,sizeof(float)*3);
-				newparticle.pos().setTo( getpos );
+				// position from our tra file
+				newparticle.pos().setTo( getpos[3*i], getpos[3*i+1], getpos[3*i+2] );
 
 				newmolecule.addParticle(newparticle);
 			}
@@ -610,13 +786,12 @@ namespace IO
 			}
 
 			seekToEntry(traFile,position); // make sure we import the correct frame!
-			Tvector<float> getpos; // A Temporary holder for float, required as the Particle uses doubles
+			std::vector<float> getpos; // A Temporary holder for floats, required as the Particle uses doubles
+			readPositions(traFile,getpos);
 			for( int i = 0; i < m_Header.atoms; i++ )
 			{
-				// read from our tra file
-				traFile.read((char*)&getpos,sizeof(float)*3);
 				SnapShotAtom& atom = ss.atom[i];
-				atom.p.setTo( getpos );
+				atom.p.setTo( getpos[3*i], getpos[3*i+1], getpos[3*i+2] );
 				atom.f.zero();
 				atom.v.zero();
 			}
@@ -634,6 +809,153 @@ namespace IO
 	}
 
 
+	InTra_BTF_Mapped::InTra_BTF_Mapped( const std::string &_fileName, bool _ValidateFile )
+		: BTF_ImportBase(_fileName), InputTrajectory_RandomAccess( _fileName ),
+		m_Validate(_ValidateFile)
+	{
+		// BTF_ImportBase only loads the header, buildIndex() counts the entries and checks their tags
+		remap();
+		reset();
+	}
+
+	void InTra_BTF_Mapped::remap()
+	{
+		m_Map = counted_ptr<IO::MappedFile>( new IO::MappedFile( m_Filename ) );
+		buildIndex();
+	}
+
+	void InTra_BTF_Mapped::buildIndex()
+	{
+		const char *data = m_Map->data();
+		const size_t filesize = m_Map->size();
+		const size_t start = (size_t)m_Header.trajectorystart;
+		const size_t blocksize = (size_t)m_Header.blocksize;
+		const size_t framebytes = 4 + sizeof(float) * 3 * m_Header.atoms; // "TRAE" + coordinates
+
+		if( (start + 8 > filesize) || (0 != memcmp( data + start, "TRASTART", 8 )) )
+		{
+			THROW(ParseException,"InTra_BTF_Mapped: Tag verification failed, 'TRASTART' not found in '" + m_Filename + "'");
+		}
+		if( m_Header.isCompressed() )
+		{
+			// variable length entries: "TRAE", the length of the rest of the entry, then the compressed coordinates
+			m_EntryOffset.clear();
+			size_t offset = start + 8;
+			while( offset < filesize )
+			{
+				int length = -1;
+				if( offset + 4 + sizeof(int) <= filesize )
+				{
+					if( m_Validate && (0 != memcmp( data + offset, "TRAE", 4 )) )
+					{
+						THROW(ParseException,"InTra_BTF_Mapped: Tag verification failed, 'TRAE' not found for entry " + int2str(m_EntryOffset.size()) );
+					}
+					memcpy( &length, data + offset + 4, sizeof(int) );
+				}
+				if( length < 0 || offset + 4 + sizeof(int) + (size_t)length > filesize )
+				{
+					THROW(ParseException,"BristolTrajectoryFormat file_size seems to be corrupted - a 'remainder of bytes' is present.");
+				}
+				m_EntryOffset.push_back( offset + 4 + sizeof(int) );
+				offset += 4 + sizeof(int) + (size_t)length;
+			}
+			m_Entries = (int) m_EntryOffset.size();
+			return;
+		}
+		if( blocksize < framebytes )
+		{
+			THROW(ParseException,"InTra_BTF_Mapped: BristolTrajectoryFormat blocksize is smaller than the coordinate block");
+		}
+		if( ((filesize - start - 8) % blocksize) != 0 )
+		{
+			THROW(ParseException,"BristolTrajectoryFormat file_size seems to be corrupted - a 'remainder of bytes' is present.");
+		}
+
+		size_t entries = (filesize - start - 8) / blocksize;
+		m_EntryOffset.resize( entries );
+		for( size_t i = 0; i < entries; i++ )
+		{
+			size_t offset = start + 8 + blocksize * i;
+			if( m_Validate && (0 != memcmp( data + offset, "TRAE", 4 )) )
+			{
+				THROW(ParseException,"InTra_BTF_Mapped: Tag verification failed, 'TRAE' not found for entry " + int2str(i) );
+			}
+			m_EntryOffset[i] = offset + 4;
+		}
+		m_Entries = (int) entries;
+	}
+
+	bool InTra_BTF_Mapped::readNext( SnapShot &ss )
+	{
+		if( isEndOfFile() ) return true;
+		readRandomAccess( ss, currentPos++ );
+		return false;
+	}
+
+	bool InTra_BTF_Mapped::skip()
+	{
+		if( isEndOfFile() ) return true;
+		currentPos++;
+		return false;
+	}
+
+	bool InTra_BTF_Mapped::isEndOfFile() const
+	{
+		return currentPos >= nEntries();
+	}
+
+	void InTra_BTF_Mapped::reset()
+	{
+		currentPos = 0;
+	}
+
+	size_t InTra_BTF_Mapped::nEntries() const
+	{
+		return m_EntryOffset.size();
+	}
+
+	BTF_FrameView InTra_BTF_Mapped::getFrame( size_t entry ) const
+	{
+		ASSERT( entry < m_EntryOffset.size(), ArgumentException, "Entry request is outside of tra range");
+		if( m_Header.isCompressed() ) THROW(ProcedureException,"InTra_BTF_Mapped::getFrame() cannot provide a view of compressed positions, use readRandomAccess()");
+		BTF_FrameView view;
+		view.entry = entry;
+		view.atoms = m_Header.atoms;
+		view.pos = (const float*)( m_Map->data() + m_EntryOffset[entry] );
+		return view;
+	}
+
+	void InTra_BTF_Mapped::readRandomAccess( SnapShot &ss, size_t entry )
+	{
+		if( m_Header.isCompressed() )
+		{
+			ASSERT( entry < m_EntryOffset.size(), ArgumentException, "Entry request is outside of tra range");
+			std::vector<float> pos( 3 * m_Header.atoms );
+			const size_t offset = m_EntryOffset[entry];
+			BTF_CompressedCoords::decompress( m_Map->data() + offset, m_Map->size() - offset, pos.size() > 0 ? &pos[0] : NULL, m_Header.atoms );
+			if( ss.nAtoms() != m_Header.atoms ) ss = SnapShot( m_Header.atoms );
+			for( int i = 0; i < m_Header.atoms; i++ )
+			{
+				SnapShotAtom& atom = ss.atom[i];
+				atom.p.setTo( pos[3*i], pos[3*i+1], pos[3*i+2] );
+				atom.f.zero();
+				atom.v.zero();
+			}
+			return;
+		}
+
+		BTF_FrameView view = getFrame( entry );
+		if( ss.nAtoms() != view.atoms ) ss = SnapShot( view.atoms );
+		for( int i = 0; i < view.atoms; i++ )
+		{
+			SnapShotAtom& atom = ss.atom[i];
+			atom.p.setTo( view.pos[3*i], view.pos[3*i+1], view.pos[3*i+2] );
+			atom.f.zero();
+			atom.v.zero();
+		}
+	}
+
+
 	BTF_Tools::BTF_Tools(std::string &_fileName, bool _ValidateFile )
 		: BTF_ImportBase(_fileName,_ValidateFile)
 	{
@@ -675,10 +997,9 @@ namespace IO
 			}
 
 			// Seek to the correct BristolTrajectoryFormat entry
-			traFile.seekg(m_Header.trajectorystart + 8 + m_Header.blocksize);
-			assertTag(traFile,"TRAE");
+			seekToEntry(traFile,_Entry);
 
-			loadVectors( traFile, positions, _filter, _molNum );
+			loadPositions( traFile, positions, _filter, _molNum );
 
 			// skip phis and psis if present
 			if( 0 <= (m_Header.Type & PhiPsis ) )
@@ -714,6 +1035,67 @@ namespace IO
 		if( traFile.is_open() ) traFile.close();
 	}
 
+	void BTF_Tools::loadBatch( Maths::BatchCRMS& _batch, AtomFilter _filter, int _molNum )
+	{
+		recountEntries();
+
+		int atomCount = 0;
+		for( int i = 0; i < m_Header.atoms; i++ )
+		{
+			atomCount += passesFilter(i,_filter,_molNum);
+		}
+		_batch.setAtomCount( atomCount );
+		_batch.reserve( m_Entries );
+
+		ifstream traFile;
+		try
+		{
+			traFile.open(m_Filename.c_str(), ios::in | ios::binary);
+			if( !traFile.is_open() )
+			{
+				THROW(IOException,"'BTF_Tools' could not open the file '" + m_Filename + "' for reading!");
+			}
+
+			std::vector<Maths::dvector> pos;
+			for( int i = 0; i < m_Entries; i++ )
+			{
+				seekToEntry(traFile,i);
+				loadPositions( traFile, pos, _filter, _molNum );
+				_batch.add( pos );
+			}
+		}
+		catch( ExceptionBase )
+		{
+			if( traFile.is_open() ) traFile.close();
+			throw; // Close the file handle and re-throw the exception.
+		}
+
+		// Close the file handle...
+		if( traFile.is_open() ) traFile.close();
+	}
+
+	void BTF_Tools::calcCRMSToEntry( int _RefEntry, std::vector<double>& _cRMS, AtomFilter _filter, int _molNum )
+	{
+		Maths::BatchCRMS batch;
+		loadBatch( batch, _filter, _molNum );
+		if( _RefEntry == -1 )
+		{
+			_RefEntry = m_Entries - 1;
+		}
+		if( _RefEntry < 0 || _RefEntry >= m_Entries )
+		{
+			THROW(ArgumentException,"The calcCRMSToEntry() reference entry is not within range!");
+		}
+		batch.calcCRMSTo( (size_t)_RefEntry, _cRMS );
+	}
+
+	void BTF_Tools::calcCRMSMatrix( std::vector<float>& _condensed, AtomFilter _filter, int _molNum )
+	{
+		Maths::BatchCRMS batch;
+		loadBatch( batch, _filter, _molNum );
+		batch.calcCRMSMatrix( _condensed );
+	}
+
 	void BTF_Tools::savePDBFile( std::string &_FileName, int _Entry )
 	{
 		savePDBFile(_FileName,_Entry,All,-1);
@@ -8,6 +8,8 @@
 #include "outtra.h"
 #include "tratypes.h"
 #include "trablocks.h"
+#include "tools/io.h"
+#include "tools/counted_ptr.h"
 #include "workspace/workspace.fwd.h"
 
 class PD_API System;
@@ -18,6 +20,11 @@ namespace Sequence
 	class PD_API BioSequence;
 }
 
+namespace Maths
+{
+	class PD_API BatchCRMS;
+}
+
 namespace IO 
 {
 	//-------------------------------------------------
@@ -69,12 +76,33 @@ namespace IO
 		virtual int create();
 		virtual int append();
 
+		/// Asynchronous output: the file is kept open and each packed frame is handed to a background
+		/// writer thread (see IO::AsyncFileWriter), so that append() does not wait for the disk.
+		/// At most _MaxQueuedFrames frames are held in memory; these are all that is lost should the
+		/// process die. By default every append() opens, writes and closes the file.
+		void setAsyncWrite( bool _Async, size_t _MaxQueuedFrames = 32 );
+		virtual void flush(); ///< Blocks until every appended frame has been written
+		void close(); ///< Flushes and releases the file, a later append() opens it again
+
+		/// Stores the atom positions lossily compressed to within 0.5/_Precision Angstrom (see BTF_CompressedCoords), 
+		/// typically 3-4 times smaller than the raw floats. Must be set before the file is created.
+		void setCompression( bool _Compress, float _Precision = 100.0f );
+
 		void addOwnedBlock( BTF_Block* _Block ); ///< Add a block that is memory managed by this class
 		void addBlock( BTF_Block& _Block ); ///< Add a block that is memory managed elsewhere
 
 	protected:
+		void packFrame( std::string& _Frame ); ///< Packs the current WorkSpace state into one contiguous trajectory entry
+
 		std::string filename;
 		ObjectContainer<BTF_Block> m_Blocks;
+
+		bool m_AsyncWrite;
+		size_t m_MaxQueuedFrames;
+		counted_ptr<AsyncFileWriter> m_Writer; ///< Open only in asynchronous mode
+
+		bool m_Compress;
+		BTF_CompressedCoords m_Compressor;
 	};
 
 
@@ -119,9 +147,14 @@ namespace IO
 		int getEntryCount() const; // The total number of entries in the file
 		int size() const;
 
+		inline bool isCompressed() const { return m_Header.isCompressed(); } ///< Are the positions stored with CompressedPositions?
+
 		const Sequence::BioSequence& getSequence() const;
 
 	protected:
+		/// Only loads the header and system definitions; the derived class must count (index) the entries itself
+		BTF_ImportBase( const std::string &_fileName );
+
 		// Parsing
 		void assertTag( std::ifstream &_stream, std::string _tag ); // parsing assistance function
 		void load(); // Load the header and system definitions from the binary file.
@@ -130,6 +163,10 @@ namespace IO
 		// that is the same length as that of m_Header.atoms.
 		// This includes the atom positions, the forcevectors, and velocities if these are added later ...
 		void loadVectors( std::ifstream &_traFile, std::vector<Maths::dvector>& _storage, AtomFilter _filter, int _molNum );
+		// loadPositions() is loadVectors() for the atom positions at the start of an entry, which are decompressed if need be.
+		void loadPositions( std::ifstream &_traFile, std::vector<Maths::dvector>& _storage, AtomFilter _filter, int _molNum );
+		// Reads the atom positions of an entry, x,y,z of each atom in turn
+		void readPositions( std::ifstream &_traFile, std::vector<float>& _xyz );
 		int passesFilter( int _Index, AtomFilter _filter, int _molNum );
 
 		void seekToEntry( std::ifstream &_stream, int _entry );
@@ -137,6 +174,9 @@ namespace IO
 		std::string m_Filename;
 		int m_Entries;
 		std::vector<BTF_SystemDefinitionEntry> sysDefs;
+
+		/// The file offset of the "TRAE" tag of each entry, only used for compressed (variable length) entries
+		std::vector<long> m_EntryStart;
 	};
 
 
@@ -190,6 +230,91 @@ namespace IO
 	};
 
 
+	//-------------------------------------------------
+	//
+	/// \brief  Zero-copy view of the coordinates of one entry of a memory mapped BTF file.
+	///
+	/// \details pos points straight into the file mapping and holds 3*atoms floats (x,y,z
+	/// of each atom in turn, in Angstrom). It stays valid as long as the InTra_BTF_Mapped
+	/// (or any of its clones) that handed it out exists.
+	///
+	struct PD_API BTF_FrameView
+	{
+		size_t entry;
+		int atoms;
+		const float *pos;
+
+		Maths::dvector getPosition( int i ) const 
+		{ 
+			return Maths::dvector( pos[3*i], pos[3*i+1], pos[3*i+2] ); 
+		}
+	};
+
+
+	//-------------------------------------------------
+	//
+	/// \brief  Random access reader for BristolTrajectoryFormat files based on a memory mapping
+	///
+	/// \details Behaves like InTra_BTF, but rather than opening and seeking through the file 
+	/// for every entry, the whole file is mapped into memory once (see IO::MappedFile) and 
+	/// the offsets of all entries are indexed (and, if _ValidateFile is set, their "TRAE" 
+	/// tags checked) when it is opened. Entries are then read directly from the mapping, 
+	/// either into a SnapShot via readRandomAccess() or, without any copying, via getFrame().
+	///
+	/// getFrame(), readRandomAccess() and nEntries() only read shared, immutable state, so 
+	/// several threads may call them on the same object at the same time. Clones share the
+	/// mapping rather than re-opening the file, which allows each thread to have its own 
+	/// sequential position (readNext()/skip()/reset()). Clones should be made on one thread.
+	///
+	/// Entries appended to the file after it was opened are only seen after remap().
+	///
+	class PD_API InTra_BTF_Mapped: public BTF_ImportBase, public InputTrajectory_RandomAccess
+	{
+	public:
+		InTra_BTF_Mapped( const std::string &_fileName, bool _ValidateFile = true);
+		virtual InTra_BTF_Mapped* clone() const { return new InTra_BTF_Mapped(*this); }
+
+		/// \brief Reads a structure and returns a SnapShot with the coordinates (and the box geometry)
+		/// \return Returns true if end of file was reached during read, false otherwise.
+		virtual bool readNext( SnapShot &ss );
+
+		/// \brief Skips an entry in the file 
+		/// \return Returns true if end of file was reached during read, false otherwise.
+		virtual bool skip();
+
+		/// \brief Returns true if file handle has reached end of file. 
+		virtual bool isEndOfFile() const;
+
+		/// \brief Go back to the start of the tra
+		virtual void reset();
+
+		virtual void readRandomAccess( SnapShot &ss, size_t entry );
+
+		/// \brief Returns the number of entries indexed when the file was (re)mapped
+		virtual size_t nEntries() const;
+
+		/// Returns a view of the coordinates of an entry without copying them.
+		/// Not available for compressed files, which can only be read via readRandomAccess().
+		BTF_FrameView getFrame( size_t entry ) const;
+
+		/// Maps the file again and indexes any entries added since it was opened
+		void remap();
+
+	protected:
+		void buildIndex();
+
+		counted_ptr<IO::MappedFile> m_Map;
+
+		/// offset of the coordinates (or of the compressed coordinate block) of each entry from the start of the file
+		std::vector<size_t> m_EntryOffset;
+
+		/// check the tag of every entry while indexing (this touches one page per entry)
+		bool m_Validate;
+
+		size_t currentPos;
+	};
+
+
 	//-------------------------------------------------
 	//
 	/// \brief A class to allow analysis of a BristolTrajectoryFormat file in the absence of the FFPS or FF classes - e.g. geometry analysis and distance calculations
@@ -218,7 +343,16 @@ namespace IO
 		void savePDBFile( std::string &_FileName, int _Entry, AtomFilter _filter );
 		void savePDBFile( std::string &_FileName, int _Entry, AtomFilter _filter, int _molNum );
 
+		/// The cRMS of every entry in the file to entry _RefEntry (-1 is the last entry) over the filtered atoms
+		void calcCRMSToEntry( int _RefEntry, std::vector<double>& _cRMS, AtomFilter _filter = CA, int _molNum = -1 );
+		/// The cRMS between all pairs of entries over the filtered atoms. Only the upper triangle (i < j) is 
+		/// returned, row by row: element (i,j) of N entries is at i*(2N-i-1)/2 + (j-i-1).
+		void calcCRMSMatrix( std::vector<float>& _condensed, AtomFilter _filter = CA, int _molNum = -1 );
+
 	protected:
+		/// Centres every entry of the file into _batch, reading the file only once
+		void loadBatch( Maths::BatchCRMS& _batch, AtomFilter _filter, int _molNum );
+
 		std::vector<Maths::dvector> positions;
 		std::vector<Maths::dvector> forces;
 		BTF_Energy ene;
@@ -36,7 +36,7 @@ namespace IO
 		_traFile.write((char*)&m_TraCapacity,sizeof(int));
 	}
 
-	void BTF_Block_Comment::appendData( std::ofstream &_traFile )
+	void BTF_Block_Comment::appendData( std::ostream &_traFile )
 	{
 		setBufferAt(size(),'\0'); // force a zero termination of the internal buffer, StringBuilder does NOT do this itself internally unless toString is called
 		_traFile.write(buffer(),(std::streamsize)m_TraCapacity); // The buffer has been ensured to be the correct minimum size in the constructor - it can't shrink
@@ -102,7 +102,7 @@ namespace IO
 		m_CurrentVectorIndex = 0; // reset this;
 	}
 
-	void BTF_Block_Vector::appendData( std::ofstream &_traFile )
+	void BTF_Block_Vector::appendData( std::ostream &_traFile )
 	{
 		// write the current data
 		_traFile.write((char*)&m_Vectors[0],sizeof(DrawingVector)*m_VectorCount);
@@ -139,5 +139,221 @@ namespace IO
 	// ---------------------------------------------------------
 	// BTF_Block_Vector: End class defintion
 	// ---------------------------------------------------------
+
+
+
+	// ---------------------------------------------------------
+	// BTF_CompressedCoords: Begin class defintion
+	// ---------------------------------------------------------
+
+	namespace
+	{
+		const int CompressedGroupSize = 16; // atoms per bit-packed group
+		const double CompressedMaxQuantised = 536870912.0; // 2^29, keeps every zig-zag coded difference within 31 bits
+
+		inline unsigned int zigZag( int _Value )
+		{
+			return ((unsigned int)_Value << 1) ^ (unsigned int)(_Value >> 31);
+		}
+
+		inline int unZigZag( unsigned int _Value )
+		{
+			return (int)(_Value >> 1) ^ -(int)(_Value & 1);
+		}
+
+		inline int bitWidth( unsigned int _Value )
+		{
+			int width = 0;
+			while( _Value != 0 )
+			{
+				width++;
+				_Value >>= 1;
+			}
+			return width;
+		}
+
+		/// Little-endian bit packing into a string, at most 32 bits per call
+		class BitWriter
+		{
+		public:
+			BitWriter( std::string& _Dest ) : m_Dest(_Dest), m_Acc(0), m_NBits(0) {}
+
+			inline void put( unsigned int _Value, int _Bits )
+			{
+				m_Acc |= (unsigned long long)_Value << m_NBits;
+				m_NBits += _Bits;
+				while( m_NBits >= 8 )
+				{
+					m_Dest.push_back( (char)(m_Acc & 0xFF) );
+					m_Acc >>= 8;
+					m_NBits -= 8;
+				}
+			}
+
+			inline void finish()
+			{
+				if( m_NBits > 0 ) m_Dest.push_back( (char)(m_Acc & 0xFF) );
+				m_Acc = 0;
+				m_NBits = 0;
+			}
+
+		private:
+			std::string& m_Dest;
+			unsigned long long m_Acc;
+			int m_NBits;
+		};
+
+		class BitReader
+		{
+		public:
+			BitReader( const unsigned char* _Src, const unsigned char* _End ) : m_Src(_Src), m_End(_End), m_Acc(0), m_NBits(0) {}
+
+			inline unsigned int get( int _Bits )
+			{
+				while( m_NBits < _Bits )
+				{
+					if( m_Src == m_End ) THROW(ParseException,"BTF_CompressedCoords: the compressed coordinate block is truncated");
+					m_Acc |= (unsigned long long)(*m_Src++) << m_NBits;
+					m_NBits += 8;
+				}
+				unsigned int value = (unsigned int)(m_Acc & ((1ULL << _Bits) - 1));
+				m_Acc >>= _Bits;
+				m_NBits -= _Bits;
+				return value;
+			}
+
+		private:
+			const unsigned char* m_Src;
+			const unsigned char* m_End;
+			unsigned long long m_Acc;
+			int m_NBits;
+		};
+	}
+
+	BTF_CompressedCoords::BTF_CompressedCoords( float _Precision )
+	{
+		setPrecision( _Precision );
+	}
+
+	void BTF_CompressedCoords::setPrecision( float _Precision )
+	{
+		if( !(_Precision > 0.0f) ) THROW(ArgumentException,"BTF_CompressedCoords: the precision must be greater than zero");
+		m_Precision = _Precision;
+	}
+
+	void BTF_CompressedCoords::compress( const float* _xyz, int _nAtoms, std::string& _Dest )
+	{
+		m_Quantised.resize( 3 * _nAtoms );
+		for( int i = 0; i < 3 * _nAtoms; i++ )
+		{
+			double q = floor( (double)_xyz[i] * m_Precision + 0.5 );
+			if( !(fabs(q) < CompressedMaxQuantised) ) // also catches NaN
+			{
+				THROW(ArgumentException,"BTF_CompressedCoords: a coordinate is too large to be stored at the requested precision");
+			}
+			m_Quantised[i] = (int)q;
+		}
+
+		size_t start = _Dest.size();
+		int size = 0; // patched below
+		_Dest.append( (const char*)&size, sizeof(int) );
+		_Dest.append( (const char*)&m_Precision, sizeof(float) );
+		if( _nAtoms > 0 ) _Dest.append( (const char*)&m_Quantised[0], 3 * sizeof(int) );
+
+		BitWriter bits( _Dest );
+		unsigned int delta[3 * CompressedGroupSize];
+		for( int first = 1; first < _nAtoms; first += CompressedGroupSize )
+		{
+			int count = std::min( CompressedGroupSize, _nAtoms - first );
+			int width[3] = { 0, 0, 0 };
+			for( int i = 0; i < count; i++ )
+			{
+				const int* cur = &m_Quantised[3 * (first + i)];
+				for( int d = 0; d < 3; d++ )
+				{
+					delta[3*i+d] = zigZag( cur[d] - cur[d-3] );
+					width[d] = std::max( width[d], bitWidth(delta[3*i+d]) );
+				}
+			}
+			for( int d = 0; d < 3; d++ )
+			{
+				bits.put( (unsigned int)width[d], 5 );
+			}
+			for( int i = 0; i < count; i++ )
+			{
+				for( int d = 0; d < 3; d++ )
+				{
+					bits.put( delta[3*i+d], width[d] );
+				}
+			}
+		}
+		bits.finish();
+
+		size = (int)(_Dest.size() - start - sizeof(int));
+		memcpy( &_Dest[start], &size, sizeof(int) );
+	}
+
+	size_t BTF_CompressedCoords::decompress( const char* _Src, size_t _Size, float* _xyz, int _nAtoms )
+	{
+		const size_t fixed = sizeof(int) + sizeof(float) + (_nAtoms > 0 ? 3 * sizeof(int) : 0);
+		int size = 0;
+		if( _Size >= sizeof(int) ) memcpy( &size, _Src, sizeof(int) );
+		if( _Size < fixed || size < 0 || (size_t)size + sizeof(int) > _Size || (size_t)size + sizeof(int) < fixed )
+		{
+			THROW(ParseException,"BTF_CompressedCoords: the compressed coordinate block is truncated");
+		}
+
+		float precision;
+		memcpy( &precision, _Src + sizeof(int), sizeof(float) );
+		if( !(precision > 0.0f) ) THROW(ParseException,"BTF_CompressedCoords: invalid precision in the compressed coordinate block");
+		const double scale = 1.0 / precision;
+
+		if( _nAtoms > 0 )
+		{
+			int q[3];
+			memcpy( q, _Src + sizeof(int) + sizeof(float), 3 * sizeof(int) );
+			BitReader bits( (const unsigned char*)_Src + fixed, (const unsigned char*)_Src + sizeof(int) + size );
+
+			for( int d = 0; d < 3; d++ ) _xyz[d] = (float)(q[d] * scale);
+			for( int first = 1; first < _nAtoms; first += CompressedGroupSize )
+			{
+				int count = std::min( CompressedGroupSize, _nAtoms - first );
+				int width[3];
+				for( int d = 0; d < 3; d++ )
+				{
+					width[d] = (int)bits.get( 5 );
+				}
+				for( int i = 0; i < count; i++ )
+				{
+					float* pos = &_xyz[3 * (first + i)];
+					for( int d = 0; d < 3; d++ )
+					{
+						q[d] += unZigZag( bits.get( width[d] ) );
+						pos[d] = (float)(q[d] * scale);
+					}
+				}
+			}
+		}
+
+		return sizeof(int) + size;
+	}
+
+	void BTF_CompressedCoords::decompress( std::istream& _Src, float* _xyz, int _nAtoms )
+	{
+		int size = 0;
+		_Src.read( (char*)&size, sizeof(int) );
+		if( _Src.gcount() != sizeof(int) || size < 0 ) THROW(ParseException,"BTF_CompressedCoords: could not read the compressed coordinate block");
+
+		std::vector<char> block( sizeof(int) + size );
+		memcpy( &block[0], &size, sizeof(int) );
+		_Src.read( &block[sizeof(int)], size );
+		if( _Src.gcount() != size ) THROW(ParseException,"BTF_CompressedCoords: the compressed coordinate block is truncated");
+
+		decompress( &block[0], block.size(), _xyz, _nAtoms );
+	}
+
+	// ---------------------------------------------------------
+	// BTF_CompressedCoords: End class defintion
+	// ---------------------------------------------------------
 }
 
@@ -35,7 +35,7 @@ namespace IO
 
 	protected:
 		virtual void appendHeader( std::ofstream &_traFile ) const = 0; // pure virtual function uses = 0 ...
-		virtual void appendData( std::ofstream &_traFile ) = 0;
+		virtual void appendData( std::ostream &_traFile ) = 0;
 		virtual int getHeaderSize() const = 0;
 		virtual int getBlockSize() const = 0;
 	};
@@ -57,7 +57,7 @@ namespace IO
 
 	protected:
 		virtual void appendHeader( std::ofstream &_traFile ) const;
-		virtual void appendData( std::ofstream &_traFile );
+		virtual void appendData( std::ostream &_traFile );
 		virtual int getHeaderSize() const;
 		virtual int getBlockSize() const;
 
@@ -90,7 +90,7 @@ namespace IO
 
 	protected:
 		virtual void appendHeader( std::ofstream &_traFile ) const;
-		virtual void appendData( std::ofstream &_traFile );
+		virtual void appendData( std::ostream &_traFile );
 		virtual int getHeaderSize() const;
 		virtual int getBlockSize() const;
 
@@ -101,6 +101,43 @@ namespace IO
 	
 
 
+	/// \brief  Lossy, XTC-style compression of the atom positions of a trajectory entry
+	/// \details Positions are rounded onto a grid of 1/Precision Angstrom (the default of 100, i.e. 0.01A, 
+	/// is the resolution of a default gromacs XTC file) and each atom is stored as its difference from 
+	/// the previous one. Consecutive atoms are mostly bonded, so these differences are small: they are 
+	/// bit-packed in groups of 16 atoms, each group using only as many bits per dimension as its largest 
+	/// difference requires. A coordinate is recovered to within 0.5/Precision Angstrom.
+	///
+	/// A compressed block is laid out as:
+	///   int   - the number of bytes in the rest of the block
+	///   float - the precision
+	///   int   - the quantised x, y and z of the first atom
+	///   the bit-packed groups: three 5-bit widths, then the zig-zag coded differences of up to 16 atoms
+	///
+	/// Used by OutTra_BTF in place of the raw float positions, see OutTra_BTF::setCompression().
+	class PD_API BTF_CompressedCoords
+	{
+	public:
+		BTF_CompressedCoords( float _Precision = 100.0f );
+
+		void setPrecision( float _Precision ); ///< Grid points per Angstrom
+		inline float getPrecision() const { return m_Precision; }
+
+		/// Appends the compressed block of _nAtoms positions (x,y,z of each atom in turn) to _Dest
+		void compress( const float* _xyz, int _nAtoms, std::string& _Dest );
+
+		/// Decodes the block at _Src, of which _Size bytes are available, into _xyz. 
+		/// Returns the number of bytes that the block occupied.
+		static size_t decompress( const char* _Src, size_t _Size, float* _xyz, int _nAtoms );
+		/// Reads and decodes a block from the current position of _Src
+		static void decompress( std::istream& _Src, float* _xyz, int _nAtoms );
+
+	private:
+		float m_Precision;
+		std::vector<int> m_Quantised;
+	};
+
+
 	//-------------------------------------------------
 	//
 	/// \brief  derive a class PD_API from this to allow easy BristolTrajectoryFormat-Comment support within that class
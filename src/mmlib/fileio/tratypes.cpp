@@ -53,7 +53,7 @@ namespace IO
 	void BTF_Header::load(std::ifstream &_traFile)
 	{
 		_traFile.read((char*)this, sizeof(BTF_Header));
-		if( version != BTF_VERSION )
+		if( version != (isCompressed() ? BTF_VERSION_COMPRESSED : BTF_VERSION) )
 		{
 			THROW(ParseException,"The major version of the Tra_file and code_version do not match!");
 		}
@@ -62,6 +62,7 @@ namespace IO
 	void BTF_Header::save(std::ofstream &_traFile, WorkSpace *_wspace, BFT_StandardIncludes _includeData, int _traStartOffset, int _additionalBlockSize)
 	{
 		Type = (int)(1 | _includeData); // 1 = AtomPos - these will always be defined!
+		version = isCompressed() ? BTF_VERSION_COMPRESSED : BTF_VERSION;
 		atoms = (int)_wspace->atom.size();
 		residues = (int)_wspace->res.size();
 
@@ -187,7 +188,7 @@ namespace IO
 		printf("BTF_Energy::info() is not implemented (waiting for reform of WorkSpace energy storage...)\n");
 	}
 
-	void BTF_Energy::save(std::ofstream &_traFile, WorkSpace* _wspace)
+	void BTF_Energy::save(std::ostream &_traFile, WorkSpace* _wspace)
 	{
 		Step = (float) _wspace->Step;
 		time = (float) _wspace->Step; //1.0E15*(double)_wspace->param.Timestep * (double)_wspace->Step; // in seconds !
@@ -16,6 +16,7 @@ namespace IO
 		// Rotamers = 4, Was here but is now deprecated...
 		Energies = 8,
 		ForceVectors = 16,
+		CompressedPositions = 32, ///< Atom positions are stored lossily compressed (see BTF_CompressedCoords), entries are then of variable length
 
 		MinimalIncludes = Energies,
 		DefaultIncludes = MinimalIncludes,
@@ -54,8 +55,14 @@ namespace IO
 		/// the internal file-format version
 		static const int BTF_VERSION = 2; 
 
+		/// the file-format version of files with CompressedPositions. Every "TRAE" tag is followed by an int 
+		/// holding the number of bytes in the rest of that entry, as entries are no longer of a constant size.
+		static const int BTF_VERSION_COMPRESSED = 3; 
 
-		///  version - currently 2. Used to tell any program parsing the file which specification version the file adheres to.
+		inline bool isCompressed() const { return 0 != (Type & CompressedPositions); }
+
+
+		///  version - currently 2, or 3 for compressed positions. Used to tell any program parsing the file which specification version the file adheres to.
 		int version; 
 
 		///  flagged Type descriptor
@@ -68,7 +75,7 @@ namespace IO
 		int atoms; 
 
 
-		// Blocksize of a trajectory entry. The size in bytes of the trajectory entry structure defined below. Note that although in the specification for any program that parses the file is a constant size, other padding data may be included by a client program per time step, which may have to be included in this region. The blocksize is therefore required to move to a particular position in the file. The number of steps that are stored in the file is not defined in the header. This can however be calculated from the blocksize and the filesize.
+		// Blocksize of a trajectory entry. The size in bytes of the trajectory entry structure defined below. Note that although in the specification for any program that parses the file is a constant size, other padding data may be included by a client program per time step, which may have to be included in this region. The blocksize is therefore required to move to a particular position in the file. The number of steps that are stored in the file is not defined in the header. This can however be calculated from the blocksize and the filesize. In files with CompressedPositions (version 3) it is the size an entry would have had uncompressed; such files have to be indexed by walking the entry length fields instead.
 		int blocksize;
 
 		///  start of first trajectory entry.  Again, as a client program may want to add custom padding data after the header, this field is required for any parsing program to know where the trajectory entries begin in the file.
@@ -197,7 +204,7 @@ namespace IO
 
 		void info(bool verbose = false);
 		void load(std::ifstream &_traFile);
-		void save(std::ofstream &_traFile, WorkSpace* _wspace );
+		void save(std::ostream &_traFile, WorkSpace* _wspace );
 
 		float Step; // 0
 		float time;
@@ -21,6 +21,10 @@ namespace Physics{
 		if(OutputLevel) printf("\tImpropers... \n");
 		if(assembleImproperList() != 0) throw(ProcedureException("Error occured during setup of Improper List")); 
 
+		// the index of terms per atom is rebuilt by calcMovedAtomEnergy() when needed
+		m_AtomTermStart.clear();
+		m_AtomTerm.clear();
+
 		needsetup = false;
 	}
 
@@ -1591,6 +1595,154 @@ check the forcefield definition files and add the missing parameters!") );
 
 
 
+	// -------------------------------------------------------------------------------
+	// Energies of single bonded terms, identical to the energies calculated by the
+	// force functions above. Used by calcMovedAtomEnergy().
+
+	static double calcBondEnergy( const SnapShotAtom *atom, const Bond &bond )
+	{
+		double d = dist(atom[bond.i].p,atom[bond.j].p);
+		return bond.k * sqr(d - bond.l);
+	}
+
+	static double calcAngleEnergy( const SnapShotAtom *atom, const Angle &angle )
+	{
+		if( angle.k == 0 ) return 0;
+		dvector iv, jv;
+		iv.diff(atom[angle.i].p,atom[angle.a].p);
+		jv.diff(atom[angle.j].p,atom[angle.a].p);
+		double cos_theta = iv.scalarProduct(jv) / (iv.mag() * jv.mag());
+		return angle.k * sqr(acos(cos_theta) - angle.theta0);
+	}
+
+	static double calcDihedralEnergy( const SnapShotAtom *atom, const Torsion &dihedral )
+	{
+		dvector vti_vta, vta_vtb, vtb_vtj;
+		vti_vta.diff(atom[dihedral.i].p,atom[dihedral.a].p);
+		vta_vtb.diff(atom[dihedral.a].p,atom[dihedral.b].p);
+		vtb_vtj.diff(atom[dihedral.b].p,atom[dihedral.j].p);
+
+		dvector nrml1, nrml2, nrml3;
+		nrml1.crossProduct(vti_vta,vta_vtb);
+		nrml2.crossProduct(vta_vtb,vtb_vtj);
+		nrml3.crossProduct(vta_vtb,nrml1);
+
+		double cos_phi = nrml1.scalarProduct(nrml2) / (nrml1.mag() * nrml2.mag());
+		double sin_phi = nrml3.scalarProduct(nrml2) / (nrml3.mag() * nrml2.mag());
+		double phi = -atan2(sin_phi, cos_phi);
+
+		double epot = 0;
+		for(int j = 0; j < dihedral.terms; j++) {
+			double k = dihedral.Vn[j];
+			double n = dihedral.n[j];
+			double gamma = dihedral.gamma[j];
+			if(n > 0) { // sin potential
+				epot += k * (1.0 + cos(n * phi + gamma));
+			} else { // harmonic potential
+				double diff = phi - gamma;
+				if(diff < -Maths::MathConst::PI)
+					diff += 2.0 * Maths::MathConst::PI;
+				else if(diff > Maths::MathConst::PI)
+					diff -= 2.0 * Maths::MathConst::PI;
+				epot += k * sqr(diff);
+			}
+		}
+		return epot;
+	}
+
+	void FF_Bonded::assembleAtomTermIndex()
+	{
+		const int natom = getWSpace().atom.size();
+		std::vector< std::vector<int> > atomterm(natom);
+
+		for(size_t ib = 0; ib < bond.size(); ib++) {
+			int code = (int(ib) << 2) | 0;
+			atomterm[bond[ib].i].push_back(code);
+			atomterm[bond[ib].j].push_back(code);
+		}
+		for(size_t ib = 0; ib < angle.size(); ib++) {
+			int code = (int(ib) << 2) | 1;
+			atomterm[angle[ib].i].push_back(code);
+			atomterm[angle[ib].a].push_back(code);
+			atomterm[angle[ib].j].push_back(code);
+		}
+		for(int type = 2; type <= 3; type++) {
+			const std::vector<Torsion> &dihedral = (type == 2) ? torsion : improper;
+			for(size_t ib = 0; ib < dihedral.size(); ib++) {
+				int code = (int(ib) << 2) | type;
+				atomterm[dihedral[ib].i].push_back(code);
+				atomterm[dihedral[ib].a].push_back(code);
+				atomterm[dihedral[ib].b].push_back(code);
+				atomterm[dihedral[ib].j].push_back(code);
+			}
+		}
+
+		m_AtomTermStart.resize(natom + 1);
+		m_AtomTerm.clear();
+		for(int i = 0; i < natom; i++) {
+			m_AtomTermStart[i] = m_AtomTerm.size();
+			m_AtomTerm.insert(m_AtomTerm.end(), atomterm[i].begin(), atomterm[i].end());
+		}
+		m_AtomTermStart[natom] = m_AtomTerm.size();
+	}
+
+	// Returns true if i is the first moved atom of the term, i.e. the one which accounts for it
+	static inline bool firstMovedAtom( const ParticleStore& atomparam, int i, int n, const int *termatom )
+	{
+		for(int m = 0; m < n; m++) {
+			if( atomparam[termatom[m]].isMoved() ) return termatom[m] == i;
+		}
+		return false;
+	}
+
+	double FF_Bonded::calcMovedAtomEnergy( const std::vector<size_t> &moved )
+	{
+		WorkSpace& wspace = getWSpace();
+		const ParticleStore& atomparam = wspace.atom;
+		const SnapShotAtom *atom = wspace.cur.atom;
+
+		if( (int)m_AtomTermStart.size() != (int)wspace.atom.size() + 1 ) assembleAtomTermIndex();
+
+		double energy = 0;
+		for(size_t k = 0; k < moved.size(); k++)
+		{
+			const int i = moved[k];
+			for(int t = m_AtomTermStart[i]; t < m_AtomTermStart[i+1]; t++)
+			{
+				const int index = m_AtomTerm[t] >> 2;
+				switch( m_AtomTerm[t] & 3 )
+				{
+				case 0:
+					{
+						const Bond &term = bond[index];
+						const int termatom[2] = { term.i, term.j };
+						if( DoBonds && firstMovedAtom( atomparam, i, 2, termatom ) ) 
+							energy += calcBondEnergy( atom, term );
+						break;
+					}
+				case 1:
+					{
+						const Angle &term = angle[index];
+						const int termatom[3] = { term.i, term.a, term.j };
+						if( DoAngles && firstMovedAtom( atomparam, i, 3, termatom ) ) 
+							energy += calcAngleEnergy( atom, term );
+						break;
+					}
+				default:
+					{
+						const bool isTorsion = (m_AtomTerm[t] & 3) == 2;
+						const Torsion &term = isTorsion ? torsion[index] : improper[index];
+						const int termatom[4] = { term.i, term.a, term.b, term.j };
+						if( (isTorsion ? DoTorsions : DoImpropers) && firstMovedAtom( atomparam, i, 4, termatom ) ) 
+							energy += calcDihedralEnergy( atom, term );
+						break;
+					}
+				}
+			}
+		}
+		return energy;
+	}
+
 	int FF_Bonded::printPSFfile_bondedparams(FILE *file)
 	{
 		// Proxies
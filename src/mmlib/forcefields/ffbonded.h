@@ -126,13 +126,17 @@ namespace Physics
 
 		virtual FF_Bonded* clone() const { return new FF_Bonded(*this); }
 
-		inline int getNumBonds() { return (int)bond.size(); }
-		inline int getNumAngles() { return (int)angle.size(); }
+		inline int getNumBonds() const { return (int)bond.size(); }
+		inline int getNumAngles() const { return (int)angle.size(); }
 		inline int getNumTorsions() { return (int)torsion.size(); }
 		inline int getNumImpropers(){ return (int)improper.size(); }
 
 		Physics::Bond getBond( int i, int j ) const;
 
+		/// The bond/angle terms by their index in the lists assembled by setup()
+		inline const Physics::Bond& getBondByIndex( int _index ) const { return bond[_index]; }
+		inline const Physics::Angle& getAngleByIndex( int _index ) const { return angle[_index]; }
+
 		bool isBonded( int i, int j ) const; ///< Returns true if atoms i and j are bonded in the workspace this forcefield is setup on
 
 		int findBond(int i, int j) const; ///< Finds the index of the bond between atoms i and j in the workspace this forcefield is setup on, or returns -1 if there is no such bond.
@@ -171,6 +175,12 @@ namespace Physics
 
 		virtual void info() const; // prints a little block of parameter information
 
+		/// Only supported for Scope == EntireSystem
+		virtual bool supportsMovedAtomEnergy() const { return Scope == EntireSystem; }
+
+		/// Sum of all bonds, angles, torsions and impropers which include a moved atom
+		virtual double calcMovedAtomEnergy( const std::vector<size_t> &moved );
+
 		double getEBond() const    { return epot_bond; }
 		double getEAngle() const   { return epot_angle; }
 		double getETorsion() const { return epot_torsion; }
@@ -214,6 +224,15 @@ namespace Physics
 		void calcImproperForces();
 		void calcImproperEnergies_Verbose();
 
+		/// Builds m_AtomTermStart/m_AtomTerm, the list of bonded terms each atom takes part in
+		void assembleAtomTermIndex();
+
+		/// The terms of atom i are m_AtomTerm[m_AtomTermStart[i]] to m_AtomTerm[m_AtomTermStart[i+1]-1],
+		/// each encoded as (index << 2) | type, where type is 0 for bonds, 1 for angles,
+		/// 2 for torsions and 3 for impropers
+		std::vector<int> m_AtomTermStart;
+		std::vector<int> m_AtomTerm;
+
 	};
 
 #ifndef SWIG
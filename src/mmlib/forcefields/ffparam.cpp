@@ -1735,6 +1735,8 @@ int FFParamSet::readLib(const std::string &filename, int level)
 		throw(IOException("Forcefield file '" + filename + "' not found"));
 	}
 
+	m_SourceFiles.push_back(fullfilename);
+
 	if( level == 0 )
 	{
 		printf("Reading library: '%s' \n",fullfilename.c_str());
@@ -1811,6 +1813,7 @@ int FFParamSet::readLib(const std::string &filename, int level)
 			// check if file exists
 			if(!IO::fileExists(LibraryPathStore::getSingleton()->findFullFilename(sb.toString())))
 			{
+				m_SourceFiles.push_back(LibraryPathStore::getSingleton()->findFullFilename(sb.toString())); // the cache must notice if it appears
 				errlog.logWarning("WARNING: INCLUDE statement refers to non-existant file '" + sb.toString() + "' - this may or may not be a problem");
 				continue;
 			}
@@ -18,6 +18,7 @@
 class PD_API FFParamSet; // the main class PD_API structure, defined/declared later
 class PD_API MoleculeDefinition;
 class PD_API AtomParameter;
+class FFParamBinaryCache; // binary serialisation of a resolved FFParamSet, see ffparamcache.cpp
 
 /// These are empty pre-allocated objects of the above classes 
 /// Used in situations where an "empty" reference is needed.
@@ -128,6 +129,7 @@ public:
 
 	friend class PD_API FFParamSet;
 	friend class PD_API MoleculeDefinition;
+	friend class FFParamBinaryCache;
 
 	char valid; // 0 for invalid (to be removed/ignored) !=0 for valid	
 
@@ -342,6 +344,7 @@ class PD_API MoleculeDefinition
 {
 public:
 	friend class PD_API FFParamSet;
+	friend class FFParamBinaryCache;
 
 	MoleculeDefinition() 
 		: letter('-'),
@@ -558,6 +561,9 @@ public:
 
 	std::vector<std::string> m_ReservedKeywords;
 
+	/// Every file opened (or looked for, via INCLUDE) by readLib(), in order. Used to validate binary caches.
+	std::vector<std::string> m_SourceFiles;
+
 	// Various flags & parameters
 	bool identgiven;
 	bool autobonds;
@@ -571,6 +577,14 @@ public:
 	int readLib(const std::string &filename, int level = 0);
 	int writeLib(const std::string &filename);
 
+	/// As readLib(), but loads the fully resolved parameter set from a binary cache when that cache 
+	/// is still valid. The cache is keyed by the size and hash of every source file (including INCLUDEs)
+	/// and is rewritten automatically when any of them change. By default the cache lives next to 
+	/// the forcefield file as '<fullfilename>.ffcache'. The cache is only used on an empty FFParamSet.
+	int readLibCached(const std::string &filename, const std::string &cachefilename = "");
+	bool readBinaryCache(const std::string &cachefilename); ///< Returns false if the cache is missing, corrupt or out of date
+	bool writeBinaryCache(const std::string &cachefilename) const; ///< Returns false if the cache could not be written
+
 	int readCHARMMprm(const std::string &filename);
 	int readCHARMMrtf(const std::string &filename);
 
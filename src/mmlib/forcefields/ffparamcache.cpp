@@ -0,0 +1,747 @@
+#include "global.h"
+
+#include "ffparam.h"
+#include "tools/io.h"
+#include "library/libpath.h"
+#include "library/valuestore.h"
+
+// -------------------------------------------------------------------------------------------------
+// Binary cache of a fully resolved FFParamSet
+//
+// Layout (native byte order, all integers are fixed width):
+//   char[8]   magic "PDFFBIN\0"
+//   uint32    format version
+//   uint32    byte order marker (0x01020304)
+//   uint32    number of source files, then per file: string path, uint64 size, uint64 content hash
+//   ...       the parameter set itself (see FFParamBinaryCache::putParamSet())
+//   uint64    hash of everything above
+//
+// Source files that were looked for but did not exist (INCLUDEs) are stored with a size of ~0,
+// so that the cache is invalidated if they later appear.
+// -------------------------------------------------------------------------------------------------
+
+const unsigned int FFPARAM_CACHE_VERSION = 1;
+const unsigned int FFPARAM_CACHE_BYTEORDER = 0x01020304;
+const char FFPARAM_CACHE_MAGIC[8] = { 'P','D','F','F','B','I','N','\0' };
+const unsigned long long FFPARAM_CACHE_MISSING = ~0ULL;
+
+//-------------------------------------------------
+//
+/// \brief Reads and writes FFParamSet binary caches
+///
+/// \details All state of the parameter set is written field by field, doubles are stored bitwise
+/// so that a cached set is identical to a parsed one. Reading is bounds checked, any inconsistency
+/// is reported as a failure and the caller falls back to parsing the text files.
+///
+class FFParamBinaryCache
+{
+public:
+	static bool write( const FFParamSet& _ffps, const std::string& _cacheFile );
+	static bool read( FFParamSet& _ffps, const std::string& _cacheFile );
+
+	/// 64-bit FNV-1a
+	static unsigned long long hash( const char* _data, size_t _length, unsigned long long _seed = 14695981039346656037ULL );
+	static bool hashFile( const std::string& _filename, unsigned long long& _size, unsigned long long& _hash );
+
+private:
+	FFParamBinaryCache() : m_Pos(0), m_Bad(false) {}
+
+	// Writing
+	template< class T > void put( const T& _value )
+	{
+		m_Buffer.append( (const char*)&_value, sizeof(T) );
+	}
+	void putString( const std::string& _value );
+	void putStrings( const std::vector<std::string>& _value );
+	void putVector( const Maths::dvector& _value );
+	void putPrePostFix( const Library::PrePostFix& _value );
+	void putCovalent( const std::vector<CovalentAtom>& _value );
+	void putParticle( const Particle& _value );
+	void putAtomTypeParameter( const AtomTypeParameter& _value );
+	void putAtomParameter( const AtomParameter& _value );
+	void putDihedral( const DihedralDefinition& _value );
+	void putMolecule( const MoleculeDefinition& _value );
+	void putParamSet( const FFParamSet& _ffps );
+
+	// Reading
+	template< class T > void get( T& _value )
+	{
+		if( m_Bad || m_Pos + sizeof(T) > m_Buffer.size() )
+		{
+			m_Bad = true;
+			return;
+		}
+		memcpy( &_value, &m_Buffer[m_Pos], sizeof(T) );
+		m_Pos += sizeof(T);
+	}
+	size_t getCount(); ///< Reads an element count and sanity checks it against the remaining data
+	void getString( std::string& _value );
+	void getStrings( std::vector<std::string>& _value );
+	void getVector( Maths::dvector& _value );
+	void getPrePostFix( Library::PrePostFix& _value );
+	void getCovalent( std::vector<CovalentAtom>& _value );
+	void getParticle( Particle& _value );
+	void getAtomTypeParameter( AtomTypeParameter& _value );
+	void getAtomParameter( AtomParameter& _value );
+	void getDihedral( DihedralDefinition& _value );
+	void getMolecule( MoleculeDefinition& _value );
+	void getParamSet( FFParamSet& _ffps );
+
+	std::string m_Buffer;
+	size_t m_Pos;
+	bool m_Bad;
+};
+
+unsigned long long FFParamBinaryCache::hash( const char* _data, size_t _length, unsigned long long _seed )
+{
+	unsigned long long h = _seed;
+	for( size_t i = 0; i < _length; i++ )
+	{
+		h ^= (unsigned char)_data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+bool FFParamBinaryCache::hashFile( const std::string& _filename, unsigned long long& _size, unsigned long long& _hash )
+{
+	if( !IO::fileExists(_filename) )
+	{
+		_size = FFPARAM_CACHE_MISSING;
+		_hash = 0;
+		return true;
+	}
+	try
+	{
+		IO::MappedFile file(_filename);
+		_size = file.size();
+		_hash = hash( file.data(), file.size() );
+		return true;
+	}
+	catch( ExceptionBase ex )
+	{
+		return false;
+	}
+}
+
+// -----------------------------------------------
+// Writing
+// -----------------------------------------------
+
+void FFParamBinaryCache::putString( const std::string& _value )
+{
+	put( (unsigned int)_value.size() );
+	m_Buffer.append( _value );
+}
+
+void FFParamBinaryCache::putStrings( const std::vector<std::string>& _value )
+{
+	put( (unsigned int)_value.size() );
+	for( size_t i = 0; i < _value.size(); i++ ) putString( _value[i] );
+}
+
+void FFParamBinaryCache::putVector( const Maths::dvector& _value )
+{
+	put( _value.x );
+	put( _value.y );
+	put( _value.z );
+}
+
+void FFParamBinaryCache::putPrePostFix( const Library::PrePostFix& _value )
+{
+	putString( _value.fix );
+	put( (char)_value.isPost );
+}
+
+void FFParamBinaryCache::putCovalent( const std::vector<CovalentAtom>& _value )
+{
+	put( (unsigned int)_value.size() );
+	for( size_t i = 0; i < _value.size(); i++ )
+	{
+		put( _value[i].i );
+		put( _value[i].i2 );
+		put( _value[i].i3 );
+		put( _value[i].d );
+	}
+}
+
+void FFParamBinaryCache::putParticle( const Particle& _value )
+{
+	put( _value.i );
+	put( _value.ir );
+	put( _value.imol );
+	put( _value.igroup );
+	putVector( _value.pos() );
+	putVector( _value.posRef() );
+	putVector( _value.posGeom() );
+	putCovalent( _value.cov12atom );
+	putCovalent( _value.cov13atom );
+	putCovalent( _value.cov14atom );
+	putString( _value.rawname );
+	putString( _value.pdbname );
+	putString( _value.type_name );
+	putString( _value.parentname );
+	putString( _value.parentl3name );
+	put( _value.parentletter );
+	put( _value.Z );
+	put( _value.mass );
+	put( _value.radius );
+	put( _value.epsilon );
+	put( _value.charge );
+	put( _value.epot );
+	put( _value.FFType );
+	put( _value.flags );
+
+	// Custom properties are held in the ValueStore singleton, store them by name and value
+	Library::ValueStore* vs = Library::ValueStore::getSingleton();
+	put( (unsigned int)_value.m_CustomProp.size() );
+	for( size_t i = 0; i < _value.m_CustomProp.size(); i++ )
+	{
+		putString( vs->getName(_value.m_CustomProp[i]) );
+		putString( vs->getRawData(_value.m_CustomProp[i]) );
+	}
+}
+
+void FFParamBinaryCache::putAtomTypeParameter( const AtomTypeParameter& _value )
+{
+	putParticle( _value );
+	putString( _value.name );
+	put( (char)_value.used );
+}
+
+void FFParamBinaryCache::putAtomParameter( const AtomParameter& _value )
+{
+	putAtomTypeParameter( _value );
+	put( _value.valid );
+	put( (unsigned int)_value.r_covalent.size() );
+	for( size_t i = 0; i < _value.r_covalent.size(); i++ )
+	{
+		put( _value.r_covalent[i].i );
+		putString( _value.r_covalent[i].ani );
+		put( _value.r_covalent[i].roi );
+	}
+	putString( _value.restraint );
+	putString( _value.comment );
+}
+
+void FFParamBinaryCache::putDihedral( const DihedralDefinition& _value )
+{
+	putString( _value.ani );
+	putString( _value.ana );
+	putString( _value.anb );
+	putString( _value.anj );
+	put( _value.roi );
+	put( _value.roa );
+	put( _value.rob );
+	put( _value.roj );
+	put( _value.Type );
+}
+
+void FFParamBinaryCache::putMolecule( const MoleculeDefinition& _value )
+{
+	put( _value.letter );
+	put( (char)_value.backlink );
+	put( (char)_value.frwdlink );
+	putString( _value.backname );
+	putString( _value.frwdname );
+	putVector( _value.backpos );
+	putVector( _value.frwdpos );
+
+	put( (unsigned int)_value.atom.size() );
+	for( size_t i = 0; i < _value.atom.size(); i++ ) putAtomParameter( _value.atom[i] );
+	put( (unsigned int)_value.improper.size() );
+	for( size_t i = 0; i < _value.improper.size(); i++ ) putDihedral( _value.improper[i] );
+	put( (unsigned int)_value.torsion.size() );
+	for( size_t i = 0; i < _value.torsion.size(); i++ ) putDihedral( _value.torsion[i] );
+
+	putString( _value.name );
+	putString( _value.l3_name );
+	putString( _value.comment );
+	put( (char)_value.m_AtomAppendMode );
+}
+
+void FFParamBinaryCache::putParamSet( const FFParamSet& _ffps )
+{
+	putString( _ffps.fffilename );
+	putString( _ffps.ffidentifier );
+	put( (char)_ffps.identgiven );
+	put( (char)_ffps.autobonds );
+	put( (char)_ffps.autoangles );
+	put( (char)_ffps.autotorsions );
+	put( _ffps.Vdw14Scaling );
+	put( _ffps.Elec14Scaling );
+
+	put( (unsigned int)_ffps.AtomType.size() );
+	for( size_t i = 0; i < _ffps.AtomType.size(); i++ ) putAtomTypeParameter( _ffps.AtomType[i] );
+
+	put( (unsigned int)_ffps.BondType.size() );
+	for( size_t i = 0; i < _ffps.BondType.size(); i++ )
+	{
+		const BondTypeParameter& b = _ffps.BondType[i];
+		put( b.i ); put( b.j ); put( b.used );
+		put( b.length ); put( b.forceconstant ); put( b.bondorder );
+	}
+
+	put( (unsigned int)_ffps.AngleType.size() );
+	for( size_t i = 0; i < _ffps.AngleType.size(); i++ )
+	{
+		const AngleTypeParameter& a = _ffps.AngleType[i];
+		put( a.used ); put( a.i ); put( a.a ); put( a.j );
+		put( a.angle ); put( a.forceconstant );
+	}
+
+	put( (unsigned int)_ffps.TorsionType.size() );
+	for( size_t i = 0; i < _ffps.TorsionType.size(); i++ )
+	{
+		const TorsionTypeParameter& t = _ffps.TorsionType[i];
+		put( t.used ); put( t.i ); put( t.a ); put( t.b ); put( t.j );
+		put( t.Type ); put( t.terms );
+		for( int k = 0; k < 4; k++ )
+		{
+			put( t.Vn[k] ); put( t.n[k] ); put( t.gamma[k] );
+		}
+	}
+
+	put( (unsigned int)_ffps.molecule.size() );
+	for( size_t i = 0; i < _ffps.molecule.size(); i++ ) putMolecule( _ffps.molecule[i] );
+
+	put( (unsigned int)_ffps.section.size() );
+	for( size_t i = 0; i < _ffps.section.size(); i++ )
+	{
+		const Section& s = _ffps.section[i];
+		putStrings( s.sectionline );
+		put( s.lineoffset );
+		putString( s.filename );
+		putString( s.sectionname );
+	}
+
+	put( (unsigned int)_ffps.AliasDef.size() );
+	for( size_t i = 0; i < _ffps.AliasDef.size(); i++ )
+	{
+		putString( _ffps.AliasDef[i].getAlias() );
+		putString( _ffps.AliasDef[i].getName() );
+	}
+
+	putStrings( _ffps.m_CustomProperty );
+	putStrings( _ffps.m_ReservedKeywords );
+
+	const std::vector<Library::ResidueClassDef>& classes = _ffps.m_Classes;
+	put( (unsigned int)classes.size() );
+	for( size_t i = 0; i < classes.size(); i++ )
+	{
+		putString( classes[i].m_Name );
+		putStrings( classes[i].m_Members );
+		putStrings( classes[i].m_Caps );
+		putPrePostFix( classes[i].m_PolymerStart );
+		putPrePostFix( classes[i].m_PolymerEnd );
+	}
+}
+
+bool FFParamBinaryCache::write( const FFParamSet& _ffps, const std::string& _cacheFile )
+{
+	FFParamBinaryCache blob;
+
+	blob.m_Buffer.append( FFPARAM_CACHE_MAGIC, sizeof(FFPARAM_CACHE_MAGIC) );
+	blob.put( FFPARAM_CACHE_VERSION );
+	blob.put( FFPARAM_CACHE_BYTEORDER );
+
+	blob.put( (unsigned int)_ffps.m_SourceFiles.size() );
+	for( size_t i = 0; i < _ffps.m_SourceFiles.size(); i++ )
+	{
+		unsigned long long size, contentHash;
+		if( !hashFile( _ffps.m_SourceFiles[i], size, contentHash ) ) return false;
+		blob.putString( _ffps.m_SourceFiles[i] );
+		blob.put( size );
+		blob.put( contentHash );
+	}
+
+	blob.putParamSet( _ffps );
+	blob.put( hash( blob.m_Buffer.data(), blob.m_Buffer.size() ) );
+
+	// Write to a temporary and rename it into place, so that concurrent jobs never see a partial cache
+	std::string tempFile = IO::tempFilenameFor( _cacheFile );
+
+	FILE* file = fopen( tempFile.c_str(), "wb" );
+	if( file == NULL ) return false;
+	bool ok = ( blob.m_Buffer.size() == fwrite( blob.m_Buffer.data(), 1, blob.m_Buffer.size(), file ) );
+	ok = ( 0 == fclose(file) ) && ok;
+	if( !ok )
+	{
+		remove( tempFile.c_str() );
+		return false;
+	}
+	return IO::replaceFile( tempFile, _cacheFile );
+}
+
+// -----------------------------------------------
+// Reading
+// -----------------------------------------------
+
+size_t FFParamBinaryCache::getCount()
+{
+	unsigned int count = 0;
+	get( count );
+	// Every element occupies at least one byte, anything else is a corrupt file
+	if( m_Bad || count > m_Buffer.size() - m_Pos )
+	{
+		m_Bad = true;
+		return 0;
+	}
+	return count;
+}
+
+void FFParamBinaryCache::getString( std::string& _value )
+{
+	size_t length = getCount();
+	if( m_Bad ) return;
+	_value.assign( &m_Buffer[0] + m_Pos, length );
+	m_Pos += length;
+}
+
+void FFParamBinaryCache::getStrings( std::vector<std::string>& _value )
+{
+	size_t count = getCount();
+	_value.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ ) getString( _value[i] );
+}
+
+void FFParamBinaryCache::getVector( Maths::dvector& _value )
+{
+	get( _value.x );
+	get( _value.y );
+	get( _value.z );
+}
+
+void FFParamBinaryCache::getPrePostFix( Library::PrePostFix& _value )
+{
+	char isPost = 0;
+	getString( _value.fix );
+	get( isPost );
+	_value.isPost = ( isPost != 0 );
+}
+
+void FFParamBinaryCache::getCovalent( std::vector<CovalentAtom>& _value )
+{
+	size_t count = getCount();
+	_value.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		get( _value[i].i );
+		get( _value[i].i2 );
+		get( _value[i].i3 );
+		get( _value[i].d );
+	}
+}
+
+void FFParamBinaryCache::getParticle( Particle& _value )
+{
+	get( _value.i );
+	get( _value.ir );
+	get( _value.imol );
+	get( _value.igroup );
+	getVector( _value.pos() );
+	getVector( _value.posRef() );
+	getVector( _value.posGeom() );
+	getCovalent( _value.cov12atom );
+	getCovalent( _value.cov13atom );
+	getCovalent( _value.cov14atom );
+	getString( _value.rawname );
+	getString( _value.pdbname );
+	getString( _value.type_name );
+	getString( _value.parentname );
+	getString( _value.parentl3name );
+	get( _value.parentletter );
+	get( _value.Z );
+	get( _value.mass );
+	get( _value.radius );
+	get( _value.epsilon );
+	get( _value.charge );
+	get( _value.epot );
+	get( _value.FFType );
+	get( _value.flags );
+
+	size_t count = getCount();
+	_value.m_CustomProp.clear();
+	std::string name, data;
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		getString( name );
+		getString( data );
+		if( !m_Bad ) _value.m_CustomProp.push_back( Library::ValueStore::getSingleton()->addNewData(name,data) );
+	}
+}
+
+void FFParamBinaryCache::getAtomTypeParameter( AtomTypeParameter& _value )
+{
+	char used = 0;
+	getParticle( _value );
+	getString( _value.name );
+	get( used );
+	_value.used = ( used != 0 );
+}
+
+void FFParamBinaryCache::getAtomParameter( AtomParameter& _value )
+{
+	getAtomTypeParameter( _value );
+	get( _value.valid );
+	size_t count = getCount();
+	_value.r_covalent.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		get( _value.r_covalent[i].i );
+		getString( _value.r_covalent[i].ani );
+		get( _value.r_covalent[i].roi );
+	}
+	getString( _value.restraint );
+	getString( _value.comment );
+}
+
+void FFParamBinaryCache::getDihedral( DihedralDefinition& _value )
+{
+	getString( _value.ani );
+	getString( _value.ana );
+	getString( _value.anb );
+	getString( _value.anj );
+	get( _value.roi );
+	get( _value.roa );
+	get( _value.rob );
+	get( _value.roj );
+	get( _value.Type );
+}
+
+void FFParamBinaryCache::getMolecule( MoleculeDefinition& _value )
+{
+	char flag = 0;
+	get( _value.letter );
+	get( flag ); _value.backlink = ( flag != 0 );
+	get( flag ); _value.frwdlink = ( flag != 0 );
+	getString( _value.backname );
+	getString( _value.frwdname );
+	getVector( _value.backpos );
+	getVector( _value.frwdpos );
+
+	size_t count = getCount();
+	_value.atom.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		getAtomParameter( _value.atom[i] );
+		_value.atom[i].parent = &_value;
+	}
+	count = getCount();
+	_value.improper.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ ) getDihedral( _value.improper[i] );
+	count = getCount();
+	_value.torsion.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ ) getDihedral( _value.torsion[i] );
+
+	getString( _value.name );
+	getString( _value.l3_name );
+	getString( _value.comment );
+	get( flag ); _value.m_AtomAppendMode = ( flag != 0 );
+}
+
+void FFParamBinaryCache::getParamSet( FFParamSet& _ffps )
+{
+	char flag = 0;
+	getString( _ffps.fffilename );
+	getString( _ffps.ffidentifier );
+	get( flag ); _ffps.identgiven = ( flag != 0 );
+	get( flag ); _ffps.autobonds = ( flag != 0 );
+	get( flag ); _ffps.autoangles = ( flag != 0 );
+	get( flag ); _ffps.autotorsions = ( flag != 0 );
+	get( _ffps.Vdw14Scaling );
+	get( _ffps.Elec14Scaling );
+
+	size_t count = getCount();
+	_ffps.AtomType.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ ) getAtomTypeParameter( _ffps.AtomType[i] );
+
+	count = getCount();
+	_ffps.BondType.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		BondTypeParameter& b = _ffps.BondType[i];
+		get( b.i ); get( b.j ); get( b.used );
+		get( b.length ); get( b.forceconstant ); get( b.bondorder );
+	}
+
+	count = getCount();
+	_ffps.AngleType.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		AngleTypeParameter& a = _ffps.AngleType[i];
+		get( a.used ); get( a.i ); get( a.a ); get( a.j );
+		get( a.angle ); get( a.forceconstant );
+	}
+
+	count = getCount();
+	_ffps.TorsionType.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		TorsionTypeParameter& t = _ffps.TorsionType[i];
+		get( t.used ); get( t.i ); get( t.a ); get( t.b ); get( t.j );
+		get( t.Type ); get( t.terms );
+		for( int k = 0; k < 4; k++ )
+		{
+			get( t.Vn[k] ); get( t.n[k] ); get( t.gamma[k] );
+		}
+	}
+
+	// Each definition is read in place, MoleculeDefinition::operator= re-links the atom parents should the vector move
+	count = getCount();
+	_ffps.molecule.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ ) getMolecule( _ffps.molecule[i] );
+
+	count = getCount();
+	_ffps.section.resize( count );
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		Section& s = _ffps.section[i];
+		getStrings( s.sectionline );
+		get( s.lineoffset );
+		getString( s.filename );
+		getString( s.sectionname );
+	}
+
+	count = getCount();
+	_ffps.AliasDef.resize( count );
+	std::string alias, name;
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		getString( alias );
+		getString( name );
+		_ffps.AliasDef[i].set( alias, name );
+	}
+
+	getStrings( _ffps.m_CustomProperty );
+	getStrings( _ffps.m_ReservedKeywords );
+
+	count = getCount();
+	_ffps.m_Classes.clear();
+	for( size_t i = 0; i < count && !m_Bad; i++ )
+	{
+		getString( name );
+		Library::ResidueClassDef def( name );
+		getStrings( def.m_Members );
+		getStrings( def.m_Caps );
+		getPrePostFix( def.m_PolymerStart );
+		getPrePostFix( def.m_PolymerEnd );
+		_ffps.m_Classes.push_back( def );
+	}
+}
+
+bool FFParamBinaryCache::read( FFParamSet& _ffps, const std::string& _cacheFile )
+{
+	if( !IO::fileExists(_cacheFile) ) return false;
+
+	FFParamBinaryCache blob;
+	try
+	{
+		IO::MappedFile file(_cacheFile);
+		if( file.size() < sizeof(FFPARAM_CACHE_MAGIC) + sizeof(unsigned long long) ) return false;
+		blob.m_Buffer.assign( file.data(), file.size() );
+	}
+	catch( ExceptionBase ex )
+	{
+		return false;
+	}
+
+	// Whole-file checksum first - this catches truncated or partially written caches
+	const size_t payloadLength = blob.m_Buffer.size() - sizeof(unsigned long long);
+	unsigned long long storedHash;
+	memcpy( &storedHash, &blob.m_Buffer[payloadLength], sizeof(storedHash) );
+	if( storedHash != hash( blob.m_Buffer.data(), payloadLength ) ) return false;
+	blob.m_Buffer.resize( payloadLength );
+
+	if( 0 != memcmp( blob.m_Buffer.data(), FFPARAM_CACHE_MAGIC, sizeof(FFPARAM_CACHE_MAGIC) ) ) return false;
+	blob.m_Pos = sizeof(FFPARAM_CACHE_MAGIC);
+
+	unsigned int version = 0, byteOrder = 0;
+	blob.get( version );
+	blob.get( byteOrder );
+	if( blob.m_Bad || version != FFPARAM_CACHE_VERSION || byteOrder != FFPARAM_CACHE_BYTEORDER ) return false;
+
+	// Has any source file changed since the cache was written?
+	std::vector<std::string> sources( blob.getCount() );
+	for( size_t i = 0; i < sources.size(); i++ )
+	{
+		unsigned long long cachedSize = 0, cachedHash = 0, size, contentHash;
+		blob.getString( sources[i] );
+		blob.get( cachedSize );
+		blob.get( cachedHash );
+		if( blob.m_Bad ) return false;
+		if( !hashFile( sources[i], size, contentHash ) ) return false;
+		if( size != cachedSize || contentHash != cachedHash ) return false;
+	}
+
+	// Load into a scratch set so that a failure leaves _ffps untouched
+	FFParamSet loaded;
+	blob.getParamSet( loaded );
+	if( blob.m_Bad || blob.m_Pos != blob.m_Buffer.size() ) return false;
+	loaded.m_SourceFiles = sources;
+
+	_ffps.fffilename = loaded.fffilename;
+	_ffps.ffidentifier = loaded.ffidentifier;
+	_ffps.identgiven = loaded.identgiven;
+	_ffps.autobonds = loaded.autobonds;
+	_ffps.autoangles = loaded.autoangles;
+	_ffps.autotorsions = loaded.autotorsions;
+	_ffps.Vdw14Scaling = loaded.Vdw14Scaling;
+	_ffps.Elec14Scaling = loaded.Elec14Scaling;
+	_ffps.AtomType.swap( loaded.AtomType );
+	_ffps.BondType.swap( loaded.BondType );
+	_ffps.AngleType.swap( loaded.AngleType );
+	_ffps.TorsionType.swap( loaded.TorsionType );
+	_ffps.molecule.swap( loaded.molecule );
+	_ffps.section.swap( loaded.section );
+	_ffps.AliasDef.swap( loaded.AliasDef );
+	_ffps.m_CustomProperty.swap( loaded.m_CustomProperty );
+	_ffps.m_ReservedKeywords.swap( loaded.m_ReservedKeywords );
+	_ffps.m_SourceFiles.swap( loaded.m_SourceFiles );
+	_ffps.m_Classes.swap( loaded.m_Classes );
+	return true;
+}
+
+// -----------------------------------------------
+// FFParamSet entry points
+// -----------------------------------------------
+
+bool FFParamSet::writeBinaryCache(const std::string &cachefilename) const
+{
+	return FFParamBinaryCache::write( *this, cachefilename );
+}
+
+bool FFParamSet::readBinaryCache(const std::string &cachefilename)
+{
+	return FFParamBinaryCache::read( *this, cachefilename );
+}
+
+int FFParamSet::readLibCached(const std::string &filename, const std::string &cachefilename)
+{
+	std::string fullfilename = LibraryPathStore::getSingleton()->findFullFilename(filename);
+	std::string cachename = cachefilename.size() > 0 ? cachefilename : fullfilename + ".ffcache";
+
+	// A cache holds exactly one resolved forcefield; layering files onto an existing set must parse them
+	if( m_SourceFiles.size() > 0 || molecule.size() > 0 || AtomType.size() > 0 )
+	{
+		return readLib(filename);
+	}
+
+	if( readBinaryCache(cachename) )
+	{
+		if( m_SourceFiles.size() > 0 && 0 == m_SourceFiles[0].compare(fullfilename) )
+		{
+			printf("Reading library: '%s' (binary cache '%s')\n",fullfilename.c_str(),cachename.c_str());
+			return 0;
+		}
+		// The cache was built from a different forcefield file - start again from scratch
+		*this = FFParamSet();
+	}
+
+	int errorstatus = readLib(filename);
+	if( errorstatus == 0 && !writeBinaryCache(cachename) )
+	{
+		printf("WARNING: Could not write the forcefield binary cache '%s'\n",cachename.c_str());
+	}
+	return errorstatus;
+}
@@ -101,6 +101,11 @@ namespace Physics
 		printf(" %-16s%10.3lf kcal/mol\n", name.c_str(), double (epot) * PhysicsConst::J2kcal * PhysicsConst::Na);
 	}	
 
+	double ForcefieldBase::calcMovedAtomEnergy( const std::vector<size_t> &moved )
+	{
+		THROW(CodeException,"The forcefield component '" + name + "' does not support calcMovedAtomEnergy()");
+	}
+
 	void ForcefieldBase::info() const
 	{				
 		printf(" %s  ", name.c_str());
@@ -217,6 +222,37 @@ namespace Physics
 			element(i).calcEnergies();
 	}
 	
+	bool Forcefield::supportsMovedAtomEnergy() const
+	{
+		for(size_t i = 0; i < size(); i++)
+		{
+			// inactive and passive components do not contribute to the total energy
+			if( !element(i).Active || element(i).Passive ) continue;
+			if( !element(i).supportsMovedAtomEnergy() ) return false;
+		}
+		return true;
+	}
+
+	void Forcefield::setupMovedAtomEnergy()
+	{
+		for(size_t i = 0; i < size(); i++)
+		{
+			if( !element(i).Active || element(i).Passive ) continue;
+			element(i).setupMovedAtomEnergy();
+		}
+	}
+
+	double Forcefield::calcMovedAtomEnergy( const std::vector<size_t> &moved )
+	{
+		double energy = 0;
+		for(size_t i = 0; i < size(); i++)
+		{
+			if( !element(i).Active || element(i).Passive ) continue;
+			energy += element(i).calcMovedAtomEnergy( moved );
+		}
+		return energy;
+	}
+
 	void Forcefield::calcForces(){
 		SnapShotAtom *atom = getWSpace().cur.atom; // atom coordinate array
 		getWSpace().zeroForces();
@@ -167,6 +167,25 @@ public:
 
 		///display energies verbosely
 		virtual void calcEnergiesVerbose(AtomicVerbosity level); 
+
+		// Incremental energy functions --------------------------------------------
+
+		/// returns true if this forcefield implements calcMovedAtomEnergy()
+		virtual bool supportsMovedAtomEnergy() const { return false; }
+
+		/// Prepares the forcefield for calls to calcMovedAtomEnergy(), for example by requesting
+		/// a neighbour list which includes shadow neighbours. Must be called before the 
+		/// energy evaluation preceeding the first call to calcMovedAtomEnergy().
+		virtual void setupMovedAtomEnergy() {}
+
+		/// \brief Returns the energy of all interactions which involve at least one of the atoms in
+		/// 'moved', i.e. that part of epot which changes when only these atoms move.
+		/// \details The atoms in 'moved' must be flagged with setMoved(true) and all others must
+		/// not be. The energy change of a local (e.g. Monte Carlo) move is then the difference of
+		/// this function after and before the move. Unlike calcEnergies() this function does not 
+		/// change epot, the workspace energies or the forces. The neighbour list is used as it is,
+		/// i.e. it must be valid for the old and the new positions of the moved atoms.
+		virtual double calcMovedAtomEnergy( const std::vector<size_t> &moved );
 	                                       
 		// inspector functions -------------------------------------------------
 
@@ -286,6 +305,13 @@ namespace Physics
 		virtual void calcEnergies();
 		virtual void calcForces();
 
+		/// true if all active, non-passive components support calcMovedAtomEnergy()
+		virtual bool supportsMovedAtomEnergy() const;
+		virtual void setupMovedAtomEnergy();
+
+		/// sum of calcMovedAtomEnergy() over all active, non-passive components
+		virtual double calcMovedAtomEnergy( const std::vector<size_t> &moved );
+
 		virtual void info();
 		virtual void infoLine() const;
 		virtual void infoLineHeader() const;
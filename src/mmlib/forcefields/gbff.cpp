@@ -24,6 +24,8 @@ namespace Physics
 		ExpApproxThreshold = -4.0;
 		DielectricOffset = -0.090;
 		BornRadiusOffset = 0.0;
+		BornRadiiUpdateInterval = 1;
+		m_BornRadiiAge = 1;
 		
 		ForceSwitch = false;
 		EnergySwitch = true;
@@ -76,12 +78,17 @@ namespace Physics
 			GB_atom_param.push_back( t3 );
 		}
 
-		wspace.nlist().requestCutoff(Cutoff);
+		// the neighbour list must also cover the born radii sum
+		wspace.nlist().requestCutoff(Maths::max(Cutoff,GbsaStillCutoff));
+
+		// need shadow neighbors !! (set before calcFixedBornRadiiTerms() rebuilds the list)
+		wspace.nlist().calcShadow(true);
 
 		calcFixedBornRadiiTerms();
 		calcBornRadii_PairwiseApprox();
 
-		wspace.nlist().calcShadow(true); // need shadow neighbors !!
+		// recalculate the born radii at the next evaluation
+		m_BornRadiiAge = Maths::max(1,BornRadiiUpdateInterval);
 
 		Active = true;
 	}
@@ -99,6 +106,7 @@ namespace Physics
 		printf(" Still Cutoff:       %lf \n", GbsaStillCutoff);
 		printf(" Dielec. Offset:     %lf \n", DielectricOffset);
 		printf(" Exp Threshold:      %lf \n", ExpApproxThreshold);
+		printf(" Born Radii Update:  every %d step(s)\n", Maths::max(1,BornRadiiUpdateInterval));
 	}
 
 	void FF_GeneralizedBorn_Still::infoLine() const 
@@ -160,22 +168,23 @@ namespace Physics
 
 	void FF_GeneralizedBorn_Still::calcEnergies()
 	{
-		calcBornRadii_PairwiseApprox();
+		updateBornRadii();
 		FF_NonBonded::calcEnergies();
 		calcBornEnergy();
 	}
 
 	void FF_GeneralizedBorn_Still::calcForces()
 	{
-		calcBornRadii_PairwiseApprox();
+		// with constant born radii their derivatives are left out
+		bool newRadii = updateBornRadii();
 		if(FastMode) 
 		{
-			calcForcesIncludingVacuo();
+			calcForcesIncludingVacuo(newRadii);
 		} 
 		else 
 		{
 			FF_NonBonded::calcForces();
-			calcBornForces();
+			calcBornForces(newRadii);
 		}
 	}
 
@@ -416,49 +425,40 @@ namespace Physics
 	{
 		WorkSpace& wspace = getWSpace();
 
-		int i, nj, j;
-		int Type;
-		double Gpol;
-		double Dist_ij;
-		double invP5;
-		double CCF;
-		double rdivR;
-		double Rj, Ri;
-
 		const NeighbourData *fnbor = wspace.nlist().getData();
-
-		invP5 = 1 / P5;
-
-		for(i = 0; i < wspace.atom.size(); i++) {
-			Type = wspace.atom[i].FFType;
-			Ri = GBtype[Type].radius;
-			// double count=0.0;
-
-			Gpol = GB_atom_param_still[i].terms123;
+		const int atoms = wspace.atom.size();
+		const double sqrStillCutoff = sqr(GbsaStillCutoff);
+		const double invP5 = 1 / P5;
+
+		// every atom only sums over its own (full, i.e. shadow) neighbour list and writes 
+		// its own radius, so the atoms can be done in parallel and in any order
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 64)
+#endif
+		for(int i = 0; i < atoms; i++) {
+			const double Ri = GBtype[wspace.atom[i].FFType].radius;
+			double Gpol = GB_atom_param_still[i].terms123;
 
 			//run over all neighbors
-			for(nj = 0; nj < fnbor[i].n; nj++) {
-				j = NList32Bit_Index(fnbor[i].i[nj]);
-				Dist_ij = sqrdist(wspace.cur.atom[i].p,wspace.cur.atom[j].p);
-
-				if(Dist_ij > sqr(GbsaStillCutoff))continue;
-			
+			for(int nj = 0; nj < fnbor[i].n; nj++) {
+				const int j = NList32Bit_Index(fnbor[i].i[nj]);
+				const double Dist_ij = sqrdist(wspace.cur.atom[i].p,wspace.cur.atom[j].p);
 
+				if(Dist_ij > sqrStillCutoff)continue;
 
 				if( NList32Bit_BondOrder(fnbor[i].i[nj]) <= BondOrder_1_3_Pair)
 					continue;// only get non-bonded and 1-4 neighbors
-		
 
-				Rj = GBtype[wspace.atom[j].FFType].radius; //wspace.atom[i].radius;
+				const double Rj = GBtype[wspace.atom[j].FFType].radius; //wspace.atom[i].radius;
 
-				rdivR = Dist_ij / sqr((Ri + Rj));
+				const double rdivR = Dist_ij / sqr((Ri + Rj));
+				double CCF;
 				if(rdivR > invP5)
 					CCF = 1.0;
 				else
 					CCF = sqr(0.5 - 0.5 * cos((rdivR * P5 * Maths::MathConst::PI)));
 
 				Gpol += P4 * GB_atom_param_still[j].Vj * CCF / (sqr(Dist_ij));
-				// count += 1.0;
 			}
 			GB_atom_param[i].bornradius = -PhysicsConst::halfeconv / Gpol + BornRadiusOffset;
 		}
@@ -466,6 +466,19 @@ namespace Physics
 	}
 
 
+	bool FF_GeneralizedBorn_Still::updateBornRadii()
+	{
+		if( m_BornRadiiAge >= BornRadiiUpdateInterval )
+		{
+			calcBornRadii_PairwiseApprox();
+			m_BornRadiiAge = 1;
+			return true;
+		}
+		m_BornRadiiAge++;
+		return false;
+	}
+
+
 
 
 	void FF_GeneralizedBorn_Still::calcBornEnergy_covalentTerms()
@@ -521,56 +534,63 @@ namespace Physics
 	{
 		WorkSpace& wspace = getWSpace();
 
-		int i, nj, j, atoms;
-		double ai, qi, qj, aiaj, srij;
-		double epol;
-		double Dist_ij;
-		double Swidth = Cutoff - InnerCutoff;
-		double invSwidth = 1 / Swidth;
-		double S;
-
 		const NeighbourData *fnbor = wspace.nlist().getData();
-		atoms = wspace.atom.size();
-
-		epot_pol = 0;
-		epot_pol_self = 0.0;
-		epot_pol_cross = 0.0;		
-
-		for(i = 0; i < atoms; i++) {
-			qi = wspace.atom[i].charge;
-			ai = GB_atom_param[i].bornradius;
-			epot_pol -= sqr(qi) / ai;
-			epot_pol_self -= sqr(qi) / ai;
+		const double Swidth = Cutoff - InnerCutoff;
+		const double invSwidth = 1 / Swidth;
+
+		// sum up the energy in blocks of atoms (in parallel) and the blocks in a fixed order
+		const int nblocks = setupAtomBlocks( 0 );
+		std::vector<GB_BlockResult> result( nblocks );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for(int b = 0; b < nblocks; b++) {
+			double pol_self = 0.0;
+			double pol_cross = 0.0;
+			for(int i = m_BlockStart[b]; i < m_BlockStart[b+1]; i++) {
+				const double qi = wspace.atom[i].charge;
+				const double ai = GB_atom_param[i].bornradius;
+				pol_self -= sqr(qi) / ai;
+
+				// do neighbors
+				for(int nj = 0; nj < fnbor[i].n; nj++) {
+					const int j = NList32Bit_Index(fnbor[i].i[nj]);
+					if(i > j)
+						continue; // only calculate half the matrix (fGB is symetric)
+
+					const double Dist_ij = dist(wspace.cur.atom[i].p,wspace.cur.atom[j].p);
+					if(Dist_ij>Cutoff) continue;
+
+					// Switching function (S)
+					double S;
+					if(Dist_ij < InnerCutoff) {
+						S = 1.0;
+					} else {
+						S = (1.0 - sqr(invSwidth * (Dist_ij - InnerCutoff)));
+						S = sqr(S);
+					}
 
-			// do neighbors
-			for(nj = 0; nj < fnbor[i].n; nj++) {
-				j = NList32Bit_Index(fnbor[i].i[nj]);
-				if(i > j)
-					continue; // only calculate half the matrix (fGB is symetric)
+					const double srij = sqr(Dist_ij);
 
-				Dist_ij = dist(wspace.cur.atom[i].p,wspace.cur.atom[j].p);
-				if(Dist_ij>Cutoff) continue;
+					const double qj = wspace.atom[j].charge;
 
-				// Switching function (S)
-				if(Dist_ij < InnerCutoff) {
-					S = 1.0;
-				} else {
-					S = (1.0 - sqr(invSwidth * (Dist_ij - InnerCutoff)));
-					S = sqr(S);
+					const double aiaj = ai * GB_atom_param[j].bornradius;
+					pol_cross -= 2.0 * S * qi * qj / sqrt(srij + aiaj * exp(-srij * 0.25 / aiaj));
 				}
-
-				srij = sqr(Dist_ij);
-
-				qj = wspace.atom[j].charge;
-
-				aiaj = ai * GB_atom_param[j].bornradius;
-				epol = 2.0 * S * qi * qj / sqrt(srij + aiaj * exp(-srij * 0.25 / aiaj));
-
-				epot_pol -= epol;
-				epot_pol_cross -= epol;
 			}
+			result[b].epot_pol_self = pol_self;
+			result[b].epot_pol_cross = pol_cross;
 		}
 
+		epot_pol_self = 0.0;
+		epot_pol_cross = 0.0;
+		for(int b = 0; b < nblocks; b++) {
+			epot_pol_self += result[b].epot_pol_self;
+			epot_pol_cross += result[b].epot_pol_cross;
+		}
+		epot_pol = epot_pol_self + epot_pol_cross;
+
 		epot_pol *= -bornpremul;
 		epot_pol_cross *= -bornpremul;
 		epot_pol_self *= -bornpremul;
@@ -1164,14 +1184,63 @@ namespace Physics
 	// Class: FF_GeneralizedBorn_Still
 	// Function: calcBornForces();
 	// -------------------------------------------------------------------------------
-	// Parameters: none
+	// Parameters: BornRadiiDerivative - include the derivative of the born radii 
+	//             with respect to the atom positions (false if they are held constant)
 	//
 	// This implements the true derivative using the born raddi chain rule of
-	// partial derivatives with respect to rij, ai and all aj
+	// partial derivatives with respect to rij, ai and all aj.
+	// The pair terms are calculated in blocks of atoms (in parallel, see
+	// calcBornForces_Block()), the chain rule part in calcBornRadiiForces()
+
+	void FF_GeneralizedBorn_Still::calcBornForces(bool BornRadiiDerivative){
+		// Proxies
+		WorkSpace& wspace = getWSpace();
+		const int atoms = wspace.atom.size();
+
+		const int nblocks = setupAtomBlocks( 4 );
+		if( (int)m_BlockDirect.size() < 4 * atoms ) m_BlockDirect.resize( 4 * atoms );
+		std::vector<GB_BlockResult> result( nblocks );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for(int b = 0; b < nblocks; b++) {
+			const int iend = m_BlockStart[b+1];
+			if( b < nblocks - 1 ) calcBornForces_Block( m_BlockStart[b], iend, &m_BlockForce[ m_BlockForceOffset[b] ], iend, result[b] );
+			else                  calcBornForces_Block( m_BlockStart[b], iend, &m_BlockDirect[0], atoms, result[b] );
+		}
+		sumBlockAccumulators( nblocks, 4 );
+
+		epot_pol_self = 0.0;
+		epot_pol_cross = 0.0;
+		for(int b = 0; b < nblocks; b++) {
+			epot_pol_self += result[b].epot_pol_self;
+			epot_pol_cross += result[b].epot_pol_cross;
+		}
+		epot_pol = epot_pol_cross + epot_pol_self;
+
+		//add electrostatic energy to the total
+		wspace.ene.epot += epot_pol;
+
+		// Now add the second part of the derivative
+		if( BornRadiiDerivative ) calcBornRadiiForces();
 
-	void FF_GeneralizedBorn_Still::calcBornForces(){
+		dvector force;
+		for(int i = 0; i < atoms; i++) {
+			force.setTo(GB_atom_param[i].dedi);
+			force.mul(-1 / (PhysicsConst::Angstrom));
+			wspace.cur.atom[i].f.add(force);
+		}
+		epot += epot_pol;
+	}
+
+
+	// Pair terms of calcBornForces() for the atoms istart to iend-1. The derivatives
+	// dE/dx, dE/dy, dE/dz and dE/dalpha are accumulated in the arrays acc[0..n-1], 
+	// acc[n..2n-1], acc[2n..3n-1] and acc[3n..4n-1] (which are zeroed first)
+	void FF_GeneralizedBorn_Still::calcBornForces_Block(int istart, int iend, double *acc, int n, GB_BlockResult &result)
+	{
 		int i, j, nj;
-		int atoms;
 		double dedr, dedalpha;
 		double dedx, dedy, dedz;
 
@@ -1193,28 +1262,24 @@ namespace Physics
 		double dedai;
 
 		double atomix, atomiy, atomiz;
-		dvector force;
 
-		epot_pol = 0.0;
-		epot_pol_self = 0.0;
-		epot_pol_cross = 0.0;
+		double epot_pol = 0.0;
+		double epot_pol_self = 0.0;
+		double epot_pol_cross = 0.0;
 
 		// Proxies
 		WorkSpace& wspace = getWSpace();
 		const NeighbourData *fnbor = wspace.nlist().getData();
-		atoms = wspace.atom.size();
 
-		premul = bornpremul;
+		double *dedix = acc;
+		double *dediy = acc + n;
+		double *dediz = acc + 2*n;
+		double *deda  = acc + 3*n;
+		memset( acc, 0, 4 * n * sizeof(double) );
 
-		// set all arrays to 0
-		for(i = 0; i < atoms; i++) {
-			GB_atom_param[i].dedi.setTo(0, 0, 0);
-			GB_atom_param[i].deda = 0.0;
-		}
-
-		int paircount=0;
+		premul = bornpremul;
 
-		for(i = 0; i < atoms; i++) {
+		for(i = istart; i < iend; i++) {
 			ai = GB_atom_param[i].bornradius;
 			qi = premul * wspace.atom[i].charge;
 
@@ -1228,14 +1293,8 @@ namespace Physics
 				j = NList32Bit_Index(fnbor[i].i[nj]);
 				if(j > i) break; // ignore shadow neighbors
 
-				//Dist_ij = fnbor[i].d[nj];
-				//if(Dist_ij>Cutoff){
-				// printf("%lf \n",Dist_ij);
-				// continue;
-				//}
 				aj = GB_atom_param[j].bornradius;
 				qiqj = qi * wspace.atom[j].charge;
-				paircount++;
 				dddx = (atomix - wspace.cur.atom[j].p.x); // these are incomplete (need div by Dist_ij)
 				dddy = (atomiy - wspace.cur.atom[j].p.y);
 				dddz = (atomiz - wspace.cur.atom[j].p.z);
@@ -1279,21 +1338,16 @@ namespace Physics
 					epot_pol_cross += epol;
 					epot_pol_cross += epol;
 
-					GB_atom_param[i].dedi.x += dedx;
-					GB_atom_param[i].dedi.y += dedy;
-					GB_atom_param[i].dedi.z += dedz;
-					GB_atom_param[j].dedi.x -= dedx;
-					GB_atom_param[j].dedi.y -= dedy;
-					GB_atom_param[j].dedi.z -= dedz;
+					dedix[i] += dedx;
+					dediy[i] += dedy;
+					dediz[i] += dedz;
+					dedix[j] -= dedx;
+					dediy[j] -= dedy;
+					dediz[j] -= dedz;
 
 					dedai += dedalpha * aj;
-					GB_atom_param[j].deda += dedalpha * ai;
+					deda[j] += dedalpha * ai;
 				} else {
-					tGB = 0;
-					mGB = 0;
-					lGB = srij;
-					fGB = Dist_ij;
-
 					epol = qiqj * invdistij;
 					dedr = -epol * invdistij;
 
@@ -1316,107 +1370,130 @@ namespace Physics
 					epot_pol_cross += epol;
 					epot_pol_cross += epol;
 
-					GB_atom_param[i].dedi.x += dedx;
-					GB_atom_param[i].dedi.y += dedy;
-					GB_atom_param[i].dedi.z += dedz;
-					GB_atom_param[j].dedi.x -= dedx;
-					GB_atom_param[j].dedi.y -= dedy;
-					GB_atom_param[j].dedi.z -= dedz;
+					dedix[i] += dedx;
+					dediy[i] += dedy;
+					dediz[i] += dedz;
+					dedix[j] -= dedx;
+					dediy[j] -= dedy;
+					dediz[j] -= dedz;
 				}
 
 			}
-			GB_atom_param[i].deda += dedai;
+			deda[i] += dedai;
 
 			epol = qi * wspace.atom[i].charge / ai;
 			epot_pol += epol; // add up energies
 			epot_pol_self += epol;
 
-			GB_atom_param[i].deda += -epol / ai;
+			deda[i] += -epol / ai;
 		}
 
+		result.epot_vdw = 0.0;
+		result.epot_elec = 0.0;
+		result.epot_pol_self = epot_pol_self;
+		result.epot_pol_cross = epot_pol_cross;
+	}
 
 
+	// Adds up the derivatives accumulated by the atom blocks (the last block in m_BlockDirect,
+	// the others in m_BlockForce) in a fixed order and stores them in GB_atom_param[].dedi and 
+	// GB_atom_param[].deda. With nfields = 5 the fifth array holds atomic energies, which 
+	// are added to wspace.atom[].epot
+	void FF_GeneralizedBorn_Still::sumBlockAccumulators(int nblocks, int nfields)
+	{
+		WorkSpace& wspace = getWSpace();
+		const int atoms = wspace.atom.size();
+		const double *direct = &m_BlockDirect[0];
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for(int i = 0; i < atoms; i++) {
+			double sum[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+			for(int k = 0; k < nfields; k++) sum[k] = direct[k * atoms + i];
+			for(int b = 0; b < nblocks - 1; b++) {
+				const int iend = m_BlockStart[b+1];
+				if( i >= iend ) continue;
+				const double *acc = &m_BlockForce[ m_BlockForceOffset[b] ];
+				for(int k = 0; k < nfields; k++) sum[k] += acc[k * iend + i];
+			}
+			GB_atom_param[i].dedi.setTo( sum[0], sum[1], sum[2] );
+			GB_atom_param[i].deda = sum[3];
+			if( nfields > 4 ) wspace.atom[i].epot += sum[4];
+		}
+	}
 
-		//add electrostatic energy to the total
-		wspace.ene.epot += epot_pol;
-
-
-		// ---------------------------------------------------------------------------
-		// Now add the second part of the derivative
-		int Type;
-		double gpi;
-		double invP5;
-		double sqrtCCF, CCF, dCCF;
-		double rdivR;
-		double Rj, Ri;
-		double Vj;
-		double r6;
-		double theta, costheta, sintheta;
-		invP5 = 1 / P5;
 
-		for(i = 0; i < wspace.atom.size(); i++) {
-			Type = wspace.atom[i].FFType;
-			Ri = GBtype[Type].radius;
+	// Second part of the derivative: the dependence of the born radii on the atom positions
+	// (the chain rule part using GB_atom_param[].deda). Rather than scattering the 
+	// contribution of every pair i,j onto both atoms, each atom gathers the terms of both
+	// (i,j) and (j,i) from its own full (i.e. shadow) neighbour list. That way every atom
+	// only writes to itself and the atoms can be done in parallel.
+	void FF_GeneralizedBorn_Still::calcBornRadiiForces()
+	{
+		WorkSpace& wspace = getWSpace();
+		const NeighbourData *fnbor = wspace.nlist().getData();
+		const int atoms = wspace.atom.size();
+		const double sqrStillCutoff = sqr(GbsaStillCutoff);
+		const double invP5 = 1 / P5;
+
+		// dE/dalpha_i * dalpha_i/dGpol_i
+		m_BornGDeda.resize( atoms );
+		for(int i = 0; i < atoms; i++) {
+			m_BornGDeda[i] = -sqr(GB_atom_param[i].bornradius) / -166.0 * GB_atom_param[i].deda;
+		}
 
-			gpi = -sqr(GB_atom_param[i].bornradius) / -166.0;
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 64)
+#endif
+		for(int i = 0; i < atoms; i++) {
+			const double Ri = GBtype[wspace.atom[i].FFType].radius;
+			const double Vi = GB_atom_param_still[i].Vj;
+			const double gdedai = m_BornGDeda[i];
+			double dedix = 0.0, dediy = 0.0, dediz = 0.0;
 
 			//all neighbors
-			for(nj = 0; nj < fnbor[i].n; nj++) {
-				j = NList32Bit_Index(fnbor[i].i[nj]);
-				dddx = (wspace.cur.atom[j].p.x - wspace.cur.atom[i].p.x); // these are incomplete (need div by Dist_ij)
-				dddy = (wspace.cur.atom[j].p.y - wspace.cur.atom[i].p.y);
-				dddz = (wspace.cur.atom[j].p.z - wspace.cur.atom[i].p.z);
-				srij = sqr(dddx) + sqr(dddy) + sqr(dddz);
-				
-				if(srij > sqr(GbsaStillCutoff))
+			for(int nj = 0; nj < fnbor[i].n; nj++) {
+				const int j = NList32Bit_Index(fnbor[i].i[nj]);
+				const double dddx = (wspace.cur.atom[j].p.x - wspace.cur.atom[i].p.x); // these are incomplete (need div by Dist_ij)
+				const double dddy = (wspace.cur.atom[j].p.y - wspace.cur.atom[i].p.y);
+				const double dddz = (wspace.cur.atom[j].p.z - wspace.cur.atom[i].p.z);
+				const double srij = sqr(dddx) + sqr(dddy) + sqr(dddz);
+
+				if(srij > sqrStillCutoff)
 					continue;
-				//if( j > i ) continue;
 				if(NList32Bit_BondOrder(fnbor[i].i[nj]) <= BondOrder_1_3_Pair)
 					continue;// only get non-bonded and 1-4 neighbors
-				
-				Rj = GBtype[wspace.atom[j].FFType].radius;
-
 
-				Vj = GB_atom_param_still[j].Vj;
+				const double Rj = GBtype[wspace.atom[j].FFType].radius;
+				const double Vj = GB_atom_param_still[j].Vj;
 
-				r6 = srij * srij * srij;
-				rdivR = srij / sqr((Ri + Rj));
+				const double r6 = srij * srij * srij;
+				const double rdivR = srij / sqr((Ri + Rj));
 
+				double CCF, dCCF;
 				if(rdivR > invP5) { // simple case, CCF = 1.0
 					CCF = 1.0;
 					dCCF = 0.0;
 				} else {
-					theta = rdivR * P5 * Maths::MathConst::PI;
-					sintheta = sin(theta);
-					costheta = cos(theta);
-					sqrtCCF = 0.5 - 0.5 * costheta;
+					const double theta = rdivR * P5 * Maths::MathConst::PI;
+					const double sqrtCCF = 0.5 - 0.5 * cos(theta);
 					CCF = sqr(sqrtCCF);
-					dCCF = 2.0 * sqrtCCF * sintheta * theta;
+					dCCF = 2.0 * sqrtCCF * sin(theta) * theta;
 				}
 
+				// CCF is symmetric, so the (i,j) and (j,i) terms only differ in the prefactor
+				const double dedr = P4 * (4.0 * CCF - dCCF) / r6 * (gdedai * Vj + m_BornGDeda[j] * Vi);
 
-				dedr = gpi * GB_atom_param[i].deda * P4 * Vj * (4.0 * CCF - dCCF) / r6;
-
-				dedx = dedr * dddx;
-				dedy = dedr * dddy;
-				dedz = dedr * dddz;
-
-				GB_atom_param[i].dedi.x += dedx;
-				GB_atom_param[i].dedi.y += dedy;
-				GB_atom_param[i].dedi.z += dedz;
-				GB_atom_param[j].dedi.x -= dedx;
-				GB_atom_param[j].dedi.y -= dedy;
-				GB_atom_param[j].dedi.z -= dedz;
-
+				dedix += dedr * dddx;
+				dediy += dedr * dddy;
+				dediz += dedr * dddz;
 			}
-		}
 
-		for(i = 0; i < atoms; i++) {
-			force.setTo(GB_atom_param[i].dedi);
-			force.mul(-1 / (PhysicsConst::Angstrom));
-			wspace.cur.atom[i].f.add(force);
+			GB_atom_param[i].dedi.x += dedix;
+			GB_atom_param[i].dedi.y += dediy;
+			GB_atom_param[i].dedi.z += dediz;
 		}
-		epot += epot_pol;
 	}
 
 
@@ -1446,14 +1523,79 @@ namespace Physics
 
 
 
-	void FF_GeneralizedBorn_Still::calcForcesIncludingVacuo()
+	void FF_GeneralizedBorn_Still::calcForcesIncludingVacuo(bool BornRadiiDerivative)
 	{
 		// Setup proxies to workspace to make code more readable.
 		WorkSpace& wspace = getWSpace();
-		size_t atoms = wspace.atom.size();              // number of atoms in workspace
-		const ParticleStore& atomparam = wspace.atom; // atom parameter array
+		const int atoms = wspace.atom.size();              // number of atoms in workspace
 		SnapShotAtom *atom = wspace.cur.atom;           // atom coordinate array
 
+		epot = 0;
+
+		for(int i = 0; i < atoms; i++)
+			GB_atom_param[i].position.setTo(atom[i].p);
+
+		// pair terms, in blocks of atoms (in parallel)
+		const int nblocks = setupAtomBlocks( 5 );
+		if( (int)m_BlockDirect.size() < 5 * atoms ) m_BlockDirect.resize( 5 * atoms );
+		std::vector<GB_BlockResult> result( nblocks );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for(int b = 0; b < nblocks; b++) {
+			const int iend = m_BlockStart[b+1];
+			if( b < nblocks - 1 ) calcForcesIncludingVacuo_Block( m_BlockStart[b], iend, &m_BlockForce[ m_BlockForceOffset[b] ], iend, result[b] );
+			else                  calcForcesIncludingVacuo_Block( m_BlockStart[b], iend, &m_BlockDirect[0], atoms, result[b] );
+		}
+		sumBlockAccumulators( nblocks, 5 );
+
+		double epot_vdw_sum = 0.0;
+		double epot_elec_sum = 0.0;
+		epot_pol_self = 0.0;
+		epot_pol_cross = 0.0;
+		for(int b = 0; b < nblocks; b++) {
+			epot_vdw_sum += result[b].epot_vdw;
+			epot_elec_sum += result[b].epot_elec;
+			epot_pol_self += result[b].epot_pol_self;
+			epot_pol_cross += result[b].epot_pol_cross;
+		}
+		epot_pol = epot_pol_cross + epot_pol_self;
+
+		wspace.ene.epot_vdw = epot_vdw_sum;
+		wspace.ene.epot_elec = epot_elec_sum;
+		wspace.ene.epot += epot_vdw_sum + epot_elec_sum;
+
+		//add electrostatic energy to the total
+		wspace.ene.epot += epot_pol;
+		//add electrostatic energy to the energy components
+		wspace.ene.epot_pol += epot_pol;
+		wspace.ene.epot_pol_cross += epot_pol_cross;
+		wspace.ene.epot_pol_self += epot_pol_self;
+
+		// Now add the second part of the derivative
+		if( BornRadiiDerivative ) calcBornRadiiForces();
+
+		dvector force;
+		for(int i = 0; i < atoms; i++) {
+			force.setTo(GB_atom_param[i].dedi);
+			force.mul((double) - 1.0 / (double) (PhysicsConst::Angstrom));
+			wspace.cur.atom[i].f.add(force);
+		}
+    epot_elec = wspace.ene.epot_elec;
+    epot_vdw  = wspace.ene.epot_vdw; 	
+
+	}
+
+
+	// Pair terms of calcForcesIncludingVacuo() for the atoms istart to iend-1. As 
+	// calcBornForces_Block() with the atomic energies in a fifth array acc[4n..5n-1]
+	void FF_GeneralizedBorn_Still::calcForcesIncludingVacuo_Block(int istart, int iend, double *acc, int n, GB_BlockResult &result)
+	{
+		// Setup proxies to workspace to make code more readable.
+		WorkSpace& wspace = getWSpace();
+		const ParticleStore& atomparam = wspace.atom; // atom parameter array
+
 		int i, j, nj;
 		int typej;
 
@@ -1487,7 +1629,6 @@ namespace Physics
 		double dedai;
 
 		double atomix, atomiy, atomiz, force_magnitude;
-		dvector fv, force;
 		double vdw_force = 0, // individual force magnitudes
 			elec_force = 0;
 		double vdw_potential = 0, // individual potential energy contributions
@@ -1500,38 +1641,27 @@ namespace Physics
 
 		double atomi_radius;
 		double atomi_epsilon;
-		dvector atomi_p;
 
-		wspace.ene.epot_vdw = 0;
-		wspace.ene.epot_elec = 0;
-
-		epot = 0;
-		epot_pol = 0.0;
-		epot_pol_self = 0.0;
-		epot_pol_cross = 0.0;
-
-		atoms = wspace.atom.size();
+		double epot_vdw = 0.0;
+		double epot_elec = 0.0;
+		double epot_pol_self = 0.0;
+		double epot_pol_cross = 0.0;
 
-		for(i = 0; i < atoms; i++)
-			GB_atom_param[i].position.setTo(atom[i].p);
+		double *dedix = acc;
+		double *dediy = acc + n;
+		double *dediz = acc + 2*n;
+		double *deda  = acc + 3*n;
+		double *atomepot = acc + 4*n;
+		memset( acc, 0, 5 * n * sizeof(double) );
 
 		premul = bornpremul;
 
-		// set all arrays to 0
-		for(i = 0; i < atoms; i++) 
-		{
-			GB_atom_param[i].dedi.setTo(0, 0, 0);
-			GB_atom_param[i].deda = 0.0;
-		}
-
-		int pairs=0;
-
-		for(i = 0; i < atoms; i++) 
+		for(i = istart; i < iend; i++) 
 		{
 			ai = GB_atom_param[i].bornradius;
-			atomix = atom[i].p.x;
-			atomiy = atom[i].p.y;
-			atomiz = atom[i].p.z;
+			atomix = GB_atom_param[i].position.x;
+			atomiy = GB_atom_param[i].position.y;
+			atomiz = GB_atom_param[i].position.z;
 			dedai = 0;
 
 			atomi_radius = atomparam[i].radius;
@@ -1556,8 +1686,6 @@ namespace Physics
 				if(srij>sqrcutoff) continue;
 				Dist_ij = sqrt(srij);
 
-				force_magnitude= 0; // total force/total pot. energy = 0
-
 				invdistij = 1 / Dist_ij; // inverse distance - universally required
 
 				aiaj = ai * aj;
@@ -1565,7 +1693,7 @@ namespace Physics
 				uGB = -srij * 0.25 / aiaj;
 
 				pair_elec14scaling = 1.0;
-				if(NList32Bit_BondOrder(fnbor[i].i[nj]) == BondOrder_1_4_Pair)
+				if(typej == BondOrder_1_4_Pair)
 					pair_elec14scaling = Elec14Scaling;
 
 				// approximate GB and vacuo electrostatic
@@ -1584,22 +1712,12 @@ namespace Physics
 
 					dedr = -epol * (Dist_ij - 0.25 * Dist_ij * tGB) * lGB;
 					dedalpha = -epol * tGB * (1.0 - uGB) * lGB;
-					/*
-					lGB = srij + mGB;
-
-					fGB = sqrt(lGB);
-					epol = premul * qiqj / fGB;
-
-					dedr = -epol * (Dist_ij - 0.25 * Dist_ij * tGB) / lGB;
-					dedalpha = -epol * tGB * (1.0 - uGB) / lGB;
 
-					*/
 					if(typej >= 3) 
 					{ 
 						// only do vdw/elec for non-bonded and 1-4 neighbors
 						elec_potential = (double) PhysicsConst::econv_joule *invdielectric * pair_elec14scaling * qiqj * invdistij;
 						elec_force = -elec_potential * invdistij;
-						pairs++;
 					}
 					// Apply switching function (S)
 					if(Dist_ij >= InnerCutoff) 
@@ -1620,24 +1738,20 @@ namespace Physics
 					dedy = dedr * dddy;
 					dedz = dedr * dddz;
 
-					epot_pol += epol;
-					epot_pol += epol;
 					epot_pol_cross += epol;
 					epot_pol_cross += epol;
-					wspace.atom[i].epot += epol;
-					wspace.atom[j].epot += epol;
+					atomepot[i] += epol;
+					atomepot[j] += epol;
 
-					GB_atom_param[i].dedi.x += dedx;
-					GB_atom_param[i].dedi.y += dedy;
-					GB_atom_param[i].dedi.z += dedz;
-					GB_atom_param[j].dedi.x -= dedx;
-					GB_atom_param[j].dedi.y -= dedy;
-					GB_atom_param[j].dedi.z -= dedz;
+					dedix[i] += dedx;
+					dediy[i] += dedy;
+					dediz[i] += dedz;
+					dedix[j] -= dedx;
+					dediy[j] -= dedy;
+					dediz[j] -= dedz;
 
 					dedai += dedalpha * aj;
-					GB_atom_param[j].deda += dedalpha * ai;
-
-					
+					deda[j] += dedalpha * ai;
 				} 
 				else 
 				{
@@ -1671,7 +1785,6 @@ namespace Physics
 						radiusij = sqr(invdistij * (atomi_radius + GB_atom_param[j].radiusij));
 						epsilon = pair_vdw14scaling * atomi_epsilon * GB_atom_param[j].epsilon;
 
-						//invd6 = cube()*cube(invdistij); // 1/d^6 needed for vdw
 						B = cube(radiusij);
 						A = sqr(B);
 
@@ -1687,19 +1800,16 @@ namespace Physics
 
 							vdw_potential *= vdwS;
 						}
-						// printf(" %lf %lf \n",VdwCutoff, VdwInnerCutoff);
 
 						// add up potentials -----------------------------
 
-						wspace.ene.epot += vdw_potential;
-						wspace.ene.epot_vdw += vdw_potential;
-						wspace.atom[i].epot += vdw_potential * 0.5;
-						wspace.atom[j].epot += vdw_potential * 0.5;
+						epot_vdw += vdw_potential;
+						atomepot[i] += vdw_potential * 0.5;
+						atomepot[j] += vdw_potential * 0.5;
 					}
-					wspace.ene.epot += elec_potential;
-					wspace.ene.epot_elec += elec_potential;
-					wspace.atom[i].epot += elec_potential * 0.5;
-					wspace.atom[j].epot += elec_potential * 0.5;
+					epot_elec += elec_potential;
+					atomepot[i] += elec_potential * 0.5;
+					atomepot[j] += elec_potential * 0.5;
 
 					// now apply the force
 					force_magnitude= 0;
@@ -1710,111 +1820,27 @@ namespace Physics
 					dedy = force_magnitude* dddy;
 					dedz = force_magnitude* dddz;
 
-					GB_atom_param[i].dedi.x += dedx;
-					GB_atom_param[i].dedi.y += dedy;
-					GB_atom_param[i].dedi.z += dedz;
-					GB_atom_param[j].dedi.x -= dedx;
-					GB_atom_param[j].dedi.y -= dedy;
-					GB_atom_param[j].dedi.z -= dedz;
+					dedix[i] += dedx;
+					dediy[i] += dedy;
+					dediz[i] += dedz;
+					dedix[j] -= dedx;
+					dediy[j] -= dedy;
+					dediz[j] -= dedz;
 				}
 			}
-			GB_atom_param[i].deda += dedai;
+			deda[i] += dedai;
 
 			epol = premul * sqr(qi) / ai;
-			epot_pol += epol; // add up energies
 			epot_pol_self += epol;
-			wspace.atom[i].epot += epol;
-
-			GB_atom_param[i].deda += -epol / ai;
-		}
-
-		//add electrostatic energy to the total
-		wspace.ene.epot += epot_pol;
-		//add electrostatic energy to the energy components
-		wspace.ene.epot_pol += epot_pol;
-		wspace.ene.epot_pol_cross += epot_pol_cross;
-		wspace.ene.epot_pol_self += epot_pol_self;
-		//printf("pairs: %d \n",pairs);
-		// ---------------------------------------------------------------------------
-		// Now add the second part of the derivative
-		int Type;
-		double gpi;
-		double invP5;
-		double sqrtCCF, CCF, dCCF;
-		double rdivR;
-		double Rj, Ri;
-		double Vj;
-		double r6;
-		double theta, costheta, sintheta;
-		invP5 = 1 / P5;
-
-		for(i = 0; i < wspace.atom.size(); i++) {
-			Type = wspace.atom[i].FFType;
-			Ri = GBtype[Type].radius;
+			atomepot[i] += epol;
 
-			gpi = -sqr(GB_atom_param[i].bornradius) / -166.0;
-
-			//all neighbors
-			for(nj = 0; nj < fnbor[i].n; nj++) {
-				j = NList32Bit_Index(fnbor[i].i[nj]);
-				dddx = (wspace.cur.atom[j].p.x - wspace.cur.atom[i].p.x); // these are incomplete (need div by Dist_ij)
-				dddy = (wspace.cur.atom[j].p.y - wspace.cur.atom[i].p.y);
-				dddz = (wspace.cur.atom[j].p.z - wspace.cur.atom[i].p.z);
-				srij = sqr(dddx) + sqr(dddy) + sqr(dddz);
-				
-				if(srij > sqr(GbsaStillCutoff))
-					continue;
-				//if( j >= i) continue;
-				if(NList32Bit_BondOrder(fnbor[i].i[nj]) <= BondOrder_1_3_Pair)
-					continue;// only get non-bonded and 1-4 neighbors
-				
-				// but treat shadow and normal neighbors the same
-				Rj = GBtype[wspace.atom[j].FFType].radius;
-
-
-				Vj = GB_atom_param_still[j].Vj;
-
-				//srij = sqr(rij);
-				r6 = srij * srij * srij;
-				rdivR = srij / sqr((Ri + Rj));
-
-				if(rdivR > invP5) { // simple case, CCF = 1.0
-					CCF = 1.0;
-					dCCF = 0.0;
-				} else {
-					theta = rdivR * P5 * Maths::MathConst::PI;
-					sintheta = sin(theta);
-					costheta = cos(theta);
-					sqrtCCF = 0.5 - 0.5 * costheta;
-					CCF = sqr(sqrtCCF);
-					dCCF = 2.0 * sqrtCCF * sintheta * theta;
-				}
-
-
-				dedr = gpi * GB_atom_param[i].deda * P4 * Vj * (4.0 * CCF - dCCF) / r6;
-
-				dedx = dedr * dddx;
-				dedy = dedr * dddy;
-				dedz = dedr * dddz;
-
-				GB_atom_param[i].dedi.x += dedx;
-				GB_atom_param[i].dedi.y += dedy;
-				GB_atom_param[i].dedi.z += dedz;
-				GB_atom_param[j].dedi.x -= dedx;
-				GB_atom_param[j].dedi.y -= dedy;
-				GB_atom_param[j].dedi.z -= dedz;
-
-			}
+			deda[i] += -epol / ai;
 		}
 
-		for(i = 0; i < atoms; i++) {
-			force.setTo(GB_atom_param[i].dedi);
-			force.mul((double) - 1.0 / (double) (PhysicsConst::Angstrom));
-			wspace.cur.atom[i].f.add(force);
-		}
-    epot_elec = wspace.ene.epot_elec;
-    epot_vdw  = wspace.ene.epot_vdw; 	
-
+		result.epot_vdw = epot_vdw;
+		result.epot_elec = epot_elec;
+		result.epot_pol_self = epot_pol_self;
+		result.epot_pol_cross = epot_pol_cross;
 	}
 } // namespace Physics
 
@@ -73,6 +73,10 @@ namespace Physics{
 
 		virtual FF_GeneralizedBorn* clone() const { return new FF_GeneralizedBorn(*this); }
 
+		/// The born radii depend on all atom positions, i.e. the energy cannot be split into
+		/// the contributions of individual atoms
+		virtual bool supportsMovedAtomEnergy() const { return false; }
+
     double getEPol() const { return epot_pol; }
   protected:
     double epot_pol; // born energy
@@ -127,11 +131,21 @@ namespace Physics{
 		bool FastMode; // ultrafast mode doing vdw and estat as well in one function
 		double DielectricSolvent;
 		double DielectricSolute;
+
+		/// Cutoff for the pairwise born radius sum (Still et al.). The neighbour list is 
+		/// extended to this distance if it is larger than Cutoff.
 		double GbsaStillCutoff;
+
 		double ExpApproxThreshold;
 		double DielectricOffset;
 		double BornRadiusOffset;
 
+		/// Recalculate the born radii only every this many energy/force evaluations 
+		/// (default 1, i.e. always). In between the radii are held constant and the forces 
+		/// are those of the GB energy with constant radii, i.e. they do not include the 
+		/// derivatives of the radii with respect to the atom positions.
+		int BornRadiiUpdateInterval;
+
 	protected:
 		virtual void setup();
 
@@ -168,6 +182,15 @@ namespace Physics{
 			double Vj;
 		};
 
+		/// Energies of one block of atoms (see FF_NonBonded::setupAtomBlocks())
+		struct GB_BlockResult
+		{
+			double epot_vdw;
+			double epot_elec;
+			double epot_pol_self;
+			double epot_pol_cross;
+		};
+
 		std::vector<GB_AtomType> GBtype;
 		std::vector<GB_Atom_Param_Still> GB_atom_param_still;
 		std::vector<GB_Atom_Param> GB_atom_param; 
@@ -179,24 +202,37 @@ namespace Physics{
 		double epot_pol_self; // components of the above
 		double epot_pol_cross;
 
+		int m_BornRadiiAge; // evaluations since the born radii were last calculated
+		std::vector<double> m_BlockDirect; // derivative accumulation arrays of the last atom block
+		std::vector<double> m_BornGDeda;   // dE/dalpha * dalpha/dGpol per atom
+
 		int readGeneralisedBornSolvationSection();
 
 		// Born Radii calculations
 		int calcFixedBornRadiiTerms();
 		int calcBornRadii_constant(double constBornRadius);
 		int calcBornRadii_PairwiseApprox();
+
+		/// Recalculates the born radii if BornRadiiUpdateInterval evaluations have passed, 
+		/// returns true if it did.
+		bool updateBornRadii();
 		
 		void calcBornEnergy_covalentTerms();
 		void calcBornEnergy();
 		void calcBornEnergy_verbose(ForcefieldBase::AtomicVerbosity verboselevel);
-		void calcBornForces();
+		void calcBornForces(bool BornRadiiDerivative = true);
+		void calcBornForces_Block(int istart, int iend, double *acc, int n, GB_BlockResult &result);
 		void calcBornForces_numerical(double dc, int dtype);
 
+		void sumBlockAccumulators(int nblocks, int nfields);
+		void calcBornRadiiForces();
+
 		// Specialized versions of the above that assume the bornradii are constant
 		void calcBornForces_constantBornRadii();
 		void calcForces_constantBornRadii_IncludingVacuo();
 
-		void calcForcesIncludingVacuo();
+		void calcForcesIncludingVacuo(bool BornRadiiDerivative = true);
+		void calcForcesIncludingVacuo_Block(int istart, int iend, double *acc, int n, GB_BlockResult &result);
 	};
 
 
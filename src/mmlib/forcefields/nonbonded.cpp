@@ -7,6 +7,25 @@
 #include "traits.h"
 #include "exception.h"
 #include "funcgen.h"
+#include "tools/cpufeatures.h"
+
+// Vector instruction sets for the SIMD kernel (FF_NonBonded_CalcForces_T_simd).
+// SSE2 is used whenever the compiler targets it (always the case on x86-64). The AVX 
+// version is compiled for its own target regardless of the compiler flags (GCC >= 4.9, 
+// MSVC 2010 SP1) and is only selected at runtime if cpuSimdLevel() reports AVX support.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define NB_SIMD_SSE2
+	#include <emmintrin.h>
+#endif
+#if defined(NB_SIMD_SSE2) && defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) && \
+	((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+	#define NB_SIMD_AVX
+	#define NB_SIMD_AVX_PRAGMA
+	#include <immintrin.h>
+#elif defined(NB_SIMD_SSE2) && defined(_MSC_FULL_VER) && (_MSC_FULL_VER >= 160040219)
+	#define NB_SIMD_AVX
+	#include <immintrin.h>
+#endif
 
 namespace Physics
 {
@@ -536,6 +555,7 @@ imageloop_continue:
 	const int T_ElecMode_DDDielectric_Levitt = 2;  // As above but with DDDielectric (a la Levitt)
 	const int	T_ElecMode_EnergySwitch = 3;         // Energy Switching
 	const int	T_ElecMode_ForceSwitch = 4;          // Force switching
+	const int	T_ElecMode_Ewald = 5;                // Ewald real space sum (erfc screened, see FF_PME)
 
 	const int T_VerboseMode_False = 0;
 	const int T_VerboseMode_True = 1;
@@ -618,6 +638,9 @@ imageloop_continue:
 		if(ff.InnerCutoff < ff.Cutoff) eshift = 1/ff.InnerCutoff + (fswitch_innerV - fswitch_cutoffV);
 		else                     eshift = 0;
 
+		// Ewald real space: d/dr erf(beta r) = ewaldfconst * exp(-(beta r)^2)
+		const double ewaldfconst = 2.0 * ff.EwaldCoeff / sqrt(MathConst::PI);
+
 		// statistics
 		int totalpairs = 0;
 		int pairs14 = 0;
@@ -801,6 +824,16 @@ imageloop_continue:
 						}
 					}
 
+					if( T_ElecMode == T_ElecMode_Ewald )
+					{
+						// The reciprocal sum (FF_PME) contains the erf(beta r)/r part of every pair, including
+						// the excluded and 1-4 ones, which is removed again here: (scale - erf(beta r))/r
+						const double qq = PhysicsConst::econv_joule * invdielectric * (qi * qj);
+						elec_potential = qq * (erfc(ff.EwaldCoeff * Dist_ij) + elec14scale - 1.0) * invdistij;
+						elec_force = -1E10 * invdistij * 
+							(elec_potential + qq * ewaldfconst * exp(-sqr(ff.EwaldCoeff * Dist_ij)));
+					}
+
 				}else{
 					elec_potential = 0;
 					elec_force = 0;
@@ -905,7 +938,7 @@ imageloop_continue:
 		Tptr ptr;
 		const static int limita=T_SqrtTable; 
 		const static int limitb=T_VdwMode_EnergySwitch;
-		const static int limitc=T_ElecMode_ForceSwitch;
+		const static int limitc=T_ElecMode_Ewald;
 		const static int limitd=T_VerboseMode_True;
 		static void overflow(){
 			throw(CodeException("CODE ERROR: FF_NonBonded_CalcForces_T_fast2_wrap template requested that is out of bounds.") ); 
@@ -915,6 +948,549 @@ imageloop_continue:
 
 
 
+	// ------------------------------------------------------------------------
+	//  Vectorised (SIMD) version of the above for the non-verbose production path
+	// ------------------------------------------------------------------------
+
+
+#ifdef NB_SIMD_SSE2
+
+	/// Number of neighbour pairs staged per vector pass (must be a multiple of the widest vector)
+	const int NB_SimdChunk = 64;
+
+
+	/// Thin wrappers around the SSE2 intrinsics (2 doubles per vector), used as 
+	/// the VT template parameter of FF_NonBonded_CalcForces_T_simd
+	struct NB_Simd_SSE2
+	{
+		typedef double Real;
+		typedef __m128d V;
+		enum { Width = 2 };
+		static inline V zero()                      { return _mm_setzero_pd(); }
+		static inline V set1( double a )            { return _mm_set1_pd( a ); }
+		static inline V load( const double *p )     { return _mm_load_pd( p ); }
+		static inline void store( double *p, V a )  { _mm_store_pd( p, a ); }
+		static inline V add( V a, V b )             { return _mm_add_pd( a, b ); }
+		static inline V sub( V a, V b )             { return _mm_sub_pd( a, b ); }
+		static inline V mul( V a, V b )             { return _mm_mul_pd( a, b ); }
+		static inline V div( V a, V b )             { return _mm_div_pd( a, b ); }
+		static inline V sqrt( V a )                 { return _mm_sqrt_pd( a ); }
+		static inline V lt( V a, V b )              { return _mm_cmplt_pd( a, b ); }
+		static inline V gt( V a, V b )              { return _mm_cmpgt_pd( a, b ); }
+		/// returns a where mask is set and b elsewhere
+		static inline V select( V mask, V a, V b )  { return _mm_or_pd( _mm_and_pd( mask, a ), _mm_andnot_pd( mask, b ) ); }
+		static inline double hsum( V a )
+		{
+			double t[2];
+			_mm_storeu_pd( t, a );
+			return t[0] + t[1];
+		}
+	};
+
+
+	/// As NB_Simd_SSE2 but single precision (4 floats per vector), used by FF_NonBonded::MixedPrecision.
+	/// hsum() converts the lanes to double before adding them up.
+	struct NB_Simd_SSE2_Float
+	{
+		typedef float Real;
+		typedef __m128 V;
+		enum { Width = 4 };
+		static inline V zero()                      { return _mm_setzero_ps(); }
+		static inline V set1( double a )            { return _mm_set1_ps( (float)a ); }
+		static inline V load( const float *p )      { return _mm_load_ps( p ); }
+		static inline void store( float *p, V a )   { _mm_store_ps( p, a ); }
+		static inline V add( V a, V b )             { return _mm_add_ps( a, b ); }
+		static inline V sub( V a, V b )             { return _mm_sub_ps( a, b ); }
+		static inline V mul( V a, V b )             { return _mm_mul_ps( a, b ); }
+		static inline V div( V a, V b )             { return _mm_div_ps( a, b ); }
+		static inline V sqrt( V a )                 { return _mm_sqrt_ps( a ); }
+		static inline V lt( V a, V b )              { return _mm_cmplt_ps( a, b ); }
+		static inline V gt( V a, V b )              { return _mm_cmpgt_ps( a, b ); }
+		/// returns a where mask is set and b elsewhere
+		static inline V select( V mask, V a, V b )  { return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) ); }
+		static inline double hsum( V a )
+		{
+			double t[4];
+			_mm_storeu_pd( t,     _mm_cvtps_pd( a ) );
+			_mm_storeu_pd( t + 2, _mm_cvtps_pd( _mm_movehl_ps( a, a ) ) );
+			return (t[0] + t[1]) + (t[2] + t[3]);
+		}
+	};
+
+
+	/// Energies and virial of one block of atoms, see FF_NonBonded_CalcForces_T_simd
+	struct NB_SimdResult
+	{
+		double epot_vdw;
+		double epot_elec;
+		double vdwcor;      ///< longrange vdw correction (already included in epot_vdw)
+		double virial;
+	};
+
+
+	typedef void (*NB_SimdKernel)(
+		const FF_NonBonded   &ff,
+		const NonBonded_Pack *local_atomparam,
+		const Maths::dvector *basisvector,
+		const NeighbourData  *fnbor,
+		const SnapShotSoA    &soa,
+		int istart, int iend,
+		double *pfx, double *pfy, double *pfz,
+		NB_SimdResult &result);
+
+
+	/// \details Vectorised version of FF_NonBonded_CalcForces_T_fast2 for T_SqrtFPU and
+	/// T_VerboseMode_False, templated on the vector type VT (NB_Simd_SSE2 or NB_Simd_AVX, or
+	/// their single precision counterparts NB_Simd_SSE2_Float and NB_Simd_AVX_Float).
+	///
+	/// The kernel only evaluates the neighbour list rows of the atoms istart to iend-1.
+	/// Coordinates are read from soa, the forces on the atoms i and on their neighbours j < i
+	/// are accumulated in pfx, pfy, pfz (which must hold at least iend elements) and the
+	/// energies and virial are returned in result. FF_NonBonded::calcForces_Simd() splits
+	/// the atoms into blocks and makes one call per block, possibly in parallel.
+	///
+	/// The neighbours of each atom i are processed in chunks of NB_SimdChunk pairs. A scalar
+	/// pass computes the separation vectors (including the periodic image shift), drops pairs
+	/// beyond the cutoff as well as fully excluded pairs (1-2 and 1-3, which contribute exactly
+	/// nothing) and gathers the pair parameters from NonBonded_Pack into aligned staging arrays.
+	/// The vector pass then evaluates LJ and Coulomb energies, forces and switching functions
+	/// VT::Width pairs at a time, using masks and selects instead of the branches of the scalar
+	/// kernel. Finally a scalar pass scatters the forces onto atoms i and j.
+	///
+	/// The arithmetic per pair is the same expression, evaluated in the same order, as in the
+	/// scalar kernel. Energies and the virial are however summed per vector lane over a chunk
+	/// before being added to the (double precision) totals, and the compiler may contract the
+	/// scalar code into fused multiply-adds, so the results are not bit identical. In double
+	/// precision energies and forces agree with the scalar kernel to a relative tolerance of
+	/// 1E-10 (typically ~1E-13).
+	///
+	/// In single precision (mixed precision mode) the separation vectors are still formed and
+	/// the forces and energies still accumulated in double precision, only the pair terms are
+	/// evaluated in float. Forces then agree with the double precision kernel to 1E-5 relative
+	/// to the largest force in the system and total energies to better than 1E-5 kcal/mol per
+	/// atom (typically 1E-6). Note that the relative error of a total can be much larger when
+	/// it is the small difference of large positive and negative contributions.
+	template <
+		class VT,
+		int T_VdwMode,
+		int T_ElecMode
+	>
+	void FF_NonBonded_CalcForces_T_simd(
+	const FF_NonBonded   &ff,
+	const NonBonded_Pack *local_atomparam,
+	const Maths::dvector *basisvector,
+	const NeighbourData  *fnbor,
+	const SnapShotSoA    &soa,
+	int istart, int iend,
+	double *pfx, double *pfy, double *pfz,
+	NB_SimdResult &result)
+	{
+		using namespace Maths;
+		typedef typename VT::V V;
+		typedef typename VT::Real Real;
+
+		const double *px = soa.x;
+		const double *py = soa.y;
+		const double *pz = soa.z;
+
+		const double sqrcutoff = sqr(ff.Cutoff);
+		const double sqrinnercutoff = sqr(ff.InnerCutoff);
+		const double invdielectric = 1.0 / ff.Dielectric;
+
+		// elec & vdw switching
+		const double invSwidth = 1.0 / (ff.Cutoff - ff.InnerCutoff);
+		const double vdwinvSwidth = 1.0 / (ff.VdwCutoff - ff.VdwInnerCutoff);
+
+		// precalculated stuff for force switching (identical to the scalar kernel)
+		const double sA = 1.0/cube( sqr(ff.Cutoff) - sqr(ff.InnerCutoff) );
+		const double sB = -(  cube(sqr(ff.Cutoff)) - 3.0* sqr(ff.Cutoff) * sqr(ff.Cutoff) * sqr(ff.InnerCutoff));
+		const double sC = 6.0* sqr(ff.Cutoff) * sqr(ff.InnerCutoff);
+		const double sD = -(sqr(ff.Cutoff) + sqr(ff.InnerCutoff));
+		const double sE = 2.0/5.0;
+		const double fswitch_innerV = sA * (sB * (1.0/ff.InnerCutoff) + 
+			sC * ff.InnerCutoff + 
+			sD * cube(ff.InnerCutoff) + 
+			sE * cube(ff.InnerCutoff) * sqr(ff.InnerCutoff));
+		const double fswitch_cutoffV = sA * (sB * (1.0/ff.Cutoff)     + 
+			sC * ff.Cutoff      + 
+			sD * cube(ff.Cutoff)      + 
+			sE * cube(ff.Cutoff)      * sqr(ff.Cutoff));
+		double eshift;
+		if(ff.InnerCutoff < ff.Cutoff) eshift = 1/ff.InnerCutoff + (fswitch_innerV - fswitch_cutoffV);
+		else                     eshift = 0;
+
+		// low bondorder scaling
+		double tabVdw14Scaling[8] = {0.0, 0.0, 0.0, ff.Vdw14Scaling, 1.0, 1.0, 1.0, 1.0};
+		double tabElec14Scaling[8] = {0.0, 0.0, 0.0, ff.Elec14Scaling, 1.0, 1.0, 1.0, 1.0};
+
+		// broadcast constants
+		const V vZero          = VT::zero();
+		const V vOne           = VT::set1( 1.0 );
+		const V vTwo           = VT::set1( 2.0 );
+		const V vHalf          = VT::set1( 0.5 );
+		const V vVdwForce      = VT::set1( 12.0E10 );
+		const V vVdwCutoff     = VT::set1( ff.VdwCutoff );
+		const V vVdwInner      = VT::set1( ff.VdwInnerCutoff );
+		const V vVdwinvSwidth  = VT::set1( vdwinvSwidth );
+		const V vVdwdSddScale  = VT::set1( -4.0E10 * sqr(vdwinvSwidth) );
+		const V vElecScale     = VT::set1( PhysicsConst::econv_joule * invdielectric );
+		const V vElecForce     = VT::set1( -1E10 );
+		const V vInner         = VT::set1( ff.InnerCutoff );
+		const V vinvSwidth     = VT::set1( invSwidth );
+		const V vdSddScale     = VT::set1( -4.0E10 * sqr(invSwidth) );
+		const V vSqrCutoff     = VT::set1( sqrcutoff );
+		const V vFSwitchK      = VT::set1( sqrcutoff  - 3.0*sqrinnercutoff );
+		const V vsA            = VT::set1( sA );
+		const V vsB            = VT::set1( sB );
+		const V vsC            = VT::set1( sC );
+		const V vsD            = VT::set1( sD );
+		const V vsE            = VT::set1( sE );
+		const V vFSwitchCutV   = VT::set1( fswitch_cutoffV );
+		const V vEShift        = VT::set1( eshift );
+		const V vAngstrom      = VT::set1( PhysicsConst::Angstrom );
+
+		// energies and virial are always accumulated in double precision
+		double epot_vdw  = 0.0;
+		double epot_elec = 0.0;
+		double virial    = 0.0;
+
+		// staging arrays for one chunk of pairs, aligned for the widest vector type. 
+		// The separation vectors stay in double precision, the rest is in VT::Real
+		double stagemem[9*NB_SimdChunk + 4];
+		double *dx     = (double *)( ((size_t)&stagemem[0] + 31) & ~(size_t)31 );
+		double *dy     = dx     + NB_SimdChunk;
+		double *dz     = dy     + NB_SimdChunk;
+		Real   *r2     = (Real *)(dz + NB_SimdChunk);
+		Real   *rad    = r2     + NB_SimdChunk;
+		Real   *eps    = rad    + NB_SimdChunk;
+		Real   *escale = eps    + NB_SimdChunk;
+		Real   *qq     = escale + NB_SimdChunk;
+		Real   *fs     = qq     + NB_SimdChunk;
+		int jindex[NB_SimdChunk];
+
+		// the longrange vdw correction is a constant per atom
+		double vdwcor_potential = 0.0;
+		if(ff.VdwCor){
+			vdwcor_potential = -0.5*ff.VdwCorDensity * ff.VdwCorEpsilon / (PhysicsConst::J2kcal * PhysicsConst::Na)
+				* (8.0/3.0) * MathConst::PI * sqr(ff.VdwCorRadius) * 
+				sqr(ff.VdwCorRadius) * sqr(ff.VdwCorRadius) /
+				cube(ff.VdwCorCutoff);
+		}
+
+		double epot_vdwcor = 0.0;
+
+		// loop over the particles of this block
+		for(int i = istart; i < iend; i++) 
+		{
+			const double atomi_radius  = local_atomparam[i].radius;
+			const double atomi_epsilon = local_atomparam[i].epsilon;
+			const double qi            = local_atomparam[i].charge;
+			const double xi            = px[i];
+			const double yi            = py[i];
+			const double zi            = pz[i];
+
+			double fxi = 0.0, fyi = 0.0, fzi = 0.0;
+
+			const int fnborn = fnbor[i].n;
+			const int *nlistptr = &fnbor[i].i[0];
+			int nj = 0;
+			while( nj < fnborn )
+			{
+				// scalar pass: distances, cutoff test and parameter gather
+				int n = 0;
+				for( ; (nj < fnborn) && (n < NB_SimdChunk); nj++ )
+				{
+					int j         = nlistptr[nj];
+					int nbor_type = j>>24;
+					j            &= 0x00FFFFFF; 
+					if( j >= i ){  // ignore shadow neighbors !!
+						nj = fnborn;
+						break;
+					}
+
+					const double vdw14scale  = tabVdw14Scaling[(nbor_type&7)]; 
+					const double elec14scale = tabElec14Scaling[(nbor_type&7)];
+					if( (vdw14scale == 0.0) && (elec14scale == 0.0) ) continue;
+
+					const dvector &shift = basisvector[ (nbor_type>>3)&31];
+					const double fvx = (px[j] - xi) + shift.x;
+					const double fvy = (py[j] - yi) + shift.y;
+					const double fvz = (pz[j] - zi) + shift.z;
+					const double sqrdistij = fvx*fvx + fvy*fvy + fvz*fvz;
+
+					// the pair is always written but only kept (n advanced) if within the cutoff - 
+					// this avoids a badly predictable branch
+					dx[n]     = fvx;
+					dy[n]     = fvy;
+					dz[n]     = fvz;
+					r2[n]     = (Real)sqrdistij;
+					rad[n]    = (Real)(atomi_radius + local_atomparam[j].radius);
+					eps[n]    = (Real)(vdw14scale * atomi_epsilon * local_atomparam[j].epsilon);
+					escale[n] = (Real)elec14scale;
+					qq[n]     = (Real)(qi * local_atomparam[j].charge);
+					jindex[n] = j;
+					n += (sqrdistij <= sqrcutoff);
+				}
+				if( n == 0 ) continue;
+
+				// pad the last vector with dummy pairs which evaluate to exactly zero
+				const int nv = ((n + VT::Width - 1) / VT::Width) * VT::Width;
+				for(int k = n; k < nv; k++){
+					dx[k] = dy[k] = dz[k] = 0.0;
+					r2[k] = 1;
+					rad[k] = eps[k] = escale[k] = qq[k] = 0;
+				}
+
+				// vector pass: energies and force magnitudes. The per lane sums over one 
+				// chunk are added to the double precision totals afterwards.
+				V vEVdw    = vZero;
+				V vEElec   = vZero;
+				V vVirial  = vZero;
+				for(int k = 0; k < nv; k += VT::Width)
+				{
+					const V sqrdistij = VT::load( r2 + k );
+					const V Dist_ij   = VT::sqrt( sqrdistij );
+					const V invdistij = VT::div( vOne, Dist_ij );
+					V force_magnitude = vZero;
+
+					if( T_VdwMode > T_VdwMode_None){
+						const V epsilon = VT::load( eps + k );
+						V B = VT::mul( VT::load( rad + k ), invdistij );
+						B = VT::mul( B, B );
+						B = VT::mul( B, VT::mul( B, B ) );
+						const V A = VT::mul( B, B );
+						V vdw_potential = VT::mul( VT::mul( vTwo, epsilon ), VT::sub( VT::mul( vHalf, A ), B ) );
+						V vdw_force = VT::mul( VT::sub( vZero, VT::mul( VT::mul( vVdwForce, epsilon ), invdistij ) ), VT::sub( A, B ) );
+
+						if( T_VdwMode == T_VdwMode_EnergySwitch ){	
+							const V x = VT::sub( Dist_ij, vVdwInner );
+							V vdwS = VT::mul( vVdwinvSwidth, x );
+							vdwS = VT::sub( vOne, VT::mul( vdwS, vdwS ) );
+							const V vdwdSdd = VT::mul( VT::mul( vVdwdSddScale, x ), vdwS );
+							vdwS = VT::mul( vdwS, vdwS );
+							const V inswitch = VT::gt( Dist_ij, vVdwInner );
+							vdw_force     = VT::select( inswitch, VT::add( VT::mul( vdwS, vdw_force ), VT::mul( vdw_potential, vdwdSdd ) ), vdw_force );
+							vdw_potential = VT::select( inswitch, VT::mul( vdw_potential, vdwS ), vdw_potential );
+						}
+
+						const V incutoff = VT::lt( Dist_ij, vVdwCutoff );
+						vdw_potential = VT::select( incutoff, vdw_potential, vZero );
+						vdw_force     = VT::select( incutoff, vdw_force, vZero );
+
+						vEVdw = VT::add( vEVdw, vdw_potential );
+						force_magnitude = vdw_force;
+					}
+
+					if( T_ElecMode > T_ElecMode_None){
+						const V qiqj = VT::mul( VT::mul( vElecScale, VT::load( escale + k ) ), VT::load( qq + k ) );
+						V elec_potential;
+						V elec_force;
+
+						if( (T_ElecMode == T_ElecMode_Normal) || (T_ElecMode == T_ElecMode_EnergySwitch) ){
+							elec_potential = VT::mul( qiqj, invdistij );
+							elec_force = VT::mul( VT::mul( VT::sub( vZero, elec_potential ), invdistij ), VT::set1( 1E10 ) );
+						}
+
+						if( T_ElecMode == T_ElecMode_EnergySwitch ){
+							const V x = VT::sub( Dist_ij, vInner );
+							V S = VT::mul( vinvSwidth, x );
+							S = VT::sub( vOne, VT::mul( S, S ) );
+							const V dSdd = VT::mul( VT::mul( vdSddScale, x ), S );
+							S = VT::mul( S, S );
+							const V inswitch = VT::gt( Dist_ij, vInner );
+							elec_force     = VT::select( inswitch, VT::add( VT::mul( S, elec_force ), VT::mul( elec_potential, dSdd ) ), elec_force );
+							elec_potential = VT::select( inswitch, VT::mul( elec_potential, S ), elec_potential );
+						}
+
+						if( T_ElecMode == T_ElecMode_ForceSwitch ){
+							const V sqrinvdist = VT::mul( invdistij, invdistij );
+							const V fpre = VT::mul( vElecForce, qiqj );
+
+							// Dist_ij > InnerCutoff
+							const V cdiff = VT::sub( vSqrCutoff, sqrdistij );
+							const V outer_force = VT::mul( VT::mul( VT::mul( VT::mul( fpre, vsA ), sqrinvdist ), VT::mul( cdiff, cdiff ) ),
+								VT::add( vFSwitchK, VT::mul( vTwo, sqrdistij ) ) );
+							const V poly = VT::add( VT::add( VT::add( VT::mul( vsB, sqrinvdist ), vsC ), VT::mul( vsD, sqrdistij ) ), 
+								VT::mul( vsE, VT::mul( sqrdistij, sqrdistij ) ) );
+							const V outer_potential = VT::mul( qiqj, 
+								VT::sub( vZero, VT::sub( VT::mul( VT::mul( vsA, Dist_ij ), poly ), vFSwitchCutV ) ) );
+
+							// Dist_ij <= InnerCutoff
+							const V inner_force = VT::mul( fpre, sqrinvdist );
+							const V inner_potential = VT::mul( qiqj, VT::sub( invdistij, vEShift ) );
+
+							const V inswitch = VT::gt( Dist_ij, vInner );
+							elec_force     = VT::select( inswitch, outer_force, inner_force );
+							elec_potential = VT::select( inswitch, outer_potential, inner_potential );
+						}
+
+						vEElec = VT::add( vEElec, elec_potential );
+						force_magnitude = VT::add( force_magnitude, elec_force );
+					}
+
+					// for intermolecular forces add up virial components
+					vVirial = VT::add( vVirial, VT::mul( VT::mul( Dist_ij, force_magnitude ), vAngstrom ) );
+
+					VT::store( fs + k, VT::mul( invdistij, force_magnitude ) );
+				}
+				epot_vdw  += VT::hsum( vEVdw );
+				epot_elec += VT::hsum( vEElec );
+				virial    += VT::hsum( vVirial );
+
+				// scalar pass: scatter the forces
+				for(int k = 0; k < n; k++)
+				{
+					const int j = jindex[k];
+					const double f = fs[k];
+					const double fvx = dx[k] * f;
+					const double fvy = dy[k] * f;
+					const double fvz = dz[k] * f;
+					fxi += fvx;
+					fyi += fvy;
+					fzi += fvz;
+					pfx[j] -= fvx;
+					pfy[j] -= fvy;
+					pfz[j] -= fvz;
+				}
+			}
+			pfx[i] += fxi;
+			pfy[i] += fyi;
+			pfz[i] += fzi;
+
+			// add a vdw correction if required
+			if(ff.VdwCor){
+				epot_vdwcor += vdwcor_potential;
+			}
+		}
+
+		result.epot_vdw  = epot_vdw;
+		result.epot_elec = epot_elec;
+		result.vdwcor    = epot_vdwcor;
+		result.virial    = virial;
+	}
+
+
+	/// Returns the instantiation of FF_NonBonded_CalcForces_T_simd matching the requested
+	/// modes, or NULL for modes which have no vector implementation (the caller then
+	/// falls back to the scalar kernel).
+	template <class VT>
+	NB_SimdKernel FF_NonBonded_CalcForces_simd_select(
+	int                T_VdwMode,
+	int                T_ElecMode)
+	{
+		if( T_VdwMode == T_VdwMode_None ){
+			switch( T_ElecMode ){
+				case T_ElecMode_None:         return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_None, T_ElecMode_None>;
+				case T_ElecMode_Normal:       return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_None, T_ElecMode_Normal>;
+				case T_ElecMode_EnergySwitch: return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_None, T_ElecMode_EnergySwitch>;
+				case T_ElecMode_ForceSwitch:  return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_None, T_ElecMode_ForceSwitch>;
+			}
+		}else if( T_VdwMode == T_VdwMode_EnergySwitch ){
+			switch( T_ElecMode ){
+				case T_ElecMode_None:         return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_EnergySwitch, T_ElecMode_None>;
+				case T_ElecMode_Normal:       return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_EnergySwitch, T_ElecMode_Normal>;
+				case T_ElecMode_EnergySwitch: return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_EnergySwitch, T_ElecMode_EnergySwitch>;
+				case T_ElecMode_ForceSwitch:  return &FF_NonBonded_CalcForces_T_simd<VT, T_VdwMode_EnergySwitch, T_ElecMode_ForceSwitch>;
+			}
+		}
+		return NULL;
+	}
+
+#endif // NB_SIMD_SSE2
+
+
+#ifdef NB_SIMD_AVX
+
+// Everything in this block is compiled for AVX, independently of the compiler flags used for the 
+// rest of the file; it is only ever called if cpuSimdLevel() says the CPU and OS support AVX.
+// The kernel instantiations must be explicit and inside this block to pick up the target.
+#ifdef NB_SIMD_AVX_PRAGMA
+	#pragma GCC push_options
+	#pragma GCC target("avx")
+#endif
+
+	/// Thin wrappers around the AVX intrinsics (4 doubles per vector)
+	struct NB_Simd_AVX
+	{
+		typedef double Real;
+		typedef __m256d V;
+		enum { Width = 4 };
+		static inline V zero()                      { return _mm256_setzero_pd(); }
+		static inline V set1( double a )            { return _mm256_set1_pd( a ); }
+		static inline V load( const double *p )     { return _mm256_load_pd( p ); }
+		static inline void store( double *p, V a )  { _mm256_store_pd( p, a ); }
+		static inline V add( V a, V b )             { return _mm256_add_pd( a, b ); }
+		static inline V sub( V a, V b )             { return _mm256_sub_pd( a, b ); }
+		static inline V mul( V a, V b )             { return _mm256_mul_pd( a, b ); }
+		static inline V div( V a, V b )             { return _mm256_div_pd( a, b ); }
+		static inline V sqrt( V a )                 { return _mm256_sqrt_pd( a ); }
+		static inline V lt( V a, V b )              { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+		static inline V gt( V a, V b )              { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+		/// returns a where mask is set and b elsewhere
+		static inline V select( V mask, V a, V b )  { return _mm256_blendv_pd( b, a, mask ); }
+		static inline double hsum( V a )
+		{
+			double t[4];
+			_mm256_storeu_pd( t, a );
+			return (t[0] + t[1]) + (t[2] + t[3]);
+		}
+	};
+
+	/// As NB_Simd_AVX but single precision (8 floats per vector)
+	struct NB_Simd_AVX_Float
+	{
+		typedef float Real;
+		typedef __m256 V;
+		enum { Width = 8 };
+		static inline V zero()                      { return _mm256_setzero_ps(); }
+		static inline V set1( double a )            { return _mm256_set1_ps( (float)a ); }
+		static inline V load( const float *p )      { return _mm256_load_ps( p ); }
+		static inline void store( float *p, V a )   { _mm256_store_ps( p, a ); }
+		static inline V add( V a, V b )             { return _mm256_add_ps( a, b ); }
+		static inline V sub( V a, V b )             { return _mm256_sub_ps( a, b ); }
+		static inline V mul( V a, V b )             { return _mm256_mul_ps( a, b ); }
+		static inline V div( V a, V b )             { return _mm256_div_ps( a, b ); }
+		static inline V sqrt( V a )                 { return _mm256_sqrt_ps( a ); }
+		static inline V lt( V a, V b )              { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+		static inline V gt( V a, V b )              { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+		/// returns a where mask is set and b elsewhere
+		static inline V select( V mask, V a, V b )  { return _mm256_blendv_ps( b, a, mask ); }
+		static inline double hsum( V a )
+		{
+			double t[8];
+			_mm256_storeu_pd( t,     _mm256_cvtps_pd( _mm256_castps256_ps128( a ) ) );
+			_mm256_storeu_pd( t + 4, _mm256_cvtps_pd( _mm256_extractf128_ps( a, 1 ) ) );
+			return ((t[0] + t[1]) + (t[2] + t[3])) + ((t[4] + t[5]) + (t[6] + t[7]));
+		}
+	};
+
+	#define NB_SIMD_AVX_INSTANTIATE(VT,VDW,ELEC) \
+		template void FF_NonBonded_CalcForces_T_simd<VT, VDW, ELEC>( \
+			const FF_NonBonded&, const NonBonded_Pack*, const Maths::dvector*, const NeighbourData*, \
+			const SnapShotSoA&, int, int, double*, double*, double*, NB_SimdResult& );
+	#define NB_SIMD_AVX_INSTANTIATE_ALL(VT) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_None,         T_ElecMode_None ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_None,         T_ElecMode_Normal ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_None,         T_ElecMode_EnergySwitch ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_None,         T_ElecMode_ForceSwitch ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_EnergySwitch, T_ElecMode_None ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_EnergySwitch, T_ElecMode_Normal ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_EnergySwitch, T_ElecMode_EnergySwitch ) \
+		NB_SIMD_AVX_INSTANTIATE( VT, T_VdwMode_EnergySwitch, T_ElecMode_ForceSwitch ) \
+		template NB_SimdKernel FF_NonBonded_CalcForces_simd_select<VT>( int, int );
+	NB_SIMD_AVX_INSTANTIATE_ALL( NB_Simd_AVX )
+	NB_SIMD_AVX_INSTANTIATE_ALL( NB_Simd_AVX_Float )
+	#undef NB_SIMD_AVX_INSTANTIATE_ALL
+	#undef NB_SIMD_AVX_INSTANTIATE
+
+#ifdef NB_SIMD_AVX_PRAGMA
+	#pragma GCC pop_options
+#endif
+
+#endif // NB_SIMD_AVX
+
+
+
 	FF_NonBonded::FF_NonBonded( WorkSpace &newwspace ): 
 	ForcefieldBase( newwspace )
 	{
@@ -951,7 +1527,14 @@ imageloop_continue:
 		printf("VDW inner Cutoff:         %4.1lf A\n", VdwInnerCutoff);
 		printf("Elec.static Cutoff:       %4.1lf A\n", Cutoff);
 		printf("Elec.static inner Cutoff: %4.1lf A\n", InnerCutoff);
-		printf("Switching:                %s\n", ForceSwitch ? "Force switching" : (EnergySwitch ? "Potential switch" : "none"));
+		if(Ewald)
+		{
+			printf("Elec.static real space:   Ewald, erfc(%6.4lf/A * r)\n", EwaldCoeff);
+		}
+		else
+		{
+			printf("Switching:                %s\n", ForceSwitch ? "Force switching" : (EnergySwitch ? "Potential switch" : "none"));
+		}
 		if(VdwCor)
 		{
 			printf("VDW correction          yes\n");
@@ -962,6 +1545,8 @@ imageloop_continue:
 		}
 		printf("UsePartialRecalc:         %s\n", UsePartialRecalc ? "Yes" : "No");
 		printf("IgnoreIntraResidue:       %s\n", IgnoreIntraResidue ? "Yes" : "No");
+		printf("SIMD kernel:              %s\n", UseSimd ? cpuSimdLevelName(simdKernelLevel()) : "disabled");
+		printf("Mixed precision:          %s\n", MixedPrecision ? "Yes" : "No");
 	}
 
 
@@ -988,6 +1573,9 @@ imageloop_continue:
 		ForceSwitch=true;    
 		EnergySwitch=false;
 
+		Ewald = false;
+		EwaldCoeff = 0.0;
+
 		// longrange vdw correction
 		VdwCor = false;
 		VdwCorDensity = 0.0;
@@ -1000,6 +1588,9 @@ imageloop_continue:
 
 		IgnoreIntraResidue = false;
 
+		UseSimd = true;
+		MixedPrecision = false;
+
 		fast = 0;
 	}
 
@@ -1122,6 +1713,7 @@ imageloop_continue:
  
 		if(EnergySwitch)T_ElecMode    =  T_ElecMode_EnergySwitch;
 		if(ForceSwitch) T_ElecMode    =  T_ElecMode_ForceSwitch;
+		if(Ewald)       T_ElecMode    =  T_ElecMode_Ewald;
 
 		if(!DoElec)T_ElecMode         =  T_ElecMode_None;
 		if(!DoVdw)T_VdwMode           =  T_VdwMode_None;
@@ -1144,7 +1736,7 @@ imageloop_continue:
 			m_Nlist_FullUpdateCount = currentCount;  // remember latest count for next time
 		}
 
-		if( (!fullrecalc) && (UsePartialRecalc) ){ 
+		if( (!fullrecalc) && (UsePartialRecalc) && (!Ewald) ){ 
 			//getWSpace().old = getWSpace().cur;
 			//calcEnergies_T<false>(); 
 
@@ -1174,12 +1766,16 @@ imageloop_continue:
 
 		if(EnergySwitch)T_ElecMode    =  T_ElecMode_EnergySwitch;
 		if(ForceSwitch) T_ElecMode    =  T_ElecMode_ForceSwitch;
+		if(Ewald)       T_ElecMode    =  T_ElecMode_Ewald;
 		if(!DoElec)T_ElecMode         =  T_ElecMode_None;
 		if(!DoVdw)T_VdwMode           =  T_VdwMode_None;
 
-		tcall4<FF_NonBonded_CalcForces_T_fast2_wrap>
-			(T_SqrtMode, T_VdwMode, T_ElecMode, 0)
-			( *this,local_atomparam, &basisvector[0], wspace, Forcefield::Summary );
+		if( !calcForces_Simd( T_VdwMode, T_ElecMode ) )
+		{
+			tcall4<FF_NonBonded_CalcForces_T_fast2_wrap>
+				(T_SqrtMode, T_VdwMode, T_ElecMode, 0)
+				( *this,local_atomparam, &basisvector[0], wspace, Forcefield::Summary );
+		}
 
 		epot_elec = wspace.ene.epot_elec;
 		epot_vdw  = wspace.ene.epot_vdw; 	
@@ -1202,6 +1798,285 @@ imageloop_continue:
 
 	};
 
+	void FF_NonBonded::setupMovedAtomEnergy()
+	{
+		getWSpace().nlist().calcShadow(true);
+	}
+
+	double FF_NonBonded::calcMovedAtomEnergy( const std::vector<size_t> &moved )
+	{
+		using namespace Maths;
+		WorkSpace& wspace = getWSpace();
+		if( !wspace.nlist().hasShadowNeighbours() )
+		{
+			THROW(ProcedureException,"FF_NonBonded::calcMovedAtomEnergy() requires a neighbour list with shadow neighbours, call setupMovedAtomEnergy() first");
+		}
+
+		setupBasisVectors();
+
+		const ParticleStore& atomparam = wspace.atom;
+		const SnapShotAtom *atom = wspace.cur.atom;
+		const NeighbourData *fnbor = wspace.nlist().getData();
+
+		const double sqrcutoff = sqr(Cutoff);
+		const double invdielectric = 1.0 / Dielectric;
+
+		// switching constants, as in FF_NonBonded_CalcForces_T_fast2
+		const double invSwidth = 1.0 / (Cutoff - InnerCutoff);
+		const double vdwinvSwidth = 1.0 / (VdwCutoff - VdwInnerCutoff);
+		const double sA = 1.0/cube( sqr(Cutoff) - sqr(InnerCutoff) );
+		const double sB = -(  cube(sqr(Cutoff)) - 3.0* sqr(Cutoff) * sqr(Cutoff) * sqr(InnerCutoff));
+		const double sC = 6.0* sqr(Cutoff) * sqr(InnerCutoff);
+		const double sD = -(sqr(Cutoff) + sqr(InnerCutoff));
+		const double sE = 2.0/5.0;
+		const double fswitch_innerV = sA * (sB * (1.0/InnerCutoff) + sC * InnerCutoff + sD * cube(InnerCutoff) + sE * cube(InnerCutoff) * sqr(InnerCutoff));
+		const double fswitch_cutoffV = sA * (sB * (1.0/Cutoff) + sC * Cutoff + sD * cube(Cutoff) + sE * cube(Cutoff) * sqr(Cutoff));
+		double eshift = 0;
+		if(InnerCutoff < Cutoff) eshift = 1/InnerCutoff + (fswitch_innerV - fswitch_cutoffV);
+
+		int elecmode = T_ElecMode_Normal;
+		if(EnergySwitch) elecmode = T_ElecMode_EnergySwitch;
+		if(ForceSwitch)  elecmode = T_ElecMode_ForceSwitch;
+		if(Ewald)        elecmode = T_ElecMode_Ewald;
+
+		const double tabVdw14Scaling[8] = {0.0, 0.0, 0.0, Vdw14Scaling, 1.0, 1.0, 1.0, 1.0};
+		const double tabElec14Scaling[8] = {0.0, 0.0, 0.0, Elec14Scaling, 1.0, 1.0, 1.0, 1.0};
+
+		double energy = 0;
+		Maths::dvector fv;
+
+		for(size_t k = 0; k < moved.size(); k++)
+		{
+			const int i = moved[k];
+			const double atomi_radius  = local_atomparam[i].radius;
+			const double atomi_epsilon = local_atomparam[i].epsilon;
+			const double qi            = local_atomparam[i].charge;
+
+			for(int nj = 0; nj < fnbor[i].n; nj++)
+			{
+				int j = fnbor[i].i[nj];
+				const int nbor_type = j>>24;
+				j &= 0x00FFFFFF;
+
+				// pairs of two moved atoms are counted once only
+				if( (j < i) && atomparam[j].isMoved() ) continue;
+
+				const double vdw14scale  = tabVdw14Scaling[(nbor_type&7)];
+				const double elec14scale = tabElec14Scaling[(nbor_type&7)];
+
+				fv.diff(atom[j].p,atom[i].p);
+				fv.add( basisvector[ (nbor_type>>3)&31 ] );
+				const double sqrdistij = fv.innerdot();
+				if( sqrdistij > sqrcutoff ) continue;
+				const double Dist_ij = sqrt(sqrdistij);
+				const double invdistij = 1.0 / Dist_ij;
+
+				if( DoVdw && (Dist_ij < VdwCutoff) )
+				{
+					const double radiusij = atomi_radius + local_atomparam[j].radius;
+					const double epsilon = vdw14scale * atomi_epsilon * local_atomparam[j].epsilon;
+					double B = sqr(radiusij*invdistij);
+					B *= B*B;
+					const double A = sqr(B);
+					double vdw_potential = (2.0 * epsilon) * (0.5 * A - B);
+					if(Dist_ij > VdwInnerCutoff) {
+						vdw_potential *= sqr(1.0 - sqr(vdwinvSwidth * (Dist_ij - VdwInnerCutoff)));
+					}
+					energy += vdw_potential;
+				}
+
+				if( DoElec )
+				{
+					const double qj = local_atomparam[j].charge;
+					double elec_potential;
+					if( elecmode == T_ElecMode_Ewald )
+					{
+						const double qq = PhysicsConst::econv_joule * invdielectric * (qi * qj);
+						elec_potential = qq * (erfc(EwaldCoeff * Dist_ij) + elec14scale - 1.0) * invdistij;
+					}
+					else if( elecmode == T_ElecMode_ForceSwitch )
+					{
+						elec_potential = PhysicsConst::econv_joule * invdielectric * elec14scale * (qi * qj);
+						if(Dist_ij > InnerCutoff) {
+							elec_potential *=  -  ( sA * Dist_ij *
+								(sB * sqr(invdistij) + sC + sD * sqrdistij + sE * sqr(sqrdistij))
+								-fswitch_cutoffV); 
+						}else{
+							elec_potential *= (invdistij - eshift);
+						}
+					}
+					else
+					{
+						elec_potential = PhysicsConst::econv_joule * invdielectric * elec14scale * (qi * qj) * invdistij;
+						if( (elecmode == T_ElecMode_EnergySwitch) && (Dist_ij > InnerCutoff) ) {
+							elec_potential *= sqr(1.0 - sqr(invSwidth * (Dist_ij - InnerCutoff)));
+						}
+					}
+					energy += elec_potential;
+				}
+			}
+		}
+
+		return energy;
+	}
+
+	CpuSimdLevel FF_NonBonded::simdKernelLevel() const
+	{
+		CpuSimdLevel level = cpuSimdLevel();
+#ifdef NB_SIMD_AVX
+		if( level >= CpuSimd_AVX ) return CpuSimd_AVX;
+#endif
+#ifdef NB_SIMD_SSE2
+		if( level >= CpuSimd_SSE2 ) return CpuSimd_SSE2;
+#endif
+		return CpuSimd_None;
+	}
+
+	/// The atoms are split into at most this many blocks, each evaluated by one thread and 
+	/// with its own force buffer (see FF_NonBonded::setupAtomBlocks())
+	const int NB_MaxBlocks = 32;
+
+	/// Minimum number of atoms per block - smaller systems use fewer blocks
+	const int NB_MinBlockAtoms = 256;
+
+	int FF_NonBonded::setupAtomBlocks( int nfields )
+	{
+		WorkSpace& wspace = getWSpace();
+		const int natom = wspace.atom.size();
+		const NeighbourData *fnbor = wspace.nlist().getData();
+
+		// Split the atoms into blocks with about equal numbers of neighbour list entries. 
+		// The number of blocks depends on the system size only, never on the number of threads.
+		const int nblocks = Maths::min( NB_MaxBlocks, Maths::max( 1, natom / NB_MinBlockAtoms ) );
+		long long total = 0;
+		for(int i = 0; i < natom; i++) total += fnbor[i].n + 1;
+		m_BlockStart.resize( nblocks + 1 );
+		m_BlockStart[0] = 0;
+		int b = 1;
+		long long sum = 0;
+		for(int i = 0; (i < natom) && (b < nblocks); i++)
+		{
+			sum += fnbor[i].n + 1;
+			while( (b < nblocks) && (sum * nblocks >= total * b) ) m_BlockStart[b++] = i + 1;
+		}
+		while( b <= nblocks ) m_BlockStart[b++] = natom;
+
+		// As the neighbour lists only contain j < i (or have them first), the buffer of 
+		// a block only needs to cover the atoms up to the end of the block.
+		m_BlockForceOffset.resize( nblocks );
+		size_t bufsize = 0;
+		for(b = 0; b < nblocks - 1; b++)
+		{
+			m_BlockForceOffset[b] = bufsize;
+			bufsize += nfields * m_BlockStart[b+1];
+		}
+		if( m_BlockForce.size() < bufsize ) m_BlockForce.resize( bufsize );
+		return nblocks;
+	}
+
+	bool FF_NonBonded::calcForces_Simd( int T_VdwMode, int T_ElecMode )
+	{
+#ifdef NB_SIMD_SSE2
+		if( !UseSimd ) return false;
+		NB_SimdKernel kernel = NULL;
+		switch( simdKernelLevel() )
+		{
+#ifdef NB_SIMD_AVX
+		case CpuSimd_AVX:
+			if( MixedPrecision ) kernel = FF_NonBonded_CalcForces_simd_select<NB_Simd_AVX_Float>( T_VdwMode, T_ElecMode );
+			else                 kernel = FF_NonBonded_CalcForces_simd_select<NB_Simd_AVX>( T_VdwMode, T_ElecMode );
+			break;
+#endif
+		case CpuSimd_SSE2:
+			if( MixedPrecision ) kernel = FF_NonBonded_CalcForces_simd_select<NB_Simd_SSE2_Float>( T_VdwMode, T_ElecMode );
+			else                 kernel = FF_NonBonded_CalcForces_simd_select<NB_Simd_SSE2>( T_VdwMode, T_ElecMode );
+			break;
+		default:
+			break;
+		}
+		if( kernel == NULL ) return false;
+
+		WorkSpace& wspace = getWSpace();
+		const NeighbourData *fnbor = wspace.nlist().getData();
+		wspace.gatherSoA();
+		SnapShotSoA &soa = wspace.cursoa;
+
+		// Each block accumulates its forces in a private buffer, except for the last one which 
+		// uses the SoA force arrays directly.
+		const int nblocks = setupAtomBlocks( 3 );
+
+		std::vector<NB_SimdResult> result( nblocks );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic, 1)
+#endif
+		for(int blk = 0; blk < nblocks; blk++)
+		{
+			const int iend = m_BlockStart[blk+1];
+			double *fx = soa.fx;
+			double *fy = soa.fy;
+			double *fz = soa.fz;
+			if( blk < nblocks - 1 )
+			{
+				fx = &m_BlockForce[ m_BlockForceOffset[blk] ];
+				fy = fx + iend;
+				fz = fy + iend;
+				memset( fx, 0, 3 * iend * sizeof(double) );
+			}
+			kernel( *this, local_atomparam, &basisvector[0], fnbor, soa, 
+				m_BlockStart[blk], iend, fx, fy, fz, result[blk] );
+		}
+
+		// Add up the block buffers, always in the same order
+		const int nreduce = m_BlockStart[nblocks-1];
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for(int i = 0; i < nreduce; i++)
+		{
+			double fx = soa.fx[i];
+			double fy = soa.fy[i];
+			double fz = soa.fz[i];
+			for(int blk = 0; blk < nblocks - 1; blk++)
+			{
+				const int iend = m_BlockStart[blk+1];
+				if( i >= iend ) continue;
+				const double *f = &m_BlockForce[ m_BlockForceOffset[blk] ];
+				fx += f[i];
+				fy += f[iend + i];
+				fz += f[2*iend + i];
+			}
+			soa.fx[i] = fx;
+			soa.fy[i] = fy;
+			soa.fz[i] = fz;
+		}
+
+		double epot_vdw  = 0.0;
+		double epot_elec = 0.0;
+		double vdwcor    = 0.0;
+		double virial    = 0.0;
+		for(int b = 0; b < nblocks; b++)
+		{
+			epot_vdw  += result[b].epot_vdw;
+			epot_elec += result[b].epot_elec;
+			vdwcor    += result[b].vdwcor;
+			virial    += result[b].virial;
+		}
+
+		wspace.ene.epot_vdw = vdwcor + epot_vdw;
+		wspace.ene.epot_elec = epot_elec;
+		wspace.ene.epot += vdwcor + epot_vdw + epot_elec;
+		wspace.ene.epot_vdw_att += vdwcor;
+		wspace.ene.InternalVirial += virial;
+		epot = wspace.ene.epot_vdw + wspace.ene.epot_elec;
+
+		wspace.scatterSoAForces();
+		return true;
+#else
+		return false;
+#endif
+	}
+
 	void FF_NonBonded::calcForces()
 	{ 
 		setupBasisVectors();
@@ -1215,13 +2090,17 @@ imageloop_continue:
 
 		if(EnergySwitch)T_ElecMode    =  T_ElecMode_EnergySwitch;
 		if(ForceSwitch) T_ElecMode    =  T_ElecMode_ForceSwitch;
+		if(Ewald)       T_ElecMode    =  T_ElecMode_Ewald;
 
 		if(!DoElec)T_ElecMode         =  T_ElecMode_None;
 		if(!DoVdw)T_VdwMode           =  T_VdwMode_None;
 
-		tcall4<FF_NonBonded_CalcForces_T_fast2_wrap>
-			(T_SqrtMode, T_VdwMode, T_ElecMode, 0)
-			( *this,local_atomparam, &basisvector[0], wspace, Forcefield::Summary );
+		if( !calcForces_Simd( T_VdwMode, T_ElecMode ) )
+		{
+			tcall4<FF_NonBonded_CalcForces_T_fast2_wrap>
+				(T_SqrtMode, T_VdwMode, T_ElecMode, 0)
+				( *this,local_atomparam, &basisvector[0], wspace, Forcefield::Summary );
+		}
 
 		epot_elec = wspace.ene.epot_elec;
 		epot_vdw  = wspace.ene.epot_vdw; 	
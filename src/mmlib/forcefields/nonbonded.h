@@ -10,6 +10,7 @@
 #include "workspace/workspace.h"
 #include "workspace/neighbourlist.h"
 #include "monitors/monitorbase.h"
+#include "tools/cpufeatures.h"
 
 class PD_API Particle;
 
@@ -121,10 +122,41 @@ namespace Physics
 		/// do potential shifting ?
 		bool   EnergySwitch;
 
+		/// Ewald real space electrostatics: the Coulomb interaction within Cutoff is screened by
+		/// erfc(EwaldCoeff * r) and excluded and 1-4 pairs are corrected for the part of their 
+		/// interaction which is contained in the reciprocal sum. ForceSwitch/EnergySwitch are 
+		/// ignored for the electrostatics. Only evaluated by the scalar kernel. Normally switched 
+		/// on by FF_PME, which adds the reciprocal sum. Default = false
+		bool   Ewald;
+
+		/// Ewald splitting parameter beta [1/Angstrom]
+		double EwaldCoeff;
+
 		bool   UsePartialRecalc;
 
 		bool   IgnoreIntraResidue;
 
+		/// Use the vectorised (SSE2/AVX) kernel for calcForces() and calcEnergies() if the CPU 
+		/// supports it. The instruction set is detected at runtime (see cpuSimdLevel()).
+		/// Results agree with the scalar kernel to a relative tolerance of 1E-10; only the 
+		/// summation order of the energies differs. Verbose energy printouts always 
+		/// use the scalar kernel. When compiled with OpenMP the vectorised kernel runs on all
+		/// threads; the atoms are split into a number of blocks which depends only on the
+		/// system size and the block results are added up in a fixed order, so energies 
+		/// and forces do not depend on the number of threads. Default = true
+		bool   UseSimd;
+
+		/// Mixed precision mode: the pair distances and LJ/Coulomb terms are computed in 
+		/// single precision (twice as many pairs per vector), while separation vectors, forces 
+		/// and energies are still accumulated in double precision. Energies agree with the 
+		/// double precision kernel to better than 1E-5 kcal/mol per atom, forces to 1E-5 of the
+		/// largest force. Only used by the vectorised kernel, i.e. it has no effect if UseSimd 
+		/// is false or the CPU has no SSE2. Default = false
+		bool   MixedPrecision;
+
+		/// The vector instruction set the kernel will use on this machine (CpuSimd_None if none)
+		CpuSimdLevel simdKernelLevel() const;
+
 		/// prints a little block of parameter information
 		void info() const;
 
@@ -187,6 +219,11 @@ namespace Physics
 
 		NonBonded_Pack *local_atomparam;
 
+		// atom blocks and their private force buffers, see setupAtomBlocks()
+		std::vector <int>    m_BlockStart;
+		std::vector <size_t> m_BlockForceOffset;
+		std::vector <double> m_BlockForce;
+
 		// a local store for the basis vectors
 		Maths::dvector basisvector[32];
 
@@ -211,6 +248,32 @@ namespace Physics
 		virtual void calcEnergies_Update();
 
 		virtual void calcForces();
+
+		/// Supported for the plain pairwise potential (see calcMovedAtomEnergy()), 
+		/// derived forcefields which change the energy function must override this.
+		virtual bool supportsMovedAtomEnergy() const { return true; }
+
+		/// Requests shadow neighbours, such that all interaction partners of an atom can be found 
+		/// from its own neighbour list
+		virtual void setupMovedAtomEnergy();
+
+		/// Same pair potential as the scalar kernel of calcEnergies(), summed over all pairs 
+		/// involving a moved atom. The (constant) long range VdW correction is not included.
+		virtual double calcMovedAtomEnergy( const std::vector<size_t> &moved );
+
+		/// Splits the atoms into blocks for parallel evaluation and returns their number. Block b 
+		/// holds the atoms m_BlockStart[b] to m_BlockStart[b+1]-1; the number of blocks and their 
+		/// boundaries depend only on the system size and the neighbour list, never on the number 
+		/// of threads. For all but the last block m_BlockForce is made to hold nfields private
+		/// accumulation arrays starting at m_BlockForceOffset[b], each as long as the number of 
+		/// atoms up to the end of the block. Adding up the buffers in block order gives results
+		/// which are independent of the number of threads.
+		int setupAtomBlocks( int nfields );
+
+		/// Runs the vectorised kernel (in parallel over blocks of atoms if compiled with OpenMP), 
+		/// returns false if it's disabled, unsupported by the CPU or has no implementation for
+		/// the requested modes.
+		bool calcForces_Simd( int T_VdwMode, int T_ElecMode );
 	};
 
 
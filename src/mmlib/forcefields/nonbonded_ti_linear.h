@@ -58,6 +58,9 @@ namespace Physics
 		virtual void calcEnergiesVerbose(ForcefieldBase::AtomicVerbosity level);
 		virtual void calcEnergies();
 		virtual void calcForces();
+
+		/// the lambda dependent potential is not implemented by calcMovedAtomEnergy()
+		virtual bool supportsMovedAtomEnergy() const { return false; }
 	};
 
 
@@ -0,0 +1,567 @@
+#include "global.h"
+
+#include "forcefields/pme.h"
+#include "forcefields/nonbonded.h"
+#include "workspace/workspace.h"
+#include "workspace/space.h"
+
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#endif
+
+using namespace Maths;
+
+namespace Physics
+{
+	namespace
+	{
+		/// Cardinal B-spline weights of order _Order at fractional offset _w (0 <= _w < 1) and
+		/// their derivatives, see Essmann et al. (1995)
+		void fillBSpline( double _w, int _Order, double *_Theta, double *_DTheta )
+		{
+			_Theta[_Order-1] = 0.0;
+			_Theta[1] = _w;
+			_Theta[0] = 1.0 - _w;
+			for( int k = 3; k < _Order; k++ )
+			{
+				double div = 1.0 / (k - 1);
+				_Theta[k-1] = div * _w * _Theta[k-2];
+				for( int j = 1; j <= k - 2; j++ )
+				{
+					_Theta[k-j-1] = div * ((_w + j) * _Theta[k-j-2] + (k - j - _w) * _Theta[k-j-1]);
+				}
+				_Theta[0] = div * (1.0 - _w) * _Theta[0];
+			}
+
+			// the derivatives follow from the splines of one order lower
+			_DTheta[0] = -_Theta[0];
+			for( int j = 1; j < _Order; j++ )
+			{
+				_DTheta[j] = _Theta[j-1] - _Theta[j];
+			}
+
+			double div = 1.0 / (_Order - 1);
+			_Theta[_Order-1] = div * _w * _Theta[_Order-2];
+			for( int j = 1; j <= _Order - 2; j++ )
+			{
+				_Theta[_Order-j-1] = div * ((_w + j) * _Theta[_Order-j-2] + (_Order - j - _w) * _Theta[_Order-j-1]);
+			}
+			_Theta[0] = div * (1.0 - _w) * _Theta[0];
+		}
+
+		/// smallest number >= _n with no prime factors other than 2, 3 and 5
+		int niceFFTSize( int _n )
+		{
+			for( ;; _n++ )
+			{
+				int r = _n;
+				while( r % 2 == 0 ) r /= 2;
+				while( r % 3 == 0 ) r /= 3;
+				while( r % 5 == 0 ) r /= 5;
+				if( r == 1 ) return _n;
+			}
+		}
+
+		/// One recursion level of a mixed radix decimation in time FFT of length
+		/// _m * _Factors[0] * ... (the structure follows KISS FFT). _Twiddle holds
+		/// exp(-2 pi i k / n) for the full length n, _Stride is n / (current length).
+		void fftWork( std::complex<double> *_Out, const std::complex<double> *_In, int _Stride,
+			const int *_Factors, const std::complex<double> *_Twiddle, int _n, bool _Forward,
+			std::complex<double> *_Scratch )
+		{
+			const int p = _Factors[0];
+			int m = 1;
+			for( const int *f = _Factors + 1; *f != 0; f++ ) m *= *f;
+
+			if( m == 1 )
+			{
+				for( int k = 0; k < p; k++ ) _Out[k] = _In[k * _Stride];
+			}
+			else
+			{
+				for( int k = 0; k < p; k++ )
+				{
+					fftWork( _Out + k * m, _In + k * _Stride, _Stride * p, _Factors + 1, _Twiddle, _n, _Forward, _Scratch );
+				}
+			}
+
+			// radix p butterflies
+			for( int u = 0; u < m; u++ )
+			{
+				for( int q = 0; q < p; q++ ) _Scratch[q] = _Out[u + q * m];
+				for( int q1 = 0; q1 < p; q1++ )
+				{
+					const int k = u + q1 * m;
+					std::complex<double> sum = _Scratch[0];
+					int tw = 0;
+					for( int q = 1; q < p; q++ )
+					{
+						tw += _Stride * k;
+						tw %= _n;
+						sum += _Scratch[q] * (_Forward ? _Twiddle[tw] : std::conj(_Twiddle[tw]));
+					}
+					_Out[k] = sum;
+				}
+			}
+		}
+	}
+
+	FF_PME::FF_PME( WorkSpace &newwspace, FF_NonBonded &_nb ):
+		ForcefieldBase( newwspace ),
+		m_NB( &_nb ),
+		m_PlanForward( NULL ),
+		m_PlanBackward( NULL )
+	{
+		name = "Particle Mesh Ewald";
+		ShortName = "PME";
+		settodefault();
+	}
+
+	FF_PME::FF_PME( const FF_PME &_Clone ):
+		ForcefieldBase( _Clone ),
+		EwaldTolerance( _Clone.EwaldTolerance ),
+		EwaldCoeff( _Clone.EwaldCoeff ),
+		GridSpacing( _Clone.GridSpacing ),
+		GridX( _Clone.GridX ),
+		GridY( _Clone.GridY ),
+		GridZ( _Clone.GridZ ),
+		SplineOrder( _Clone.SplineOrder ),
+		m_NB( _Clone.m_NB ),
+		m_Beta( _Clone.m_Beta ),
+		m_ERecip( _Clone.m_ERecip ),
+		m_ESelf( _Clone.m_ESelf ),
+		m_Charge( _Clone.m_Charge ),
+		m_Theta( _Clone.m_Theta ),
+		m_DTheta( _Clone.m_DTheta ),
+		m_Index( _Clone.m_Index ),
+		m_Grid( _Clone.m_Grid ),
+		m_PlanForward( NULL ), // the plans are made again on first use
+		m_PlanBackward( NULL )
+	{
+		for( int d = 0; d < 3; d++ )
+		{
+			m_K[d] = _Clone.m_K[d];
+			m_BSplineModuli[d] = _Clone.m_BSplineModuli[d];
+			m_Twiddle[d] = _Clone.m_Twiddle[d];
+			m_Factors[d] = _Clone.m_Factors[d];
+		}
+	}
+
+	FF_PME::~FF_PME()
+	{
+#ifdef HAVE_FFTW
+		if( m_PlanForward != NULL ) fftw_destroy_plan( (fftw_plan)m_PlanForward );
+		if( m_PlanBackward != NULL ) fftw_destroy_plan( (fftw_plan)m_PlanBackward );
+#endif
+	}
+
+	void FF_PME::settodefault()
+	{
+		EwaldTolerance = 1E-5;
+		EwaldCoeff = 0.0;
+		GridSpacing = 1.0;
+		GridX = 0;
+		GridY = 0;
+		GridZ = 0;
+		SplineOrder = 4;
+
+		m_Beta = 0.0;
+		m_K[0] = m_K[1] = m_K[2] = 0;
+		m_ERecip = 0.0;
+		m_ESelf = 0.0;
+	}
+
+	void FF_PME::setup()
+	{
+		WorkSpace& wspace = getWSpace();
+		const PeriodicBox *box = dynamic_cast<const PeriodicBox*>( &wspace.boundary() );
+		if( box == NULL )
+		{
+			THROW(ProcedureException,"FF_PME: Particle mesh Ewald requires a PeriodicBox boundary");
+		}
+		if( &m_NB->getWSpace() != &wspace )
+		{
+			THROW(ArgumentException,"FF_PME: The FF_NonBonded must use the same WorkSpace");
+		}
+		if( m_NB->DDDielectric )
+		{
+			THROW(ArgumentException,"FF_PME: Ewald summation cannot be used with a distance dependent dielectric");
+		}
+		if( (SplineOrder < 3) || (SplineOrder > 12) )
+		{
+			THROW(ArgumentException,"FF_PME: SplineOrder must be between 3 and 12");
+		}
+		if( (EwaldCoeff <= 0.0) && ((EwaldTolerance <= 0.0) || (EwaldTolerance >= 1.0)) )
+		{
+			THROW(ArgumentException,"FF_PME: EwaldTolerance must be between 0 and 1");
+		}
+		Active = true;
+
+		// Ewald splitting parameter: erfc(beta*Cutoff) = EwaldTolerance
+		m_Beta = EwaldCoeff;
+		if( m_Beta <= 0.0 )
+		{
+			double low = 0.0;
+			double high = 10.0 / m_NB->Cutoff;
+			for( int i = 0; i < 100; i++ )
+			{
+				m_Beta = 0.5 * (low + high);
+				if( erfc( m_Beta * m_NB->Cutoff ) > EwaldTolerance ) low = m_Beta;
+				else                                                 high = m_Beta;
+			}
+		}
+		m_NB->Ewald = true;
+		m_NB->EwaldCoeff = m_Beta;
+
+		// charges and the constant self energy
+		const int natom = wspace.nAtoms();
+		m_Charge.resize( natom );
+		double sumq2 = 0.0;
+		for( int i = 0; i < natom; i++ )
+		{
+			m_Charge[i] = wspace.atom[i].charge;
+			sumq2 += sqr( m_Charge[i] );
+		}
+		m_ESelf = -PhysicsConst::econv_joule / m_NB->Dielectric * m_Beta / sqrt(MathConst::PI) * sumq2;
+
+		// grid
+		dvector A, B, C;
+		box->getBoxVectors( A, B, C );
+		const double boxsize[3] = { A.x, B.y, C.z };
+		const int grid[3] = { GridX, GridY, GridZ };
+		for( int d = 0; d < 3; d++ )
+		{
+			if( grid[d] > 0 )
+			{
+				m_K[d] = grid[d];
+			}
+			else
+			{
+				if( GridSpacing <= 0.0 ) THROW(ArgumentException,"FF_PME: GridSpacing must be greater than zero");
+				m_K[d] = niceFFTSize( Maths::max( SplineOrder, (int)ceil( boxsize[d] / GridSpacing ) ) );
+			}
+			if( m_K[d] < SplineOrder )
+			{
+				THROW(ArgumentException,"FF_PME: The grid must have at least SplineOrder points along each dimension");
+			}
+
+			// B-spline moduli |b(m)|^2 (eq. 4.4 of Essmann et al.)
+			std::vector<double> theta( SplineOrder ), dtheta( SplineOrder );
+			fillBSpline( 0.0, SplineOrder, &theta[0], &dtheta[0] );
+			const int K = m_K[d];
+			m_BSplineModuli[d].resize( K );
+			for( int m = 0; m < K; m++ )
+			{
+				double sc = 0.0, ss = 0.0;
+				for( int j = 0; j < SplineOrder; j++ )
+				{
+					const double arg = MathConst::TwoPI * m * j / K;
+					sc += theta[j] * cos(arg);
+					ss += theta[j] * sin(arg);
+				}
+				m_BSplineModuli[d][m] = sqr(sc) + sqr(ss);
+			}
+			// odd orders have a zero at the Nyquist frequency
+			for( int m = 0; m < K; m++ )
+			{
+				if( m_BSplineModuli[d][m] < 1E-7 )
+				{
+					m_BSplineModuli[d][m] = 0.5 * (m_BSplineModuli[d][(m+K-1)%K] + m_BSplineModuli[d][(m+1)%K]);
+				}
+			}
+
+			// built-in FFT
+			m_Twiddle[d].resize( K );
+			for( int k = 0; k < K; k++ )
+			{
+				m_Twiddle[d][k] = std::polar( 1.0, -MathConst::TwoPI * k / K );
+			}
+			m_Factors[d].clear();
+			int n = K;
+			while( n % 4 == 0 ){ m_Factors[d].push_back( 4 ); n /= 4; }
+			while( n % 2 == 0 ){ m_Factors[d].push_back( 2 ); n /= 2; }
+			for( int p = 3; n > 1; p += 2 )
+			{
+				while( n % p == 0 ){ m_Factors[d].push_back( p ); n /= p; }
+			}
+			m_Factors[d].push_back( 0 ); // terminator
+		}
+
+		m_Grid.assign( (size_t)m_K[0] * m_K[1] * m_K[2], Complex(0.0, 0.0) );
+
+#ifdef HAVE_FFTW
+		if( m_PlanForward != NULL ) fftw_destroy_plan( (fftw_plan)m_PlanForward );
+		if( m_PlanBackward != NULL ) fftw_destroy_plan( (fftw_plan)m_PlanBackward );
+#endif
+		m_PlanForward = NULL;
+		m_PlanBackward = NULL;
+	}
+
+	// Include all variables who's change should trigger a resetup
+	unsigned long FF_PME::calcCheckSum()
+	{
+		unsigned long sum = ForcefieldBase::calcCheckSum();
+		sum += (unsigned long)( m_NB->Cutoff * 100000.0 ) +
+			(unsigned long)( EwaldCoeff * 1000000.0 ) +
+			(unsigned long)( -log10(EwaldTolerance) * 1000.0 ) +
+			(unsigned long)( GridSpacing * 10000.0 ) +
+			7 * GridX + 1031 * GridY + 104729 * GridZ + 13 * SplineOrder;
+		return sum;
+	}
+
+	void FF_PME::info() const
+	{
+		ForcefieldBase::info();
+		printf("Ewald coefficient:        %8.5lf 1/A\n", m_Beta);
+		printf("Real space cutoff:        %4.1lf A (FF_NonBonded)\n", m_NB->Cutoff);
+		printf("Grid:                     %d x %d x %d\n", m_K[0], m_K[1], m_K[2]);
+		printf("B-spline order:           %d\n", SplineOrder);
+#ifdef HAVE_FFTW
+		printf("FFT:                      FFTW\n");
+#else
+		printf("FFT:                      built-in\n");
+#endif
+	}
+
+	void FF_PME::infoLine() const
+	{
+		printf("% 8.1lf", double(epot) * PhysicsConst::J2kcal * PhysicsConst::Na);
+	}
+
+	void FF_PME::infoLineHeader() const
+	{
+		printf("%8s", "EPME");
+	}
+
+	void FF_PME::calcEnergiesVerbose(ForcefieldBase::AtomicVerbosity level)
+	{
+		calc( false );
+		printf(" Ewald reciprocal: %10.3lf kcal/mol\n", m_ERecip * PhysicsConst::J2kcal * PhysicsConst::Na);
+		printf(" Ewald self:       %10.3lf kcal/mol\n", m_ESelf * PhysicsConst::J2kcal * PhysicsConst::Na);
+	}
+
+	void FF_PME::calcEnergies()
+	{
+		calc( false );
+	}
+
+	void FF_PME::calcForces()
+	{
+		calc( true );
+	}
+
+	void FF_PME::calcSplines( const Maths::dvector &_Box )
+	{
+		WorkSpace& wspace = getWSpace();
+		const int natom = wspace.nAtoms();
+		const int order = SplineOrder;
+		const double box[3] = { _Box.x, _Box.y, _Box.z };
+
+		m_Theta.resize( 3 * order * natom );
+		m_DTheta.resize( 3 * order * natom );
+		m_Index.resize( 3 * natom );
+
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for( int i = 0; i < natom; i++ )
+		{
+			const dvector &p = wspace.cur.atom[i].p;
+			const double pos[3] = { p.x, p.y, p.z };
+			for( int d = 0; d < 3; d++ )
+			{
+				double s = pos[d] / box[d];
+				s -= floor( s );
+				const double u = s * m_K[d];
+				int iu = (int)u;
+				const double w = u - iu;
+				if( iu >= m_K[d] ) iu -= m_K[d];
+				m_Index[3*i+d] = (iu - order + 1 + m_K[d]) % m_K[d];
+				fillBSpline( w, order, &m_Theta[(3*i+d)*order], &m_DTheta[(3*i+d)*order] );
+			}
+		}
+	}
+
+	void FF_PME::fft( bool _Forward )
+	{
+#ifdef HAVE_FFTW
+		fftw_complex *data = reinterpret_cast<fftw_complex*>( &m_Grid[0] );
+		if( m_PlanForward == NULL )
+		{
+			// FFTW_ESTIMATE does not touch the grid while planning
+			m_PlanForward  = fftw_plan_dft_3d( m_K[0], m_K[1], m_K[2], data, data, FFTW_FORWARD,  FFTW_ESTIMATE | FFTW_UNALIGNED );
+			m_PlanBackward = fftw_plan_dft_3d( m_K[0], m_K[1], m_K[2], data, data, FFTW_BACKWARD, FFTW_ESTIMATE | FFTW_UNALIGNED );
+		}
+		fftw_execute_dft( (fftw_plan)(_Forward ? m_PlanForward : m_PlanBackward), data, data );
+#else
+		// one dimensional transforms along z, y and x; index = (x * K1 + y) * K2 + z
+		const int K[3] = { m_K[0], m_K[1], m_K[2] };
+		const int stride[3] = { K[1] * K[2], K[2], 1 };
+		for( int d = 2; d >= 0; d-- )
+		{
+			const int n = K[d];
+			const int a = (d + 1) % 3; // the other two dimensions
+			const int b = (d + 2) % 3;
+			const int nlines = K[a] * K[b];
+#ifdef HAVE_OPENMP
+			#pragma omp parallel
+#endif
+			{
+				std::vector<Complex> in( n ), out( n ), scratch( n );
+#ifdef HAVE_OPENMP
+				#pragma omp for schedule(static)
+#endif
+				for( int line = 0; line < nlines; line++ )
+				{
+					Complex *start = &m_Grid[ (line / K[b]) * stride[a] + (line % K[b]) * stride[b] ];
+					for( int k = 0; k < n; k++ ) in[k] = start[k * stride[d]];
+					fftWork( &out[0], &in[0], 1, &m_Factors[d][0], &m_Twiddle[d][0], n, _Forward, &scratch[0] );
+					for( int k = 0; k < n; k++ ) start[k * stride[d]] = out[k];
+				}
+			}
+		}
+#endif
+	}
+
+	void FF_PME::calc( bool _Forces )
+	{
+		WorkSpace& wspace = getWSpace();
+		const int natom = wspace.nAtoms();
+		const int order = SplineOrder;
+		const int K0 = m_K[0];
+		const int K1 = m_K[1];
+		const int K2 = m_K[2];
+
+		const PeriodicBox *pbox = dynamic_cast<const PeriodicBox*>( &wspace.boundary() );
+		if( pbox == NULL )
+		{
+			THROW(ProcedureException,"FF_PME: Particle mesh Ewald requires a PeriodicBox boundary");
+		}
+		dvector A, B, C;
+		pbox->getBoxVectors( A, B, C );
+		const dvector box( A.x, B.y, C.z );
+		const double volume = box.x * box.y * box.z;
+		const double prefactor = PhysicsConst::econv_joule / m_NB->Dielectric;
+
+		// spread the charges onto the grid
+		calcSplines( box );
+		std::fill( m_Grid.begin(), m_Grid.end(), Complex(0.0, 0.0) );
+		double qtotal = 0.0;
+		for( int i = 0; i < natom; i++ )
+		{
+			const double q = m_Charge[i];
+			qtotal += q;
+			if( q == 0.0 ) continue;
+			const double *tx = &m_Theta[(3*i+0)*order];
+			const double *ty = &m_Theta[(3*i+1)*order];
+			const double *tz = &m_Theta[(3*i+2)*order];
+			int ix = m_Index[3*i+0];
+			for( int jx = 0; jx < order; jx++, ix = (ix + 1 == K0 ? 0 : ix + 1) )
+			{
+				int iy = m_Index[3*i+1];
+				for( int jy = 0; jy < order; jy++, iy = (iy + 1 == K1 ? 0 : iy + 1) )
+				{
+					const double qxy = q * tx[jx] * ty[jy];
+					Complex *row = &m_Grid[ ((size_t)ix * K1 + iy) * K2 ];
+					int iz = m_Index[3*i+2];
+					for( int jz = 0; jz < order; jz++, iz = (iz + 1 == K2 ? 0 : iz + 1) )
+					{
+						row[iz] += qxy * tz[jz];
+					}
+				}
+			}
+		}
+
+		fft( true );
+
+		// Multiply with the reciprocal space kernel (eq. 3.9 of Essmann et al.). The energy is
+		// 1/2 sum_m eterm(m) |S(m)|^2 and InternalVirial gets its derivative with respect to a
+		// uniform scaling of the system, as for the pairwise forcefields.
+		const double pisqrinvbeta2 = sqr( MathConst::PI / m_Beta );
+		const double eprefactor = prefactor / (MathConst::PI * volume);
+		double energy = 0.0;
+		double virial = 0.0;
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for reduction(+:energy,virial) schedule(static)
+#endif
+		for( int kx = 0; kx < K0; kx++ )
+		{
+			const double mx = (kx <= K0/2 ? kx : kx - K0) / box.x;
+			for( int ky = 0; ky < K1; ky++ )
+			{
+				const double my = (ky <= K1/2 ? ky : ky - K1) / box.y;
+				const double bxy = m_BSplineModuli[0][kx] * m_BSplineModuli[1][ky];
+				Complex *row = &m_Grid[ ((size_t)kx * K1 + ky) * K2 ];
+				for( int kz = 0; kz < K2; kz++ )
+				{
+					if( (kx == 0) && (ky == 0) && (kz == 0) )
+					{
+						row[kz] = 0.0;
+						continue;
+					}
+					const double mz = (kz <= K2/2 ? kz : kz - K2) / box.z;
+					const double m2 = sqr(mx) + sqr(my) + sqr(mz);
+					const double eterm = eprefactor * exp( -pisqrinvbeta2 * m2 ) / (m2 * bxy * m_BSplineModuli[2][kz]);
+					const double ene = 0.5 * eterm * std::norm( row[kz] );
+					energy += ene;
+					virial += ene * (2.0 * pisqrinvbeta2 * m2 - 1.0);
+					row[kz] *= eterm;
+				}
+			}
+		}
+
+		// the neutralising background of a charged system
+		const double enet = -0.5 * prefactor * MathConst::PI * sqr(qtotal) / (volume * sqr(m_Beta));
+		energy += enet;
+		virial -= 3.0 * enet;
+
+		m_ERecip = energy;
+		epot = m_ERecip + m_ESelf;
+		wspace.ene.epot += epot;
+		wspace.ene.InternalVirial += virial;
+
+		if( !_Forces ) return;
+
+		// the convolution of the charges with the Ewald kernel is the derivative of the energy
+		// with respect to the grid charges
+		fft( false );
+
+		const double fscale[3] = { -1E10 * K0 / box.x, -1E10 * K1 / box.y, -1E10 * K2 / box.z };
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for( int i = 0; i < natom; i++ )
+		{
+			const double q = m_Charge[i];
+			if( q == 0.0 ) continue;
+			const double *tx = &m_Theta[(3*i+0)*order];
+			const double *ty = &m_Theta[(3*i+1)*order];
+			const double *tz = &m_Theta[(3*i+2)*order];
+			const double *dtx = &m_DTheta[(3*i+0)*order];
+			const double *dty = &m_DTheta[(3*i+1)*order];
+			const double *dtz = &m_DTheta[(3*i+2)*order];
+			double fx = 0.0, fy = 0.0, fz = 0.0;
+			int ix = m_Index[3*i+0];
+			for( int jx = 0; jx < order; jx++, ix = (ix + 1 == K0 ? 0 : ix + 1) )
+			{
+				int iy = m_Index[3*i+1];
+				for( int jy = 0; jy < order; jy++, iy = (iy + 1 == K1 ? 0 : iy + 1) )
+				{
+					const Complex *row = &m_Grid[ ((size_t)ix * K1 + iy) * K2 ];
+					int iz = m_Index[3*i+2];
+					for( int jz = 0; jz < order; jz++, iz = (iz + 1 == K2 ? 0 : iz + 1) )
+					{
+						const double c = row[iz].real();
+						fx += dtx[jx] * ty[jy] * tz[jz] * c;
+						fy += tx[jx] * dty[jy] * tz[jz] * c;
+						fz += tx[jx] * ty[jy] * dtz[jz] * c;
+					}
+				}
+			}
+			wspace.cur.atom[i].f.x += q * fscale[0] * fx;
+			wspace.cur.atom[i].f.y += q * fscale[1] * fy;
+			wspace.cur.atom[i].f.z += q * fscale[2] * fz;
+		}
+	}
+}
+
@@ -0,0 +1,151 @@
+#ifndef __FF_PME_H
+#define __FF_PME_H
+
+#include <vector>
+#include <complex>
+
+#include "forcefields/forcefield.h" // provides base class
+
+namespace Physics
+{
+	class FF_NonBonded;
+
+
+
+
+
+//-------------------------------------------------
+//
+/// \brief Smooth particle-mesh Ewald (PME) long range electrostatics for PeriodicBox systems
+///
+/// \details
+/// The Coulomb interaction is split into a short ranged part, erfc(beta r)/r, which is summed
+/// over the neighbour list by the FF_NonBonded given to the constructor, and a smooth long
+/// ranged part, erf(beta r)/r, which is summed over all periodic images in reciprocal space
+/// by this component. setup() switches the FF_NonBonded into its Ewald mode (see
+/// FF_NonBonded::Ewald), so both components must be added to the same Forcefield:
+///
+///   FF_NonBonded nb(wspace);
+///   nb.Cutoff = 10; nb.VdwCutoff = 10; nb.VdwInnerCutoff = 9;
+///   ff.add(nb);
+///   FF_PME pme(wspace, nb);
+///   ff.add(pme);
+///
+/// The charges are spread onto a regular grid with cardinal B-splines of order SplineOrder,
+/// the grid is Fourier transformed, multiplied by the Ewald kernel and transformed back;
+/// forces follow analytically from the derivatives of the B-splines. The reciprocal sum also
+/// contains the erf(beta r)/r interaction of excluded and 1-4 scaled pairs and of each charge
+/// with itself. The former is removed by the real space kernel of FF_NonBonded, the latter
+/// by the constant self energy -beta/sqrt(pi) sum q^2. Systems with a net charge are
+/// neutralised by a uniform background charge.
+///
+/// The Fourier transforms use FFTW 3 if PD is configured --with-fftw, and a built-in mixed
+/// radix FFT otherwise. The built-in version is fastest for grid sizes with factors 2, 3 and
+/// 5 only, which is what automatic grid sizing chooses.
+///
+/// The energy (reciprocal sum + self energy) is added to the total potential energy but not
+/// to Hamiltonian::epot_elec, which holds the real space part only. Dielectric is taken from
+/// the FF_NonBonded. Requires the (rectangular) PeriodicBox boundary.
+///
+/// References:
+/// [1] U. Essmann, L. Perera, M. L. Berkowitz, T. Darden, H. Lee and L. G. Pedersen,
+/// A smooth particle mesh Ewald method, J. Chem. Phys. 103, 8577-8593 (1995)
+///
+/// [2] T. Darden, D. York and L. Pedersen, Particle mesh Ewald: An N log(N) method for
+/// Ewald sums in large systems, J. Chem. Phys. 98, 10089-10092 (1993)
+///
+	class PD_API FF_PME: public ForcefieldBase
+	{
+	public:
+		FF_PME( WorkSpace &newwspace, FF_NonBonded &_nb );
+		FF_PME( const FF_PME &_Clone );
+		virtual ~FF_PME();
+
+		virtual FF_PME* clone() const { return new FF_PME(*this); }
+
+		virtual void settodefault();
+
+		/// Relative size of the real space interaction at the cutoff, erfc(beta*Cutoff), used to
+		/// derive the Ewald splitting parameter from FF_NonBonded::Cutoff. Default = 1E-5
+		double EwaldTolerance;
+
+		/// Ewald splitting parameter beta [1/Angstrom]. 0 derives it from EwaldTolerance. Default = 0
+		double EwaldCoeff;
+
+		/// Largest grid spacing [Angstrom] used for automatic grid sizing. Default = 1.0
+		double GridSpacing;
+
+		/// Number of grid points along x, y and z. 0 chooses the smallest number with factors 2, 3
+		/// and 5 only which gives a spacing of at most GridSpacing. Default = 0
+		int GridX;
+		int GridY;
+		int GridZ;
+
+		/// Order of the B-spline interpolation (4 = cubic). Higher orders are more accurate
+		/// on the same grid. Default = 4
+		int SplineOrder;
+
+		/// The Ewald splitting parameter in use [1/Angstrom] (valid after setup)
+		double getEwaldCoeff() const { return m_Beta; }
+
+		/// Reciprocal space energy of the last evaluation, including the net charge correction [J]
+		double getERecip() const { return m_ERecip; }
+
+		/// Self energy [J]
+		double getESelf() const { return m_ESelf; }
+
+	protected:
+		virtual void setup();
+		virtual unsigned long calcCheckSum();
+
+		virtual void calcEnergiesVerbose(ForcefieldBase::AtomicVerbosity level);
+		virtual void calcEnergies();
+		virtual void calcForces();
+
+		virtual void info() const;           ///< prints a little block of parameter information
+		virtual void infoLine() const;       ///< prints a line of current energies
+		virtual void infoLineHeader() const; ///< prints the headers for the above function
+
+	private:
+		typedef std::complex<double> Complex;
+
+		FF_PME& operator=( const FF_PME & ); // not implemented
+
+		/// Evaluates the energy and virial, and the forces if _Forces is true
+		void calc( bool _Forces );
+
+		/// Fills m_Theta/m_DTheta and m_Index for all atoms from the current positions
+		void calcSplines( const Maths::dvector &_Box );
+
+		/// Forward and backward 3D Fourier transform of m_Grid (unnormalised)
+		void fft( bool _Forward );
+
+		FF_NonBonded *m_NB;
+
+		double m_Beta;
+		int m_K[3];       ///< grid dimensions
+
+		double m_ERecip;
+		double m_ESelf;
+
+		std::vector<double> m_Charge;  ///< atom charges
+		std::vector<double> m_BSplineModuli[3];
+
+		std::vector<double> m_Theta;   ///< B-spline weights, natom*3*SplineOrder
+		std::vector<double> m_DTheta;  ///< and their derivatives
+		std::vector<int> m_Index;      ///< first grid point of each atom along x, y, z
+
+		std::vector<Complex> m_Grid;
+
+		/// built-in FFT: twiddle factors and factorisation of each dimension
+		std::vector<Complex> m_Twiddle[3];
+		std::vector<int> m_Factors[3];
+
+		/// FFTW plans (fftw_plan) when compiled with HAVE_FFTW
+		void *m_PlanForward;
+		void *m_PlanBackward;
+	};
+}
+
+#endif
+
@@ -4,6 +4,8 @@
 #include <vector>
 #include "tools/enum.h"
 
+class FFParamBinaryCache; // serialises the class definitions held by FFParamSet
+
 namespace Library
 {
 	// Filter what we actually require from our PDB file. Often, we just want the polypeptide.
@@ -80,6 +82,7 @@ namespace Library
 	class ResidueClassDef
 	{
 		friend class ClassMapper;
+		friend class ::FFParamBinaryCache;
 	public:
 		ResidueClassDef( const std::string& _Name );
 		const std::string& getName() const;
@@ -113,6 +116,7 @@ namespace Library
 	///
 	class PD_API ClassMapper
 	{
+		friend class ::FFParamBinaryCache;
 	public:
 		ClassMapper();
 		bool isOfClass( ExtdResidueClasses _Class, const std::string& _ResName ) const;
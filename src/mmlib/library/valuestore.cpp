@@ -42,6 +42,14 @@ bool ValueStore::hasName(size_t id, const std::string &_qname){
 	return false;
 }
 
+const std::string &ValueStore::getName(size_t id) const
+{
+	if( id >= m_Value.size() ){
+		throw(ArgumentException("Data ID given to ValueStore is invalid. No such piece of data."));
+	}
+	return m_Name[ m_Value[id].m_NameIndex ];
+}
+
 const std::string &ValueStore::getRawData(size_t id) const
 {
 	if( id >= m_Value.size() ){
@@ -70,6 +70,7 @@ namespace Library
 
 		/// check if a certain piece of data has a certain name associated with it
 		bool hasName(size_t id, const std::string &_qname);
+		const std::string& getName(size_t id) const;
 		const std::string& getRawData(size_t id) const;
 		void setRawData(size_t id, const std::string& _newData);
 
@@ -32,6 +32,7 @@ namespace Manipulator
 {	
 	int CartesianMove::apply()
 	{
+		clearTouchedAtoms();
 		if(fprob>0)
 		{
 			for(size_t im = 0; im < wspace->atom.size(); im++) 
@@ -49,11 +50,13 @@ namespace Manipulator
 				displaceAtom(im);
 			}
 		}
+		finishTouchedAtoms();
 		return 1;
 	}
 
 	void CartesianMove::displaceAtom(size_t i)
 	{
+		touchAtom(i);
 		double n1, n2, n3, n4;
 		nrand(n1, n2, xsigma);
 		nrand(n3, n4, xsigma);
@@ -267,22 +270,38 @@ namespace Manipulator
 
 		RotBond& rotbond = wspace->rotbond();
 
+		clearTouchedAtoms();
 		for(i = 0; i < rotbond.size(); i++) {
 			if((rotbond[i].Type == RotatableBond::Single)) {
 				if(frand() < p120) {
 					dihedrand = rand() % 3 - 1;
+					touchRotatableBond(i);
 					rotbond.rotate(i, dihedrand * DegToRad(120.0) );
 				}
 				if(frand() < pnormal) {
 					nrand(nrandnum1, nrandnum2, sdnormal); //15
+					touchRotatableBond(i);
 					rotbond.rotate(i, nrandnum1);
 				}
 				moveseverity = max(moveseverity, 1);
 			}
 		}
+		finishTouchedAtoms();
 		return moveseverity;
 	};
 
+	void SidechainTorsionalMove::touchRotatableBond(int irbond)
+	{
+		// same segments as RotBond::rotate()
+		const RotatableBond& bond = wspace->rotbond()[irbond];
+		for(int s = 0; s < MAXROTATABLEBONDSEGS; s++) {
+			if(bond.segmentstart[s] < 0) break;
+			for(int i = bond.segmentstart[s]; i <= bond.segmentend[s]; i++) {
+				touchAtom(i);
+			}
+		}
+	}
+
 
 	// changes each backbone (psi/psi) torsion by a normal function
 	int BackboneTorsionalMove::apply(){
@@ -58,6 +58,8 @@ namespace Manipulator
 
 		int apply();
 
+		virtual bool reportsTouchedAtoms() const { return true; }
+
 		int RepeatInterval;
 	protected:
 		int    m_MoveCount;
@@ -297,7 +299,10 @@ namespace Manipulator
 
 		int apply();
 
+		virtual bool reportsTouchedAtoms() const { return true; }
+
 	protected:
+		void   touchRotatableBond(int irbond); // touches all atoms rotated by the rotatable bond irbond
 		double p120;
 		double pnormal;
 		double sdnormal;
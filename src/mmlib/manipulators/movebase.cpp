@@ -1,4 +1,5 @@
 #include "global.h"
+#include <algorithm>
 #include "manipulators/movebase.h"
 #include "workspace/workspace.h"
 
@@ -23,6 +24,19 @@ namespace Manipulator
 		}
 	}
 
+	void MoveBase::touchAtom(size_t i)
+	{
+		wspace->journalAtom(i);
+		wspace->atom[i].setMoved(true);
+		m_TouchedAtoms.push_back(i);
+	}
+
+	void MoveBase::finishTouchedAtoms()
+	{
+		std::sort( m_TouchedAtoms.begin(), m_TouchedAtoms.end() );
+		m_TouchedAtoms.erase( std::unique( m_TouchedAtoms.begin(), m_TouchedAtoms.end() ), m_TouchedAtoms.end() );
+	}
+
 	MoveSet::MoveSet(WorkSpace& newwspace)
 		: MoveBase(newwspace) 
 	{
@@ -40,11 +54,27 @@ namespace Manipulator
 
 	int MoveSet::apply()
 	{
+		clearTouchedAtoms();
 		for(size_t i = 0; i < size(); i++)
 		{
 			element(i).apply();
+			if( element(i).reportsTouchedAtoms() )
+			{
+				const std::vector<size_t>& touched = element(i).touchedAtoms();
+				m_TouchedAtoms.insert( m_TouchedAtoms.end(), touched.begin(), touched.end() );
+			}
 		}
+		finishTouchedAtoms();
 		return 0;
 	}
+
+	bool MoveSet::reportsTouchedAtoms() const
+	{
+		for(size_t i = 0; i < size(); i++)
+		{
+			if( !element(i).reportsTouchedAtoms() ) return false;
+		}
+		return true;
+	}
 }
 
@@ -1,6 +1,7 @@
 #ifndef __MOVEBASE_H
 #define __MOVEBASE_H
 
+#include <vector>
 #include "object.h"
 #include "workspace/workspace.fwd.h"
 
@@ -27,6 +28,19 @@ namespace Manipulator
 		/// moves and should execute the move it implements.
 		virtual int apply() = 0;
 
+		/// \brief Returns true if apply() reports the atoms it changes, see touchedAtoms().
+		/// Moves which only change a few atoms should implement this, as it allows 
+		/// MonteCarlo to rescore only the interactions of those atoms (MonteCarlo::UseDeltaEnergy).
+		virtual bool reportsTouchedAtoms() const { return false; }
+
+		/// \brief The indices of all atoms whose positions were changed by the last call to apply(), 
+		/// in ascending order. Only valid if reportsTouchedAtoms() returns true. The list may include
+		/// atoms which did not actually move but never misses one which did. The move also flags
+		/// these atoms with setMoved(true), the caller is responsible for resetting the flags before 
+		/// calling apply() (e.g. with resetAllAtomMovedFlags()). If the WorkSpace undo journal is 
+		/// open the original positions of these atoms are recorded in it.
+		const std::vector<size_t>& touchedAtoms() const { return m_TouchedAtoms; }
+
 		/// \brief This is a convenient little function that simply calls apply() rounds
 		/// times and saves it in a trajectory (you must load the trajectory into 
 		/// the workspace previously)
@@ -37,6 +51,17 @@ namespace Manipulator
 
 	protected:
 		WorkSpace* wspace;
+
+		/// Empties the list of touched atoms, call at the beginning of apply()
+		void clearTouchedAtoms() { m_TouchedAtoms.clear(); }
+
+		/// Records that atom i is being moved and flags it as such, call before changing its position
+		void touchAtom(size_t i);
+
+		/// Sorts the list of touched atoms and removes duplicates, call at the end of apply()
+		void finishTouchedAtoms();
+
+		std::vector<size_t> m_TouchedAtoms;
 	};
 }
 
@@ -67,6 +92,9 @@ namespace Manipulator
 		virtual ~MoveSet();
 		virtual MoveSet* clone() const;
 		virtual int apply();
+
+		/// True if all the moves in the set report their touched atoms
+		virtual bool reportsTouchedAtoms() const;
 	};
 }
 
@@ -11,6 +11,11 @@
 
 #include "rotamer_applicatorbase.h"
 
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
 namespace Manipulator
 {
 
@@ -266,7 +271,11 @@ namespace Manipulator
 	{
 		// Trivially count clashes, deriving classes can do a better job.
 		// This function is required to be in the base class as stericEnergy() uses it.
-		return simpleClash( atom[i], atom[j], 0.7 ) ? 1.0f : 0.0f;
+		// Positions must come from snap, which is not always the WorkSpace itself.
+		double sqrdist = snap.atom[i].p.sqrdist( snap.atom[j].p );
+		double radSum = atom[i].radius + atom[j].radius;
+		radSum *= radSum;
+		return (sqrdist / radSum) < 0.7 ? 1.0f : 0.0f;
 	}
 
 	size_t RotamerApplicatorBase::getStoredStaticEneIndexer( size_t _rotLinkIndex, size_t _slot ) const
@@ -274,15 +283,28 @@ namespace Manipulator
 		return m_StoreSelfEnergy[_rotLinkIndex][_slot].second;
 	}
 
-	const std::vector< std::vector<RotEneStoreType> >& RotamerApplicatorBase::getStoredPairwiseEne( size_t _rotLinkI, size_t _rotLinkK ) const
+	size_t RotamerApplicatorBase::pairBlockOffset( size_t _rotLinkI, size_t _rotLinkK ) const
 	{
-		ASSERT( _rotLinkI != _rotLinkK, CodeException, "No self pair-interactions allowed!" );		
-		if( _rotLinkK < _rotLinkI )
-		{
-			std::swap( _rotLinkK, _rotLinkI );
-		}
-		size_t kLookup = _rotLinkK - _rotLinkI - 1;
-		return m_StorePairEnergy[ _rotLinkI ][ kLookup ];
+		// Partners are stored in ascending order, so a binary search of the row finds the block
+		std::vector<size_t>::const_iterator rowBegin = m_PairPartner.begin() + m_PairRowStart[_rotLinkI];
+		std::vector<size_t>::const_iterator rowEnd = m_PairPartner.begin() + m_PairRowStart[_rotLinkI+1];
+		std::vector<size_t>::const_iterator it = std::lower_bound( rowBegin, rowEnd, _rotLinkK );
+		if( it == rowEnd || *it != _rotLinkK )
+			return SIZE_T_FAIL;
+		return m_PairOffset[ it - m_PairPartner.begin() ];
+	}
+
+	RotamerPairBlock RotamerApplicatorBase::getStoredPairwiseEne( size_t _rotLinkI, size_t _rotLinkK ) const
+	{
+		ASSERT( _rotLinkI != _rotLinkK, CodeException, "No self pair-interactions allowed!" );
+		size_t offset = pairBlockOffset( _rotLinkI, _rotLinkK );
+		if( offset == SIZE_T_FAIL )
+			return RotamerPairBlock(); // These two can never interact
+		// Blocks are stored row-major by the lower serial, the strides hide which half we are in
+		if( _rotLinkI < _rotLinkK )
+			return RotamerPairBlock( &m_StorePairEnergy[offset], m_RotamerLinks[_rotLinkK].nRot(), 1 );
+		else
+			return RotamerPairBlock( &m_StorePairEnergy[offset], 1, m_RotamerLinks[_rotLinkI].nRot() );
 	}
 
 	RotEneStoreType RotamerApplicatorBase::getStoredPairwiseEne( size_t _rotLinkI, size_t _rotJ, size_t _rotLinkK, size_t _rotM ) const
@@ -293,8 +315,24 @@ namespace Manipulator
 			std::swap( _rotLinkK, _rotLinkI );
 			std::swap( _rotJ, _rotM );
 		}
-		size_t kLookup = _rotLinkK - _rotLinkI - 1;
-		return m_StorePairEnergy[ _rotLinkI ][ kLookup ][ _rotJ ][ _rotM ];
+		size_t offset = pairBlockOffset( _rotLinkI, _rotLinkK );
+		if( offset == SIZE_T_FAIL )
+			return 0.0f;
+		return m_StorePairEnergy[ offset + _rotJ * m_RotamerLinks[_rotLinkK].nRot() + _rotM ];
+	}
+
+	size_t RotamerApplicatorBase::memuse(int level)
+	{
+		size_t s_self = 0;
+		for( size_t i = 0; i < m_StoreSelfEnergy.size(); i++ )
+			s_self += m_StoreSelfEnergy[i].capacity() * sizeof(std::pair<RotEneStoreType,size_t>);
+		size_t s_pair = m_StorePairEnergy.capacity() * sizeof(RotEneStoreType);
+		size_t s_table = (m_PairRowStart.capacity() + m_PairPartner.capacity() + m_PairOffset.capacity()) * sizeof(size_t);
+		if(level>1)printf("    rotamer self energies: %d --> %3.2lf Mb \n",
+			(int)m_StoreSelfEnergy.size(), double(s_self)/(1024.0*1024.0));
+		if(level>1)printf("    rotamer pair energies: %d pairs --> %3.2lf Mb \n",
+			(int)(m_PairPartner.size()/2), double(s_pair+s_table)/(1024.0*1024.0));
+		return sizeof(*this) + s_self + s_pair + s_table;
 	}
 
 	std::pair<RotEneStoreType, size_t> RotamerApplicatorBase::getStoredStaticEne( size_t _rotLinkIndex, size_t _slot ) const 
@@ -303,11 +341,15 @@ namespace Manipulator
 	}
 
 	RotEneStoreType RotamerApplicatorBase::calcEPairwise( size_t _rotLinkI, size_t _rotLinkJ ) const
+	{
+		return calcEPairwise( _rotLinkI, _rotLinkJ, wspace->cur );
+	}
+
+	RotEneStoreType RotamerApplicatorBase::calcEPairwise( size_t _rotLinkI, size_t _rotLinkJ, const SnapShot& cur ) const
 	{
 		ASSERT( _rotLinkI != _rotLinkJ, CodeException, "Rotamer cannot be pair-wise conpared with itself");
 
 		const ParticleStore& atoms = wspace->atom;
-		const SnapShot& cur = wspace->cur;
 		const Residue& resI = wspace->res[ m_RotamerLinks[_rotLinkI].resIndex ];
 		const Residue& resJ = wspace->res[ m_RotamerLinks[_rotLinkJ].resIndex ];
 
@@ -333,11 +375,15 @@ namespace Manipulator
 	}
 
 	RotEneStoreType RotamerApplicatorBase::calcESteric_Static( size_t _rotLinkIndex ) const
+	{
+		return calcESteric_Static( _rotLinkIndex, wspace->cur );
+	}
+
+	RotEneStoreType RotamerApplicatorBase::calcESteric_Static( size_t _rotLinkIndex, const SnapShot& cur ) const
 	{
 		const ParticleStore& atoms = wspace->atom;
 		int resIIndex = (int)m_RotamerLinks[_rotLinkIndex].resIndex;
 		const Residue& res = wspace->res[ resIIndex ];
-		const SnapShot& cur = wspace->cur;
 
 		RotEneStoreType stericEnergy = 0.0;
 		const GridPoint* _list;
@@ -534,57 +580,22 @@ namespace Manipulator
 		// Calculate ESelf
 		m_StoreSelfEnergy[i][j] = std::pair<RotEneStoreType,size_t>(calcESteric_Static(i),j);
 
-		// Proxies
-		const SnapShot& cur = wspace->cur;
-		RotamerLink& rotI = m_RotamerLinks[i];
-		size_t nrotI = rotI.nRot();
-		int ancI = rotI.indexMap[rotI.rot->getCartesianAnchorRot1()];
-
-		size_t pairedCount = m_RotamerLinks.size() - i - 1;
-		for( size_t k = 0; k < pairedCount; k++ )
+		// Only the interacting partners above i, the block is owned by the lower serial
+		const std::vector<size_t>& partner = m_PairPartner;
+		std::vector<size_t>::const_iterator rowEnd = partner.begin() + m_PairRowStart[i+1];
+		std::vector<size_t>::const_iterator it = std::upper_bound( partner.begin() + m_PairRowStart[i], rowEnd, i );
+		for( ; it != rowEnd; it++ )
 		{		
-			size_t rotKIndex = k+i+1;
+			size_t rotKIndex = *it;
 			RotamerLink& rotK = m_RotamerLinks[rotKIndex];
 			size_t nrotK = rotK.nRot();
-#ifdef _DEBUG
-			bool checker = false;
-#endif
-			double interactionSum = rotI.maxInteractionDistance + rotK.maxInteractionDistance;
-			interactionSum *= interactionSum;
-			int ancK = rotK.indexMap[rotK.rot->getCartesianAnchorRot1()];
-			double sqrDist = cur.atom[ancI].p.sqrdist( cur.atom[ancK].p );
-
-			m_StorePairEnergy[i][k][j].resize(nrotK,RotEneStoreType_MAX);
-
-			if( interactionSum < sqrDist )
-			{		
-				for( size_t m = 0; m < nrotK; m++ )
-				{							
-					if( rotK.getActive(m) )
-					{
-						m_StorePairEnergy[i][k][j][m] = 0.0;
-					}
-				}						
-#ifndef _DEBUG
-				continue;							
-#else
-				checker = true;
-#endif
-			}
-			else
-			{						
-				for( size_t m = 0; m < nrotK; m++ )
-				{							
-					if( rotK.getActive(m) )
-					{
-						rotK.apply( m );
-						RotEneStoreType e = calcEPairwise( i, rotKIndex );
-#ifdef _DEBUG
-						if( checker )
-							ASSERT( e == 0.0, CodeException, "Assumption Failure");
-#endif
-						m_StorePairEnergy[i][k][j][m] = e;
-					}
+			RotEneStoreType* row = &m_StorePairEnergy[ m_PairOffset[ it - partner.begin() ] + j * nrotK ];
+			for( size_t m = 0; m < nrotK; m++ )
+			{							
+				if( rotK.getActive(m) )
+				{
+					rotK.apply( m );
+					row[m] = calcEPairwise( i, rotKIndex );
 				}
 			}
 		}
@@ -599,16 +610,6 @@ namespace Manipulator
 		// Self
 		m_StoreSelfEnergy[i].resize( nrotI, std::pair<RotEneStoreType,size_t>(RotEneStoreType_MAX,SIZE_T_FAIL) );
 
-		// Pair
-		size_t pairedCount = m_RotamerLinks.size() - i - 1;
-		m_StorePairEnergy[i].resize(pairedCount); // diagonal of square matrix		
-
-		// Alloc arrays
-		for( size_t k = 0; k < pairedCount; k++ )
-		{
-			m_StorePairEnergy[i][k].resize(nrotI);
-		}
-
 		for( size_t j = 0; j < nrotI; j++ )
 		{
 			if( !m_RotamerLinks[i].getActive(j) )
@@ -623,7 +624,7 @@ namespace Manipulator
 		}
 	}
 
-	// A copy of preCalculateSterics_inner( size_t i ) with a different 'rotKIndex' loop and indexer range checks
+	// A copy of preCalculateSterics_inner( size_t i, size_t j ) which visits partners both above and below roti
 	void RotamerApplicatorBase::preCalculateSterics_PostCall( size_t roti, size_t j )
 	{
 		// Calc pair-energy to the current APPLIED rotamer of picked residue i	
@@ -632,84 +633,260 @@ namespace Manipulator
 		m_StoreSelfEnergy[roti][j] = std::pair<RotEneStoreType,size_t>(calcESteric_Static(roti),j);
 
 		// Proxies
-		const SnapShot& cur = wspace->cur;
-		RotamerLink& rotI = m_RotamerLinks[roti];
-		size_t nrotI = rotI.nRot();
-		int ancI = rotI.indexMap[rotI.rot->getCartesianAnchorRot1()];
+		size_t nrotI = m_RotamerLinks[roti].nRot();
 
-		size_t pairedCount = m_RotamerLinks.size() - roti - 1;
-		for( size_t rotKIndex = 0; rotKIndex < m_RotamerLinks.size(); rotKIndex++ )
+		for( size_t p = m_PairRowStart[roti]; p < m_PairRowStart[roti+1]; p++ )
 		{		
-			if( rotKIndex == roti )
-				continue;
-
+			size_t rotKIndex = m_PairPartner[p];
 			RotamerLink& rotK = m_RotamerLinks[rotKIndex];
 			size_t nrotK = rotK.nRot();
 
-			// array indexers
+			// Address rotamer j of roti within the shared block, whichever half it is in
+			RotEneStoreType* block = &m_StorePairEnergy[ m_PairOffset[p] ];
+			size_t strideJ = 1;
+			size_t strideM = nrotI;
 			if( roti < rotKIndex )
 			{
-				ASSERT( m_StorePairEnergy[roti][rotKIndex-roti-1][j].size() == 0, CodeException, "Assumption Fail");
-				m_StorePairEnergy[roti][rotKIndex-roti-1][j].resize(nrotK,RotEneStoreType_MAX);
+				strideJ = nrotK;
+				strideM = 1;
+			}
+
+			for( size_t m = 0; m < nrotK; m++ )
+			{							
+				if( rotK.getActive(m) )
+				{
+					rotK.apply( m );
+					block[ j * strideJ + m * strideM ] = calcEPairwise( roti, rotKIndex );
+				}
+			}
+		}
+	}
+
+	void RotamerApplicatorBase::buildPairTable()
+	{
+		const SnapShot& cur = wspace->cur;
+		const size_t nLinks = m_RotamerLinks.size();
+
+		// Which residues can interact at all? The anchor atoms are not moved by rotamer application,
+		// so the answer holds for every rotamer combination. Pushing in (i,k) order leaves each row ascending.
+		std::vector< std::vector<size_t> > partners( nLinks );
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			const RotamerLink& rotI = m_RotamerLinks[i];
+			int ancI = rotI.indexMap[rotI.rot->getCartesianAnchorRot1()];
+			for( size_t k = i + 1; k < nLinks; k++ )
+			{
+				const RotamerLink& rotK = m_RotamerLinks[k];
+				double interactionSum = rotI.maxInteractionDistance + rotK.maxInteractionDistance;
+				interactionSum *= interactionSum;
+				int ancK = rotK.indexMap[rotK.rot->getCartesianAnchorRot1()];
+				double sqrDist = cur.atom[ancI].p.sqrdist( cur.atom[ancK].p );
+				if( interactionSum < sqrDist )
+				{
+					// Assert that there is indeed no interaction when in debug!
+					D_ASSERT( calcEPairwise( i, k ) == 0.0, CodeException, "Critical code assumption failure!");
+					continue;
+				}
+				partners[i].push_back(k);
+				partners[k].push_back(i);
+			}
+		}
+
+		// Flatten into the CSR arrays
+		m_PairRowStart.resize( nLinks + 1 );
+		m_PairRowStart[0] = 0;
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			m_PairRowStart[i+1] = m_PairRowStart[i] + partners[i].size();
+		}
+		m_PairPartner.resize( m_PairRowStart[nLinks] );
+		m_PairOffset.resize( m_PairRowStart[nLinks] );
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			std::copy( partners[i].begin(), partners[i].end(), m_PairPartner.begin() + m_PairRowStart[i] );
+		}
+
+		// One block per pair, owned by the lower serial and mirrored into the row of the higher
+		size_t total = 0;
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			size_t nrotI = m_RotamerLinks[i].nRot();
+			for( size_t p = m_PairRowStart[i]; p < m_PairRowStart[i+1]; p++ )
+			{
+				size_t k = m_PairPartner[p];
+				if( k < i )
+					continue;
+				m_PairOffset[p] = total;
+				std::vector<size_t>::iterator mirror = std::lower_bound( 
+					m_PairPartner.begin() + m_PairRowStart[k], m_PairPartner.begin() + m_PairRowStart[k+1], i );
+				m_PairOffset[ mirror - m_PairPartner.begin() ] = total;
+				total += nrotI * m_RotamerLinks[k].nRot();
+			}
+		}
+
+		// Single allocation; inactive rotamers keep the 'not calculated' marker
+		m_StorePairEnergy.assign( total, RotEneStoreType_MAX );
+	}
+
+	bool RotamerApplicatorBase::canPreCalculateFromCache() const
+	{
+		// Cartesian and idealised application place a rotamer using only the backbone anchors, which never move.
+		// Plain torsional application rotates away from whatever was applied last, so it has to stay serial.
+		return m_Mode == ApplyCartesian || m_Mode == ApplyTorsional_Idealise;
+	}
+
+	/// One unit of work for preCalculateSterics_Cached(). 
+	/// A self task has pairIndex == SIZE_T_FAIL, otherwise it fills one block of the pair table.
+	struct PreCalcTask
+	{
+		size_t link;
+		size_t pairIndex;
+		double cost;
+		bool operator<( const PreCalcTask& _Other ) const { return cost > _Other.cost; } // most expensive first
+	};
+
+	void RotamerApplicatorBase::preCalculateSterics_Cached()
+	{
+		const ParticleStore& atoms = wspace->atom;
+		const size_t nLinks = m_RotamerLinks.size();
+
+		// Apply every active rotamer once and cache the coordinates of its residue.
+		// Applying in ascending order leaves each residue in its last active rotamer,
+		// exactly the state the serial fill leaves behind.
+		std::vector<size_t> cacheStart( nLinks );
+		size_t cacheSize = 0;
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			const Residue& res = wspace->res[ m_RotamerLinks[i].resIndex ];
+			cacheStart[i] = cacheSize;
+			cacheSize += m_RotamerLinks[i].nRot() * (res.ilast - res.ifirst + 1);
+		}
+		std::vector<Maths::dvector> cache( cacheSize );
+		std::vector<double> sideChainCount( nLinks, 0.0 );
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			RotamerLink& rotI = m_RotamerLinks[i];
+			const Residue& res = wspace->res[ rotI.resIndex ];
+			size_t nAtom = res.ilast - res.ifirst + 1;
+			for( size_t iat = res.ifirst; iat <= res.ilast; iat++ )
+			{
+				if( atoms[iat].isSideChain() ) sideChainCount[i]++;
+			}
+			m_StoreSelfEnergy[i].resize( rotI.nRot(), std::pair<RotEneStoreType,size_t>(RotEneStoreType_MAX,SIZE_T_FAIL) );
+			for( size_t j = 0; j < rotI.nRot(); j++ )
+			{
+				m_StoreSelfEnergy[i][j] = std::pair<RotEneStoreType,size_t>(RotEneStoreType_MAX,j);
+				if( !rotI.getActive(j) )
+					continue;
+				rotI.apply(j);
+				for( size_t a = 0; a < nAtom; a++ )
+				{
+					cache[ cacheStart[i] + j * nAtom + a ] = wspace->cur.atom[ res.ifirst + a ].p;
+				}
+			}
+		}
+
+		// One task per self energy row and one per pair block. The costs vary by orders of magnitude,
+		// so hand the largest out first and let idle threads take the next one from the queue.
+		std::vector<PreCalcTask> tasks;
+		for( size_t i = 0; i < nLinks; i++ )
+		{
+			double activeI = (double)m_RotamerLinks[i].countActive();
+			PreCalcTask self;
+			self.link = i;
+			self.pairIndex = SIZE_T_FAIL;
+			self.cost = activeI * sideChainCount[i];
+			tasks.push_back( self );
+			for( size_t p = m_PairRowStart[i]; p < m_PairRowStart[i+1]; p++ )
+			{
+				size_t k = m_PairPartner[p];
+				if( k < i )
+					continue;
+				PreCalcTask pair;
+				pair.link = i;
+				pair.pairIndex = p;
+				pair.cost = activeI * sideChainCount[i] * (double)m_RotamerLinks[k].countActive() * sideChainCount[k];
+				tasks.push_back( pair );
 			}
+		}
+		std::stable_sort( tasks.begin(), tasks.end() );
+
+		// Each thread places rotamers into a private copy of the coordinates
+		int nThreads = 1;
+#ifdef HAVE_OPENMP
+		nThreads = omp_get_max_threads();
+#endif
+		std::vector<SnapShot> threadSnap( nThreads, wspace->cur );
+		std::vector<int> thrown( tasks.size(), 0 );
 
-#ifdef _DEBUG
-			bool checker = false;
+		const int nTasks = (int)tasks.size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic,1)
 #endif
-			double interactionSum = rotI.maxInteractionDistance + rotK.maxInteractionDistance;
-			interactionSum *= interactionSum;
-			int ancK = rotK.indexMap[rotK.rot->getCartesianAnchorRot1()];
-			double sqrDist = cur.atom[ancI].p.sqrdist( cur.atom[ancK].p );	
-
-			if( interactionSum < sqrDist )
-			{		
-				for( size_t m = 0; m < nrotK; m++ )
-				{							
-					if( rotK.getActive(m) )
+		for( int t = 0; t < nTasks; t++ )
+		{
+			// exceptions must not leave the parallel region, rethrow them below
+			try
+			{
+				int thread = 0;
+#ifdef HAVE_OPENMP
+				thread = omp_get_thread_num();
+#endif
+				SnapShot& snap = threadSnap[thread];
+				const size_t i = tasks[t].link;
+				const RotamerLink& rotI = m_RotamerLinks[i];
+				const Residue& resI = wspace->res[ rotI.resIndex ];
+				const size_t nAtomI = resI.ilast - resI.ifirst + 1;
+
+				if( tasks[t].pairIndex == SIZE_T_FAIL )
+				{
+					for( size_t j = 0; j < rotI.nRot(); j++ )
 					{
-						if( roti < rotKIndex )
-						{
-							m_StorePairEnergy[roti][rotKIndex-roti-1][j][m] = 0.0;
-						}
-						else
-						{
-							ASSERT( m_StorePairEnergy[rotKIndex][roti-rotKIndex-1][m].size() != 0, CodeException, "Assumption failure" );
-							//m_StorePairEnergy[rotKIndex][roti-rotKIndex][m].resize(nrotI,RotEneStoreType_MAX);
-							m_StorePairEnergy[rotKIndex][roti-rotKIndex-1][m][j] = 0.0;
-						}
+						if( !rotI.getActive(j) )
+							continue;
+						for( size_t a = 0; a < nAtomI; a++ )
+							snap.atom[ resI.ifirst + a ].p = cache[ cacheStart[i] + j * nAtomI + a ];
+						m_StoreSelfEnergy[i][j].first = calcESteric_Static( i, snap );
 					}
-				}						
-#ifndef _DEBUG
-				continue;							
-#else
-				checker = true;
-#endif
-			}
-			else
-			{						
-				for( size_t m = 0; m < nrotK; m++ )
-				{							
-					if( rotK.getActive(m) )
+				}
+				else
+				{
+					const size_t k = m_PairPartner[ tasks[t].pairIndex ];
+					const RotamerLink& rotK = m_RotamerLinks[k];
+					const Residue& resK = wspace->res[ rotK.resIndex ];
+					const size_t nAtomK = resK.ilast - resK.ifirst + 1;
+					const size_t nrotK = rotK.nRot();
+					RotEneStoreType* block = &m_StorePairEnergy[ m_PairOffset[ tasks[t].pairIndex ] ];
+					for( size_t j = 0; j < rotI.nRot(); j++ )
 					{
-						rotK.apply( m );
-						RotEneStoreType e = calcEPairwise( roti, rotKIndex );
-#ifdef _DEBUG
-						if( checker )
-							ASSERT( e == 0.0, CodeException, "Assumption Failure");
-#endif
-						if( roti < rotKIndex )
-						{
-							m_StorePairEnergy[roti][rotKIndex-roti-1][j][m] = e;
-						}
-						else
+						if( !rotI.getActive(j) )
+							continue;
+						for( size_t a = 0; a < nAtomI; a++ )
+							snap.atom[ resI.ifirst + a ].p = cache[ cacheStart[i] + j * nAtomI + a ];
+						for( size_t m = 0; m < nrotK; m++ )
 						{
-							ASSERT( m_StorePairEnergy[rotKIndex][roti-rotKIndex-1][m].size() != 0, CodeException, "Assumption failure" );
-							//m_StorePairEnergy[rotKIndex][roti-rotKIndex][m].resize(nrotI,RotEneStoreType_MAX);
-							m_StorePairEnergy[rotKIndex][roti-rotKIndex-1][m][j] = e;							
+							if( !rotK.getActive(m) )
+								continue;
+							for( size_t a = 0; a < nAtomK; a++ )
+								snap.atom[ resK.ifirst + a ].p = cache[ cacheStart[k] + m * nAtomK + a ];
+							block[ j * nrotK + m ] = calcEPairwise( i, k, snap );
 						}
 					}
 				}
 			}
+			catch( ExceptionBase &ex )
+			{
+				ex.Details();
+				thrown[t] = 1;
+			}
+		}
+
+		for( size_t t = 0; t < tasks.size(); t++ )
+		{
+			if( thrown[t] )
+			{
+				THROW(ProcedureException,"Rotamer energy pre-calculation failed with an exception (see above)");
+			}
 		}
 	}
 
@@ -718,8 +895,13 @@ namespace Manipulator
 		// Init arrays
 		m_StoreSelfEnergy.clear();
 		m_StoreSelfEnergy.resize( m_RotamerLinks.size() );
-		m_StorePairEnergy.clear();
-		m_StorePairEnergy.resize( m_RotamerLinks.size() );
+		buildPairTable();
+
+		if( canPreCalculateFromCache() )
+		{
+			preCalculateSterics_Cached();
+			return;
+		}
 
 		for( size_t i = 0; i < m_RotamerLinks.size(); i++ )
 		{
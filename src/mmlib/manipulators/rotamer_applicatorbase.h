@@ -136,6 +136,29 @@ namespace Manipulator
 	typedef float RotEneStoreType;
 	extern const RotEneStoreType RotEneStoreType_MAX;
 
+	/// \brief A read-only view of the rotamer x rotamer pair-energy block shared by two RotamerLinks.
+	/// \details Returned by RotamerApplicatorBase::getStoredPairwiseEne(). The view is oriented so that
+	/// operator() always takes the rotamer of the first requested link first, whichever half of the
+	/// symmetric table the block is physically stored in. Pairs that cannot interact own no block and read as 0.0.
+	class PD_API RotamerPairBlock
+	{
+	public:
+		RotamerPairBlock() : m_Data(NULL), m_StrideI(0), m_StrideK(0) {}
+		RotamerPairBlock( const RotEneStoreType* _Data, size_t _StrideI, size_t _StrideK ) 
+			: m_Data(_Data), m_StrideI(_StrideI), m_StrideK(_StrideK) {}
+
+		inline bool interacts() const { return m_Data != NULL; } ///< False if the two residues are too far apart to ever interact
+		inline RotEneStoreType operator()( size_t _rotI, size_t _rotK ) const
+		{
+			return m_Data == NULL ? 0.0f : m_Data[ _rotI * m_StrideI + _rotK * m_StrideK ];
+		}
+
+	private:
+		const RotEneStoreType* m_Data;
+		size_t m_StrideI;
+		size_t m_StrideK;
+	};
+
 	//----------------------------------------------------------------------
 	/// \brief A base class for classes which apply rotamer states
 	/// \details
@@ -183,21 +206,28 @@ namespace Manipulator
 
 		void setPeriodicIdealiseInterval( size_t interval ); ///< If ApplyMode == Torsional_PeriodicIdealise, this is our interval.
 
-		const std::vector< std::vector<RotEneStoreType> >& getStoredPairwiseEne( size_t _rotLinkI, size_t _rotLinkK ) const;
+		RotamerPairBlock getStoredPairwiseEne( size_t _rotLinkI, size_t _rotLinkK ) const;
 		RotEneStoreType getStoredPairwiseEne( size_t _rotLinkI, size_t _rotJ, size_t _rotLinkK, size_t _rotM ) const;
 		std::pair<RotEneStoreType, size_t> getStoredStaticEne( size_t _rotLinkIndex, size_t _slot ) const;
 		size_t getStoredStaticEneIndexer( size_t _rotLinkIndex, size_t _slot ) const;
 
+		size_t memuse(int level); ///< Bytes held by the pre-calculated self and pair energy stores
+
 	protected:
 		void recalcRotlinkMaxProbability();
 
 		RotEneStoreType calcEPairwise( size_t _rotLinkI, size_t _rotLinkJ ) const;
+		RotEneStoreType calcEPairwise( size_t _rotLinkI, size_t _rotLinkJ, const SnapShot& _snap ) const; ///< As above, but reading coordinates from _snap rather than the WorkSpace
 		RotEneStoreType calcESteric_Static( size_t _rotLinkIndex ) const;
+		RotEneStoreType calcESteric_Static( size_t _rotLinkIndex, const SnapShot& _snap ) const; ///< As above, but reading coordinates from _snap rather than the WorkSpace
 
 		void preCalculateSterics(); ///< Fills both the arrays below for efficiency
 		void preCalculateSterics_PostCall( size_t i, size_t j ); ///< Add steric interactions AFTER reactivation
 		mutable std::vector< std::vector< std::pair< RotEneStoreType, size_t > > > m_StoreSelfEnergy; ///< 2D jagged array. Stores self energies. Mutable as this is an internal cache that needs to be modified by public const functions.
-		mutable std::vector< std::vector< std::vector< std::vector< RotEneStoreType > > > > m_StorePairEnergy; ///< 4D jagged array. Stores pair energies. Mutable as this is an internal cache that needs to be modified by public const functions.
+		mutable std::vector< RotEneStoreType > m_StorePairEnergy; ///< Packed pair energies. One contiguous nRot(i) x nRot(k) row-major block per interacting pair i<k. Mutable as this is an internal cache that needs to be modified by public const functions.
+		std::vector< size_t > m_PairRowStart; ///< Sparse pair table: row i spans [m_PairRowStart[i], m_PairRowStart[i+1]) of the two arrays below
+		std::vector< size_t > m_PairPartner; ///< Sparse pair table: serials of the RotamerLinks that can interact with the row, ascending
+		std::vector< size_t > m_PairOffset; ///< Sparse pair table: offset of the shared block in m_StorePairEnergy, stored for both orientations
 
 		RotEneStoreType staticStericEnergy_Core( size_t _rotLinkIndex ) const; ///< Steric energy based upon the **static** grid, using the atomInteractionEnergy()
 		virtual RotEneStoreType atomInteractionEnergy( const ParticleStore& atom, const SnapShot& snap, size_t i, size_t j ) const;
@@ -215,6 +245,10 @@ namespace Manipulator
 		const Library::RotamerLibrary* m_Lib;
 
 	private:
+		void buildPairTable(); ///< Find the interacting residue pairs and allocate their blocks
+		size_t pairBlockOffset( size_t _rotLinkI, size_t _rotLinkK ) const; ///< Returns SIZE_T_FAIL if the pair does not interact
+		bool canPreCalculateFromCache() const; ///< True if the rotamer mode places rotamers independently of the previously applied state
+		void preCalculateSterics_Cached(); ///< Multithreaded fill from cached rotamer coordinates, used by preCalculateSterics() when possible
 		void preCalculateSterics_inner( size_t i );
 		void preCalculateSterics_inner( size_t i, size_t j ); ///< called by preCalculateSterics
 	};
@@ -11,6 +11,7 @@ namespace Manipulator
 {
 	const double DEFAULT_EBBMAX = 5.0; // 50.0 is the SCWRL original paper EBBMAX cutoff for interaction
 	const double DEFAULT_PROB_CAP = 0.9; // 90% is the SCWRL original paper probability cutoff for rotamer inclusion
+	const int DEFAULT_DEE_MAX_ROUNDS = 20; // DEE normally runs dry well before this
 
 	size_t NthActiveBackLookup( RotamerLink& rotLink, size_t compRotamerSerial )
 	{
@@ -33,6 +34,8 @@ namespace Manipulator
 		IgnoreHydrogenForSterics = false;
 		PROB_CAP = DEFAULT_PROB_CAP;
 		SupressStaticGridRefreshOnApply = false;
+		DEEMaxRounds = DEFAULT_DEE_MAX_ROUNDS;
+		SplitDEE = true;
 	}
 
 	RotamerApplicator_SCWRL::RotamerApplicator_SCWRL( WorkSpace& _wspace, const Library::RotamerLibrary& _Lib, const PickResidueBase& _Picker, RotamerMode _mode )
@@ -42,6 +45,8 @@ namespace Manipulator
 		IgnoreHydrogenForSterics = false;
 		PROB_CAP = DEFAULT_PROB_CAP;
 		SupressStaticGridRefreshOnApply = false;
+		DEEMaxRounds = DEFAULT_DEE_MAX_ROUNDS;
+		SplitDEE = true;
 	}
 
 	RotamerApplicator_SCWRL* RotamerApplicator_SCWRL::clone() const
@@ -149,7 +154,7 @@ namespace Manipulator
 							continue; // you cant interact with yourself
 						const RotamerLink& rotJ = m_RotamerLinks[j];
 
-						const std::vector< std::vector<RotEneStoreType> >& ePairs = getStoredPairwiseEne( i, j );
+						RotamerPairBlock ePairs = getStoredPairwiseEne( i, j );
 
 						Maths::Edge e(i, j);
 						// Computationally cheap, so test first, prior to interactionSum which requires
@@ -184,11 +189,7 @@ namespace Manipulator
 									if( !rotJ.getActive(m) )
 										continue; // this rotamer or residue I is not active
 
-									RotEneStoreType ePair;
-									if( i < j )
-										ePair = ePairs[k][m];
-									else
-										ePair = ePairs[m][k];
+									RotEneStoreType ePair = ePairs(k,m);
 
 									//DEBUG_PAIR_ENE( i, j, k, m, ePair );
 
@@ -224,71 +225,149 @@ BREAK_OUTER:
 
 	void RotamerApplicator_SCWRL::deadEndElimination()
 	{
-		// Against all other residues, we are going to identify rotamers in residue '_resID'
-		// that are higher in energy than all other rotamers in residue '_resID' for all other
-		// residues and their rotamers.
-		// To do this we will use the Goldstein Criterion!! Wooooo, that sounds fancy!
-		// See the SCQRL paper or google
-		// 'An extension of dead-end elimination for protein side-chain conformation using merge-decoupling'
-		// for an explanation of the simplest 'deadEndElimination' (DEE) which is the one used here
-		// Note, below we are using sorted lists to increase the efficiency of the algorithm
-		// Hence the backward enumeration below.
-
-		double eliminated = 0.0;
-		double totalRotamers = 0.0;
-
+		// Against all other residues, we are going to identify rotamers in residue 'i' that can 
+		// not be part of the global minimum whatever the other residues do, using the Goldstein criterion.
+		// See the SCWRL paper or 
+		// 'An extension of dead-end elimination for protein side-chain conformation using merge-decoupling'.
+		// When no single competitor suffices, split DEE (Pierce et al. 2000) lets a different competitor 
+		// win for each rotamer of one neighbouring 'split' residue.
+		// Every elimination tightens the pair minima of the neighbours, so rounds are repeated until 
+		// one eliminates nothing.
+
+		size_t totalRotamers = 0;
 		for( size_t i = 0; i < m_RotamerLinks.size(); i++ )
 		{
-			RotamerLink& rot = m_RotamerLinks[i];
+			totalRotamers += m_RotamerLinks[i].countActive();
+		}
+
+		size_t eliminated = 0;
+		for( int round = 0; round < DEEMaxRounds; round++ )
+		{
+			size_t goldstein = 0;
+			size_t split = 0;
+			for( size_t i = 0; i < m_RotamerLinks.size(); i++ )
+			{
+				deadEndElimination_Residue( i, goldstein, split );
+			}
+			eliminated += goldstein + split;
+
+			if( OutputLevel >= Verbosity::Normal )
+				Printf("DEE round %d: eliminated %d (Goldstein %d, split %d), %d remain\n")
+					(round+1)((int)(goldstein+split))((int)goldstein)((int)split)((int)(totalRotamers-eliminated));
+
+			if( goldstein + split == 0 )
+				break;
+		}
+
+		if( OutputLevel )
+			Printf("Dead-end Eliminated %5.2lf%% of rotamers! (%d/%d)\n\n")
+				(totalRotamers > 0 ? (100.0*eliminated)/totalRotamers : 0.0)((int)eliminated)((int)totalRotamers);
+	}
+
+	void RotamerApplicator_SCWRL::deadEndElimination_Residue( size_t i, size_t& goldstein, size_t& split )
+	{
+		RotamerLink& rot = m_RotamerLinks[i];
+		if( rot.countActive() <= 1 )
+		{
+			// There cant by definition be any to eliminate
+			return;
+		}
 
-			size_t activeCnt = rot.countActive();
-			totalRotamers += activeCnt;
-			if( activeCnt <= 1 )
+		// The self energies are sorted by now, we want them by rotamer index too
+		const size_t nRot = rot.nRot();
+		std::vector<RotEneStoreType> selfE( nRot, RotEneStoreType_MAX );
+		std::vector<size_t> order; // active rotamers, lowest self energy first
+		for( size_t j = 0; j < nRot; j++ )
+		{
+			std::pair<RotEneStoreType, size_t> self = getStoredStaticEne( i, j );
+			selfE[self.second] = self.first;
+			if( rot.getActive( self.second ) )
 			{
-				// There cant by definition be any to eliminate
-				continue;
+				ASSERT( self.first != RotEneStoreType_MAX, CodeException, "Unassigned ESelf");
+				order.push_back( self.second );
 			}
+		}
 
-			for( int j = ((int)rot.nRot())-1; j >= 0; j-- ) // from highest to lowest
+		// Only residues that can interact with 'i' contribute to the pair terms
+		const size_t rowBegin = m_PairRowStart[i];
+		const size_t nPartner = m_PairRowStart[i+1] - rowBegin;
+		std::vector<RotamerPairBlock> blocks( nPartner );
+		for( size_t p = 0; p < nPartner; p++ )
+		{
+			blocks[p] = getStoredPairwiseEne( i, m_PairPartner[rowBegin+p] );
+		}
+
+		std::vector<double> decision( order.size() ); // Goldstein sum for each competitor
+		std::vector<double> partnerMin( order.size() * nPartner ); // and its per-partner terms, for the split test
+
+		for( int r = ((int)order.size())-1; r >= 0; r-- ) // from highest to lowest
+		{
+			if( rot.countActive() <= 1 )
+				return;
+			const size_t rotR = order[r];
+
+			bool dead = false;
+			for( size_t t = 0; t < order.size(); t++ ) // from lowest to highest, the most likely to dominate
 			{
-				std::pair<RotEneStoreType, size_t> selfE_j = getStoredStaticEne( i, j );
-				if( rot.getActive( selfE_j.second ) )
+				const size_t rotT = order[t];
+				decision[t] = -DBL_MAX;
+				if( t == (size_t)r || !rot.getActive( rotT ) )
+					continue;
+				decision[t] = deadEndElimination_Core( i, rotR, rotT, blocks, &partnerMin[t*nPartner] ) + selfE[rotR] - selfE[rotT];
+				if( decision[t] > 0.0 )
 				{
-					ASSERT( selfE_j.first != RotEneStoreType_MAX, CodeException, "Unassigned ESelf");
+					if( OutputLevel >= Verbosity::Loud )
+						Printf("ELIMINATION!!, %d: %d vs %d (%8.3lf vs. %8.3lf) (%8.3lf)\n")(i)(rotR)(rotT)(selfE[rotR])(selfE[rotT])(decision[t]);
+					dead = true;
+					goldstein++;
+					break;
+				}
+			}
 
-					for( int k = ((int)rot.nRot())-1; k >= 0; k-- ) // from highest to lowest
+			if( !dead && SplitDEE )
+			{
+				// Split on each neighbour in turn. rotR is dead if every rotamer 'k' of the split residue
+				// is dominated by some competitor, the competitor using E(rotR,k)-E(rotT,k) in place of its minimum.
+				for( size_t p = 0; p < nPartner && !dead; p++ )
+				{
+					const RotamerLink& rotV = m_RotamerLinks[ m_PairPartner[rowBegin+p] ];
+					if( rotV.countActive() <= 1 || !blocks[p].interacts() )
+						continue; // splitting gains nothing over Goldstein
+					bool covered = true;
+					for( size_t k = 0; k < rotV.nRot() && covered; k++ )
 					{
-						if( j == k )
+						if( !rotV.getActive(k) )
 							continue;
-						std::pair<RotEneStoreType, size_t> selfE_k = getStoredStaticEne( i, k );
-
-						if( rot.getActive( selfE_k.second ) )
+						covered = false;
+						for( size_t t = 0; t < order.size(); t++ )
 						{
-							ASSERT( selfE_k.first != RotEneStoreType_MAX, CodeException, "Unassigned ESelf");
-
-							double decisionSum = deadEndElimination_Core( rot, i, selfE_j, selfE_k );
-							if( decisionSum > 0.0 )
+							if( decision[t] == -DBL_MAX )
+								continue;
+							double splitSum = decision[t] - partnerMin[t*nPartner+p] + 
+								((double)blocks[p](rotR,k) - (double)blocks[p](order[t],k));
+							if( splitSum > 0.0 )
 							{
-								if( OutputLevel >= Verbosity::Loud )
-									Printf("ELIMINATION!!, %d: %d vs %d (%8.3lf vs. %8.3lf) (%8.3lf)\n")(i)(selfE_j.second)(selfE_k.second)(selfE_j.first)(selfE_k.first)(decisionSum);
-								// Woooo; One more eliminated from the overall search!
-								rot.setActive( selfE_j.second, false );
-								eliminated += 1.0;
+								covered = true;
 								break;
 							}
-							else
-							{
-								if( OutputLevel >= Verbosity::Loud )
-									Printf("No Elimination, %d: %d vs %d (%8.3lf vs. %8.3lf) (%8.3lf)\n")(i)(selfE_j.second)(selfE_k.second)(selfE_j.first)(selfE_k.first)(decisionSum);
-							}
 						}
 					}
+					if( covered )
+					{
+						if( OutputLevel >= Verbosity::Loud )
+							Printf("SPLIT ELIMINATION!!, %d: %d split on %d\n")(i)(rotR)(m_PairPartner[rowBegin+p]);
+						dead = true;
+						split++;
+					}
 				}
 			}
-		}
 
-		if( OutputLevel )
-			Printf("Dead-end Eliminated %5.2lf%% of rotamers! (%d/%d)\n\n")((eliminated/totalRotamers)*100.0)((int)eliminated)((int)totalRotamers);
+			if( dead )
+			{
+				// Woooo; One more eliminated from the overall search!
+				rot.setActive( rotR, false );
+			}
+		}
 	}
 
 	// void RotamerApplicator_SCWRL::DEBUG_PAIR_ENE( size_t _resI, size_t _resJ, size_t _rotK, size_t _rotM, double theEne )
@@ -301,86 +380,44 @@ BREAK_OUTER:
 	//#endif
 	// }
 
-	double RotamerApplicator_SCWRL::deadEndElimination_Core(RotamerLink& rotI, size_t _rotID, std::pair<RotEneStoreType, size_t> Si, std::pair<RotEneStoreType, size_t> Ri )
+	double RotamerApplicator_SCWRL::deadEndElimination_Core( size_t _rotID, size_t _rotR, size_t _rotT, const std::vector<RotamerPairBlock>& _blocks, double* _partnerMin )
 	{
-		RotEneStoreType pairMinimisedSum = 0.0f;
-		for( size_t j = 0; j < m_RotamerLinks.size(); j++ )
+		// Sum over the neighbours of min_k[ E(R,k) - E(T,k) ]; each term is also stored in _partnerMin
+		double pairMinimisedSum = 0.0;
+		const size_t rowBegin = m_PairRowStart[_rotID];
+		for( size_t p = 0; p < _blocks.size(); p++ )
 		{
-			if( j != _rotID )
-			{
-				RotamerLink& rotJ = m_RotamerLinks[j];
-
-				RotEneStoreType minWRTSi = RotEneStoreType_MAX;
-				RotEneStoreType minWRTRi = RotEneStoreType_MAX;
-				const std::vector< std::vector<RotEneStoreType> >& ePairwise = getStoredPairwiseEne( _rotID, j );
-
-				if( rotJ.countActive() == 0 )
-				{
-					// Then finalisePreCalculatedSterics() will have set cache position k=0 to be the pairwise
-					// interactions of the rotamers with the FFParam conformation...
-
-					RotEneStoreType eneSiJu;
-					RotEneStoreType eneRiJu;
-
-					// The call to getStoredPairwiseEne above only stores 1/2 the matrix!
-					if( _rotID < j )
-					{
-						eneSiJu = ePairwise[Si.second][0];
-						eneRiJu = ePairwise[Ri.second][0];
-					}
-					else
-					{
-						eneSiJu = ePairwise[0][Si.second];
-						eneRiJu = ePairwise[0][Ri.second];
-					}
+			const RotamerLink& rotJ = m_RotamerLinks[ m_PairPartner[rowBegin+p] ];
+			const RotamerPairBlock& ePairwise = _blocks[p];
 
-					ASSERT( eneSiJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
-					minWRTSi = std::min( minWRTSi, eneSiJu );
-					ASSERT( eneRiJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
-					minWRTRi = std::min( minWRTRi, eneRiJu );
-				}
-				else
+			double minDelta = DBL_MAX;
+			if( rotJ.countActive() == 0 )
+			{
+				// Then finalisePreCalculatedSterics() will have set cache position k=0 to be the pairwise
+				// interactions of the rotamers with the FFParam conformation...
+				RotEneStoreType eneRJu = ePairwise(_rotR,0);
+				RotEneStoreType eneTJu = ePairwise(_rotT,0);
+				ASSERT( eneRJu != RotEneStoreType_MAX && eneTJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
+				minDelta = (double)eneRJu - (double)eneTJu;
+			}
+			else
+			{
+				for( size_t k = 0; k < rotJ.nRot(); k++ )
 				{
-					for( int k = 0; k < rotJ.nRot(); k++ )
+					if( rotJ.getActive(k) )
 					{
-						if( rotJ.getActive(k) )
-						{
-							RotEneStoreType eneSiJu;
-							RotEneStoreType eneRiJu;
-
-							// The call to getStoredPairwiseEne above only stores 1/2 the matrix!
-							if( _rotID < j )
-							{
-								eneSiJu = ePairwise[Si.second][k];
-								eneRiJu = ePairwise[Ri.second][k];
-							}
-							else
-							{
-								eneSiJu = ePairwise[k][Si.second];
-								eneRiJu = ePairwise[k][Ri.second];
-							}
-
-							ASSERT( eneSiJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
-							minWRTSi = std::min( minWRTSi, eneSiJu );
-							ASSERT( eneRiJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
-							minWRTRi = std::min( minWRTRi, eneRiJu );
-
-							//DEBUG_PAIR_ENE( _rotID, j, Si.second, k, eneSiJu );
-							//DEBUG_PAIR_ENE( _rotID, j, Ri.second, k, eneRiJu );
-						}
+						RotEneStoreType eneRJu = ePairwise(_rotR,k);
+						RotEneStoreType eneTJu = ePairwise(_rotT,k);
+						ASSERT( eneRJu != RotEneStoreType_MAX && eneTJu != RotEneStoreType_MAX, CodeException, "Cached value has not been calculated");
+						minDelta = std::min( minDelta, (double)eneRJu - (double)eneTJu );
 					}
 				}
-
-				RotEneStoreType minimisedDelta = minWRTSi - minWRTRi;
-
-				pairMinimisedSum += minimisedDelta;
 			}
-		}
-
-		RotEneStoreType selfDelta = Si.first - Ri.first;
-		RotEneStoreType decisionSum = selfDelta + pairMinimisedSum;
 
-		return decisionSum; // If its greater than zero, Si cannot be part of the global energy minimim and can therefore be culled!!
+			_partnerMin[p] = minDelta;
+			pairMinimisedSum += minDelta;
+		}
+		return pairMinimisedSum; // Add the self energy difference; if greater than zero, R cannot be part of the global energy minimum
 	}
 
 	void RotamerApplicator_SCWRL::finalisePreCalculatedSterics()
@@ -729,6 +766,17 @@ BREAK_OUTER:
 
 		bool creatingSuperEneArray = superRotamerEnergies2.size() == 0;
 
+		// Resolve the pair-energy block between each level and all those below it once, 
+		// rather than for every rotamer combination enumerated below
+		std::vector< std::vector< RotamerPairBlock > > levelPairs( vertexLinks.size() );
+		for( size_t pos = 1; pos < vertexLinks.size(); pos++ )
+		{
+			for( size_t i = 0; i < pos; i++ )
+			{
+				levelPairs[pos].push_back( getStoredPairwiseEne( vertexLinks[pos].serial(), vertexLinks[i].serial() ) );
+			}
+		}
+
 		// ---------------------------------
 		// Phase 2, Enumerate the primary vertexes rotamers, finding the best solution
 		// amongst all children for each one. Record only the best, and save it for this
@@ -826,11 +874,7 @@ BREAK_OUTER:
 					}
 
 					// Add the pair interaction with the primary-vertex
-					double pairEne = getStoredPairwiseEne(
-						vertexLinks[pos].serial(),
-						compRotamerSerial,
-						vertexLinks[0].serial(),
-						rotamerID );
+					double pairEne = levelPairs[pos][0]( compRotamerSerial, rotamerID );
 					ASSERT( pairEne != DBL_MAX, CodeException, "Pair energy non precalculated!?!");
 					levelEne += pairEne;
 
@@ -841,11 +885,7 @@ BREAK_OUTER:
 						{
 							goto DIE_PAIR_ENE_COMP_OVER_BEST;
 						}
-						pairEne = getStoredPairwiseEne(
-							vertexLinks[pos].serial(),
-							compRotamerSerial,
-							vertexLinks[i].serial(),
-							appliedRotStack[i-1] );
+						pairEne = levelPairs[pos][i]( compRotamerSerial, appliedRotStack[i-1] );
 						ASSERT( pairEne != DBL_MAX, CodeException, "Pair energy non precalculated!?!");
 						levelEne += pairEne;
 					}
@@ -1041,6 +1081,10 @@ DIE_PAIR_ENE_COMP_OVER_BEST:
 
 		// These will then be filled in **the current structural context** by SCWRLInitRotamerFilter
 		preCalculateSterics(); // Base class call. Il est tres critique! Used by SCWRLInitRotamerFilter below...
+		if( OutputLevel > Verbosity::Normal )
+		{
+			memuse(2);
+		}
 
 		if( OutputLevel > Verbosity::Quiet )
 		{
@@ -58,13 +58,15 @@ namespace Manipulator
 		bool IgnoreHydrogenForSterics; ///< Ignore hydrogens in atom interaction calcs (SCWRL paper, yes, us, no)
 		double EBBMAX; ///< 50.0 is the SCWRL EBBMAX cutoff for interaction
 		double PROB_CAP; ///< 90% probability filter
+		int DEEMaxRounds; ///< Upper limit on the number of dead-end elimination rounds, 0 disables DEE
+		bool SplitDEE; ///< Fall back on the split DEE criterion for rotamers that Goldstein DEE cannot eliminate
 
 	protected:
 
 		//void DEBUG_PAIR_ENE( size_t _resI, size_t _resJ, size_t _rotK, size_t _rotM, double theEne );
 
 		void finalisePreCalculatedSterics();
-		void deadEndElimination(); /// Remove rotamers which cannot by definition be part of the global SCRWL energy minimim
+		void deadEndElimination(); /// Iteratively remove rotamers which cannot by definition be part of the global SCRWL energy minimim
 		size_t detectRotamerContacts(); /// Fill the undirected graph from the current residue contacts
 		bool reactivateSingleBestRotamerIfNoneAreValid( RotamerCumulativeProbabilityDensityFilter& sqrwlFilter ); ///< If all valid rotamer states are sterically screened, reactivate the best failing possibility... its as good as we are going to get!
 		void resolveGraph(); ///< If residue interactions are found, resolve the Undirected Graph! :-D
@@ -78,7 +80,8 @@ namespace Manipulator
 		std::vector<bool> m_FlagActiveResidue; ///< Used to store which picked residues are "active"
 
 	private:
-		double deadEndElimination_Core(RotamerLink& rot, size_t _rotID, std::pair<RotEneStoreType, size_t> Si, std::pair<RotEneStoreType, size_t> Ri ); /// inner call
+		void deadEndElimination_Residue( size_t i, size_t& goldstein, size_t& split ); ///< One DEE pass over the rotamers of residue i
+		double deadEndElimination_Core( size_t _rotID, size_t _rotR, size_t _rotT, const std::vector<RotamerPairBlock>& _blocks, double* _partnerMin ); /// inner call
 		size_t traverseRotStack( std::vector< VertexLink >& vertexLinks );
 	};
 }
@@ -246,8 +246,22 @@ namespace Maths
 		return *pfNAN;
 	}
 
+	// Generator of the calling thread, NULL means the global rand() is used
+	static FastRandom* ThreadRandom = NULL;
+#ifdef HAVE_OPENMP
+	#pragma omp threadprivate(ThreadRandom)
+#endif
+
+	FastRandom* setThreadRandom( FastRandom* _Rand )
+	{
+		FastRandom* previous = ThreadRandom;
+		ThreadRandom = _Rand;
+		return previous;
+	}
+
 	bool brand()
 	{
+		if( ThreadRandom ) return ThreadRandom->nextBool();
 		return ( 0 ==
 			rand() % 2 // either 0 or 1 with equal probability ...
 			);
@@ -255,6 +269,8 @@ namespace Maths
 
 	double frand() // returns a random number evenly distributed between 0.0 .. 1.0 (not including!)
 	{
+		// nextDouble() is 0.0 .. 1.0 (not including 1.0), flip it such that log(frand()) is safe
+		if( ThreadRandom ) return 1.0 - ThreadRandom->nextDouble();
 		double zeta1;
 		zeta1 = (double) (1.0 + (double) rand()) / ((double) (RAND_MAX) + 1.0); //uniform random number 0..1
 		return zeta1;
@@ -262,6 +278,7 @@ namespace Maths
 
 	double frand01() // returns a random number evenly distributed between 0.0 .. 1.0 (including!)
 	{ 
+		if( ThreadRandom ) return ThreadRandom->nextDouble(); // never quite 1.0, close enough
 		double zeta1;
 		zeta1 = (double) ((double) rand()) / ((double) (RAND_MAX)); //uniform random number 0..1
 		return zeta1;
@@ -3,6 +3,7 @@
 
 #include <math.h> // Reqired as template bodies must be in this file, and functions like pow() are used
 #include "maths/maths.fwd.h"
+#include "maths/fastrandom.fwd.h"
 
 
 namespace Maths
@@ -117,6 +118,12 @@ namespace Maths
 		}
 	}
 
+	/// Makes _Rand the generator behind brand(), frand(), frand01() and nrand() for the
+	/// calling thread only. NULL restores the global rand(). Returns the previous generator.
+	/// This lets concurrent simulations (e.g. REX_Parallel) draw their noise from
+	/// separately seeded streams instead of all queueing on the lock of rand().
+	PD_API FastRandom* setThreadRandom( FastRandom* _Rand );
+
 	/// returns a binary random decision
 	PD_API bool brand();
 
@@ -0,0 +1,216 @@
+#include "global.h"
+
+#include "maths/rmsbatch.h"
+
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
+namespace Maths
+{
+	BatchCRMS::BatchCRMS()
+		: m_NAtoms(0)
+	{
+	}
+
+	BatchCRMS::BatchCRMS( size_t _nAtoms )
+		: m_NAtoms(_nAtoms)
+	{
+	}
+
+	void BatchCRMS::setAtomCount( size_t _nAtoms )
+	{
+		m_NAtoms = _nAtoms;
+		clear();
+	}
+
+	void BatchCRMS::clear()
+	{
+		m_Coords.clear();
+		m_InnerProduct.clear();
+	}
+
+	void BatchCRMS::reserve( size_t _nStructures )
+	{
+		m_Coords.reserve( _nStructures * 3 * m_NAtoms );
+		m_InnerProduct.reserve( _nStructures );
+	}
+
+	size_t BatchCRMS::add( const Maths::dvector* _pos )
+	{
+		size_t index = size();
+		m_Coords.resize( m_Coords.size() + 3 * m_NAtoms );
+		m_InnerProduct.push_back( centre( _pos, &m_Coords[index * 3 * m_NAtoms] ) );
+		return index;
+	}
+
+	size_t BatchCRMS::add( const std::vector<Maths::dvector>& _pos )
+	{
+		if( _pos.size() != m_NAtoms )
+			THROW(ArgumentException,"BatchCRMS::add(): the structure does not have the expected number of atoms");
+		if( m_NAtoms == 0 )
+			return add( (const Maths::dvector*)NULL );
+		return add( &_pos[0] );
+	}
+
+	double BatchCRMS::centre( const Maths::dvector* _pos, float* _dest ) const
+	{
+		if( m_NAtoms == 0 )
+			return 0.0;
+
+		Maths::dvector cog(0, 0, 0);
+		for( size_t a = 0; a < m_NAtoms; a++ )
+			cog.add( _pos[a] );
+		cog.div( (double) m_NAtoms );
+
+		float* x = _dest;
+		float* y = _dest + m_NAtoms;
+		float* z = _dest + 2 * m_NAtoms;
+		double G = 0.0;
+		for( size_t a = 0; a < m_NAtoms; a++ )
+		{
+			x[a] = (float)(_pos[a].x - cog.x);
+			y[a] = (float)(_pos[a].y - cog.y);
+			z[a] = (float)(_pos[a].z - cog.z);
+			// the inner product must be taken from the stored (rounded) values to match the correlation sums
+			G += (double)x[a] * x[a] + (double)y[a] * y[a] + (double)z[a] * z[a];
+		}
+		return G;
+	}
+
+	double BatchCRMS::calcCRMS( size_t _i, size_t _j ) const
+	{
+		D_ASSERT( _i < size() && _j < size(), OutOfRangeException, "BatchCRMS::calcCRMS() index out of range");
+		return qcpCRMS( coords(_i), m_InnerProduct[_i], coords(_j), m_InnerProduct[_j], m_NAtoms );
+	}
+
+	void BatchCRMS::calcCRMSTo( const Maths::dvector* _ref, std::vector<double>& _cRMS ) const
+	{
+		std::vector<float> ref( 3 * m_NAtoms );
+		double Gref = centre( _ref, m_NAtoms > 0 ? &ref[0] : NULL );
+		const float* pRef = m_NAtoms > 0 ? &ref[0] : NULL;
+
+		_cRMS.resize( size() );
+		const int n = (int) size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for( int i = 0; i < n; i++ )
+		{
+			_cRMS[i] = qcpCRMS( coords(i), m_InnerProduct[i], pRef, Gref, m_NAtoms );
+		}
+	}
+
+	void BatchCRMS::calcCRMSTo( size_t _ref, std::vector<double>& _cRMS ) const
+	{
+		ASSERT( _ref < size(), OutOfRangeException, "BatchCRMS::calcCRMSTo() reference index out of range");
+		_cRMS.resize( size() );
+		const int n = (int) size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for( int i = 0; i < n; i++ )
+		{
+			_cRMS[i] = calcCRMS( i, _ref );
+		}
+	}
+
+	void BatchCRMS::calcCRMSMatrix( std::vector<float>& _condensed ) const
+	{
+		const size_t n = size();
+		_condensed.resize( n > 1 ? n * (n - 1) / 2 : 0 );
+		const int nrow = (int) n;
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(dynamic,1)
+#endif
+		for( int i = 0; i < nrow; i++ )
+		{
+			size_t k = condensedIndex( i, i + 1 );
+			for( size_t j = i + 1; j < n; j++ )
+			{
+				_condensed[k++] = (float) calcCRMS( i, j );
+			}
+		}
+	}
+
+	size_t BatchCRMS::memuse( int level ) const
+	{
+		size_t mem = m_Coords.capacity() * sizeof(float) + m_InnerProduct.capacity() * sizeof(double);
+		if(level>1)printf("    BatchCRMS: %d --> %3.2lf Mb \n", (int)size(), double(mem)/1024.0/1024.0);
+		return mem;
+	}
+
+	double BatchCRMS::qcpCRMS( const float* _a, double _Ga, const float* _b, double _Gb, size_t _nAtoms )
+	{
+		if( _nAtoms == 0 )
+			return -1.0;
+
+		const float* ax = _a;
+		const float* ay = _a + _nAtoms;
+		const float* az = _a + 2 * _nAtoms;
+		const float* bx = _b;
+		const float* by = _b + _nAtoms;
+		const float* bz = _b + 2 * _nAtoms;
+
+		// correlation matrix of the two centred structures
+		double Sxx = 0, Sxy = 0, Sxz = 0;
+		double Syx = 0, Syy = 0, Syz = 0;
+		double Szx = 0, Szy = 0, Szz = 0;
+		for( size_t k = 0; k < _nAtoms; k++ )
+		{
+			const double x1 = ax[k], y1 = ay[k], z1 = az[k];
+			const double x2 = bx[k], y2 = by[k], z2 = bz[k];
+			Sxx += x1 * x2; Sxy += x1 * y2; Sxz += x1 * z2;
+			Syx += y1 * x2; Syy += y1 * y2; Syz += y1 * z2;
+			Szx += z1 * x2; Szy += z1 * y2; Szz += z1 * z2;
+		}
+
+		const double E0 = 0.5 * (_Ga + _Gb);
+
+		// coefficients of the characteristic polynomial P(l) = l^4 + C2 l^2 + C1 l + C0
+		const double Sxx2 = Sxx * Sxx, Syy2 = Syy * Syy, Szz2 = Szz * Szz;
+		const double Sxy2 = Sxy * Sxy, Syz2 = Syz * Syz, Sxz2 = Sxz * Sxz;
+		const double Syx2 = Syx * Syx, Szy2 = Szy * Szy, Szx2 = Szx * Szx;
+
+		const double SyzSzymSyySzz2 = 2.0 * (Syz * Szy - Syy * Szz);
+		const double Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+
+		const double C2 = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+		const double C1 = 8.0 * (Sxx * Syz * Szy + Syy * Szx * Sxz + Szz * Sxy * Syx
+			- Sxx * Syy * Szz - Syz * Szx * Sxy - Szy * Syx * Sxz);
+
+		const double SxzpSzx = Sxz + Szx;
+		const double SyzpSzy = Syz + Szy;
+		const double SxypSyx = Sxy + Syx;
+		const double SyzmSzy = Syz - Szy;
+		const double SxzmSzx = Sxz - Szx;
+		const double SxymSyx = Sxy - Syx;
+		const double SxxpSyy = Sxx + Syy;
+		const double SxxmSyy = Sxx - Syy;
+		const double Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+		const double C0 = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2
+			+ (Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2)
+			+ (-(SxzpSzx) * (SyzmSzy) + (SxymSyx) * (SxxmSyy - Szz)) * (-(SxzmSzx) * (SyzpSzy) + (SxymSyx) * (SxxmSyy + Szz))
+			+ (-(SxzpSzx) * (SyzpSzy) - (SxypSyx) * (SxxpSyy - Szz)) * (-(SxzmSzx) * (SyzmSzy) - (SxypSyx) * (SxxpSyy + Szz))
+			+ (+(SxypSyx) * (SyzpSzy) + (SxzpSzx) * (SxxmSyy + Szz)) * (-(SxymSyx) * (SyzmSzy) + (SxzpSzx) * (SxxpSyy + Szz))
+			+ (+(SxypSyx) * (SyzmSzy) + (SxzmSzx) * (SxxmSyy - Szz)) * (-(SxymSyx) * (SyzpSzy) + (SxzmSzx) * (SxxpSyy - Szz));
+
+		// Newton-Raphson for the largest root, E0 is an upper bound to it
+		double lambda = E0;
+		for( int i = 0; i < 50; i++ )
+		{
+			const double old = lambda;
+			const double l2 = lambda * lambda;
+			const double b = (l2 + C2) * lambda;
+			const double a = b + C1;
+			lambda -= (a * lambda + C0) / (2.0 * l2 * lambda + b + a);
+			if( fabs(lambda - old) < fabs(1.0e-11 * lambda) )
+				break;
+		}
+
+		return sqrt( fabs( 2.0 * (E0 - lambda) / (double) _nAtoms ) );
+	}
+}
+
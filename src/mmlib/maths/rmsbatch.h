@@ -0,0 +1,73 @@
+#ifndef __RMS_BATCH_H
+#define __RMS_BATCH_H
+
+/// \file maths/rmsbatch.h
+/// \brief Batched cRMS calculation between many structures of the same length
+/// \details calcVectorCRMS() re-centres both structures and diagonalises a fresh correlation
+/// matrix on every call. When one structure is compared against many others (clustering,
+/// trajectory analysis) that work is repeated over and over again. BatchCRMS centres each structure
+/// exactly once on entry and caches its inner product G = sum(|x|^2). A cRMS is then only a 3x3
+/// correlation matrix plus a Newton solve for the largest root of the quaternion characteristic
+/// polynomial:
+///
+/// D. L. Theobald, Acta Cryst. (2005). A61, 478-480
+/// Rapid calculation of RMSDs using a quaternion-based characteristic polynomial.
+/// See also P. Liu, D. K. Agrafiotis & D. L. Theobald (2010). J. Comput. Chem. 31, 1561-1563.
+///
+/// Centred coordinates are held as one contiguous float block per structure (all x, then all y,
+/// then all z), the correlation sums are accumulated in double.
+
+#include <vector>
+
+namespace Maths
+{
+	class PD_API BatchCRMS
+	{
+	public:
+		BatchCRMS();
+		BatchCRMS( size_t _nAtoms );
+
+		void setAtomCount( size_t _nAtoms ); ///< Sets the number of atoms per structure, removes all structures
+		void clear(); ///< Removes all structures, the atom count is retained
+		void reserve( size_t _nStructures );
+
+		inline size_t nAtoms() const { return m_NAtoms; }
+		inline size_t size() const { return m_InnerProduct.size(); }
+
+		/// Centres and stores a structure of nAtoms() positions, returns its index
+		size_t add( const Maths::dvector* _pos );
+		size_t add( const std::vector<Maths::dvector>& _pos );
+
+		/// The cRMS between two stored structures
+		double calcCRMS( size_t _i, size_t _j ) const;
+
+		/// Many-vs-one: the cRMS of every stored structure to _ref (nAtoms() positions).
+		void calcCRMSTo( const Maths::dvector* _ref, std::vector<double>& _cRMS ) const;
+		/// Many-vs-one: the cRMS of every stored structure to stored structure _ref.
+		void calcCRMSTo( size_t _ref, std::vector<double>& _cRMS ) const;
+
+		/// Many-vs-many: the upper triangle (i < j) of the cRMS matrix, row by row.
+		/// Element (i,j) lives at condensedIndex(i,j).
+		void calcCRMSMatrix( std::vector<float>& _condensed ) const;
+		inline size_t condensedIndex( size_t _i, size_t _j ) const
+		{
+			return _i * (2 * size() - _i - 1) / 2 + (_j - _i - 1);
+		}
+
+		size_t memuse( int level ) const;
+
+	private:
+		/// Centres _pos into _dest (x block, y block, z block) and returns the inner product
+		double centre( const Maths::dvector* _pos, float* _dest ) const;
+		inline const float* coords( size_t _i ) const { return &m_Coords[_i * 3 * m_NAtoms]; }
+
+		static double qcpCRMS( const float* _a, double _Ga, const float* _b, double _Gb, size_t _nAtoms );
+
+		size_t m_NAtoms;
+		std::vector<float> m_Coords;
+		std::vector<double> m_InnerProduct;
+	};
+}
+
+#endif
+
@@ -14,9 +14,11 @@
 #include "mmlib/maths/maths_vector.h"
 #include "mmlib/maths/graphtheory.h"
 #include "mmlib/maths/fastrandom.h"
+#include "mmlib/maths/rmsbatch.h"
 
 #include "mmlib/maths/histogram.h"
 #include "mmlib/tools/statclock.h"
+#include "mmlib/tools/cpufeatures.h"
 #include "mmlib/tools/streamwriter.h"
 #include "mmlib/tools/stringbuilder.h"
 
@@ -82,6 +84,7 @@
 #include "mmlib/forcefields/nonbonded.h"
 #include "mmlib/forcefields/nonbonded_ti.h"
 #include "mmlib/forcefields/nonbonded_ti_linear.h"
+#include "mmlib/forcefields/pme.h"
 #include "mmlib/forcefields/breakablebonded.h"
 
 #include "mmlib/manipulators/movebase.h"
@@ -96,6 +99,7 @@
 #include "mmlib/protocols/energy.h"
 #include "mmlib/protocols/minimise.h"
 #include "mmlib/protocols/temperature.h"
+#include "mmlib/protocols/constraints.h"
 #include "mmlib/protocols/md.h"
 #include "mmlib/protocols/rerun.h"
 #include "mmlib/protocols/remd.h"
@@ -0,0 +1,413 @@
+#include "global.h"
+
+#include "workspace/workspace.h"
+#include "workspace/space.h"
+#include "forcefields/ffbonded.h"
+
+#include "protocols/constraints.h"
+
+using namespace Physics;
+using namespace Maths;
+
+namespace Protocol
+{
+	BondConstraints::BondConstraints()
+		: Tolerance(1E-6),
+		MaxIterations(1000),
+		m_FirstAtom(0),
+		m_LastAtom(-1)
+	{
+	}
+
+	void BondConstraints::clear()
+	{
+		m_Bond.clear();
+		m_Water.clear();
+		m_InWater.clear();
+		m_Reference.clear();
+		m_FirstAtom = 0;
+		m_LastAtom = -1;
+	}
+
+	void BondConstraints::includeAtom( int _i )
+	{
+		if( m_LastAtom < m_FirstAtom )
+		{
+			m_FirstAtom = _i;
+			m_LastAtom = _i;
+		}
+		m_FirstAtom = Maths::min( m_FirstAtom, _i );
+		m_LastAtom = Maths::max( m_LastAtom, _i );
+	}
+
+	void BondConstraints::addBonds( const FF_Bonded& _ffb, const WorkSpace& _wspace, int _Start, int _End, bool _HydrogensOnly )
+	{
+		const ParticleStore& atomparam = _wspace.atom;
+		m_InWater.resize( atomparam.size(), false );
+
+		for( int b = 0; b < _ffb.getNumBonds(); b++ )
+		{
+			const Bond& bond = _ffb.getBondByIndex( b );
+			if( bond.i < _Start || bond.i > _End || bond.j < _Start || bond.j > _End ) continue;
+			if( m_InWater[bond.i] || m_InWater[bond.j] ) continue;
+			if( _HydrogensOnly && !atomparam[bond.i].isHydrogen() && !atomparam[bond.j].isHydrogen() ) continue;
+			if( !(bond.l > 0.0) )
+			{
+				THROW(ArgumentException,"BondConstraints: cannot constrain a bond of zero length between atoms " + int2str(bond.i) + " and " + int2str(bond.j) );
+			}
+
+			Constraint con;
+			con.i = bond.i;
+			con.j = bond.j;
+			con.l2 = sqr( bond.l );
+			con.invmi = 1.0 / atomparam[bond.i].mass;
+			con.invmj = 1.0 / atomparam[bond.j].mass;
+			m_Bond.push_back( con );
+
+			includeAtom( bond.i );
+			includeAtom( bond.j );
+		}
+	}
+
+	void BondConstraints::addRigidWater( const FF_Bonded& _ffb, const WorkSpace& _wspace, int _Start, int _End )
+	{
+		const ParticleStore& atomparam = _wspace.atom;
+		m_InWater.resize( atomparam.size(), false );
+
+		for( size_t im = 0; im < _wspace.mol.size(); im++ )
+		{
+			// same molecule layout as TIP3P_Move: the oxygen followed by its two hydrogens
+			int o = _wspace.mol[im].ifirst;
+			if( _wspace.mol[im].ilast != o + 2 ) continue;
+			if( o < _Start || o + 2 > _End ) continue;
+			if( atomparam[o].Z != 8 || !atomparam[o+1].isHydrogen() || !atomparam[o+2].isHydrogen() ) continue;
+			if( atomparam[o+1].mass != atomparam[o+2].mass ) continue; // SETTLE needs two identical hydrogens
+
+			int b1 = _ffb.findBond( o, o + 1 );
+			int b2 = _ffb.findBond( o, o + 2 );
+			if( b1 < 0 || b2 < 0 ) continue;
+
+			Water water;
+			water.o = o;
+			water.dOH = _ffb.getBondByIndex( b1 ).l;
+			if( fabs( water.dOH - _ffb.getBondByIndex( b2 ).l ) > 1E-6 * water.dOH ) continue;
+
+			int bhh = _ffb.findBond( o + 1, o + 2 );
+			int ahoh = _ffb.findAngle( o + 1, o, o + 2 );
+			if( bhh >= 0 )
+			{
+				water.dHH = _ffb.getBondByIndex( bhh ).l;
+			}
+			else if( ahoh >= 0 )
+			{
+				water.dHH = 2.0 * water.dOH * sin( 0.5 * _ffb.getAngleByIndex( ahoh ).theta0 );
+			}
+			else
+			{
+				continue;
+			}
+			if( !(water.dHH > 0.0) || water.dHH >= 2.0 * water.dOH ) continue;
+
+			m_Water.push_back( water );
+			for( int i = o; i <= o + 2; i++ )
+			{
+				m_InWater[i] = true;
+				includeAtom( i );
+			}
+		}
+
+		// any bonds of these waters constrained before now are handled by SETTLE instead
+		size_t kept = 0;
+		for( size_t c = 0; c < m_Bond.size(); c++ )
+		{
+			if( m_InWater[m_Bond[c].i] || m_InWater[m_Bond[c].j] ) continue;
+			m_Bond[kept++] = m_Bond[c];
+		}
+		m_Bond.resize( kept );
+	}
+
+	void BondConstraints::storeReference( const WorkSpace& _wspace )
+	{
+		if( empty() ) return;
+		m_Reference.resize( m_LastAtom - m_FirstAtom + 1 );
+		for( int i = m_FirstAtom; i <= m_LastAtom; i++ )
+		{
+			m_Reference[i - m_FirstAtom] = _wspace.cur.atom[i].p;
+		}
+	}
+
+	void BondConstraints::constrainPositions( WorkSpace& _wspace, double _VelocityFactor )
+	{
+		if( empty() ) return;
+		if( m_Reference.size() != (size_t)(m_LastAtom - m_FirstAtom + 1) )
+		{
+			THROW(CodeException,"BondConstraints::constrainPositions() called without a reference, call storeReference() first");
+		}
+
+		SnapShotAtom *atom = _wspace.cur.atom;
+		const Space& space = _wspace.boundary();
+
+		// SETTLE: every water is solved analytically and independently
+		int failed = 0;
+		const int nwater = (int)m_Water.size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static) reduction(+:failed)
+#endif
+		for( int w = 0; w < nwater; w++ )
+		{
+			if( !settlePositions( _wspace, m_Water[w], _VelocityFactor ) ) failed++;
+		}
+		if( failed > 0 )
+		{
+			THROW(ProcedureException,"SETTLE failed for " + int2str(failed) + " water molecule(s), the simulation is unstable (is the Timestep too large?)");
+		}
+
+		// SHAKE: correct the remaining bonds along their reference vectors until all lengths are within Tolerance
+		dvector r, rref, dp;
+		for( int iter = 0; iter < MaxIterations; iter++ )
+		{
+			bool done = true;
+			for( size_t c = 0; c < m_Bond.size(); c++ )
+			{
+				const Constraint& con = m_Bond[c];
+				r.diff( atom[con.i].p, atom[con.j].p );
+				space.getClosestImage( r );
+				double diff = con.l2 - r.innerdot();
+				if( fabs( diff ) <= 2.0 * Tolerance * con.l2 ) continue;
+				done = false;
+
+				rref.diff( m_Reference[con.i - m_FirstAtom], m_Reference[con.j - m_FirstAtom] );
+				space.getClosestImage( rref );
+				double dot = dotProduct( rref, r );
+				if( dot < 1E-6 * con.l2 )
+				{
+					THROW(ProcedureException,"SHAKE: the bond between atoms " + int2str(con.i) + " and " + int2str(con.j) +
+						" has rotated too far within one step, the simulation is unstable (is the Timestep too large?)");
+				}
+				double g = diff / ( 2.0 * dot * ( con.invmi + con.invmj ) );
+
+				dp.setTo( rref );
+				dp.mul( g * con.invmi );
+				atom[con.i].p.add( dp );
+				dp.mul( _VelocityFactor );
+				atom[con.i].v.add( dp );
+
+				dp.setTo( rref );
+				dp.mul( g * con.invmj );
+				atom[con.j].p.sub( dp );
+				dp.mul( _VelocityFactor );
+				atom[con.j].v.sub( dp );
+			}
+			if( done ) return;
+		}
+
+		THROW(ProcedureException,"SHAKE did not converge within " + int2str(MaxIterations) + " iterations, the simulation is unstable (is the Timestep too large?)");
+	}
+
+	void BondConstraints::constrainVelocities( WorkSpace& _wspace, double _Timestep )
+	{
+		if( empty() ) return;
+
+		SnapShotAtom *atom = _wspace.cur.atom;
+		const Space& space = _wspace.boundary();
+
+		const int nwater = (int)m_Water.size();
+#ifdef HAVE_OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for( int w = 0; w < nwater; w++ )
+		{
+			settleVelocities( _wspace, m_Water[w] );
+		}
+
+		// RATTLE: r.v_ij (Angstrom m/s) is converged once the bond would drift by less than Tolerance * length over one Timestep
+		const double tol = Tolerance * PhysicsConst::Angstrom / _Timestep;
+		dvector r, vij, dv;
+		for( int iter = 0; iter < MaxIterations; iter++ )
+		{
+			bool done = true;
+			for( size_t c = 0; c < m_Bond.size(); c++ )
+			{
+				const Constraint& con = m_Bond[c];
+				r.diff( atom[con.i].p, atom[con.j].p );
+				space.getClosestImage( r );
+				vij.diff( atom[con.i].v, atom[con.j].v );
+				double rv = dotProduct( r, vij );
+				if( fabs( rv ) <= tol * con.l2 ) continue;
+				done = false;
+
+				double k = rv / ( con.l2 * ( con.invmi + con.invmj ) );
+
+				dv.setTo( r );
+				dv.mul( k * con.invmi );
+				atom[con.i].v.sub( dv );
+
+				dv.setTo( r );
+				dv.mul( k * con.invmj );
+				atom[con.j].v.add( dv );
+			}
+			if( done ) return;
+		}
+
+		THROW(ProcedureException,"RATTLE did not converge within " + int2str(MaxIterations) + " iterations, the simulation is unstable (is the Timestep too large?)");
+	}
+
+	bool BondConstraints::settlePositions( WorkSpace& _wspace, const Water& _water, double _VelocityFactor ) const
+	{
+		SnapShotAtom *atom = _wspace.cur.atom;
+		const Space& space = _wspace.boundary();
+		const int o = _water.o;
+		const double mO = _wspace.atom[o].mass;
+		const double mH = _wspace.atom[o+1].mass;
+		const double wohh = mO + 2.0 * mH;
+
+		// the reference (constrained) geometry relative to the reference oxygen
+		const dvector& refO = m_Reference[o - m_FirstAtom];
+		dvector b0, c0;
+		b0.diff( m_Reference[o + 1 - m_FirstAtom], refO ); space.getClosestImage( b0 );
+		c0.diff( m_Reference[o + 2 - m_FirstAtom], refO ); space.getClosestImage( c0 );
+
+		// the unconstrained new positions relative to their centre of mass
+		dvector a1, b1, c1;
+		a1.diff( atom[o].p, refO );     space.getClosestImage( a1 );
+		b1.diff( atom[o + 1].p, refO ); space.getClosestImage( b1 );
+		c1.diff( atom[o + 2].p, refO ); space.getClosestImage( c1 );
+		dvector com( a1 );
+		com.mul( mO );
+		dvector h( b1 );
+		h.add( c1 );
+		h.mul( mH );
+		com.add( h );
+		com.div( wohh );
+		a1.sub( com );
+		b1.sub( com );
+		c1.sub( com );
+
+		// frame with z normal to the reference plane and the new oxygen in the y-z plane
+		dvector zaks, xaks, yaks;
+		zaks.crossProduct( b0, c0 );
+		xaks.crossProduct( a1, zaks );
+		yaks.crossProduct( zaks, xaks );
+		if( !(zaks.mag() > 0.0) || !(xaks.mag() > 0.0) ) return false;
+		xaks.unify();
+		yaks.unify();
+		zaks.unify();
+
+		const double xb0d = dotProduct( xaks, b0 ), yb0d = dotProduct( yaks, b0 );
+		const double xc0d = dotProduct( xaks, c0 ), yc0d = dotProduct( yaks, c0 );
+		const double za1d = dotProduct( zaks, a1 );
+		const double xb1d = dotProduct( xaks, b1 ), yb1d = dotProduct( yaks, b1 ), zb1d = dotProduct( zaks, b1 );
+		const double xc1d = dotProduct( xaks, c1 ), yc1d = dotProduct( yaks, c1 ), zc1d = dotProduct( zaks, c1 );
+
+		// canonical water: O at (0,ra,0), the hydrogens at (-+rc,-rb,0), centre of mass at the origin
+		const double rc = 0.5 * _water.dHH;
+		const double height = sqrt( sqr( _water.dOH ) - sqr( rc ) );
+		const double ra = 2.0 * mH * height / wohh;
+		const double rb = height - ra;
+
+		// tilt out of the reference plane: the constraint forces act within it, so z is kept
+		const double sinphi = za1d / ra;
+		double tmp = 1.0 - sqr( sinphi );
+		if( !(tmp > 0.0) ) return false;
+		const double cosphi = sqrt( tmp );
+		const double sinpsi = ( zb1d - zc1d ) / ( 2.0 * rc * cosphi );
+		tmp = 1.0 - sqr( sinpsi );
+		if( !(tmp > 0.0) ) return false;
+		const double cospsi = sqrt( tmp );
+
+		const double ya2d = ra * cosphi;
+		const double xb2d = -rc * cospsi;
+		const double yb2d = -rb * cosphi - rc * sinpsi * sinphi;
+		const double yc2d = -rb * cosphi + rc * sinpsi * sinphi;
+
+		// rotation about z that leaves no net constraint torque normal to the reference plane
+		const double alpha = xb2d * ( xb0d - xc0d ) + yb0d * yb2d + yc0d * yc2d;
+		const double beta  = xb2d * ( yc0d - yb0d ) + xb0d * yb2d + xc0d * yc2d;
+		const double gamma = xb0d * yb1d - xb1d * yb0d + xc0d * yc1d - xc1d * yc0d;
+		const double al2be2 = sqr( alpha ) + sqr( beta );
+		tmp = al2be2 - sqr( gamma );
+		if( !(tmp >= 0.0) ) return false;
+		const double sinthe = ( alpha * gamma - beta * sqrt( tmp ) ) / al2be2;
+		tmp = 1.0 - sqr( sinthe );
+		if( !(tmp >= 0.0) ) return false;
+		const double costhe = sqrt( tmp );
+
+		dvector a3, b3, c3, t;
+		a3.setTo( xaks ); a3.mul( -ya2d * sinthe );
+		t.setTo( yaks );  t.mul( ya2d * costhe );               a3.add( t );
+		t.setTo( zaks );  t.mul( za1d );                        a3.add( t );
+
+		b3.setTo( xaks ); b3.mul( xb2d * costhe - yb2d * sinthe );
+		t.setTo( yaks );  t.mul( xb2d * sinthe + yb2d * costhe ); b3.add( t );
+		t.setTo( zaks );  t.mul( zb1d );                        b3.add( t );
+
+		c3.setTo( xaks ); c3.mul( -xb2d * costhe - yc2d * sinthe );
+		t.setTo( yaks );  t.mul( -xb2d * sinthe + yc2d * costhe ); c3.add( t );
+		t.setTo( zaks );  t.mul( zc1d );                        c3.add( t );
+
+		// apply as corrections, so that no atom changes its periodic image
+		a3.sub( a1 );
+		b3.sub( b1 );
+		c3.sub( c1 );
+		atom[o].p.add( a3 );
+		atom[o + 1].p.add( b3 );
+		atom[o + 2].p.add( c3 );
+		a3.mul( _VelocityFactor );
+		b3.mul( _VelocityFactor );
+		c3.mul( _VelocityFactor );
+		atom[o].v.add( a3 );
+		atom[o + 1].v.add( b3 );
+		atom[o + 2].v.add( c3 );
+
+		return true;
+	}
+
+	void BondConstraints::settleVelocities( WorkSpace& _wspace, const Water& _water ) const
+	{
+		SnapShotAtom *atom = _wspace.cur.atom;
+		const Space& space = _wspace.boundary();
+		const int o = _water.o;
+		const double imA = 1.0 / _wspace.atom[o].mass;
+		const double imB = 1.0 / _wspace.atom[o+1].mass;
+		const double imC = 1.0 / _wspace.atom[o+2].mass;
+
+		// unit vectors O->H1, O->H2 and H1->H2
+		dvector eAB, eAC, eBC;
+		eAB.diff( atom[o + 1].p, atom[o].p );     space.getClosestImage( eAB ); eAB.unify();
+		eAC.diff( atom[o + 2].p, atom[o].p );     space.getClosestImage( eAC ); eAC.unify();
+		eBC.diff( atom[o + 2].p, atom[o + 1].p ); space.getClosestImage( eBC ); eBC.unify();
+
+		dvector vAB, vAC, vBC;
+		vAB.diff( atom[o + 1].v, atom[o].v );
+		vAC.diff( atom[o + 2].v, atom[o].v );
+		vBC.diff( atom[o + 2].v, atom[o + 1].v );
+
+		// Impulses tAB, tAC, tBC along the three bonds: vA += (tAB eAB + tAC eAC)/mA,
+		// vB += (tBC eBC - tAB eAB)/mB, vC -= (tAC eAC + tBC eBC)/mC, such that no bond
+		// changes length. A 3x3 linear system solved directly.
+		const double cABAC = dotProduct( eAB, eAC );
+		const double cABBC = dotProduct( eAB, eBC );
+		const double cACBC = dotProduct( eAC, eBC );
+
+		const double m11 = imA + imB, m12 = cABAC * imA, m13 = -cABBC * imB;
+		const double m21 = cABAC * imA, m22 = imA + imC, m23 = cACBC * imC;
+		const double m31 = -cABBC * imB, m32 = cACBC * imC, m33 = imB + imC;
+		const double r1 = dotProduct( eAB, vAB );
+		const double r2 = dotProduct( eAC, vAC );
+		const double r3 = dotProduct( eBC, vBC );
+
+		const double det = m11 * ( m22 * m33 - m23 * m32 ) - m12 * ( m21 * m33 - m23 * m31 ) + m13 * ( m21 * m32 - m22 * m31 );
+		const double tAB = ( r1 * ( m22 * m33 - m23 * m32 ) - m12 * ( r2 * m33 - m23 * r3 ) + m13 * ( r2 * m32 - m22 * r3 ) ) / det;
+		const double tAC = ( m11 * ( r2 * m33 - m23 * r3 ) - r1 * ( m21 * m33 - m23 * m31 ) + m13 * ( m21 * r3 - r2 * m31 ) ) / det;
+		const double tBC = ( m11 * ( m22 * r3 - r2 * m32 ) - m12 * ( m21 * r3 - r2 * m31 ) + r1 * ( m21 * m32 - m22 * m31 ) ) / det;
+
+		dvector dv;
+		dv.setTo( eAB ); dv.mul( tAB * imA ); atom[o].v.add( dv );
+		dv.setTo( eAC ); dv.mul( tAC * imA ); atom[o].v.add( dv );
+		dv.setTo( eAB ); dv.mul( tAB * imB ); atom[o + 1].v.sub( dv );
+		dv.setTo( eBC ); dv.mul( tBC * imB ); atom[o + 1].v.add( dv );
+		dv.setTo( eAC ); dv.mul( tAC * imC ); atom[o + 2].v.sub( dv );
+		dv.setTo( eBC ); dv.mul( tBC * imC ); atom[o + 2].v.sub( dv );
+	}
+}
+
@@ -0,0 +1,120 @@
+#ifndef __CONSTRAINTS_H
+#define __CONSTRAINTS_H
+
+// Essential Headers
+#include <vector>
+#include "workspace/workspace.fwd.h"
+
+namespace Physics
+{
+	class PD_API FF_Bonded;
+}
+
+namespace Protocol
+{
+	/// \brief Holonomic bond length constraints for the MD integrators
+	/// \details
+	/// Holds a set of bonds at fixed length so that the fastest motions in the
+	/// system (bond vibrations to hydrogen) no longer limit the integration
+	/// timestep. Bonds and their lengths are taken from an FF_Bonded bond list.
+	///
+	/// General bonds are solved iteratively: SHAKE moves the new positions back
+	/// onto the constraints along the bond vectors of the previous step,
+	/// RATTLE removes the velocity components along the constrained bonds.
+	/// Rigid three site water (TIP3P, the model also assumed by TIP3P_Move: oxygen
+	/// first, then the two hydrogens) is solved analytically by SETTLE.
+	///
+	/// Positions are in Angstrom, velocities in m/s.
+	///
+	/// SHAKE:
+	/// J.-P. Ryckaert, G. Ciccotti and H. J. C. Berendsen, Numerical integration of
+	/// the cartesian equations of motion of a system with constraints: molecular dynamics
+	/// of n-alkanes, J. Comput. Phys. 23, 327-341 (1977)
+	///
+	/// RATTLE:
+	/// H. C. Andersen, Rattle: A "velocity" version of the Shake algorithm for molecular
+	/// dynamics calculations, J. Comput. Phys. 52, 24-34 (1983)
+	///
+	/// SETTLE:
+	/// S. Miyamoto and P. A. Kollman, SETTLE: An analytical version of the SHAKE and
+	/// RATTLE algorithm for rigid water models, J. Comput. Chem. 13, 952-962 (1992)
+	class PD_API BondConstraints
+	{
+	public:
+		BondConstraints();
+
+		/// removes all constraints
+		void clear();
+
+		/// Constrains the bonds of FF_Bonded between atoms _Start to _End (inclusive). Only bonds
+		/// involving a hydrogen if _HydrogensOnly is true. Bonds of rigid waters are skipped.
+		void addBonds( const Physics::FF_Bonded& _ffb, const WorkSpace& _wspace, int _Start, int _End, bool _HydrogensOnly );
+
+		/// Makes every three atom water molecule (O,H,H) between atoms _Start to _End rigid. The O-H length is
+		/// taken from FF_Bonded, the H-H length from its H-O-H angle (or the H-H bond if there is one).
+		void addRigidWater( const Physics::FF_Bonded& _ffb, const WorkSpace& _wspace, int _Start, int _End );
+
+		inline bool empty() const { return m_Bond.empty() && m_Water.empty(); }
+		inline size_t nBonds() const { return m_Bond.size(); }
+		inline size_t nWaters() const { return m_Water.size(); }
+
+		/// number of degrees of freedom removed from the system
+		inline int nConstraints() const { return (int)(m_Bond.size() + 3 * m_Water.size()); }
+
+		/// Remembers the current (constrained) positions. constrainPositions() corrects along these bond vectors.
+		void storeReference( const WorkSpace& _wspace );
+
+		/// SHAKE/SETTLE: moves the current positions back onto the constraints. Each position correction (Angstrom)
+		/// times _VelocityFactor is added to the velocity of the atom, pass 0 to leave velocities untouched.
+		void constrainPositions( WorkSpace& _wspace, double _VelocityFactor );
+
+		/// RATTLE/SETTLE: removes the velocity components along the constrained bonds. A bond is converged once its
+		/// length would not drift by more than Tolerance within _Timestep (seconds).
+		void constrainVelocities( WorkSpace& _wspace, double _Timestep );
+
+		/// relative tolerance on the constrained bond lengths (default 1E-6)
+		double Tolerance;
+
+		/// maximum number of SHAKE/RATTLE iterations before giving up (default 1000)
+		int MaxIterations;
+
+	private:
+		struct Constraint
+		{
+			int i;
+			int j;
+			double l2;    ///< squared target length in Angstrom^2
+			double invmi; ///< inverse masses
+			double invmj;
+		};
+
+		struct Water
+		{
+			int o;        ///< oxygen, the hydrogens are o+1 and o+2
+			double dOH;   ///< O-H distance in Angstrom
+			double dHH;   ///< H-H distance in Angstrom
+		};
+
+		void includeAtom( int _i );
+
+		/// return false if the water is too distorted to be solved
+		bool settlePositions( WorkSpace& _wspace, const Water& _water, double _VelocityFactor ) const;
+		void settleVelocities( WorkSpace& _wspace, const Water& _water ) const;
+
+		std::vector<Constraint> m_Bond;
+		std::vector<Water> m_Water;
+
+		/// Atoms already constrained as part of a rigid water
+		std::vector<bool> m_InWater;
+
+		/// lowest and highest constrained atom
+		int m_FirstAtom;
+		int m_LastAtom;
+
+		/// positions at the beginning of the step, indexed from m_FirstAtom
+		std::vector<Maths::dvector> m_Reference;
+	};
+}
+
+#endif
+
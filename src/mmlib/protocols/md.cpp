@@ -8,6 +8,7 @@
 #include "workspace/space.h"
 
 #include "forcefields/forcefield.h"
+#include "forcefields/ffbonded.h"
 
 #include "protocols/md.h"
 
@@ -67,6 +68,10 @@ namespace Protocol
 		m_CurPress = 0;
 
 		CentreAfterMove = false;
+
+		Constraints = NoConstraints;
+		RigidWater = false;
+		ConstraintTolerance = 1E-6;
 	};
 
 	void MolecularDynamics::info() const
@@ -111,6 +116,16 @@ namespace Protocol
 		}
 		printf("\n");
 		printf("BerendsenPressureTau %e\n", BerendsenPressureTau );
+		printf("Constraints          ");
+		switch (Constraints) {
+				case NoConstraints: printf("None"); break;
+				case HBonds:        printf("Bonds to hydrogen (SHAKE/RATTLE)"); break;
+				case AllBonds:      printf("All bonds (SHAKE/RATTLE)"); break;
+				default: printf("Unknown");
+		}
+		printf("\n");
+		printf("RigidWater           %s\n", RigidWater ? "true (SETTLE)" : "false" );
+		printf("ConstraintTolerance  %e\n", ConstraintTolerance );
 
 	}
 
@@ -136,9 +151,10 @@ namespace Protocol
 	{
 		int start = getStartAtom();
 		int end = getEndAtom();
-		int natom = getNAtoms();
 
-		m_TargetEkin = 3 * natom * PhysicsConst::kB * TargetTemp->get(0) / 2;
+		setupConstraints();
+
+		m_TargetEkin = getDegreesOfFreedom() * PhysicsConst::kB * TargetTemp->get(0) / 2;
 
 		if(RandVel) { // randomise the velocities if required by user parameter
 			printf("Randomizing velocities to boltzmann distribution at T=%.1lf K \n",
@@ -152,6 +168,40 @@ namespace Protocol
 
 			calcOldPositions();
 		}
+		else
+		{
+			m_Constraints.constrainVelocities(getWSpace(), Timestep);
+		}
+	}
+
+	void MolecularDynamics::setupConstraints()
+	{
+		m_Constraints.clear();
+		m_Constraints.Tolerance = ConstraintTolerance;
+		if((Constraints == NoConstraints) && (!RigidWater)) return;
+
+		Physics::FF_Bonded* ffbonded = NULL;
+		if(!obtainFFComponent(getFF(), ffbonded))
+		{
+			THROW(ArgumentException,"MolecularDynamics: bond constraints require exactly one FF_Bonded component in the forcefield");
+		}
+
+		// waters first, their bonds are then left to SETTLE
+		if(RigidWater) m_Constraints.addRigidWater(*ffbonded, getWSpace(), getStartAtom(), getEndAtom());
+		if(Constraints != NoConstraints) m_Constraints.addBonds(*ffbonded, getWSpace(), getStartAtom(), getEndAtom(), Constraints == HBonds);
+
+		if(OutputLevel)
+			printf("Constraining %d bonds (SHAKE/RATTLE) and %d rigid waters (SETTLE)\n",
+				(int)m_Constraints.nBonds(), (int)m_Constraints.nWaters());
+
+		// bring the starting structure onto the constraints
+		m_Constraints.storeReference(getWSpace());
+		m_Constraints.constrainPositions(getWSpace(), 0.0);
+	}
+
+	int MolecularDynamics::getDegreesOfFreedom() const
+	{
+		return 3 * getNAtoms() - m_Constraints.nConstraints();
 	}
 
 	int MolecularDynamics::runcore()
@@ -176,6 +226,7 @@ namespace Protocol
 
 		starttime = (int) time(NULL);
 		int stepsTaken = run_core();
+		getWSpace().outtra.flush(); // asynchronous trajectories have written every frame once run() returns
 		endtime = (int) time(NULL);
 		if(OutputLevel) {
  			
@@ -315,6 +366,9 @@ namespace Protocol
 
 
 	void MolecularDynamics::applyForces(){
+		// SHAKE corrects the new positions along the bonds as they are now
+		m_Constraints.storeReference(getWSpace());
+
 		switch (Integrator) {
 				case Verlet:
 					applyForces_VerletIntegration();
@@ -343,7 +397,6 @@ namespace Protocol
 		int i;
 		double sigma;
 		double vx, vy, vz;
-		int natom = getNAtoms();
 
 		if(OutputLevel)
 			printf("Setting initital velocities of ensemble.. Temperature %6.1lf\n", tgtTemp);
@@ -355,10 +408,11 @@ namespace Protocol
 			nrand(vy, vz, sigma);
 			getWSpace().cur.atom[i].v.setTo(vx, vy, vz);
 		}
+		m_Constraints.constrainVelocities(getWSpace(), Timestep);
 
 		calcKineticEnergy();
 
-		setKineticEnergyTo(3 * natom * PhysicsConst::kB * tgtTemp / 2);
+		setKineticEnergyTo(getDegreesOfFreedom() * PhysicsConst::kB * tgtTemp / 2);
 		calcKineticEnergy();
 	}
 
@@ -504,7 +558,6 @@ namespace Protocol
 	void MolecularDynamics::calcKineticEnergy()
 	{
 		SnapShotAtom *atom = getWSpace().cur.atom; // atom coordinate array
-		int natom = getNAtoms();
 		int i;
 		getWSpace().ene.ekin = 0;
 
@@ -514,8 +567,8 @@ namespace Protocol
 			getWSpace().ene.ekin += (0.5 * getWSpace().atom[i].mass * sqr(atom[i].v.mag()));
 		}
 
-		// Calculate Temperature from K = 2NkBT/2
-		m_CurTemp = 2.0 * getWSpace().ene.ekin / (3 * natom * PhysicsConst::kB);
+		// Calculate Temperature from K = NkBT/2, N being the number of (unconstrained) degrees of freedom
+		m_CurTemp = 2.0 * getWSpace().ene.ekin / (getDegreesOfFreedom() * PhysicsConst::kB);
 
 		// Get volume and convert into units of meters (instead of Angstroms)
 		double V = getWSpace().getVolume() * 1E-30;
@@ -567,6 +620,7 @@ namespace Protocol
 				return;
 			case Andersen:
 				applyAndersonThermostat(TargetTemp->get(double(Step)/double(Steps)));
+				m_Constraints.constrainVelocities(getWSpace(), Timestep); // the new velocities know nothing of the constraints
 				return;
 			case Berendsen:
 				applyBerendsenThermostat(TargetTemp->get(double(Step)/double(Steps)));
@@ -580,12 +634,11 @@ namespace Protocol
 	void MolecularDynamics::applyBerendsenThermostat(double TargetTargetTemp)
 	{
 		SnapShotAtom *atom = getWSpace().cur.atom; // atom coordinate array
-		int natom = getNAtoms();
 		double chi; // adjustment factor
 		double Edes; // desired Ekinetic
 		int i;
 
-		Edes = 3.0 * natom * PhysicsConst::kB * TargetTargetTemp / 2.0;
+		Edes = getDegreesOfFreedom() * PhysicsConst::kB * TargetTargetTemp / 2.0;
 		chi = sqrt(1.0 + Timestep * (Edes / double(getWSpace().ene.ekin) - 1.0) / BerendsenTau);
 
 		int end = getEndAtom();
@@ -617,7 +670,7 @@ namespace Protocol
 		for(i = getStartAtom(); i <= end; i++)
 		{
 			// randomly decide if this atom is to be changed.
-			if((rand() % 10000) > intrate)
+			if((int)(frand01() * 9999.0) > intrate)
 				continue;
 
 			//sample a new velocity from a Maxwell-Boltzmann distribution
@@ -772,6 +825,9 @@ namespace Protocol
 			atom[i].p.setTo(np);
 		}
 
+		// the velocities are central differences, a correction of r(t+dt) changes them by half
+		m_Constraints.constrainPositions(getWSpace(), PhysicsConst::Angstrom / (2 * Timestep));
+
 		//remember old forces
 		for(i = getStartAtom(); i <= end; i++)
 		{
@@ -806,6 +862,7 @@ namespace Protocol
 			dv.z = atom[i].f.z * tinvmass;
 			atom[i].v.add(dv);
 		}
+		m_Constraints.constrainVelocities(getWSpace(), Timestep);
 
 		// The velocities are now "real", i.e. finished and thus now is the time
 		// to calculate the kinetic energy and apply any barostat
@@ -835,6 +892,7 @@ namespace Protocol
 			atom[i].p.add(dr);
 			atom[i].v.add(dv);
 		}
+		m_Constraints.constrainPositions(getWSpace(), PhysicsConst::Angstrom / Timestep);
 	}
 
 	// MolecularDynamics::Beeman's algorithm
@@ -869,6 +927,7 @@ namespace Protocol
 				atom[i].v.add(dv);
 			}
 		}
+		m_Constraints.constrainVelocities(getWSpace(), Timestep);
 
 		calcKineticEnergy(); //calculate instanteneous temperature & pressure
 		applyThermostat();   //adjust velocities according to Thermostat
@@ -898,6 +957,7 @@ namespace Protocol
 				// save current force as next Step's old force
 				oldatom[i].f.setTo(atom[i].f);
 			}
+			m_Constraints.constrainPositions(getWSpace(), PhysicsConst::Angstrom / Timestep);
 		}
 	}
 
@@ -996,6 +1056,7 @@ namespace Protocol
 				atom[i].v.add(dv);
 			}
 		}
+		m_Constraints.constrainVelocities(getWSpace(), Timestep);
 
 		// The velocities are now "real", i.e. finished and thus now is the time
 		// to calculate the kinetic energy and apply any barostat
@@ -1038,6 +1099,7 @@ namespace Protocol
 				atom[i].v.mul(c0);
 				atom[i].v.add(dv);
 			}
+			m_Constraints.constrainPositions(getWSpace(), PhysicsConst::Angstrom / Timestep);
 		}
 	}
 
@@ -1153,6 +1215,7 @@ namespace Protocol
 				}
 			}
 		}
+		m_Constraints.constrainVelocities(getWSpace(), Timestep);
 
 		// The velocities are now "real", i.e. finished and thus now is the time
 		// to calculate the kinetic energy and apply any barostat
@@ -1215,6 +1278,7 @@ namespace Protocol
 					atom[i].v.add(dv);
 				}
 			}
+			m_Constraints.constrainPositions(getWSpace(), PhysicsConst::Angstrom / Timestep);
 		}
 
 	}
@@ -4,6 +4,7 @@
 // Essential Headers
 #include "protocols/protocolbase.h" // Provides a base class
 #include "protocols/temperature.h"  // Provides a class member
+#include "protocols/constraints.h"  // Provides a class member
 #include "workspace/workspace.fwd.h"
 
 namespace Protocol{
@@ -21,6 +22,7 @@ namespace Protocol{
 	///  Thermostats implemented: Berendsen and Andersen 
 	///  Barostats implemented: Berendsen 
 	///  Langevin Dynamics
+	///  Bond constraints: SHAKE/RATTLE for bonds to hydrogen or all bonds, SETTLE for rigid water
 	///
 	/// 
 	///
@@ -79,6 +81,7 @@ namespace Protocol{
 		enum ThermostatType { NoThermostat, Andersen, Berendsen};
 		enum BarostatType   { NoBarostat, BerendsenBaro };
 		enum IntegratorType { Verlet, VelocityVerlet, Beeman, Langevin };
+		enum ConstraintType { NoConstraints, HBonds, AllBonds };
 
 		/// type of MD Integrator algorithm {Verlet|VelocityVerlet|Beeman|Langevin}
 		IntegratorType Integrator;     
@@ -127,6 +130,17 @@ public:
 		/// not in periodic boundary conditions
 		bool CentreAfterMove;
 
+		/// Bonds held at their equilibrium length by SHAKE/RATTLE {NoConstraints|HBonds|AllBonds}.
+		/// Constraining the bonds to hydrogen allows a Timestep of 2E-15 seconds.
+		/// The bonds are taken from the FF_Bonded component of the forcefield.
+		ConstraintType Constraints;
+
+		/// Keep three atom water molecules (TIP3P) rigid using SETTLE
+		bool RigidWater;
+
+		/// relative tolerance on the constrained bond lengths (default 1E-6)
+		double ConstraintTolerance;
+
 	protected:
 
 		/// sets default parameter values
@@ -182,7 +196,14 @@ public:
 		Maths::dvector linmom;
 		Maths::dvector angmom;
 
+		/// the bond constraints set up from Constraints and RigidWater
+		BondConstraints m_Constraints;
+
 		void setup(); 
+		void setupConstraints();
+
+		/// number of degrees of freedom: 3 per atom less one per constraint
+		int getDegreesOfFreedom() const;
 		int run_core();
 
 		//Statistical calculations
@@ -3,7 +3,9 @@
 #include "manipulators/movebase.h"
 #include "protocols/temperature.h"
 #include "workspace/workspace.h"
+#include "workspace/neighbourlist.h"
 #include "forcefields/forcefield.h"
+#include "protocols/energy.h"
 
 #include "montecarlo.h"
 
@@ -26,30 +28,75 @@ namespace Protocol
 
 		bool doReasons = OutputLevel && ReportFilterFailReasons;
 
+		bool useDelta = UseDeltaEnergy && canUseDeltaEnergy();
+		if( UseDeltaEnergy && !useDelta && OutputLevel )
+		{
+			printf("mc: UseDeltaEnergy ignored - requires an Energy evaluator, moves which report their touched atoms\n"
+			       "    and a forcefield which supports calcMovedAtomEnergy()\n");
+		}
+		if( useDelta ) ff->setupMovedAtomEnergy();
+
+		// rejected moves are undone through the workspace journal rather than by reloading oldstate
+		bool useJournal = canUseJournal();
+
 		reset();
 
 		// save original state
 		oldstate = getWSpace().save();
 		lowstate = oldstate;	
+		oldEne = oldstate.epot;
 
 		for(Step = 0; Step < Steps; Step++) 
 		{
 			getWSpace().Step = Step;
-			if(every(Step, 100)) getWSpace().cleanSpace(); // occasionally move any stray molecules back into simulation
+
+			if( useDelta )
+			{
+				if( (Step > 0) && every(Step, DeltaEnergyResync) )
+				{
+					// a full evaluation of the last accepted state removes accumulated rounding errors
+					getWSpace().cleanSpace(); 
+					evaluations += evaluator->runcore();
+					if( OutputLevel >= Verbosity::Loud )
+					{
+						printf("mc: delta energy drift: %e kcal/mol \n", 
+							(getWSpace().ene.epot - oldEne) * PhysicsConst::J2kcal * PhysicsConst::Na);
+					}
+					oldEne = getWSpace().ene.epot;
+				}
+			}
+			else
+			{
+				if(every(Step, 100)) getWSpace().cleanSpace(); // occasionally move any stray molecules back into simulation
+			}
+
+			unsigned nlistUpdates = getWSpace().nlist().getFullUpdateCount();
 
 			// make a change to the structure
 			getWSpace().resetAllAtomMovedFlags();
+			if( useJournal ) getWSpace().beginJournal();
 			if(Step != 0) moveset->apply();
 
 			if( DoZeroGeometry ) getWSpace().zeroCentreOfGeometry();
 
+			// can the energy of this move be obtained incrementally ?
+			bool deltaStep = useDelta && (Step != 0) && isLocalMove( moveset->touchedAtoms() );
+
 			validity = Reject; // RESET to INVALID
 
 			if( PreFilters.passes() ) // PRE-screen PRIOR to using the evaluator (thats the main point of a filter)
 			{		
-				evaluations += evaluator->runcore();
+				if( deltaStep )
+				{
+					calcDeltaEnergy( moveset->touchedAtoms() );
+					evaluations++;
+				}
+				else
+				{
+					evaluations += evaluator->runcore();
+				}
 				// reject/accept structure according to metropolis criterion
-				bool accepted = accept(getWSpace().ene.epot, oldstate.epot);
+				bool accepted = accept(getWSpace().ene.epot, oldEne);
 
 				// If we have already failed, there is no point in running post-filters.
 				if( accepted )
@@ -94,15 +141,35 @@ namespace Protocol
 
 			if(validity != Accept)
 			{				
-				getWSpace().load(oldstate);
+				if( useJournal )
+				{
+					// only the journalled atoms differ from the last accepted state
+					getWSpace().rollbackJournal();
+				}
+				else
+				{
+					getWSpace().load(oldstate);
+				}
+				// a neighbour list built for the rejected structure may not be valid for the old one
+				if( useDelta && (getWSpace().nlist().getFullUpdateCount() != nlistUpdates) )
+					getWSpace().nlist().refresh();
 				nonacceptances++;
 				repeatmonitors();
 				if(UpdateTraRej && every(Step,UpdateTra)) getWSpace().outtra.append();
 			}
 			else
 			{
-				
-				oldstate = getWSpace().save();
+				if( useJournal )
+				{
+					getWSpace().commitJournal();
+				}
+				else
+				{
+					oldstate = getWSpace().save();
+				}
+				oldEne = getWSpace().ene.epot;
+				// later incremental steps rely on the list being valid for all atoms
+				if( useDelta && !deltaStep ) getWSpace().nlist().refresh();
 				acceptances++;
 				nonacceptances = 0;
 				runmonitors(); // update monitors with a new measurement 
@@ -114,7 +181,9 @@ namespace Protocol
 		{
 		case MonteCarlo::LastAcc:
 			{
-				getWSpace().load(oldstate);
+				// with the journal rejected moves are undone immediately, hence the 
+				// workspace already holds the last accepted structure
+				if( !useJournal ) getWSpace().load(oldstate);
 				break;
 			}
 		case MonteCarlo::LowestEpot:
@@ -140,6 +209,43 @@ namespace Protocol
 		return Step;
 	}
 
+	bool MonteCarlo::canUseJournal() const
+	{
+		// the evaluator must calculate the energy of the structure as it is - a minimiser
+		// for example would move atoms which the moves did not touch
+		if( dynamic_cast<const Energy*>(evaluator) == NULL ) return false;
+		if( DoZeroGeometry ) return false;
+		return moveset->reportsTouchedAtoms();
+	}
+
+	bool MonteCarlo::canUseDeltaEnergy() const
+	{
+		return canUseJournal() && ff->supportsMovedAtomEnergy();
+	}
+
+	bool MonteCarlo::isLocalMove( const std::vector<size_t> &touched ) const
+	{
+		// beyond about a quarter of the atoms a full evaluation is cheaper
+		if( touched.size() * 4 > getWSpace().nAtoms() ) return false;
+
+		// the neighbour list must still be valid for the new positions, otherwise fall 
+		// back to a full evaluation (the evaluator refreshes the list itself)
+		return !getWSpace().nlist().requiresRefresh( touched );
+	}
+
+	void MonteCarlo::calcDeltaEnergy( const std::vector<size_t> &touched )
+	{
+		WorkSpace &wspace = getWSpace();
+		double enew = ff->calcMovedAtomEnergy( touched );
+
+		// the journal holds the last accepted positions of the touched atoms
+		wspace.swapJournal();
+		double eold = ff->calcMovedAtomEnergy( touched );
+		wspace.swapJournal();
+
+		wspace.ene.epot = oldEne + (enew - eold);
+	}
+
 	bool MonteCarlo::accept( double enenew, double eneold ) const
 	{ 
 		if(!isNumber(enenew)) return false;
@@ -210,7 +316,7 @@ namespace Protocol
 		printf("%c%6d%8d%4d %6.2lf %9.3lf %9.3lf %9.3lf %5.1lf %5.1lf",
 			accType, Step, evaluations, acceptances, accScope,
 			getWSpace().ene.epot * PhysicsConst::J2kcal * PhysicsConst::Na,
-			oldstate.epot * PhysicsConst::J2kcal * PhysicsConst::Na,
+			oldEne * PhysicsConst::J2kcal * PhysicsConst::Na,
 			lowestEne * PhysicsConst::J2kcal * PhysicsConst::Na,
 			(double) acceptances / double (Step + 1),
 			Temperature->get(double(Step)/double(Steps)));
@@ -49,6 +49,8 @@ namespace Protocol
 			UpdateTraRej = false;
 			DoZeroGeometry = false;
 			ReportFilterFailReasons = false;
+			UseDeltaEnergy = false;
+			DeltaEnergyResync = 100;
 			Temperature = new ConstantProfile( 300 ); 
 			FinalState = LastAcc;
 			reset();
@@ -106,6 +108,21 @@ public:
 		/// Report why filters have failed
 		bool ReportFilterFailReasons; 
 
+		/// \brief Evaluate local moves incrementally (default false).
+		/// \details Requires that all moves report their touched atoms (MoveBase::reportsTouchedAtoms()),
+		/// that the forcefield supports Forcefield::calcMovedAtomEnergy() and that the evaluator 
+		/// is an Energy protocol (i.e. does not change the structure), otherwise it is ignored.
+		/// The energy of a trial structure is then the energy of the last accepted structure plus 
+		/// the change of the interactions of the touched atoms, and a rejection only restores 
+		/// the touched atoms. Moves which touch a large part of the system or move atoms beyond 
+		/// the neighbour list padding are evaluated in full. Note that in incremental steps only 
+		/// the total energy is updated, the energy components are those of the last full evaluation. 
+		bool UseDeltaEnergy;
+
+		/// Number of Steps between full energy evaluations (which remove any accumulated rounding
+		/// errors) when UseDeltaEnergy is on. Default = 100
+		int DeltaEnergyResync;
+
 		enum FinalStateType
 		{
 			Last, 
@@ -139,9 +156,30 @@ public:
 		/// lowest energy state so far
 		SnapShot lowstate;  
 	
-		/// last accepted state 
+		/// last accepted state (not kept up to date when rejected moves are undone through
+		/// the WorkSpace undo journal, see canUseJournal())
 		SnapShot oldstate;  
 
+		/// energy of the last accepted state
+		double oldEne;
+
+		/// \brief true if rejected moves can be undone with the WorkSpace undo journal
+		/// \details This requires all moves to report (and thus journal) their touched atoms and an
+		/// evaluator which does not change the structure. Note that forces and velocities are not 
+		/// restored by the journal.
+		bool canUseJournal() const;
+
+		/// true if the conditions for UseDeltaEnergy are met
+		bool canUseDeltaEnergy() const;
+
+		/// true if the last move can be evaluated incrementally, i.e. it touched few atoms
+		/// and none of them moved far enough to invalidate the neighbour list
+		bool isLocalMove( const std::vector<size_t> &touched ) const;
+
+		/// sets ene.epot to the energy of the current structure, which differs from
+		/// the last accepted one only in the touched (and journalled) atoms
+		void calcDeltaEnergy( const std::vector<size_t> &touched );
+
 	private:
 		int Step;
 
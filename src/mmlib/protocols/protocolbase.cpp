@@ -116,7 +116,7 @@ namespace Protocol{
 		if((nlist_counter%UpdateNList)==0)
 		{
 			getWSpace().cleanSpace();
-			getWSpace().nlist().calcNewList();
+			getWSpace().nlist().refresh(); // only rebuilds if required when displacement tracking is on
 		}
 		nlist_counter++;
 	}
@@ -92,6 +92,8 @@ namespace Protocol
 		int UpdateMon;   
 		
 		/// number of Steps between full neighborlist updates;
+		/// If the neighbour list tracks displacements (NeighbourListBase::trackDisplacement)
+		/// this is merely the number of Steps between checks whether an update is required.
 		int UpdateNList; 
 		
 		/// Controls screen output
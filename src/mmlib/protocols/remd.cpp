@@ -30,7 +30,7 @@ namespace Protocol{
 			THROW(CodeException,"Error in REX_Replica : Internal SnapShot and WorkSpace have different number of atoms!");
 		}
 
-		for(i = 0; i <= m_Structure.nAtoms() ; i++) {
+		for(i = 0; i < m_Structure.nAtoms() ; i++) {
 			sigma = sqrt(PhysicsConst::kB * m_Temperature / protocol().getWSpace().atom[i].mass);
 			nrand(vx, vy, sigma);
 			nrand(vy, vz, sigma);
@@ -209,21 +209,7 @@ namespace Protocol{
 			excnt++;
 		}
 
-		printf("REX_Replica Exchange Statistics: \n");
-		for(r = 0; r < rep.size(); r++) {
-			accfreq[r] /= (double) excnt;
-			printf("rep.stat %3d:\t%4.1lf\t%10.3lf\n",
-				r,
-				rep[r].getTargetTemp(),
-				accfreq[r]);
-		}
-
-		printf("REX_Replica exchanges throughout run: \n");
-		for(int iex = 0; iex < excnt + 1; iex++) {
-			for(r = 0; r < rep.size(); r++)
-				printf("%2d\t", Tempstat[sqrmat(iex, r, rep.size())]);
-			printf("\n");
-		}
+		printExchangeStatistics( accfreq, Tempstat, excnt );
 
 		FILE *file = NULL;
 		if(rdstdout_file != NULL) file = fopen(rdstdout_file, "at");
@@ -236,6 +222,24 @@ namespace Protocol{
 		return Step;
 	}
 
+	void REX_Local::printExchangeStatistics( const double *accfreq, const int *Tempstat, int nexchange ) const
+	{
+		printf("REX_Replica Exchange Statistics: \n");
+		for(size_t r = 0; r < rep.size(); r++) {
+			printf("rep.stat %3d:\t%4.1lf\t%10.3lf\n",
+				r,
+				rep[r].getTargetTemp(),
+				accfreq[r] / (double) nexchange);
+		}
+
+		printf("REX_Replica exchanges throughout run: \n");
+		for(int iex = 0; iex < nexchange + 1; iex++) {
+			for(size_t r = 0; r < rep.size(); r++)
+				printf("%2d\t", Tempstat[sqrmat(iex, r, rep.size())]);
+			printf("\n");
+		}
+	}
+
 	void REX_Local::getReplicas(SnapShot * m_Structure_ext){
 		for(int r = 0; r < rep.size(); r++) {
 			m_Structure_ext[r] = rep[r].m_Structure;
@@ -339,5 +343,275 @@ namespace Protocol{
 		return (delta <= 0) || (exp(-delta) > frand()); 
 	}
 
-}
 
+
+
+
+
+
+
+
+	int REX_Parallel::runcore(){
+		int t; // counts over temperature slots
+		int excnt = 0; // counts exchanges
+		int Step;
+
+		doParallelSafetyCheck();
+
+		const int nrep = rep.size();
+		m_TempRep.resize( nrep );
+		m_SlotTemp.resize( nrep );
+
+		// seed the replica generators one after another from the global generator
+		m_Rand.clear();
+		for(t = 0; t < nrep; t++) {
+			m_Rand.push_back( FastRandom( rand() ) );
+		}
+
+		double *accfreq = new double[nrep];
+		int *Tempstat = new int[nrep * (Steps+10)];
+
+		for(t = 0; t < nrep; t++) {
+			accfreq[t] = 0;
+			m_TempRep[t] = t;
+			m_SlotTemp[t] = rep[t].getTargetTemp();
+
+			// The replicas run concurrently, so they must not write to the screen or to
+			// shared monitors. Monitors and trajectory are looked after by this class.
+			rep[t].protocol().OutputLevel = Verbosity::Silent;
+			rep[t].protocol().mon.clear();
+			rep[t].protocol().UpdateTra = -1;
+
+			// each replica continues from its structure in temperature order
+			rep[t].protocol().getWSpace().load( rep[t].m_Structure );
+
+			Tempstat[sqrmat(0, t, nrep)] = t;
+		}
+
+		// Print a header
+		if((OutputLevel) &&
+			(UpdateScr > 0)){
+				printf("remdstart ");
+				rep[FocusRep].protocol().infoLineHeader();
+				printf("\n");
+		}
+
+		std::vector<int> failed;
+
+		// Start the simulation
+		for(Step = 0; Step < Steps; Step ++) {
+
+			if( runRound( Step, failed ) > 0 ){
+				for(size_t f = 0; f < failed.size(); f++) rescueReplica( failed[f] );
+			}
+
+			// all replicas have been run, record their energies for the exchange criterion
+			for(t = 0; t < nrep; t++) {
+				rep[t].m_Structure.epot = rep[t].protocol().getWSpace().ene.epot;
+			}
+
+			// report on the replica at the focus temperature
+			REX_Replica &focus = rep[ m_TempRep[FocusRep] ];
+			if((OutputLevel) &&
+				(UpdateScr > 0)&&
+				 ((excnt % UpdateScr)==0)){
+					printf("remd.rep %3d ",excnt);
+					focus.protocol().infoLine();
+					focus.protocol().getFF().infoLine();
+					printf("\n");
+			}
+			bool measure = (mon.size() > 0) && (UpdateMon > 0) && ((mon_counter % UpdateMon) == 0);
+			bool savetra = every( Step, UpdateTra );
+			if( measure || savetra ){
+				getWSpace().load( focus.protocol().getWSpace().save() );
+				if( savetra ) getWSpace().outtra.append();
+			}
+			runmonitors();
+
+			// prepare statistics
+			for(t = 0; t < nrep; t++) {
+				Tempstat[sqrmat(excnt + 1, t, nrep)] = Tempstat[sqrmat(excnt, t, nrep)];
+			}
+
+			// alternatively attempt to swap 0&1, 2&3 , 4&5 ... or 1&2, 3&4, 5&6 ...
+			for(t = (excnt % 2); t < (nrep - 1); t += 2) {
+
+				// same criterion as REX_Local, applied to the replicas currently at the
+				// temperatures of slot t and t+1
+				if( exchangeCriterion( rep[ m_TempRep[t] ] , rep[ m_TempRep[t + 1] ] ) ){
+
+					exchangeSlots( t );
+
+					int rTemp = Tempstat[sqrmat(excnt + 1, t, nrep)];
+					Tempstat[sqrmat(excnt + 1, t, nrep)] = Tempstat[sqrmat(excnt + 1, t + 1, nrep)];
+					Tempstat[sqrmat(excnt + 1, t + 1, nrep)] = rTemp;
+
+					if( OutputLevel >= Verbosity::Loud ){
+						printf( "Swapped replicas %d and %d \n", t, t+1 );
+					}
+
+					accfreq[t] += 1.0;
+				}
+			}
+
+			excnt++;
+		}
+
+		// Put the structures back into temperature order and the temperatures back onto
+		// their original replicas, such that the state between runs matches REX_Local.
+		std::vector<SnapShot> final( nrep );
+		for(t = 0; t < nrep; t++) {
+			final[t] = rep[ m_TempRep[t] ].protocol().getWSpace().save();
+		}
+		for(t = 0; t < nrep; t++) {
+			rep[t].m_Structure = final[t];
+			rep[t].setTargetTemp( m_SlotTemp[t] );
+			rep[t].protocol().getWSpace().load( rep[t].m_Structure );
+			m_TempRep[t] = t;
+		}
+
+		printExchangeStatistics( accfreq, Tempstat, excnt );
+
+		delete[]accfreq;
+		delete[]Tempstat;
+
+		return Step;
+	}
+
+	int REX_Parallel::runRound( int round, std::vector<int> &failed ){
+		const int nrep = rep.size();
+		std::vector<int> result( nrep, 0 );
+		std::vector<int> thrown( nrep, 0 );
+
+		if( round == 0 ){
+			// The first call to run() also sets up the forcefields, do it one after another
+			for(int r = 0; r < nrep; r++) {
+				FastRandom* previous = setThreadRandom( &m_Rand[r] );
+				rep[r].protocol().setTargetTemp( rep[r].getTargetTemp() );
+				result[r] = rep[r].protocol().run();
+				setThreadRandom( previous );
+			}
+		}else{
+#ifdef HAVE_OPENMP
+			#pragma omp parallel for schedule(dynamic,1)
+#endif
+			for(int r = 0; r < nrep; r++) {
+				// this thread draws its random numbers from the generator of replica r only
+				FastRandom* previous = setThreadRandom( &m_Rand[r] );
+				// exceptions must not leave the parallel region, rethrow them below
+				try{
+					rep[r].protocol().setTargetTemp( rep[r].getTargetTemp() );
+					result[r] = rep[r].protocol().runcore();
+				}
+				catch( ExceptionBase &ex ){
+					ex.Details();
+					thrown[r] = 1;
+				}
+				catch( ... ){
+					printf("remd.run_core_failure: replica %d threw an unknown exception\n", r);
+					thrown[r] = 1;
+				}
+				setThreadRandom( previous );
+			}
+		}
+
+		for(int r = 0; r < nrep; r++) {
+			if( thrown[r] ){
+				THROW(ProcedureException,"Replica " + int2str(r) + " failed with an exception (see above)");
+			}
+		}
+
+		failed.clear();
+		for(int t = 0; t < nrep; t++) {
+			if( result[ m_TempRep[t] ] < 0 ) failed.push_back( t );
+		}
+		return failed.size();
+	}
+
+	void REX_Parallel::rescueReplica( int t ){
+		// if runcore() fails it mean the simulation was unstable and "exploded"
+		// in that case attempt to rescue the situation by taking the structure of
+		// the replica above, minimising it and giving it new velocities.
+		// Note: this is thermodynamically 'illegal' and can only be tolerated without
+		// affecting the results if it occurs sporadically!
+		REX_Replica &failedrep = rep[ m_TempRep[t] ];
+		printf("remd.run_core_failure: Temp: %lf \n", failedrep.getTargetTemp());
+
+		int exchangefor = t + 1;
+		if(exchangefor >= (int)rep.size())
+			exchangefor = t - 1;
+		if(exchangefor < 0) return; // nothing to copy from
+
+		WorkSpace &wspace = failedrep.protocol().getWSpace();
+		wspace.load( rep[ m_TempRep[exchangefor] ].protocol().getWSpace().save() );
+
+		Minimisation mini( failedrep.protocol().getFF() );
+		mini.Algorithm = Minimisation::ConjugateGradients;
+		mini.Steps = 200;
+		mini.StepSize = 2E6;
+		mini.runcore();
+
+		failedrep.m_Structure = wspace.save();
+		FastRandom* previous = setThreadRandom( &m_Rand[ m_TempRep[t] ] );
+		failedrep.setInitialSpeeds( );
+		setThreadRandom( previous );
+		wspace.load( failedrep.m_Structure );
+	}
+
+	void REX_Parallel::exchangeSlots( int t ){
+		REX_Replica &lower = rep[ m_TempRep[t] ];
+		REX_Replica &upper = rep[ m_TempRep[t + 1] ];
+		WorkSpace &lowerws = lower.protocol().getWSpace();
+		WorkSpace &upperws = upper.protocol().getWSpace();
+
+		// the exchange mode of an adjacent pair of temperatures is that of rep[t], as in REX_Local
+		double factor = sqrt(m_SlotTemp[t + 1] / m_SlotTemp[t]);
+		switch ( rep[t].ExchangeMode ){
+			case REX_Replica::Swap:
+				// swap the temperatures, the structures stay where they are
+				lower.setTargetTemp( m_SlotTemp[t + 1] );
+				upper.setTargetTemp( m_SlotTemp[t] );
+				std::swap( m_TempRep[t], m_TempRep[t + 1] );
+				lowerws.scaleVelocities( factor );
+				upperws.scaleVelocities( 1 / factor );
+				break;
+			case REX_Replica::Downward:
+				lowerws.load( upperws.save() );
+				lowerws.scaleVelocities( 1 / factor );
+				lower.m_Structure.epot = upper.m_Structure.epot;
+				break;
+			case REX_Replica::Upward:
+				upperws.load( lowerws.save() );
+				upperws.scaleVelocities( factor );
+				upper.m_Structure.epot = lower.m_Structure.epot;
+				break;
+		}
+	}
+
+	void REX_Parallel::doParallelSafetyCheck(){
+		if( rep.size() == 0 ){
+			throw(ProcedureException("No Replicas were created before running the ReplicaExchange protocol"));
+		}
+		if( (FocusRep < 0) || (FocusRep >= (int)rep.size()) ){
+			throw(ProcedureException("FocusRep must be the index of one of the replicas") );
+		}
+
+		for(size_t r = 0; r < rep.size(); r++)
+		{
+			const WorkSpace *wspace = &rep[r].protocol().getWSpace();
+			if( wspace == &getWSpace() ){
+				throw(ProcedureException("Replicas of REX_Parallel must not work on the workspace of REX_Parallel itself !") );
+			}
+			if( wspace->nAtoms() != getWSpace().nAtoms() ){
+				throw(ProcedureException("All Replicas must have the same number of atoms !") );
+			}
+			for(size_t q = 0; q < r; q++)
+			{
+				if( wspace == &rep[q].protocol().getWSpace() ){
+					throw(ProcedureException("Every replica of REX_Parallel must work on a workspace of its own !") );
+				}
+			}
+		}
+	}
+
+}
@@ -10,6 +10,7 @@
 namespace Protocol{
 	class PD_API ProtocolBase;
 	class PD_API REX_Local;
+	class PD_API REX_Parallel;
 
 
 
@@ -27,6 +28,7 @@ namespace Protocol{
 	///
 	class PD_API REX_Replica{
 		friend class PD_API REX_Local;
+		friend class PD_API REX_Parallel;
 	
 		public:	
 		enum ExchangeModeType { Swap, Downward, Upward };
@@ -221,6 +223,11 @@ namespace Protocol{
 		/// Check that all replicas have identical numbers of atoms and work with the same workspace
 		void doInternalSafetyCheck();
 
+		/// Prints the acceptance ratio of every temperature pair and the history of which 
+		/// replica structure was at which temperature (Tempstat holds nexchange+1 rows of 
+		/// rep.size() entries).
+		void printExchangeStatistics( const double *accfreq, const int *Tempstat, int nexchange ) const;
+
 		/// prints a line of current energies
 		virtual void infoLine() const {}; 
 
@@ -229,6 +236,98 @@ namespace Protocol{
 
 		std::vector <REX_Replica> rep;
 	};
+
+
+
+
+
+
+
+
+	//-------------------------------------------------
+	//
+	/// \brief Replica Exchange with all replicas running concurrently
+	///
+	/// \details 
+	/// REX_Parallel runs the same algorithm as REX_Local, but rather than loading every 
+	/// replica into one WorkSpace in turn, each replica keeps its own WorkSpace and Forcefield
+	/// and all replicas of a round are simulated at the same time, one per OpenMP thread.
+	/// The threads only synchronise at the exchange points. An accepted exchange then swaps 
+	/// the target temperatures of the two replicas (and rescales their velocities) instead of 
+	/// copying their structures. Only the Downward and Upward exchange modes still copy 
+	/// a structure, as they duplicate one replica by definition.
+	///
+	/// Each replica must therefore be added with a template protocol that works on a
+	/// WorkSpace of its own, for example (Python):
+	///
+	/// \code
+	/// rex = REX_Parallel(ff)
+	/// for T in temps:
+	///   wspace = WorkSpace(sys)
+	///   ffr = createff(wspace)
+	///   rex.addReplica( MolecularDynamics(ffr), T )
+	/// \endcode
+	///
+	/// The Forcefield passed to the constructor (and its WorkSpace) is not simulated. 
+	/// After every round the replica at the temperature FocusRep is copied into it, 
+	/// Monitors added to REX_Parallel are measured on it every UpdateMon rounds and a 
+	/// trajectory entry is appended to its outtra every UpdateTra rounds. Likewise every
+	/// UpdateScr rounds an info line of that replica is printed. The replica protocols 
+	/// themselves run silently.
+	///
+	/// Outside runcore() the replica structures are held in temperature order as in
+	/// REX_Local, so getReplicas(), setReplicas(), printCheckPointMIME() and 
+	/// readCheckPointMIME() behave the same for both classes. The exchange statistics
+	/// printed at the end of a run also have the same format.
+	///
+	/// Every replica draws its random numbers (thermostat noise, Monte Carlo moves, new
+	/// velocities after a rescue) from a FastRandom of its own, so the threads do not 
+	/// contend for the global rand(). The generators are seeded from rand() at the start
+	/// of runcore(), hence a parallel run is reproducible from the global random seed.
+	///
+	class PD_API REX_Parallel: public REX_Local
+	{
+	public:
+		REX_Parallel(Physics::Forcefield & _ff):
+		REX_Local(_ff)
+		{
+			name = "Parallel Replica Exchange Manager";
+		}
+
+		virtual ~REX_Parallel(){
+		}
+
+		virtual REX_Parallel* clone() const 
+		{ 
+			return new REX_Parallel(*this); 
+		}
+
+		virtual int runcore();
+
+	protected:
+		/// Check that every replica has a WorkSpace of its own and that all WorkSpaces 
+		/// have the same number of atoms
+		void doParallelSafetyCheck();
+
+		/// Runs one round of all the replicas concurrently. Returns the number
+		/// of replicas whose simulation failed; these are listed in failed.
+		int runRound( int round, std::vector<int> &failed );
+
+		/// Attempts to rescue the replica at temperature slot t after its simulation failed
+		void rescueReplica( int t );
+
+		/// Accepted exchange between the temperature slots t and t+1
+		void exchangeSlots( int t );
+
+		/// Index of the replica currently running at the temperature of rep[t]
+		std::vector<int> m_TempRep;
+
+		/// Target temperatures of the slots (i.e. of rep[t] when the run started)
+		std::vector<double> m_SlotTemp;
+
+		/// Random number generator of each replica (indexed like rep, not by slot)
+		std::vector<Maths::FastRandom> m_Rand;
+	};
 }
 #endif
 
@@ -1,5 +1,7 @@
 #include "global.h"
 
+#include <algorithm>
+
 #include "alignment.h"
 
 #include "tools/stringtool.h"
@@ -11,12 +13,32 @@ using namespace std;
 
 namespace Sequence
 {
-	BestPathBase::BestPathBase( int gapPenalty, size_t xDimension, size_t yDimension ) : m_GapPenalty(gapPenalty),
+	size_t BestPathScratch::memuse( int level ) const
+	{
+		size_t mem = sizeof(double) * ( score.capacity() + prev.capacity() + cur.capacity() + colMax.capacity() + 
+			rowMax.capacity() + firstColumn.capacity() + checkpoint.capacity() ) +
+			sizeof(int) * ( colArg.capacity() + rowArg.capacity() + path.capacity() + checkpointArg.capacity() );
+		if(level>1)printf("    BestPathScratch: %d moves --> %3.2lf Mb \n", (int)path.size(), double(mem)/1024.0/1024.0);
+		return mem;
+	}
+
+	BestPathBase::BestPathBase( int gapPenalty, size_t xDimension, size_t yDimension, BestPathScratch* scratch, bool linearMemory ) : m_GapPenalty(gapPenalty),
 		m_XDimension(xDimension),
 		m_YDimension(yDimension),
-		m_ScoreMatrix(xDimension,yDimension),
-		m_PathStoreMatrix((int)xDimension-1,(int)yDimension-1,2) // has to be 1 smaller than the scoreMartix, the 3rd dimension holds the 2 coordinates i and j of the desired next cell in the scoreMatrix
+		m_BestPathStartCellIDX(0),
+		m_BestPathStartCellIDY(0),
+		m_Scratch(scratch != NULL ? scratch : &m_OwnScratch),
+		m_LinearMemory(linearMemory),
+		m_ScoreMatrixFilled(false),
+		m_BlockSize(1),
+		m_TraceBlock(-1)
 	{
+		// a single block is the whole table, otherwise the square root of the number of summed rows balances 
+		// the moves held for one block against the row states held at the block boundaries
+		if( m_XDimension > 1 )
+		{
+			m_BlockSize = m_LinearMemory ? (int)ceil(sqrt((double)(m_XDimension - 1))) : m_XDimension - 1;
+		}
 	}
 
 	int* BestPathBase::getEquiv( AlignmentDef &_AlignDef )
@@ -24,80 +46,203 @@ namespace Sequence
 		return _AlignDef.m_Equiv;
 	}
 
-	void BestPathBase::getBestPath()
+	void BestPathBase::FillScoreRow( int i, double* row )
 	{
-		int IPlusOne, JPlusOne, bestI, bestJ;
-		double bestValue;
+		if( !m_ScoreMatrixFilled )
+		{
+			m_ScoreMatrix = TNT::Array2D<double>(m_XDimension,m_YDimension);
+			FillScoreMatrix();
+			m_ScoreMatrixFilled = true;
+		}
+		for( int j = 0; j < m_YDimension; j++ )
+		{
+			row[j] = m_ScoreMatrix[i][j];
+		}
+	}
+
+	void BestPathBase::sumRow( int i, int* path )
+	{
+		BestPathScratch& s = *m_Scratch;
+		const int lastJ = m_YDimension - 1;
+		const double gap = (double)m_GapPenalty;
+
+		double* score = &s.score[0];
+		FillScoreRow( i, score );
+
+		// suffix maxima along row i+1, on a tie the lowest column is kept
+		const double* prev = &s.prev[0];
+		double* rowMax = &s.rowMax[0];
+		int* rowArg = &s.rowArg[0];
+		for( int l = lastJ; l >= 0; l-- )
+		{
+			if( prev[l] >= rowMax[l+1] )
+			{
+				rowMax[l] = prev[l];
+				rowArg[l] = l;
+			}
+			else
+			{
+				rowMax[l] = rowMax[l+1];
+				rowArg[l] = rowArg[l+1];
+			}
+		}
 
-		FillScoreMatrix();
+		// No cell of row i depends on another cell of row i, so this is a straight branch-free loop over
+		// contiguous arrays. The diagonal is assumed best, a gap (penalised) has to be strictly better to replace it.
+		const double* colMax = &s.colMax[0];
+		const int* colArg = &s.colArg[0];
+		double* cur = &s.cur[0];
+		for( int j = 0; j < lastJ; j++ )
+		{
+			double best = prev[j+1];
+			int move = 0;
+			const double down = colMax[j+1] - gap;
+			move = down > best ? colArg[j+1] : move;
+			best = down > best ? down : best;
+			const double along = rowMax[j+2] - gap;
+			move = along > best ? -rowArg[j+2] : move;
+			best = along > best ? along : best;
+			cur[j] = score[j] + best;
+			path[j] = move;
+		}
+		cur[lastJ] = score[lastJ];
 
-		for( int i = m_XDimension - 2; i >= 0; i-- ) // counting backwards from the far corner of the table and up one diagonally
+		// row i+1 becomes part of the column maxima of row i-1, it is lower than all rows already in there
+		double* colMaxW = &s.colMax[0];
+		int* colArgW = &s.colArg[0];
+		for( int j = 0; j <= lastJ; j++ )
 		{
-			for( int j = m_YDimension - 2; j >= 0; j-- )
+			if( prev[j] >= colMaxW[j] )
 			{
-				IPlusOne = i + 1; // the plus ones are the next cell down diagonally, i.e. the first evaluation for best path ..
-				JPlusOne = j + 1;
-				bestI = IPlusOne; // we will initially asume that the diagonal is the best initial path, to be edited in a moment if not
-				bestJ = JPlusOne;
-				bestValue = m_ScoreMatrix[bestI][bestJ]; // so what is the assumptions' value
+				colMaxW[j] = prev[j];
+				colArgW[j] = i + 1;
+			}
+		}
 
-				for( int countI = i + 2; countI < m_XDimension; countI++ )
-				{
-					double additionScore = m_ScoreMatrix[countI][JPlusOne] - m_GapPenalty;
-					// gap penalty is invoked on anything other than the direct diagonal;
-					if( additionScore > bestValue )
-					{
-						bestI = countI;
-						bestJ = JPlusOne;
-						bestValue = additionScore;
-					}
-				}
+		s.prev.swap( s.cur );
+		s.firstColumn[i] = s.prev[0];
+	}
 
-				for( int countJ = j + 2; countJ < m_YDimension; countJ++ )
+	void BestPathBase::sumRows( int top, int bottom, int* path, bool checkpoint )
+	{
+		BestPathScratch& s = *m_Scratch;
+		const int rowLength = m_YDimension - 1;
+		for( int i = top; i >= bottom; i-- )
+		{
+			if( checkpoint )
+			{
+				// the first row summed in each block: record the state it is summed from
+				if( i == top || (i + 1) % m_BlockSize == 0 )
 				{
-					double additionScore = m_ScoreMatrix[IPlusOne][countJ] - m_GapPenalty;
-					if( additionScore > bestValue )
-					{
-						bestI = IPlusOne;
-						bestJ = countJ;
-						bestValue = additionScore;
-					}
+					size_t block = i / m_BlockSize;
+					std::copy( s.prev.begin(), s.prev.end(), s.checkpoint.begin() + block * 2 * m_YDimension );
+					std::copy( s.colMax.begin(), s.colMax.end(), s.checkpoint.begin() + (block * 2 + 1) * m_YDimension );
+					std::copy( s.colArg.begin(), s.colArg.end(), s.checkpointArg.begin() + block * m_YDimension );
 				}
-
-				m_PathStoreMatrix[i][j][0] = bestI; // this records an ID for the cell we found for following the path backwards
-				m_PathStoreMatrix[i][j][1] = bestJ;
-
-				m_ScoreMatrix[i][j] += bestValue; // the best possible scoring total from the path from the current i,j pairing
+				sumRow( i, path ); // the moves are not kept, the block is re-summed during the traceback
 			}
+			else
+			{
+				sumRow( i, path + (size_t)(i - bottom) * rowLength );
+			}
+		}
+	}
+
+	void BestPathBase::getBestPath()
+	{
+		BestPathScratch& s = *m_Scratch;
+		const int X = m_XDimension;
+		const int Y = m_YDimension;
+
+		s.score.resize(Y);
+		s.prev.resize(Y);
+		s.cur.resize(Y);
+		s.colMax.assign(Y,-DBL_MAX);
+		s.colArg.assign(Y,X);
+		s.rowMax.resize(Y+1);
+		s.rowArg.resize(Y+1);
+		s.rowMax[Y] = -DBL_MAX;
+		s.rowArg[Y] = Y;
+		s.firstColumn.resize(X);
+		s.path.resize( (size_t)m_BlockSize * (Y - 1) );
+		if( m_LinearMemory )
+		{
+			size_t blocks = (X - 2) / m_BlockSize + 1;
+			s.checkpoint.resize( blocks * 2 * Y );
+			s.checkpointArg.resize( blocks * Y );
 		}
 
+		// counting backwards from the far corner of the table, the last row and column are just their scores
+		FillScoreRow( X - 1, &s.prev[0] );
+		s.firstColumn[X-1] = s.prev[0];
+		sumRows( X - 2, 0, &s.path[0], m_LinearMemory );
+		m_TraceBlock = m_LinearMemory ? -1 : 0;
+
 		// we now need to find the best starting cell and set m_BestPathStartCellIDX, and m_BestPathStartCellIDY
-		double bestScoreMatrixValue = m_ScoreMatrix[0][0]; // begin with this cell
+		// s.prev now holds the summed row 0
+		double bestScoreMatrixValue = s.firstColumn[0]; // begin with this cell
 		m_BestPathStartCellIDX = 0;
 		m_BestPathStartCellIDY = 0;
 		// is it the best, probably not...
 
-		for( int i = 1; i < m_XDimension; i++ )
+		for( int i = 1; i < X; i++ )
 		{
-			if( m_ScoreMatrix[i][0] > bestScoreMatrixValue )
+			if( s.firstColumn[i] > bestScoreMatrixValue )
 			{
 				m_BestPathStartCellIDX = i;
-				bestScoreMatrixValue = m_ScoreMatrix[i][0];
+				bestScoreMatrixValue = s.firstColumn[i];
 			}
 		}
-		for( int j = 1; j < m_YDimension; j++ )
+		for( int j = 1; j < Y; j++ )
 		{
-			if( m_ScoreMatrix[0][j] > bestScoreMatrixValue )
+			if( s.prev[j] > bestScoreMatrixValue )
 			{
 				m_BestPathStartCellIDX = 0; // we neeed to be in the 1st row or the 1st column
 				m_BestPathStartCellIDY = j;
-				bestScoreMatrixValue = m_ScoreMatrix[0][j];
+				bestScoreMatrixValue = s.prev[j];
 			}
 		}
-		// The m_PathStoreMatrix has been found and the starting cell for the path has been defined.
+		// The moves have been found and the starting cell for the path has been defined.
 		// Our work here is done!
 	}
 
+	bool BestPathBase::stepPath( int& i, int& j )
+	{
+		if( i >= m_XDimension - 1 || j >= m_YDimension - 1 )
+			return false; // we have fallen off the end of the table
+
+		BestPathScratch& s = *m_Scratch;
+		int block = i / m_BlockSize;
+		if( block != m_TraceBlock )
+		{
+			// linear memory mode: re-sum the block from the state recorded at its boundary
+			std::copy( s.checkpoint.begin() + block * 2 * m_YDimension, s.checkpoint.begin() + (block * 2 + 1) * m_YDimension, s.prev.begin() );
+			std::copy( s.checkpoint.begin() + (block * 2 + 1) * m_YDimension, s.checkpoint.begin() + (block * 2 + 2) * m_YDimension, s.colMax.begin() );
+			std::copy( s.checkpointArg.begin() + block * m_YDimension, s.checkpointArg.begin() + (block + 1) * m_YDimension, s.colArg.begin() );
+			int top = std::min( (block + 1) * m_BlockSize, m_XDimension - 1 ) - 1;
+			sumRows( top, block * m_BlockSize, &s.path[0], false );
+			m_TraceBlock = block;
+		}
+
+		int move = s.path[ (size_t)(i - block * m_BlockSize) * (m_YDimension - 1) + j ];
+		if( move == 0 )
+		{
+			i++;
+			j++;
+		}
+		else if( move > 0 )
+		{
+			i = move;
+			j++;
+		}
+		else
+		{
+			i++;
+			j = -move;
+		}
+		return true;
+	}
+
 
 
 	void AlignmentDef::ResetAlignment()
@@ -425,15 +570,15 @@ namespace Sequence
 		}
 	}
 
-	SimpleBestPath::SimpleBestPath( int gapPenalty, AlignmentDef &_AlignDef ) : 
+	SimpleBestPath::SimpleBestPath( int gapPenalty, AlignmentDef &_AlignDef, BestPathScratch* scratch, bool linearMemory ) : 
 		m_AlignDef(&_AlignDef),
-		BestPathBase( gapPenalty, _AlignDef.getSeq1().size(), _AlignDef.getSeq2().size() )
+		BestPathBase( gapPenalty, _AlignDef.getSeq1().size(), _AlignDef.getSeq2().size(), scratch, linearMemory )
 	{
 	}
 
 	void SimpleBestPath::FillEquivList()
 	{
-		// now we need to fill the _equiv from the 'best path' through the newly summed m_ScoreMatrix
+		// now we need to fill the _equiv from the 'best path' recorded by getBestPath()
 		int* _equiv = getEquiv( *m_AlignDef );
 
 		// init locals
@@ -442,32 +587,38 @@ namespace Sequence
 
 		m_AlignDef->ResetAlignment();
 
-		// lets move through the path array to set the Equivelencies in '_equiv'
-		// while() i.e. until we fall off the end of the table
-		while( iPointer < ( m_XDimension - 1 ) && jPointer < ( m_YDimension - 1 ) ) 
+		// lets move through the path to set the Equivelencies in '_equiv'
+		// until we fall off the end of the table
+		_equiv[ iPointer ] = jPointer;
+		while( stepPath( iPointer, jPointer ) ) 
 		{
-			// mark the equiv
 			_equiv[ iPointer ] = jPointer;
-
-			// get the next cell IDs
-			// TempBufferIPointer :- needed as the jPointer-lookup needs the older iPointer
-			int TempBufferIPointer = m_PathStoreMatrix[iPointer][jPointer][0];
-			jPointer = m_PathStoreMatrix[iPointer][jPointer][1];
-			iPointer = TempBufferIPointer;
 		}
 
-		// mark the equiv
-		_equiv[ iPointer ] = jPointer;
-
 		// all equivs are now set, we are done
 	}
 
+	void SimpleBestPath::FillScoreRow( int i, double* row )
+	{
+		const BioSequence &seq1 = m_AlignDef->getSeq1();
+		const BioSequence &seq2 = m_AlignDef->getSeq2();
+		const char resI = seq1[i];
+		for( int j = 0; j < m_YDimension; j++ )
+		{
+			row[j] = ( resI == seq2[j] ) ? 2.0 : 0.0;
+		}
+	}
+
 	void SimpleBestPath::FillScoreMatrix()
 	{
 		const BioSequence &seq1 = m_AlignDef->getSeq1();
 		const BioSequence &seq2 = m_AlignDef->getSeq2();
 
-		// make the scorematrix
+		// make the scorematrix - getBestPath() uses FillScoreRow() and never allocates it
+		if( m_ScoreMatrix.dim1() != m_XDimension || m_ScoreMatrix.dim2() != m_YDimension )
+		{
+			m_ScoreMatrix = TNT::Array2D<double>(m_XDimension,m_YDimension);
+		}
 		for( int i = 0; i < m_XDimension; i++ )
 		{
 			for( int j = 0; j < m_YDimension; j++ )
@@ -484,7 +635,8 @@ namespace Sequence
 		}
 	}
 
-	SimpleAligner::SimpleAligner() : AlignerBase()
+	SimpleAligner::SimpleAligner() : AlignerBase(),
+		LinearMemoryCells(4*1024*1024)
 	{
 	}
 
@@ -492,7 +644,8 @@ namespace Sequence
 	{
 		// _AlignDef.ResetAlignment() is called by Align() in base class
 		
-		SimpleBestPath bp( 1, _AlignDef );
+		size_t cells = _AlignDef.getSeq1().size() * _AlignDef.getSeq2().size();
+		SimpleBestPath bp( 1, _AlignDef, &m_Scratch, cells > LinearMemoryCells );
 		bp.getBestPath(); // Class 'BestPathBase' calls 'FillScoreMatrix()' during getBestPath()
 		bp.FillEquivList();
 	}
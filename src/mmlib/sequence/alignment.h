@@ -14,6 +14,35 @@ namespace Sequence
 
 
 
+//-------------------------------------------------
+//
+/// \brief Working storage of BestPathBase, kept between alignments so that repeated alignments do not reallocate
+///
+/// \details The best path is summed a row at a time from the far corner of the table. Only the row being summed
+/// and the one below it are held, together with per column maxima of all rows further down. The moves of the
+/// best path are stored as one int per cell: 0 for the diagonal, k > 0 for a gap down to row k and -l for a gap
+/// along to column l. In linear memory mode only the moves of one block of rows are held at a time, the
+/// row states at the block boundaries are kept in 'checkpoint' to re-sum a block during the traceback.
+///
+	struct PD_API BestPathScratch
+	{
+		std::vector<double> score; ///< The scores of the row being summed
+		std::vector<double> prev; ///< Summed row i+1
+		std::vector<double> cur; ///< Summed row i
+		std::vector<double> colMax; ///< Per column, the best summed value of the rows beyond i+1 ...
+		std::vector<int> colArg; ///< ... and the lowest row that holds it
+		std::vector<double> rowMax; ///< Suffix maxima of row i+1 ...
+		std::vector<int> rowArg; ///< ... and the lowest column that holds them
+		std::vector<double> firstColumn; ///< Summed values of column 0, candidates for the start of the path
+		std::vector<int> path; ///< Moves of the best path from each cell
+		std::vector<double> checkpoint; ///< prev and colMax at each block boundary (linear memory mode)
+		std::vector<int> checkpointArg; ///< colArg at each block boundary (linear memory mode)
+
+		size_t memuse( int level ) const;
+	};
+
+
+
 
 
 
@@ -33,21 +62,35 @@ namespace Sequence
 	class PD_API BestPathBase // Pure abstract base class
 	{
 	public:
-		BestPathBase( int gapPenalty, size_t xDimension, size_t yDimension );
+		BestPathBase( int gapPenalty, size_t xDimension, size_t yDimension, BestPathScratch* scratch = NULL, bool linearMemory = false );
 		virtual void FillScoreMatrix() = 0; // override for in derived classes for custom score behaviour
-		void getBestPath(); // finds the sum route through the matrix and then fills the m_PathStoreMatrix to record the best path
+		virtual void FillScoreRow( int i, double* row ); ///< Scores of row i (m_YDimension values). The default takes them from FillScoreMatrix()
+		void getBestPath(); // finds the sum route through the matrix and then records the moves of the best path
 
 	protected:
 		int* getEquiv( AlignmentDef &_AlignDef ); /// Obtain a writable pointer to the current AlignDef
 
+		/// Moves (i,j) to the next cell of the best path, returns false once the path has fallen off the end of the table
+		bool stepPath( int& i, int& j );
+
 		int m_GapPenalty;
 		int m_XDimension;
 		int m_YDimension;
 		int m_BestPathStartCellIDX;
 		int m_BestPathStartCellIDY;
 
-		TNT::Array2D<double> m_ScoreMatrix;
-		TNT::Array3D<int> m_PathStoreMatrix;
+		TNT::Array2D<double> m_ScoreMatrix; ///< Only allocated if the default FillScoreRow() is used
+
+	private:
+		void sumRows( int top, int bottom, int* path, bool checkpoint );
+		void sumRow( int i, int* path );
+
+		BestPathScratch m_OwnScratch;
+		BestPathScratch* m_Scratch;
+		bool m_LinearMemory;
+		bool m_ScoreMatrixFilled;
+		int m_BlockSize; ///< Rows per traceback block in linear memory mode
+		int m_TraceBlock; ///< The block whose moves are currently held in m_Scratch->path
 	};
 
 
@@ -219,10 +262,11 @@ namespace Sequence
 	{
 		friend class SimpleAligner;
 	protected:
-		SimpleBestPath( int gapPenalty, AlignmentDef &_AlignDef );
+		SimpleBestPath( int gapPenalty, AlignmentDef &_AlignDef, BestPathScratch* scratch = NULL, bool linearMemory = false );
 		void FillEquivList();	
 		// Member Functions
 		virtual void FillScoreMatrix();		
+		virtual void FillScoreRow( int i, double* row );
 		AlignmentDef *m_AlignDef;
 	};
 
@@ -283,8 +327,15 @@ void Test_Alignment_Code()
 	{
 	public:
 		SimpleAligner();
+
+		/// Alignments whose table has more cells than this keep only O(sqrt(len1)) rows of path moves
+		/// and re-sum each block of rows during the traceback, trading twice the work for memory.
+		size_t LinearMemoryCells;
+
 	protected:
 		virtual void AlignCore( AlignmentDef &_AlignDef ) const;
+
+		mutable BestPathScratch m_Scratch; ///< Re-used by every AlignCore() call - an aligner must not be shared between threads
 	};
 
 
@@ -199,7 +199,7 @@ double Particle::getCustomProperty_Double(const std::string &_name) const {
 
 void Width4Printer( const std::string& _term )
 {
-	static StringBuilder sb;
+	StringBuilder sb;
 	sb.setTo(_term);
 	if(sb.size()<4)
 	{
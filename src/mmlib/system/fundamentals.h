@@ -91,6 +91,7 @@ class PD_API Particle
 public:
 	friend class MoleculeBase;
 	friend class WorkspaceCreatorBase;
+	friend class FFParamBinaryCache;
 
 	Particle();
 	Particle(
@@ -309,7 +309,7 @@ bool rebuildMissingAtoms( MoleculeBase& mol, Verbosity::Type verbose )
 			// We will get into this code path if we are something like water
 			// very small and lacking forward and back links
 
-			static Maths::dvector cog; // centre of mass
+			Maths::dvector cog; // centre of mass
 			cog.setTo(0,0,0);
 			int validCount = 0;
 			for(size_t j = jStart; j <= jEnd; j++)
@@ -333,7 +333,7 @@ bool rebuildMissingAtoms( MoleculeBase& mol, Verbosity::Type verbose )
 			{
 				cog.div((double)validCount);
 				// Superimpose the centre of the geoPos onto the current centre of mass!
-				static Maths::dvector cogGeo; // centre of mass
+				Maths::dvector cogGeo; // centre of mass
 				cogGeo.setTo(0,0,0);
 				for(size_t j = jStart; j <= jEnd; j++)
 				{
@@ -0,0 +1,93 @@
+#include "global.h"
+#include "tools/cpufeatures.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <cpuid.h>
+	#define CPUFEATURES_X86_GCC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#define CPUFEATURES_X86_MSVC
+#endif
+
+namespace
+{
+	// cpuid leaf 'leaf', subleaf 'sub' -> regs[4] = {eax, ebx, ecx, edx}
+	bool cpuid( unsigned leaf, unsigned sub, unsigned regs[4] )
+	{
+#if defined(CPUFEATURES_X86_GCC)
+		if( __get_cpuid_max( leaf & 0x80000000u, 0 ) < leaf ) return false;
+		__cpuid_count( leaf, sub, regs[0], regs[1], regs[2], regs[3] );
+		return true;
+#elif defined(CPUFEATURES_X86_MSVC)
+		int r[4];
+		__cpuid( r, 0 );
+		if( (unsigned)r[0] < leaf ) return false;
+		__cpuidex( r, (int)leaf, (int)sub );
+		for( int i = 0; i < 4; i++ ) regs[i] = (unsigned)r[i];
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// The XCR0 register tells us which register sets the OS saves on a context switch
+	unsigned long long xgetbv0()
+	{
+#if defined(CPUFEATURES_X86_GCC)
+		unsigned lo, hi;
+		__asm__ __volatile__( ".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0) );
+		return ((unsigned long long)hi << 32) | lo;
+#elif defined(CPUFEATURES_X86_MSVC) && (_MSC_FULL_VER >= 160040219)
+		return _xgetbv(0);
+#else
+		return 0;
+#endif
+	}
+
+	CpuSimdLevel detectSimdLevel()
+	{
+		unsigned regs[4];
+		if( !cpuid( 1, 0, regs ) ) return CpuSimd_None;
+
+		CpuSimdLevel level = CpuSimd_None;
+		if( regs[3] & (1u << 26) ) level = CpuSimd_SSE2;
+
+		const bool osxsave = (regs[2] & (1u << 27)) != 0;
+		const bool avx     = (regs[2] & (1u << 28)) != 0;
+		if( level == CpuSimd_SSE2 && osxsave && avx && ((xgetbv0() & 6) == 6) )
+		{
+			level = CpuSimd_AVX;
+			if( cpuid( 7, 0, regs ) && (regs[1] & (1u << 5)) ) level = CpuSimd_AVX2;
+		}
+		return level;
+	}
+
+	CpuSimdLevel applyEnvironmentCap( CpuSimdLevel level )
+	{
+		const char *env = getenv( "PD_SIMD" );
+		if( env == NULL ) return level;
+		CpuSimdLevel cap = level;
+		if(      strcmp( env, "none" ) == 0 ) cap = CpuSimd_None;
+		else if( strcmp( env, "sse2" ) == 0 ) cap = CpuSimd_SSE2;
+		else if( strcmp( env, "avx"  ) == 0 ) cap = CpuSimd_AVX;
+		else if( strcmp( env, "avx2" ) == 0 ) cap = CpuSimd_AVX2;
+		return cap < level ? cap : level;
+	}
+}
+
+CpuSimdLevel cpuSimdLevel()
+{
+	static const CpuSimdLevel level = applyEnvironmentCap( detectSimdLevel() );
+	return level;
+}
+
+const char *cpuSimdLevelName( CpuSimdLevel level )
+{
+	switch( level )
+	{
+		case CpuSimd_SSE2: return "SSE2";
+		case CpuSimd_AVX:  return "AVX";
+		case CpuSimd_AVX2: return "AVX2";
+		default:           return "none";
+	}
+}
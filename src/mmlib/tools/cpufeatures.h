@@ -0,0 +1,31 @@
+#ifndef __CPUFEATURES_H
+#define __CPUFEATURES_H
+
+//-------------------------------------------------
+//
+/// \brief Runtime detection of the vector instruction sets of the host CPU
+///
+/// \details Kernels which have SSE2/AVX code paths compiled in use this to decide
+/// at runtime which of them the machine they are running on can actually execute.
+/// AVX is only reported if the operating system also saves the upper halves of the
+/// ymm registers (checked via XGETBV). The result is determined once and cached.
+///
+/// The environment variable PD_SIMD can be set to "none", "sse2" or "avx" to cap
+/// the reported level, which is useful for comparing vector and scalar results.
+///
+enum CpuSimdLevel
+{
+	CpuSimd_None = 0,
+	CpuSimd_SSE2 = 1,
+	CpuSimd_AVX  = 2,
+	CpuSimd_AVX2 = 3
+};
+
+/// Returns the highest vector instruction set supported by CPU and OS
+PD_API CpuSimdLevel cpuSimdLevel();
+
+/// Returns a printable name for a CpuSimdLevel
+PD_API const char *cpuSimdLevelName( CpuSimdLevel level );
+
+#endif
+
@@ -1,5 +1,19 @@
 #include "global.h"
 
+#ifdef WIN32
+	#include <windows.h>
+	#include <process.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <pthread.h>
+#endif
+
+#include <deque>
+#include <time.h>
+
 #include "io.h"
 
 using namespace Maths;
@@ -195,6 +209,274 @@ namespace IO // tools for file manipulation and information import
 		return (long)pos;
 	}
 
+	std::string tempFilenameFor( const std::string &_filename )
+	{
+#ifdef WIN32
+		unsigned long pid = (unsigned long)_getpid();
+#else
+		unsigned long pid = (unsigned long)getpid();
+#endif
+		// the address of a local tells apart threads of the same process
+		int local = 0;
+		char suffix[64];
+		sprintf( suffix, ".%lx.%lx%lx.tmp", pid, (unsigned long)time(NULL), (unsigned long)(size_t)&local );
+		return _filename + suffix;
+	}
+
+	bool replaceFile( const std::string &_tempFile, const std::string &_filename )
+	{
+		if( 0 != rename( _tempFile.c_str(), _filename.c_str() ) )
+		{
+			// Windows will not rename over an existing file
+			remove( _filename.c_str() );
+			if( 0 != rename( _tempFile.c_str(), _filename.c_str() ) )
+			{
+				remove( _tempFile.c_str() );
+				return false;
+			}
+		}
+		return true;
+	}
+
+	MappedFile::MappedFile( const std::string &_filename ):
+		m_Filename( _filename ),
+		m_Data( NULL ),
+		m_Size( 0 )
+	{
+#ifdef WIN32
+		m_Mapping = NULL;
+		m_File = CreateFileA( _filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+		if( m_File == INVALID_HANDLE_VALUE )
+		{
+			THROW(IOException,"MappedFile could not open the file '" + _filename + "'");
+		}
+		LARGE_INTEGER filesize;
+		if( !GetFileSizeEx( (HANDLE)m_File, &filesize ) )
+		{
+			CloseHandle( (HANDLE)m_File );
+			THROW(IOException,"MappedFile could not determine the size of '" + _filename + "'");
+		}
+		m_Size = (size_t) filesize.QuadPart;
+		if( m_Size == 0 ) return; // nothing to map
+		m_Mapping = CreateFileMapping( (HANDLE)m_File, NULL, PAGE_READONLY, 0, 0, NULL );
+		if( m_Mapping != NULL )
+		{
+			m_Data = (const char*) MapViewOfFile( (HANDLE)m_Mapping, FILE_MAP_READ, 0, 0, 0 );
+		}
+		if( m_Data == NULL )
+		{
+			if( m_Mapping != NULL ) CloseHandle( (HANDLE)m_Mapping );
+			CloseHandle( (HANDLE)m_File );
+			THROW(IOException,"MappedFile could not map the file '" + _filename + "' into memory");
+		}
+#else
+		m_Fd = open( _filename.c_str(), O_RDONLY );
+		if( m_Fd < 0 )
+		{
+			THROW(IOException,"MappedFile could not open the file '" + _filename + "'");
+		}
+		struct stat filestat;
+		if( fstat( m_Fd, &filestat ) != 0 )
+		{
+			close( m_Fd );
+			THROW(IOException,"MappedFile could not determine the size of '" + _filename + "'");
+		}
+		m_Size = (size_t) filestat.st_size;
+		if( m_Size == 0 ) return; // nothing to map, mmap() would fail
+		void *mapping = mmap( NULL, m_Size, PROT_READ, MAP_SHARED, m_Fd, 0 );
+		if( mapping == MAP_FAILED )
+		{
+			close( m_Fd );
+			THROW(IOException,"MappedFile could not map the file '" + _filename + "' into memory");
+		}
+		m_Data = (const char*) mapping;
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+#ifdef WIN32
+		if( m_Data != NULL ) UnmapViewOfFile( m_Data );
+		if( m_Mapping != NULL ) CloseHandle( (HANDLE)m_Mapping );
+		CloseHandle( (HANDLE)m_File );
+#else
+		if( m_Data != NULL ) munmap( (void*) m_Data, m_Size );
+		close( m_Fd );
+#endif
+	}
+
+	struct AsyncFileWriter::State
+	{
+		FILE *file;
+		size_t maxQueued;
+		std::deque<std::string> queue;
+		std::string error;
+#ifndef WIN32
+		pthread_t thread;
+		pthread_mutex_t lock;
+		pthread_cond_t queued;   ///< signalled when a record is queued or the writer should stop
+		pthread_cond_t written;  ///< signalled when a record has been written
+		bool writing; ///< the writer has taken a record off the queue and not yet written it
+		bool stop;
+#endif
+	};
+
+	AsyncFileWriter::AsyncFileWriter( const std::string &_filename, size_t _MaxQueued ):
+		m_Filename( _filename ),
+		m_State( NULL )
+	{
+		FILE *file = fopen( _filename.c_str(), "ab" );
+		if( file == NULL )
+		{
+			THROW(IOException,"AsyncFileWriter could not open the file '" + _filename + "' for writing");
+		}
+		m_State = new State();
+		m_State->file = file;
+		m_State->maxQueued = _MaxQueued > 0 ? _MaxQueued : 1;
+#ifndef WIN32
+		m_State->writing = false;
+		m_State->stop = false;
+		pthread_mutex_init( &m_State->lock, NULL );
+		pthread_cond_init( &m_State->queued, NULL );
+		pthread_cond_init( &m_State->written, NULL );
+		if( 0 != pthread_create( &m_State->thread, NULL, &AsyncFileWriter::writerMain, m_State ) )
+		{
+			pthread_cond_destroy( &m_State->written );
+			pthread_cond_destroy( &m_State->queued );
+			pthread_mutex_destroy( &m_State->lock );
+			fclose( m_State->file );
+			delete m_State;
+			m_State = NULL;
+			THROW(IOException,"AsyncFileWriter could not start its writer thread for '" + _filename + "'");
+		}
+#endif
+	}
+
+	AsyncFileWriter::~AsyncFileWriter()
+	{
+		try
+		{
+			close();
+		}
+		catch( ExceptionBase ex )
+		{
+			// never throw from a destructor, the message has already been printed by the exception
+		}
+	}
+
+	void* AsyncFileWriter::writerMain( void* _State )
+	{
+#ifndef WIN32
+		State *state = (State*)_State;
+		std::string record;
+		pthread_mutex_lock( &state->lock );
+		while( true )
+		{
+			while( state->queue.size() == 0 && !state->stop )
+			{
+				pthread_cond_wait( &state->queued, &state->lock );
+			}
+			if( state->queue.size() == 0 ) break; // stop requested and nothing left to write
+
+			record.swap( state->queue.front() );
+			state->queue.pop_front();
+			state->writing = true;
+			pthread_mutex_unlock( &state->lock );
+
+			// Write outside the lock so that the producer can keep queueing
+			bool ok = ( record.size() == fwrite( record.data(), 1, record.size(), state->file ) );
+			ok = ( 0 == fflush( state->file ) ) && ok;
+
+			pthread_mutex_lock( &state->lock );
+			state->writing = false;
+			if( !ok && state->error.size() == 0 )
+			{
+				state->error = "AsyncFileWriter failed to write to the file";
+			}
+			pthread_cond_broadcast( &state->written );
+		}
+		pthread_mutex_unlock( &state->lock );
+#endif
+		return NULL;
+	}
+
+	void AsyncFileWriter::write( std::string &_Record )
+	{
+		if( m_State == NULL )
+		{
+			THROW(IOException,"AsyncFileWriter::write() called on the closed file '" + m_Filename + "'");
+		}
+#ifdef WIN32
+		bool ok = ( _Record.size() == fwrite( _Record.data(), 1, _Record.size(), m_State->file ) );
+		ok = ( 0 == fflush( m_State->file ) ) && ok;
+		_Record.clear();
+		if( !ok ) THROW(IOException,"AsyncFileWriter failed to write to '" + m_Filename + "'");
+#else
+		pthread_mutex_lock( &m_State->lock );
+		while( m_State->queue.size() >= m_State->maxQueued && m_State->error.size() == 0 )
+		{
+			pthread_cond_wait( &m_State->written, &m_State->lock );
+		}
+		if( m_State->error.size() != 0 )
+		{
+			std::string error = m_State->error;
+			pthread_mutex_unlock( &m_State->lock );
+			THROW(IOException,error + " '" + m_Filename + "'");
+		}
+		m_State->queue.push_back( std::string() );
+		m_State->queue.back().swap( _Record );
+		pthread_cond_signal( &m_State->queued );
+		pthread_mutex_unlock( &m_State->lock );
+#endif
+	}
+
+	void AsyncFileWriter::flush()
+	{
+		if( m_State == NULL ) return;
+#ifndef WIN32
+		pthread_mutex_lock( &m_State->lock );
+		while( ( m_State->queue.size() > 0 || m_State->writing ) && m_State->error.size() == 0 )
+		{
+			pthread_cond_wait( &m_State->written, &m_State->lock );
+		}
+		std::string error = m_State->error;
+		pthread_mutex_unlock( &m_State->lock );
+		if( error.size() != 0 )
+		{
+			THROW(IOException,error + " '" + m_Filename + "'");
+		}
+#endif
+	}
+
+	void AsyncFileWriter::close()
+	{
+		if( m_State == NULL ) return;
+		std::string error;
+#ifndef WIN32
+		// The writer drains the queue before it honours the stop request
+		pthread_mutex_lock( &m_State->lock );
+		m_State->stop = true;
+		pthread_cond_signal( &m_State->queued );
+		pthread_mutex_unlock( &m_State->lock );
+		pthread_join( m_State->thread, NULL );
+		pthread_cond_destroy( &m_State->written );
+		pthread_cond_destroy( &m_State->queued );
+		pthread_mutex_destroy( &m_State->lock );
+		error = m_State->error;
+#endif
+		if( 0 != fclose( m_State->file ) && error.size() == 0 )
+		{
+			error = "AsyncFileWriter failed to close the file";
+		}
+		delete m_State;
+		m_State = NULL;
+		if( error.size() != 0 )
+		{
+			THROW(IOException,error + " '" + m_Filename + "'");
+		}
+	}
+
 	bool PD_API fileExists(const std::string &_filename)
 	{
 		FILE *file;
@@ -27,11 +27,99 @@ namespace IO // tools for file manipulation and information import
 	long PD_API getFileSize( const std::string &_filename );
 	bool PD_API fileExists(const std::string &_filename);
 
+	/// Returns a name in the directory of _filename for a temporary file that is later renamed
+	/// onto _filename. The name contains the process id, the time and the calling thread's stack,
+	/// so concurrent jobs writing the same file never use the same temporary.
+	std::string PD_API tempFilenameFor( const std::string &_filename );
+	/// Renames _tempFile onto _filename, replacing any existing file. The temporary is
+	/// removed if that fails. Returns true on success.
+	bool PD_API replaceFile( const std::string &_tempFile, const std::string &_filename );
+
 	// [todo] need updating to std::string (mook)
 	int PD_API fcopy(char *, char *); // copies a file from one to other
 	int PD_API readFlatVectorFile(char *filename, Maths::dvector ** point, int *npoints);
 	int PD_API readFlatFloatFile(char *filename, double **value, int *nvalues);
 
+	//-------------------------------------------------
+	//
+	/// \brief  Read-only memory mapping of an entire file
+	///
+	/// \details The file is mapped into the address space when the object is constructed
+	/// and unmapped when it is destroyed. The operating system pages the contents in on 
+	/// demand and shares them between all threads (and processes) reading the same file,
+	/// so random access into large files costs no more than the pages actually touched.
+	/// data() stays valid for the lifetime of the object and may be read concurrently from
+	/// several threads. Throws an IOException if the file cannot be opened or mapped.
+	/// 
+	/// Objects cannot be copied, share them via a (counted) pointer instead.
+	///
+	class PD_API MappedFile
+	{
+	public:
+		MappedFile( const std::string &_filename );
+		~MappedFile();
+
+		const char *data() const { return m_Data; }
+		size_t size() const { return m_Size; }
+		const std::string &getFilename() const { return m_Filename; }
+
+	private:
+		MappedFile( const MappedFile & );
+		MappedFile &operator=( const MappedFile & );
+
+		std::string m_Filename;
+		const char *m_Data;
+		size_t m_Size;
+#ifdef WIN32
+		void *m_File;
+		void *m_Mapping;
+#else
+		int m_Fd;
+#endif
+	};
+
+	//-------------------------------------------------
+	//
+	/// \brief  Appends whole records to a file from a background writer thread
+	///
+	/// \details The file is opened (for appending) on construction and kept open until close().
+	/// write() queues a record and returns immediately unless MaxQueued records are already 
+	/// waiting, in which case it blocks until the writer thread has caught up. The writer flushes 
+	/// every record to the operating system as soon as it is written, so if the process dies only 
+	/// the records still in the queue are lost. flush() blocks until the queue is empty, close() 
+	/// flushes, stops the thread and closes the file; the destructor calls close().
+	/// Errors in the writer thread are re-thrown as IOException from the next write(), flush() or close().
+	///
+	/// On WIN32 builds there is no writer thread: records are written straight away, but the
+	/// file is still held open between records.
+	///
+	/// Objects cannot be copied, share them via a (counted) pointer instead.
+	///
+	class PD_API AsyncFileWriter
+	{
+	public:
+		AsyncFileWriter( const std::string &_filename, size_t _MaxQueued = 32 );
+		~AsyncFileWriter();
+
+		/// Queues a record. The contents of _Record are taken over, it is left empty.
+		void write( std::string &_Record );
+		void flush(); ///< Blocks until every queued record has been handed to the operating system
+		void close(); ///< Flushes and closes the file, further writes throw
+
+		bool isOpen() const { return m_State != NULL; }
+		const std::string &getFilename() const { return m_Filename; }
+
+	private:
+		AsyncFileWriter( const AsyncFileWriter & );
+		AsyncFileWriter &operator=( const AsyncFileWriter & );
+
+		struct State;
+		static void* writerMain( void* _State );
+
+		std::string m_Filename;
+		State *m_State;
+	};
+
 	// Generic File Handle
 	// This is directly lifted from bjarne stroustrup's C++ Classic
 
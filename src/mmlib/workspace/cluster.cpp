@@ -1,6 +1,21 @@
 #include "global.h"
+
+#include <algorithm>
+
+#include "maths/rmsbatch.h"
 #include "workspace/cluster.h"
 
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
+// Number of SnapShots along each edge of a tile of the cRMS matrix. A tile is evaluated by one thread,
+// so the centred coordinates of both of its edges stay in cache while its pairs are compared.
+const size_t Cluster_TileSize = 64;
+
+using namespace Maths;
+
 
 ClusterBase::ClusterBase():
 	SnapShotLibrary()
@@ -31,22 +46,151 @@ size_t ClusterBase::getIndexMember(const int indexNumber, const int memberNumber
 	return cluster[indexNumber].index[memberNumber];
 }
 
+size_t ClusterBase::neighbourCount(const size_t i) const
+{
+	return neighbourStart[i+1] - neighbourStart[i];
+}
+
+size_t ClusterBase::getNeighbour(const size_t i, const size_t n) const
+{
+	return neighbour[neighbourStart[i] + n];
+}
+
+void ClusterBase::calcPairCrms(double cutoff, std::vector< std::vector<size_t> >& found, TNT::Array2D <double>* array) const
+{
+	const size_t n = dataSize();
+	const size_t natoms = data[0].nAtoms();
+	for (size_t i = 1; i < n; i++)
+	{
+		if (data[i].nAtoms() != natoms)
+			THROW(ProcedureException,"SnapShots are incompatible (Total number of atoms doesnt match)");
+	}
+
+	// every tile on or above the diagonal, the costs are equal bar the diagonal ones
+	const size_t ntiles = (n + Cluster_TileSize - 1) / Cluster_TileSize;
+	std::vector<size_t> tileI, tileJ;
+	for (size_t ti = 0; ti < ntiles; ti++)
+	{
+		for (size_t tj = ti; tj < ntiles; tj++)
+		{
+			tileI.push_back(ti);
+			tileJ.push_back(tj);
+		}
+	}
+
+	// every SnapShot is centred once, each pair is then a correlation matrix and a QCP solve
+	Maths::BatchCRMS batch(natoms);
+	batch.reserve(n);
+	std::vector<Maths::dvector> pos(natoms);
+	for (size_t i = 0; i < n; i++)
+	{
+		for (size_t a = 0; a < natoms; a++)
+			pos[a] = data[i].atom[a].p;
+		batch.add(pos);
+	}
+
+	int nthreads = 1;
+#ifdef HAVE_OPENMP
+	nthreads = omp_get_max_threads();
+#endif
+	found.clear();
+	found.resize(nthreads);
+
+	const int ntask = (int)tileI.size();
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for schedule(dynamic,1)
+#endif
+	for (int t = 0; t < ntask; t++)
+	{
+		int thread = 0;
+#ifdef HAVE_OPENMP
+		thread = omp_get_thread_num();
+#endif
+		const size_t iFirst = tileI[t] * Cluster_TileSize;
+		const size_t iLast = std::min(n, iFirst + Cluster_TileSize);
+		const size_t jFirst = tileJ[t] * Cluster_TileSize;
+		const size_t jLast = std::min(n, jFirst + Cluster_TileSize);
+
+		for (size_t i = iFirst; i < iLast; i++)
+		{
+			for (size_t j = std::max(jFirst, i + 1); j < jLast; j++)
+			{
+				double cRMS = batch.calcCRMS(i, j);
+				if (array != NULL)
+				{
+					(*array)[i][j] = cRMS;
+					(*array)[j][i] = cRMS;
+				}
+				else if (cRMS < cutoff)
+				{
+					found[thread].push_back(i);
+					found[thread].push_back(j);
+				}
+			}
+		}
+	}
+}
+
 void ClusterBase::reallocateCrmsArray()
 {
 	/// create a 2D array whose size in each dimension is initialised to the number of snapshots
-	cRMSarray = TNT::Array2D <double> (dataSize(), dataSize());
+	cRMSarray = TNT::Array2D <double> (dataSize(), dataSize(), 0.0);
+	if (dataSize() == 0) return;
 
 	/// add the cRMS differences for each pair of SnapShots to the array
-	for (int i = 0; i < dataSize(); i++)
+	std::vector< std::vector<size_t> > found;
+	calcPairCrms(0.0, found, &cRMSarray);
+}
+
+void ClusterBase::calcNeighbourLists(double cutoff)
+{
+	const size_t n = dataSize();
+	neighbourStart.assign(n + 1, 0);
+	neighbour.clear();
+	if (n == 0) return;
+
+	std::vector< std::vector<size_t> > found;
+	calcPairCrms(cutoff, found, NULL);
+
+	/// a SnapShot is its own neighbour, its cRMS from itself being 0
+	const size_t self = (0.0 < cutoff) ? 1 : 0;
+
+	/// count, then fill, both directions of each pair
+	for (size_t i = 0; i < n; i++)
+		neighbourStart[i + 1] = self;
+	for (size_t t = 0; t < found.size(); t++)
+	{
+		for (size_t p = 0; p < found[t].size(); p += 2)
+		{
+			neighbourStart[found[t][p] + 1]++;
+			neighbourStart[found[t][p + 1] + 1]++;
+		}
+	}
+	for (size_t i = 0; i < n; i++)
+		neighbourStart[i + 1] += neighbourStart[i];
+
+	neighbour.resize(neighbourStart[n]);
+	std::vector<size_t> fill(neighbourStart.begin(), neighbourStart.end() - 1);
+	if (self)
+	{
+		for (size_t i = 0; i < n; i++)
+			neighbour[fill[i]++] = i;
+	}
+	for (size_t t = 0; t < found.size(); t++)
 	{
-		for (int j = (i + 1); j < dataSize(); j++)
+		for (size_t p = 0; p < found[t].size(); p += 2)
 		{
-			double cRMS = data[i].cRMSFrom(data[j]);
-			cRMSarray[i][j] = cRMS;
-			cRMSarray[j][i] = cRMS;
+			size_t i = found[t][p];
+			size_t j = found[t][p + 1];
+			neighbour[fill[i]++] = j;
+			neighbour[fill[j]++] = i;
 		}
-		cRMSarray[i][i] = 0;
+		std::vector<size_t>().swap(found[t]); // release as we go
 	}
+
+	/// the threads found pairs in no particular order
+	for (size_t i = 0; i < n; i++)
+		std::sort(neighbour.begin() + neighbourStart[i], neighbour.begin() + neighbourStart[i + 1]);
 }
 
 
@@ -63,8 +207,8 @@ ClusterSimple::~ClusterSimple()
 void ClusterSimple::doClustering()
 {
 	///\brief do this each time the doClustering function is called to make sure the
-	/// cRMS array is up to date
-	reallocateCrmsArray();
+	/// neighbour lists are up to date
+	calcNeighbourLists(clusterCutoff);
 
 	///\brief resize the taken array to make sure it fits the number of Snapshots
 	/// and initialise everything to false
@@ -87,15 +231,13 @@ void ClusterSimple::doClustering()
 		/// then make it the representative SnapShot of a new one
 		newCluster.centre = i;
 
-		for (int j = 0; j < dataSize(); j++)
+		for (size_t n = neighbourStart[i]; n < neighbourStart[i + 1]; n++)
 		{
+			size_t j = neighbour[n];
 			if (taken[j]) continue;
 
-			if (cRMSarray[i][j] < clusterCutoff)
-			{
-				newCluster.index.push_back(j);
-				taken[j] = true;
-			}
+			newCluster.index.push_back(j);
+			taken[j] = true;
 		}
 
 		cluster.push_back( newCluster );
@@ -61,6 +61,12 @@ public:
 	/// allows you to set the cRMS cutoff for clustering
 	double clusterCutoff;
 
+	/// get the number of SnapShots closer than the cutoff to SnapShot i, as found by calcNeighbourLists()
+	size_t neighbourCount(const size_t i) const;
+
+	/// get the n'th neighbour of SnapShot i (neighbours are in ascending order)
+	size_t getNeighbour(const size_t i, const size_t n) const;
+
 protected:
 	std::vector <IndexGroup> cluster;
 
@@ -68,9 +74,24 @@ protected:
 	TNT::Array2D <double> cRMSarray;
 
 	///\brief function to initialise a 2D array to the number of SnapShots and
-	/// add to the array cRMS differences between each pair of SnapShots
+	/// add to the array cRMS differences between each pair of SnapShots.
+	/// Memory grows as N^2; prefer calcNeighbourLists() for large libraries
 	virtual void reallocateCrmsArray();
 
+	///\brief find, for every SnapShot, all SnapShots whose cRMS from it is below cutoff
+	/// (itself included if cutoff > 0). Pairs are evaluated in parallel tiles and only
+	/// the neighbours are kept, so memory grows with the number of close pairs, not N^2
+	void calcNeighbourLists(double cutoff);
+
+	/// Condensed neighbour lists: the neighbours of i are neighbour[neighbourStart[i]] to neighbour[neighbourStart[i+1]-1]
+	std::vector <size_t> neighbourStart;
+	std::vector <size_t> neighbour;
+
+private:
+	///\brief evaluate the cRMS of every pair i<j, a tile of SnapShots at a time on each thread.
+	/// Pairs below cutoff are appended (i,j) to found[thread]; if array is given all values are written into it instead
+	void calcPairCrms(double cutoff, std::vector< std::vector<size_t> >& found, TNT::Array2D <double>* array) const;
+
 };
 
 
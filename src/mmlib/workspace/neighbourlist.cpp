@@ -1,5 +1,12 @@
 #include "global.h"
 
+#include <algorithm>
+
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
 #include "space.h"
 #include "workspace.h"
 #include "bondorder.h"
@@ -16,9 +23,14 @@ currentMaxNeighbors(0),
 Enabled(true),
 Cutoff(0.0), 
 Padding(0.5),
-CalcShadow(false)
+CalcShadow(false),
+TrackDisplacement(false),
+m_ReferenceCutoff(0.0),
+m_ReferencePadding(0.0),
+m_ReferenceCalcShadow(false)
 {
 	m_FullUpdateCount = 0; 
+	m_AvoidedUpdateCount = 0; 
 }
 
 NeighbourListBase::NeighbourListBase(const NeighbourListBase &copy)
@@ -56,6 +68,82 @@ void NeighbourListBase::setPadding( double newpadding )
 	Padding = newpadding;
 }
 
+void NeighbourListBase::refresh()
+{
+	if( TrackDisplacement && !requiresRefresh() )
+	{
+		m_AvoidedUpdateCount++;
+		return;
+	}
+	calcNewList();
+}
+
+void NeighbourListBase::getBox( Maths::dvector box[3] ) const
+{
+	const ClosedSpace *space = dynamic_cast<const ClosedSpace*>( &wspace->boundary() );
+	if( space != NULL ) space->getBoxVectors( box[0], box[1], box[2] );
+	else                box[0] = box[1] = box[2] = dvector(0,0,0);
+}
+
+bool NeighbourListBase::referenceChanged() const
+{
+	if( (int)m_ReferencePos.size() != wspace->atom.size() ) return true;
+	if( m_ReferenceCutoff != Cutoff ) return true;
+	if( m_ReferencePadding != Padding ) return true;
+	if( m_ReferenceCalcShadow != CalcShadow ) return true;
+
+	// the image shifts of a periodic boundary change with its dimensions
+	dvector box[3];
+	getBox( box );
+	for(int d=0;d<3;d++)
+	{
+		if( (box[d].x != m_ReferenceBox[d].x) || (box[d].y != m_ReferenceBox[d].y) || (box[d].z != m_ReferenceBox[d].z) ) return true;
+	}
+	return false;
+}
+
+bool NeighbourListBase::requiresRefresh() const
+{
+	int natom = wspace->atom.size();
+	if( referenceChanged() ) return true;
+
+	// The list contains all pairs within Cutoff+Padding, so as long as no atom has 
+	// moved by more than Padding/2 no pair can have come closer than Cutoff unnoticed.
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	double sqrMoveLimit = sqr(0.5*Padding);
+	for(int i=0;i<natom;i++)
+	{
+		if( nlist_atom[i].p.sqrdist(m_ReferencePos[i]) > sqrMoveLimit ) return true;
+	}
+	return false;
+}
+
+bool NeighbourListBase::requiresRefresh( const std::vector<size_t> &atoms ) const
+{
+	if( referenceChanged() ) return true;
+
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	double sqrMoveLimit = sqr(0.5*Padding);
+	for(size_t k=0;k<atoms.size();k++)
+	{
+		size_t i = atoms[k];
+		if( nlist_atom[i].p.sqrdist(m_ReferencePos[i]) > sqrMoveLimit ) return true;
+	}
+	return false;
+}
+
+void NeighbourListBase::storeReferencePositions()
+{
+	int natom = wspace->atom.size();
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	m_ReferencePos.resize(natom);
+	for(int i=0;i<natom;i++) m_ReferencePos[i] = nlist_atom[i].p;
+	m_ReferenceCutoff = Cutoff;
+	m_ReferencePadding = Padding;
+	m_ReferenceCalcShadow = CalcShadow;
+	getBox( m_ReferenceBox );
+}
+
 void NeighbourListBase::reassignList()
 {
 	printf("Allocating new full neighbor list\n");
@@ -202,9 +290,86 @@ void NeighbourList_32Bit_Base::correctOffDiagonalBondOrders()
 	}
 }
 
+// Returns the OpenMP thread number (or 0 if we're compiled without OpenMP)
+inline int NList_ThreadNum()
+{
+#ifdef HAVE_OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+// Number of atoms handed to a thread at a time. Atoms with many neighbors
+// are unevenly distributed so we use dynamic scheduling.
+const int NList_AtomBlockSize = 64;
+
+void NeighbourList_32Bit_Base::prepareThreadBuffers()
+{
+	int nthreads = 1;
+#ifdef HAVE_OPENMP
+	nthreads = omp_get_max_threads();
+#endif
+	m_ThreadBuffer.resize(nthreads);
+	for(int t=0;t<nthreads;t++) m_ThreadBuffer[t].clear(); // keeps the capacity from the last build
+
+	int natom = wspace->atom.size();
+	m_AtomThread.resize(natom);
+	m_AtomOffset.resize(natom);
+	m_AtomCount.resize(natom);
+}
+
+void NeighbourList_32Bit_Base::compactThreadBuffers()
+{
+	int natom = wspace->atom.size();
+	int i;
+
+	// The thread buffers grow as needed, so we only need to make sure the final
+	// list is large enough once - no need to restart the calculation.
+	int total = 0;
+	for(i=0;i<natom;i++) total += m_AtomCount[i];
+	if( total >= currentMaxNeighbors ) 
+	{
+		reserveMemoryFor( Maths::max( (int)((double)currentMaxNeighbors*1.5), (int)((double)total*1.5) ) );
+	}
+
+	// set neighbor list starts (in atom order, just like the serial lists)
+	int memcount = 0;
+	for(i=0;i<natom;i++)
+	{
+		fnbor[i].i = (int *) (&neighborlistspace[memcount*sizeof(int)]);
+		fnbor[i].Type = (int *) (&neighborlistspace[memcount*sizeof(int)]);
+		fnbor[i].n = m_AtomCount[i];
+		memcount += m_AtomCount[i];
+	}
+
+	// and copy the segments across
+#ifdef HAVE_OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for(i=0;i<natom;i++)
+	{
+		if(m_AtomCount[i] > 0)
+		{
+			memcpy( fnbor[i].i, &m_ThreadBuffer[m_AtomThread[i]][m_AtomOffset[i]], m_AtomCount[i]*sizeof(int) );
+		}
+	}
+}
+
+size_t NeighbourList_32Bit_Base::memuse(int level)
+{
+	size_t bytesrequired = NeighbourListBase::memuse(level);
+	size_t bufferbytes = (m_AtomThread.capacity() + m_AtomOffset.capacity() + m_AtomCount.capacity()) * sizeof(int);
+	for(size_t t=0;t<m_ThreadBuffer.size();t++) bufferbytes += m_ThreadBuffer[t].capacity() * sizeof(int);
+	if(level>1)printf("    ptr_nlist thread buffers: %d --> %3.2lf Mb \n",
+		(int)m_ThreadBuffer.size(), double(bufferbytes)/(1024.0*1024.0));
+	return bytesrequired + bufferbytes;
+}
+
 void NeighbourList::calcNewList()
 {
 	incFullUpdateCount();   // Mark that we've been called - improtant for other classes to update fully
+	storeReferencePositions(); // Remember where the atoms were for requiresRefresh()
 
 	// Determine the type of space loaded into workspace to choose
 	// the right neighbor list
@@ -236,83 +401,73 @@ void NeighbourList::calcNewList_InfiniteSpace()
 
 	// Proxy to atom positions
 	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	const int natom = wspace->atom.size();
 
-	// Local variables
-	int i,j;
-	double sqrdistij;
 	double sqrIncludeLimit = sqr(Cutoff + Padding);
-	dvector dc,ic;
 
-	int bondorderij;
 	const BondOrder& bondOrder = wspace->bondorder();
 
-	// restart point for when we run out of neighborlist space
-calcNewNeighborList_restart:
-
 	// raw proxies for the bondorder array (faster than std::vector access)
 	const int t_MaxIndexDelta = bondOrder.getMaxIndexDelta();
 	const char *t_Data  = &bondOrder.getDiagData()[0];
 
-	// clear neighbor arrays
-	for(i=0;i<wspace->atom.size();i++) 
-		fnbor[i].n=0;
-
-	int memcount = 0;
+	prepareThreadBuffers();
 
 	// Create neighborlists
-	for(i=0;i<wspace->atom.size();i++){				
-		//fnbor[i].i = (int *) (&neighborlistspace[memcount*sizeof(int)*2]);
-		// set neighbor list start 
-		fnbor[i].i = (int *) (&neighborlistspace[memcount*sizeof(int)]);
-		fnbor[i].Type = (int *) (&neighborlistspace[memcount*sizeof(int)]);
-
-		int limit;
-		if(CalcShadow) limit = wspace->atom.size();
-		else           limit = i;
-
-		// now loop over all remaining atoms
-		for(j=0;j<limit;j++){
-			dc.diff(nlist_atom[j].p,nlist_atom[i].p);
-			sqrdistij = dc.innerdot();
-
-			// ignore pairs with distance greater than cutoff
-			if(sqrdistij > sqrIncludeLimit) continue;
-			// only get bondorder if necessary;
-			bondorderij = 7; 
-			if( abs(j - i) < t_MaxIndexDelta ){ 
-				if( j > i ){
-					bondorderij = t_Data[sqrmat(i, j - i - 1, t_MaxIndexDelta)];
-				}else{
-					bondorderij = t_Data[sqrmat(j, i - j - 1, t_MaxIndexDelta)];
+#ifdef HAVE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		const int thread = NList_ThreadNum();
+		std::vector<int> &buffer = m_ThreadBuffer[thread];
+		int i,j;
+		double sqrdistij;
+		dvector dc;
+		int bondorderij;
+
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(dynamic, NList_AtomBlockSize)
+#endif
+		for(i=0;i<natom;i++){				
+			beginAtom(i, thread);
+
+			int limit;
+			if(CalcShadow) limit = natom;
+			else           limit = i;
+
+			// now loop over all remaining atoms
+			for(j=0;j<limit;j++){
+				dc.diff(nlist_atom[j].p,nlist_atom[i].p);
+				sqrdistij = dc.innerdot();
+
+				// ignore pairs with distance greater than cutoff
+				if(sqrdistij > sqrIncludeLimit) continue;
+				// only get bondorder if necessary;
+				bondorderij = 7; 
+				if( abs(j - i) < t_MaxIndexDelta ){ 
+					if( j > i ){
+						bondorderij = t_Data[sqrmat(i, j - i - 1, t_MaxIndexDelta)];
+					}else{
+						bondorderij = t_Data[sqrmat(j, i - j - 1, t_MaxIndexDelta)];
+					}
+					if( j == i ) continue;
 				}
-				if( j == i ) continue;
-			}
-
-			// when there are more than 12.7 million atoms (unlikely currently)
 
-			//fnbor[i].i[fnbor[i].n*2] = j; // j is a neighbor of i
-			//fnbor[i].i[fnbor[i].n*2+1] = (image<<3) + (bondorderij&7);
+				// when there are more than 12.7 million atoms (unlikely currently)
 
-			// Bit structure:
-			// 76543210 76543210 76543210 76543210
-			// `---'`-' `-------< index >--------'
-			//   |    \------- bondorder            (0-8) 
-			//    \----------- image vector (index) (0-32) 
-
-			fnbor[i].i[fnbor[i].n] = j&0x00FFFFFF | ((bondorderij&7)<<24) ;
-
-			fnbor[i].n++;
-			memcount++;
+				// Bit structure:
+				// 76543210 76543210 76543210 76543210
+				// `---'`-' `-------< index >--------'
+				//   |    \------- bondorder            (0-8) 
+				//    \----------- image vector (index) (0-32) 
 
-		}
-		// check if we're starting to run out of space - if so abort, restart and 
-		// increase neighborlist
-		if(memcount >= (currentMaxNeighbors-wspace->atom.size()-1000) ) 
-		{
-			reserveMemoryFor( (int)((double)currentMaxNeighbors*1.5));
-			goto calcNewNeighborList_restart;
+				buffer.push_back( j&0x00FFFFFF | ((bondorderij&7)<<24) );
+			}
+			endAtom(i, thread);
 		}
 	}
+
+	compactThreadBuffers();
 }
 
 
@@ -326,99 +481,82 @@ void NeighbourList::calcNewList_PeriodicBox()
 
 	// Proxy to atom positions
 	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	const int natom = wspace->atom.size();
 
-	// Local variables
-	int i,j;
-	double sqrdistij;
 	double sqrIncludeLimit = sqr(Cutoff + Padding);
-	dvector dc,ic;
 
-	int bondorderij;
 	const BondOrder& bondOrder = wspace->bondorder();
 
-	int 	image,nimages=wspace->boundary().ncells();
-	// restart point for when we run out of neighborlist space
-calcNewNeighborList_restart:
-
 	// raw proxies for the bondorder array (faster than std::vector access)
 	const int t_MaxIndexDelta = bondOrder.getMaxIndexDelta();
 	const char *t_Data  = &bondOrder.getDiagData()[0];
 
-	// clear neighbor arrays
-	for(i=0;i<wspace->atom.size();i++) fnbor[i].n=0;
-
-	int memcount = 0;
-
+	prepareThreadBuffers();
 
 	// Create neighborlists
-	for(i=0;i<wspace->atom.size();i++){				
-		//if(i<200) printf("%d  %d\n ",i,memcount);	
-		//fnbor[i].i = (int *) (&neighborlistspace[memcount*sizeof(int)*2]);
-
-		// set neighbor list start 
-		fnbor[i].i = (int *) (&neighborlistspace[memcount*sizeof(int)]);
-		fnbor[i].Type = (int *) (&neighborlistspace[memcount*sizeof(int)]);
-
-		int limit;
-		if(CalcShadow) limit = wspace->atom.size();
-		else           limit = i;
-
-		// now loop over all remaining atoms
-		for(j=0;j<limit;j++){
-			dc.diff(nlist_atom[j].p,nlist_atom[i].p);
-			image=13; // in Periodic space, image 13 is the self list
-			while(dc.x >  periodic_box->halfBoxSize.x){ dc.x -= periodic_box->boxSize.x; image-=9;} 
-			while(dc.x < -periodic_box->halfBoxSize.x){ dc.x += periodic_box->boxSize.x; image+=9;} 
-			while(dc.y >  periodic_box->halfBoxSize.y){ dc.y -= periodic_box->boxSize.y; image-=3;} 
-			while(dc.y < -periodic_box->halfBoxSize.y){ dc.y += periodic_box->boxSize.y; image+=3;} 
-			while(dc.z >  periodic_box->halfBoxSize.z){ dc.z -= periodic_box->boxSize.z; image-=1;} 
-			while(dc.z < -periodic_box->halfBoxSize.z){ dc.z += periodic_box->boxSize.z; image+=1;}			
-			sqrdistij = dc.innerdot();
-
-			// ignore pairs with distance greater than cutoff
-			if(sqrdistij > sqrIncludeLimit) continue;
-
-			// only get bondorder if necessary;
-			bondorderij = 15; 
-			if( abs(j - i) < t_MaxIndexDelta ){ 
-				if( j > i ){
-					bondorderij = t_Data[sqrmat(i, j - i - 1, t_MaxIndexDelta)];
-				}else{
-					bondorderij = t_Data[sqrmat(j, i - j - 1, t_MaxIndexDelta)];
+#ifdef HAVE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		const int thread = NList_ThreadNum();
+		std::vector<int> &buffer = m_ThreadBuffer[thread];
+		int i,j;
+		double sqrdistij;
+		dvector dc;
+		int bondorderij;
+		int image;
+
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(dynamic, NList_AtomBlockSize)
+#endif
+		for(i=0;i<natom;i++){				
+			beginAtom(i, thread);
+
+			int limit;
+			if(CalcShadow) limit = natom;
+			else           limit = i;
+
+			// now loop over all remaining atoms
+			for(j=0;j<limit;j++){
+				dc.diff(nlist_atom[j].p,nlist_atom[i].p);
+				image=13; // in Periodic space, image 13 is the self list
+				while(dc.x >  periodic_box->halfBoxSize.x){ dc.x -= periodic_box->boxSize.x; image-=9;} 
+				while(dc.x < -periodic_box->halfBoxSize.x){ dc.x += periodic_box->boxSize.x; image+=9;} 
+				while(dc.y >  periodic_box->halfBoxSize.y){ dc.y -= periodic_box->boxSize.y; image-=3;} 
+				while(dc.y < -periodic_box->halfBoxSize.y){ dc.y += periodic_box->boxSize.y; image+=3;} 
+				while(dc.z >  periodic_box->halfBoxSize.z){ dc.z -= periodic_box->boxSize.z; image-=1;} 
+				while(dc.z < -periodic_box->halfBoxSize.z){ dc.z += periodic_box->boxSize.z; image+=1;}			
+				sqrdistij = dc.innerdot();
+
+				// ignore pairs with distance greater than cutoff
+				if(sqrdistij > sqrIncludeLimit) continue;
+
+				// only get bondorder if necessary;
+				bondorderij = 15; 
+				if( abs(j - i) < t_MaxIndexDelta ){ 
+					if( j > i ){
+						bondorderij = t_Data[sqrmat(i, j - i - 1, t_MaxIndexDelta)];
+					}else{
+						bondorderij = t_Data[sqrmat(j, i - j - 1, t_MaxIndexDelta)];
+					}
+					if( j == i ) continue;
 				}
-				if( j == i ) continue;
-				//if(bondorderij < 3) continue;
-			}
 
-			//if((i>29)&&(i<31)) printf("%d  %d %d\n ",i,j,memcount);	
-			// when there are more than 12.7 million atoms (unlikely currently)
+				// when there are more than 12.7 million atoms (unlikely currently)
 
-			//fnbor[i].i[fnbor[i].n*2] = j; // j is a neighbor of i
-			//fnbor[i].i[fnbor[i].n*2+1] = (image<<3) + (bondorderij&7);
-
-			// Bit structure:
-			// 76543210 76543210 76543210 76543210
-			// `---'`-' `-------< index >--------'
-			//   |    \------- bondorder            (0-8) 
-			//    \----------- image vector (index) (0-32) 
-
-			fnbor[i].i[fnbor[i].n] = j&0x00FFFFFF | ((bondorderij&7)<<24) | ((image&31)<<27);
-
-			fnbor[i].n++;
-			memcount++;
+				// Bit structure:
+				// 76543210 76543210 76543210 76543210
+				// `---'`-' `-------< index >--------'
+				//   |    \------- bondorder            (0-8) 
+				//    \----------- image vector (index) (0-32) 
 
-		}
-		// check if we're starting to run out of space - if so abort, restart and 
-		// increase neighborlist
-		if(memcount >= (currentMaxNeighbors-wspace->atom.size()-1000) ) 
-		{
-			reserveMemoryFor( (int)((double)currentMaxNeighbors*1.5));
-			goto calcNewNeighborList_restart;
+				buffer.push_back( j&0x00FFFFFF | ((bondorderij&7)<<24) | ((image&31)<<27) );
+			}
+			endAtom(i, thread);
 		}
 	}
 
-	//printf("MEMCOUNT: %d \n", memcount ) ;
-
+	compactThreadBuffers();
 }
 
 
@@ -571,6 +709,261 @@ calcNewNeighborList_restart:
 
 
 
+/// Cell-list based neighbor list
+
+// Comparison function to sort packed 32Bit neighbor entries by their atom index only
+inline bool NList32Bit_IndexLess( int a, int b )
+{
+	return NList32Bit_Index(a) < NList32Bit_Index(b);
+}
+
+// We never want more than this many cells per atom - very sparse systems 
+// (e.g. two molecules far apart) would otherwise create huge, empty grids
+const int NList_MaxCellsPerAtom = 4;
+
+size_t NeighbourList_CellBased::memuse(int level)
+{
+	size_t bytesrequired = NeighbourList::memuse(level);
+	size_t cellbytes = (m_CellStart.capacity() + m_CellAtom.capacity() + 
+		m_AtomCell.capacity()) * sizeof(int);
+	if(level>1)printf("    ptr_nlist cells: %d --> %3.2lf Mb \n",
+		(int)m_CellStart.size(), double(cellbytes)/(1024.0*1024.0));
+	return bytesrequired + cellbytes;
+}
+
+void NeighbourList_CellBased::assignCells( const std::vector<int> &atomcell, int ncells )
+{
+	int natom = atomcell.size();
+
+	// count the atoms in each cell
+	m_CellStart.assign(ncells+1,0);
+	for(int i=0;i<natom;i++) m_CellStart[atomcell[i]+1]++;
+	for(int c=0;c<ncells;c++) m_CellStart[c+1] += m_CellStart[c];
+
+	// and place them - since we loop in ascending order the atoms in 
+	// each cell will be sorted by their index
+	m_CellAtom.resize(natom);
+	std::vector<int> fill(m_CellStart.begin(),m_CellStart.end()-1);
+	for(int i=0;i<natom;i++) m_CellAtom[fill[atomcell[i]]++] = i;
+}
+
+void NeighbourList_CellBased::calcNewList_InfiniteSpace()
+{
+	// Check the right kind of Space is loaded into wspace
+	if(dynamic_cast<InfiniteSpace *> (&wspace->boundary()) == NULL){
+		throw(ProcedureException("To use NeighbourList_CellBased::calcNewList_InfiniteSpace you must load an InfiniteSpace space\ninto the workspace you are using, by calling wspace.setBoundary(...) "));
+	}
+
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	int natom = wspace->atom.size();
+	double cellSize = Cutoff + Padding;
+	if((natom == 0)||(cellSize <= 0)) 
+	{
+		NeighbourList::calcNewList_InfiniteSpace();
+		return;
+	}
+
+	// find the extent of the system
+	dvector lo(nlist_atom[0].p);
+	dvector hi(nlist_atom[0].p);
+	for(int i=1;i<natom;i++)
+	{
+		const dvector &p = nlist_atom[i].p;
+		if(p.x < lo.x) lo.x = p.x; 
+		if(p.y < lo.y) lo.y = p.y; 
+		if(p.z < lo.z) lo.z = p.z; 
+		if(p.x > hi.x) hi.x = p.x; 
+		if(p.y > hi.y) hi.y = p.y; 
+		if(p.z > hi.z) hi.z = p.z; 
+	}
+
+	// cells must be at least Cutoff+Padding wide, but we also limit their total number
+	int nx,ny,nz;
+	for(;;)
+	{
+		nx = (int)((hi.x - lo.x)/cellSize) + 1;
+		ny = (int)((hi.y - lo.y)/cellSize) + 1;
+		nz = (int)((hi.z - lo.z)/cellSize) + 1;
+		double ncells = double(nx)*double(ny)*double(nz);
+		if(ncells <= double(NList_MaxCellsPerAtom*natom + 27)) break;
+		cellSize *= 1.25;
+	}
+
+	double invCellSize = 1.0 / cellSize;
+	m_AtomCell.resize(natom);
+	for(int i=0;i<natom;i++)
+	{
+		const dvector &p = nlist_atom[i].p;
+		int ix = Maths::min( (int)((p.x - lo.x)*invCellSize), nx-1 );
+		int iy = Maths::min( (int)((p.y - lo.y)*invCellSize), ny-1 );
+		int iz = Maths::min( (int)((p.z - lo.z)*invCellSize), nz-1 );
+		m_AtomCell[i] = (ix*ny + iy)*nz + iz;
+	}
+	assignCells(m_AtomCell, nx*ny*nz);
+
+	calcNewList_FromCells(nx,ny,nz,NULL);
+}
+
+void NeighbourList_CellBased::calcNewList_PeriodicBox()
+{
+	// Check the right kind of Space is loaded into wspace
+	PeriodicBox *periodic_box = dynamic_cast<PeriodicBox *> (&wspace->boundary());
+	if(periodic_box == NULL){
+		throw(ProcedureException("To use NeighbourList_CellBased::calcNewList_PeriodicBox you must load a PeriodicBox space\ninto the workspace you are using, by calling wspace.setBoundary(...) "));
+	}
+
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	int natom = wspace->atom.size();
+	double cellSize = Cutoff + Padding;
+
+	int nx = 0, ny = 0, nz = 0;
+	if(cellSize > 0)
+	{
+		nx = (int)(periodic_box->boxSize.x / cellSize);
+		ny = (int)(periodic_box->boxSize.y / cellSize);
+		nz = (int)(periodic_box->boxSize.z / cellSize);
+	}
+
+	// With less than 3 cells in any dimension neighboring cells would be 
+	// visited more than once - fall back to the brute force method.
+	if((natom == 0)||(nx < 3)||(ny < 3)||(nz < 3))
+	{
+		NeighbourList::calcNewList_PeriodicBox();
+		return;
+	}
+
+	// assign atoms to cells using their wrapped fractional coordinates
+	m_AtomCell.resize(natom);
+	for(int i=0;i<natom;i++)
+	{
+		const dvector &p = nlist_atom[i].p;
+		double fx = (p.x + periodic_box->halfBoxSize.x) / periodic_box->boxSize.x;
+		double fy = (p.y + periodic_box->halfBoxSize.y) / periodic_box->boxSize.y;
+		double fz = (p.z + periodic_box->halfBoxSize.z) / periodic_box->boxSize.z;
+		fx -= floor(fx);
+		fy -= floor(fy);
+		fz -= floor(fz);
+		int ix = Maths::min( (int)(fx*nx), nx-1 );
+		int iy = Maths::min( (int)(fy*ny), ny-1 );
+		int iz = Maths::min( (int)(fz*nz), nz-1 );
+		m_AtomCell[i] = (ix*ny + iy)*nz + iz;
+	}
+	assignCells(m_AtomCell, nx*ny*nz);
+
+	calcNewList_FromCells(nx,ny,nz,periodic_box);
+}
+
+void NeighbourList_CellBased::calcNewList_FromCells( int nx, int ny, int nz, const PeriodicBox *periodic_box )
+{
+	// Proxy to atom positions
+	const SnapShotAtom *nlist_atom = wspace->cur.atom;
+	const int natom = wspace->atom.size();
+
+	double sqrIncludeLimit = sqr(Cutoff + Padding);
+
+	const BondOrder& bondOrder = wspace->bondorder();
+
+	// raw proxies for the bondorder array (faster than std::vector access)
+	const int t_MaxIndexDelta = bondOrder.getMaxIndexDelta();
+	const char *t_Data  = &bondOrder.getDiagData()[0];
+
+	prepareThreadBuffers();
+
+#ifdef HAVE_OPENMP
+	#pragma omp parallel
+#endif
+	{
+		const int thread = NList_ThreadNum();
+		std::vector<int> &buffer = m_ThreadBuffer[thread];
+		int i,j;
+		double sqrdistij;
+		dvector dc;
+		int bondorderij;
+		int image;
+
+#ifdef HAVE_OPENMP
+		#pragma omp for schedule(dynamic, NList_AtomBlockSize)
+#endif
+		for(i=0;i<natom;i++)
+		{
+			int ci = m_AtomCell[i];
+			int cix = ci / (ny*nz);
+			int ciy = (ci / nz) % ny;
+			int ciz = ci % nz;
+
+			beginAtom(i, thread);
+
+			// loop over the 27 cells surrounding (and including) the cell of atom i
+			for(int dx=-1;dx<=1;dx++)
+			{
+				int cx = cix + dx;
+				if(periodic_box){ if(cx < 0) cx += nx; else if(cx >= nx) cx -= nx; }
+				else if((cx < 0)||(cx >= nx)) continue;
+				for(int dy=-1;dy<=1;dy++)
+				{
+					int cy = ciy + dy;
+					if(periodic_box){ if(cy < 0) cy += ny; else if(cy >= ny) cy -= ny; }
+					else if((cy < 0)||(cy >= ny)) continue;
+					for(int dz=-1;dz<=1;dz++)
+					{
+						int cz = ciz + dz;
+						if(periodic_box){ if(cz < 0) cz += nz; else if(cz >= nz) cz -= nz; }
+						else if((cz < 0)||(cz >= nz)) continue;
+
+						int c = (cx*ny + cy)*nz + cz;
+						for(int k=m_CellStart[c];k<m_CellStart[c+1];k++)
+						{
+							j = m_CellAtom[k];
+							// atoms within a cell are sorted, so without shadow neighbors we're done
+							if((!CalcShadow)&&(j >= i)) break;
+							if(j == i) continue;
+
+							dc.diff(nlist_atom[j].p,nlist_atom[i].p);
+							image = 13; // in Periodic space, image 13 is the self list
+							if(periodic_box)
+							{
+								while(dc.x >  periodic_box->halfBoxSize.x){ dc.x -= periodic_box->boxSize.x; image-=9;} 
+								while(dc.x < -periodic_box->halfBoxSize.x){ dc.x += periodic_box->boxSize.x; image+=9;} 
+								while(dc.y >  periodic_box->halfBoxSize.y){ dc.y -= periodic_box->boxSize.y; image-=3;} 
+								while(dc.y < -periodic_box->halfBoxSize.y){ dc.y += periodic_box->boxSize.y; image+=3;} 
+								while(dc.z >  periodic_box->halfBoxSize.z){ dc.z -= periodic_box->boxSize.z; image-=1;} 
+								while(dc.z < -periodic_box->halfBoxSize.z){ dc.z += periodic_box->boxSize.z; image+=1;}			
+							}
+							sqrdistij = dc.innerdot();
+
+							// ignore pairs with distance greater than cutoff
+							if(sqrdistij > sqrIncludeLimit) continue;
+
+							// only get bondorder if necessary;
+							bondorderij = 7; 
+							if( abs(j - i) < t_MaxIndexDelta ){ 
+								if( j > i ){
+									bondorderij = t_Data[sqrmat(i, j - i - 1, t_MaxIndexDelta)];
+								}else{
+									bondorderij = t_Data[sqrmat(j, i - j - 1, t_MaxIndexDelta)];
+								}
+							}
+
+							// Same bit structure as NeighbourList, the image bits remain 0 in InfiniteSpace
+							if(periodic_box) buffer.push_back( j&0x00FFFFFF | ((bondorderij&7)<<24) | ((image&31)<<27) );
+							else             buffer.push_back( j&0x00FFFFFF | ((bondorderij&7)<<24) );
+						}
+					}
+				}
+			}
+
+			endAtom(i, thread);
+
+			// NeighbourList produces neighbors in ascending order - do the same here
+			std::sort(buffer.begin() + m_AtomOffset[i], buffer.end(), NList32Bit_IndexLess);
+		}
+	}
+
+	compactThreadBuffers();
+}
+
+
+
 //////// DEPRECATED STUFF /////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////
 
@@ -582,6 +975,7 @@ void DeprecatedNeighbourList::calcNewList()
 	// check if we're switched on !?
 	if(!Enabled) return;
 	incFullUpdateCount();   // Mark that we've been called - improtant for other classes to update fully
+	storeReferencePositions(); // Remember where the atoms were for requiresRefresh()
 
 	// check if we're compatible with the space loaded
 	if(dynamic_cast<const InfiniteSpace*>(&wspace->boundary()) == NULL)
@@ -699,6 +1093,7 @@ void NeighbourList_GeneralBoundary::calcNewList()
 	// check if we're switched on !?
 	if(!Enabled) return;
 	incFullUpdateCount();   // Mark that we've been called - improtant for other classes to update fully
+	storeReferencePositions(); // Remember where the atoms were for requiresRefresh()
 
 	// Proxy to atom positions
 	const SnapShotAtom *nlist_atom = wspace->cur.atom;
@@ -813,6 +1208,7 @@ void NeighbourList_PeriodicBox::calcNewList()
 	// check if we're switched on !?
 	if(!Enabled) return;
 	incFullUpdateCount();   // Mark that we've been called - improtant for other classes to update fully
+	storeReferencePositions(); // Remember where the atoms were for requiresRefresh()
 
 	// Proxy to atom positions
 	const SnapShotAtom *nlist_atom = wspace->cur.atom;
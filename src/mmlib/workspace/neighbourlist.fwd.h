@@ -2,6 +2,7 @@ class PD_API NeighbourListBase;
 class PD_API NeighbourList_32Bit_Base;
 class PD_API NeighbourList;
 class PD_API NeighbourList_GroupBased;
+class PD_API NeighbourList_CellBased;
 class PD_API DeprecatedNeighbourList;
 class PD_API NeighbourList_GeneralBoundary;
 class PD_API NeighbourList_PeriodicBox;
@@ -6,6 +6,7 @@
 
 #include "system/fundamentals.fwd.h"
 #include "workspace/bondorder.fwd.h"
+#include "workspace/space.fwd.h"
 #include "workspace/workspace.fwd.h"
 
 struct NeighbourData
@@ -51,7 +52,9 @@ public:
 	void     calcShadow( bool Enabled ) { CalcShadow = Enabled; }	
 	void     requestCutoff( double newcutoff );
 	void     setPadding( double newpadding );
+	void     trackDisplacement( bool Enabled ) { TrackDisplacement = Enabled; }
 	unsigned getFullUpdateCount() const { return m_FullUpdateCount; } 
+	unsigned getAvoidedUpdateCount() const { return m_AvoidedUpdateCount; } 
 
 
 	// OO Accessors
@@ -64,6 +67,23 @@ public:
 	// Neighbor list calculations
 	virtual void calcNewList() = 0; /// A full recalculation of the neighbour list
 
+	/// Recalculates the neighbour list only if necessary. Without displacement tracking this 
+	/// is identical to calcNewList(). With displacement tracking enabled the list is only 
+	/// rebuilt once any atom has moved more than half the Padding since the last rebuild - 
+	/// otherwise the avoided update counter is incremented.
+	void refresh(); 
+
+	/// Returns true if any atom has moved more than half the Padding since the last full update 
+	/// (or if the Cutoff, the Padding, the box dimensions or the number of atoms have changed)
+	bool requiresRefresh() const;
+
+	/// As above, but only checks the displacement of the given atoms. Sufficient if no 
+	/// other atom has moved since the last full update.
+	bool requiresRefresh( const std::vector<size_t> &atoms ) const;
+
+	/// Returns true if the current list was built including shadow neighbours
+	bool hasShadowNeighbours() const { return m_ReferenceCalcShadow; }
+
 protected:
 	// Internal memory management
 	virtual void reinit( WorkSpace* _wspace );
@@ -72,6 +92,16 @@ protected:
 	void         clear();
 	void         incFullUpdateCount() { m_FullUpdateCount++; }
 
+	/// Remembers the current atom positions, the Cutoff, Padding, CalcShadow and box dimensions
+	/// such that requiresRefresh() can later decide if a full update is needed
+	void         storeReferencePositions();
+
+	/// True if anything but the atom positions differs from the last full update
+	bool         referenceChanged() const;
+
+	/// Box vectors of the boundary (zero if it is not a ClosedSpace)
+	void         getBox( Maths::dvector box[3] ) const;
+
 	NeighbourListBase(const NeighbourListBase &copy);
 
 
@@ -89,6 +119,9 @@ protected: 	// protected member data ---------------------------------
 	/// included shadow neighbor in neighbor list
 	bool CalcShadow;
 
+	/// Only rebuild the list in refresh() if atoms have moved more than Padding/2
+	bool TrackDisplacement;
+
 
 
 	// Internal neighbourlist data allocation -----------------------------
@@ -106,6 +139,26 @@ protected: 	// protected member data ---------------------------------
 	/// list. In this way, forcefields and other components can 
 	/// tell if they must update themselves.
 	unsigned m_FullUpdateCount;
+
+	/// Counts the calls to refresh() which did not require a full update
+	unsigned m_AvoidedUpdateCount;
+
+	// Displacement tracking -----------------------------------------------
+
+	/// Atom positions at the last full update
+	std::vector<Maths::dvector> m_ReferencePos;
+
+	/// Cutoff at the last full update
+	double m_ReferenceCutoff;
+
+	/// Padding at the last full update
+	double m_ReferencePadding;
+
+	/// CalcShadow at the last full update
+	bool m_ReferenceCalcShadow;
+
+	/// Box vectors at the last full update
+	Maths::dvector m_ReferenceBox[3];
 };
 
 
@@ -148,6 +201,8 @@ public:
 	virtual ~NeighbourList_32Bit_Base(){};
 	virtual void reassignList();
 
+	virtual size_t  memuse(int level);
+
 	virtual size_t   nNeighbours(size_t i) const { return fnbor[i].n; }
 	virtual int      getNeighbourIndex(size_t i, size_t nj) const {       return NList32Bit_Index(fnbor[i].i[nj]); }
 	virtual int      getNeighbourBondOrder(size_t i, size_t nj) const {   return NList32Bit_BondOrder(fnbor[i].i[nj]); }
@@ -163,6 +218,43 @@ protected:
   /// correct the bondorders of the respective neighbors. This is
   /// necessary for disulfide bonds for example
 	virtual void correctOffDiagonalBondOrders();
+
+	// Parallel list construction -------------------------------------------
+	// Each thread appends the neighbors of the atoms it processes to its own growing 
+	// buffer. Once all atoms are done, compactThreadBuffers() copies the segments into 
+	// neighborlistspace in atom order, so running out of space never requires a restart. 
+	// With HAVE_OPENMP defined the calcNewList_* functions use all available threads.
+
+	/// Sizes the per-thread and per-atom book keeping arrays
+	void prepareThreadBuffers();
+
+	/// Marks the start of atom i's neighbors in the buffer of thread
+	inline void beginAtom( int i, int thread )
+	{
+		m_AtomThread[i] = thread;
+		m_AtomOffset[i] = m_ThreadBuffer[thread].size();
+	}
+
+	/// Marks the end of atom i's neighbors in the buffer of thread
+	inline void endAtom( int i, int thread )
+	{
+		m_AtomCount[i] = m_ThreadBuffer[thread].size() - m_AtomOffset[i];
+	}
+
+	/// Copies the per-thread segments into the final contiguous neighbor list
+	void compactThreadBuffers();
+
+	/// One growing neighbor buffer per thread
+	std::vector< std::vector<int> > m_ThreadBuffer;
+
+	/// The thread which processed each atom
+	std::vector<int> m_AtomThread;
+
+	/// The start of each atom's neighbors within its thread buffer
+	std::vector<int> m_AtomOffset;
+
+	/// The number of neighbors of each atom
+	std::vector<int> m_AtomCount;
 };
 
 
@@ -228,6 +320,60 @@ protected:
 
 
 
+
+
+
+//-------------------------------------------------
+//
+/// \brief  Cell-list (linked-cell) 32Bit NeighborList for Infinite or PeriodicBox spaces
+///
+/// \details Instead of comparing every atom with every other atom, the atoms are first
+/// hashed into a grid of cubic cells whose edge length is at least Cutoff+Padding.
+/// Each atom then only needs to be compared with the atoms in its own and the 26
+/// surrounding cells, making a full rebuild O(N) rather than O(N^2).
+///
+/// The generated lists are identical to those of NeighbourList (same 32Bit packed
+/// NeighbourData, same bondorder and image bits, neighbours sorted by atom index), 
+/// so all forcefields work unchanged. Simply load it into the workspace:
+///
+///   nlist = NeighbourList_CellBased()
+///   wspace.setNeighbourList(nlist)
+///
+/// For PeriodicBoxes with less than 3 cells along any axis the brute force
+/// NeighbourList code is used instead, as the cells would otherwise be visited twice.
+///
+class PD_API NeighbourList_CellBased: public NeighbourList
+{
+public:
+	NeighbourList_CellBased():NeighbourList(){};
+	virtual ~NeighbourList_CellBased(){};
+
+	virtual size_t memuse(int level);
+
+protected:
+	virtual void calcNewList_InfiniteSpace();
+	virtual void calcNewList_PeriodicBox(); 
+
+	/// Sorts the atoms into the cell grid (counting sort, atoms stay in ascending order within each cell)
+	void assignCells( const std::vector<int> &atomcell, int ncells );
+
+	/// Builds the actual neighbor lists from the cell grid created by assignCells()
+	void calcNewList_FromCells( int nx, int ny, int nz, const PeriodicBox *periodic_box );
+
+	/// Index of the first atom of each cell in m_CellAtom (size ncells+1)
+	std::vector<int> m_CellStart;
+
+	/// Atom indices sorted by cell
+	std::vector<int> m_CellAtom;
+
+	/// The cell each atom was assigned to
+	std::vector<int> m_AtomCell;
+
+};
+
+
+
+
 ///// OLD DEPRECATED NEIGHBOR LISTS
 
 
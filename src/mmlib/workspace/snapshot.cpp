@@ -80,6 +80,112 @@ SnapShot &SnapShot::operator= (const SnapShot &psp)
 
 
 
+SnapShotSoA::SnapShotSoA():
+	x(NULL), y(NULL), z(NULL),
+	fx(NULL), fy(NULL), fz(NULL),
+	m_Block(NULL),
+	natoms(0),
+	m_Stride(0)
+{
+}
+
+SnapShotSoA::SnapShotSoA(const SnapShotSoA &copy):
+	x(NULL), y(NULL), z(NULL),
+	fx(NULL), fy(NULL), fz(NULL),
+	m_Block(NULL),
+	natoms(0),
+	m_Stride(0)
+{
+	(*this) = copy;
+}
+
+SnapShotSoA::~SnapShotSoA()
+{
+	clear();
+}
+
+void SnapShotSoA::clear()
+{
+	delete[] m_Block;
+	m_Block = NULL;
+	x = y = z = fx = fy = fz = NULL;
+	natoms = 0;
+	m_Stride = 0;
+}
+
+SnapShotSoA &SnapShotSoA::operator= (const SnapShotSoA &copy)
+{
+	// check for self assignement
+	if(&copy == this)	return (*this);
+	resize(copy.natoms);
+	if(m_Stride > 0)
+	{
+		// the arrays are contiguous so one copy does it
+		memcpy(x, copy.x, m_Stride * 6 * sizeof(double));
+	}
+	return (*this);
+}
+
+void SnapShotSoA::resize(size_t _natoms)
+{
+	if( (_natoms == natoms) && (m_Block != NULL) ) return;
+	clear();
+	if(_natoms == 0) return;
+
+	natoms = _natoms;
+	m_Stride = ((natoms + Padding - 1) / Padding) * Padding;
+
+	// allocate one block with some slack and align the first array manually.
+	// m_Stride is a multiple of Padding (8 doubles = 64 bytes) so all 6 arrays are aligned.
+	m_Block = new char[ m_Stride * 6 * sizeof(double) + Alignment ];
+	size_t misalign = ((size_t)m_Block) % Alignment;
+	double *base = (double *)(m_Block + (misalign ? (Alignment - misalign) : 0));
+
+	x  = base;
+	y  = base + m_Stride;
+	z  = base + m_Stride * 2;
+	fx = base + m_Stride * 3;
+	fy = base + m_Stride * 4;
+	fz = base + m_Stride * 5;
+
+	// padding elements stay zero for good
+	memset(base, 0, m_Stride * 6 * sizeof(double));
+}
+
+void SnapShotSoA::loadPositions(const SnapShot &psp)
+{
+	resize(psp.natoms);
+	const SnapShotAtom *atom = psp.atom;
+	for(size_t i = 0; i < natoms; i++)
+	{
+		x[i] = atom[i].p.x;
+		y[i] = atom[i].p.y;
+		z[i] = atom[i].p.z;
+	}
+	zeroForces();
+}
+
+void SnapShotSoA::zeroForces()
+{
+	if(m_Stride == 0) return;
+	// fx, fy and fz are contiguous
+	memset(fx, 0, m_Stride * 3 * sizeof(double));
+}
+
+void SnapShotSoA::addForcesTo(SnapShot &psp) const
+{
+	if( psp.natoms != natoms ) THROW(CodeException,"SnapShotSoA and SnapShot are incompatible (number of atoms doesnt match)");
+	SnapShotAtom *atom = psp.atom;
+	for(size_t i = 0; i < natoms; i++)
+	{
+		atom[i].f.x += fx[i];
+		atom[i].f.y += fy[i];
+		atom[i].f.z += fz[i];
+	}
+}
+
+
+
 double SnapShot::cRMSFrom(const SnapShot &psp2) const
 {	
 	if( natoms != psp2.natoms ) throw("PhaseSpacePoints are incompatible (Total number of atoms doesnt match)");
@@ -9,6 +9,8 @@
 #include "workspace/workspace.fwd.h"
 #include "system/molecule.fwd.h"
 
+class PD_API SnapShot;
+
 //-------------------------------------------------
 /// \brief Passive class that holds position velocity and forces of a particle.
 /// \details Class used exclusively by SnapShot
@@ -22,6 +24,86 @@ class PD_API SnapShotAtom
 };
 
 
+//-------------------------------------------------
+//
+/// \brief Structure-of-arrays copy of the positions and forces of a SnapShot
+///
+/// \details SnapShotAtom interleaves position, force and velocity (9 doubles per atom),
+/// so kernels which only read positions and write forces waste most of every cache line
+/// they touch. SnapShotSoA holds the positions and forces in separate, contiguous
+/// x[], y[], z[] and fx[], fy[], fz[] arrays which are aligned to SnapShotSoA::Alignment 
+/// bytes and padded (with zeros) to a multiple of SnapShotSoA::Padding elements, such that 
+/// vectorised loops can stream over them without peeling or remainder handling.
+///
+/// The SnapShotAtom array remains the master copy of the coordinates, i.e. all existing 
+/// code using atom[i].p and atom[i].f continues to work. A kernel wishing to use the SoA layout
+/// calls loadPositions() (which also zeroes the SoA forces), does its work on the arrays and
+/// then calls addForcesTo() to accumulate the forces back onto atom[i].f. 
+/// WorkSpace holds one of these for its cur SnapShot (WorkSpace::cursoa).
+///
+class PD_API SnapShotSoA
+{
+public:
+	/// Byte alignment of each of the arrays (enough for AVX)
+	static const size_t Alignment = 32;
+
+	/// Arrays are padded to a multiple of this many elements
+	static const size_t Padding = 8;
+
+	SnapShotSoA();
+	SnapShotSoA(const SnapShotSoA &copy);
+	~SnapShotSoA();
+
+#ifndef SWIG
+	SnapShotSoA &operator= (const SnapShotSoA &copy);
+#endif
+
+	/// (Re)allocates the arrays for _natoms atoms, if necessary
+	void resize(size_t _natoms);
+
+	/// Copies the positions of psp into x[],y[],z[] and zeroes the forces
+	void loadPositions(const SnapShot &psp);
+
+	/// Sets fx[],fy[],fz[] to zero
+	void zeroForces();
+
+	/// Adds fx[],fy[],fz[] onto the forces psp.atom[i].f
+	void addForcesTo(SnapShot &psp) const;
+
+	size_t nAtoms() const { return natoms; }
+
+	/// Number of elements allocated per array (natoms rounded up to a multiple of Padding)
+	size_t stride() const { return m_Stride; }
+
+	size_t memuse(int level){
+		level--;
+		return sizeof(*this) + m_Stride * 6 * sizeof(double) + Alignment;
+	}
+
+public:
+	// Member Data - all point into one aligned block of memory
+
+	double *x;  ///< x positions
+	double *y;  ///< y positions
+	double *z;  ///< z positions
+	double *fx; ///< x forces
+	double *fy; ///< y forces
+	double *fz; ///< z forces
+
+private:
+	void clear();
+
+	/// The raw allocation the arrays point into
+	char *m_Block;
+
+	/// number of atoms
+	size_t natoms;
+
+	/// length of each array
+	size_t m_Stride;
+};
+
+
 //-------------------------------------------------
 //
 /// \brief  Class that works in conjunction with WorkSpace and is used to hold a SnapShot of a simualation
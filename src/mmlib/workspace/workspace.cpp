@@ -1,5 +1,7 @@
 #include "global.h"
 
+#include <algorithm>
+
 #include "forcefields/forcefield.h"
 #include "system/workspacecreator.h"
 #include "system/system.h"
@@ -66,6 +68,9 @@ void WorkSpace::CommonInit()
 
 	m_CheckSum = 0;
 
+	m_Journalling = false;
+	m_JournalEpoch = 0;
+
 	//outtra.linkWSpace(*this); // link the outtra to its parent wspace to trigger ene calcs
 }
 
@@ -182,6 +187,55 @@ void WorkSpace::load(const SnapShot &psp)
 }
 
 
+void WorkSpace::beginJournal()
+{
+	if( m_JournalMark.size() != nAtoms() )
+	{
+		m_JournalMark.assign( nAtoms(), 0 );
+		m_JournalEpoch = 0;
+	}
+	if( ++m_JournalEpoch == 0 )
+	{
+		// the epoch counter wrapped around - old marks could be mistaken for current ones
+		std::fill( m_JournalMark.begin(), m_JournalMark.end(), 0 );
+		m_JournalEpoch = 1;
+	}
+	m_JournalAtom.clear();
+	m_JournalPos.clear();
+	m_Journalling = true;
+}
+
+void WorkSpace::journalAtomCore(size_t i)
+{
+	m_JournalMark[i] = m_JournalEpoch;
+	m_JournalAtom.push_back(i);
+	m_JournalPos.push_back(cur.atom[i].p);
+}
+
+void WorkSpace::rollbackJournal()
+{
+	for(size_t k = 0; k < m_JournalAtom.size(); k++)
+	{
+		cur.atom[m_JournalAtom[k]].p = m_JournalPos[k];
+	}
+	commitJournal();
+}
+
+void WorkSpace::commitJournal()
+{
+	m_JournalAtom.clear();
+	m_JournalPos.clear();
+	m_Journalling = false;
+}
+
+void WorkSpace::swapJournal()
+{
+	for(size_t k = 0; k < m_JournalAtom.size(); k++)
+	{
+		std::swap( cur.atom[m_JournalAtom[k]].p, m_JournalPos[k] );
+	}
+}
+
 void WorkSpace::load_forced(const SnapShot &psp)
 { 
 	if(nAtoms() != psp.natoms){	
@@ -343,6 +397,10 @@ void WorkSpace::cleanSpace()
 		dvector cog_inbox(cog);
 		ptr_boundary->moveIntoBox(cog_inbox);
 		cog_inbox.sub(cog);
+		if( m_Journalling && (cog_inbox.innerdot() > 0.0) )
+		{
+			for(int i = mol[imol].ifirst; i <= mol[imol].ilast; i++) journalAtom(i);
+		}
 		moveMolecule(imol,cog_inbox);
 	}
 }
@@ -383,6 +441,7 @@ size_t WorkSpace::memuse(int level)
 	size_t s_isysxxx = 2 * sizeof(int)*nAtoms();
 	size_t s_cur = cur.memuse(level);
 	size_t s_old = old.memuse(level);
+	size_t s_cursoa = cursoa.memuse(level);
 	size_t s_nlist = ptr_nlist->memuse(level);   
 	size_t s_rotlist = ptr_rotbondlist->memuse(level);
 	size_t s_bondorder = ptr_bondorder->memuse(level);
@@ -390,7 +449,7 @@ size_t WorkSpace::memuse(int level)
 	if(level >= 0)
 	{
 		printf("WorkSpace (total)  %d : \n",(int)(s_self+ s_atom+ s_res+ s_mol+
-							s_isysxxx+s_cur+s_old+s_nlist+s_rotlist+s_bondorder));
+							s_isysxxx+s_cur+s_old+s_cursoa+s_nlist+s_rotlist+s_bondorder));
 		printf("  self: %d\n"		 ,(int)s_self);
 		printf("  atom: %d\n"		 ,(int)s_atom);
 		printf("  res: %d\n"		 ,(int)s_res);
@@ -398,12 +457,13 @@ size_t WorkSpace::memuse(int level)
 		printf("  isysxx: %d\n"  ,(int)s_isysxxx); 
 		printf("  cur: %d\n"		 ,(int)s_cur);
 		printf("  old: %d\n"		 ,(int)s_old);
+		printf("  cursoa: %d\n"	 ,(int)s_cursoa);
 		printf("  ptr_nlist: %d\n"   ,(int)s_nlist);   
 		printf("  rotlist: %d\n" ,(int)s_rotlist);
 		printf("  ptr_bondorder: %d\n",(int)s_bondorder);
 	}
 	return s_self+ s_atom+ s_res+ s_mol+
-				 s_isysxxx+s_cur+s_old+
+				 s_isysxxx+s_cur+s_old+s_cursoa+
 				 s_nlist+s_rotlist+s_bondorder;
 }
 
@@ -271,6 +271,17 @@ public:
 	/// OLD Atom positions, forces etc. (from previous Step)
 	SnapShot	old; 
 
+	/// Optional structure-of-arrays mirror of the positions and forces in cur.
+	/// Kernels which want contiguous coordinates call gatherSoA() before and 
+	/// scatterSoAForces() after their calculation; cur always remains the master copy.
+	SnapShotSoA cursoa;
+
+	/// Copies the current positions into cursoa and zeroes its forces 
+	void gatherSoA() { cursoa.loadPositions(cur); }
+
+	/// Adds the forces accumulated in cursoa onto the forces in cur
+	void scatterSoAForces() { cursoa.addForcesTo(cur); }
+
 	/// Save snapshot of workspace - returns a copy of cur
 	SnapShot save() const;
 
@@ -281,6 +292,53 @@ public:
 	void load_forced(const SnapShot &psp); 
 	/// @}
 
+	/// \name Undo journal
+	/// \brief Records the original positions of the atoms changed after beginJournal(), such 
+	/// that a trial change can be undone without saving and loading an entire SnapShot.
+	/// \details Code which changes atom positions while a journal is open calls journalAtom(i) 
+	/// BEFORE it changes atom i; MoveBase::touchAtom() does this for all moves which report 
+	/// their touched atoms. Only the first call for each atom records a position, so undoing
+	/// a change costs O(changed atoms) rather than O(N). Forces and velocities are not journalled.
+	/// @{
+
+	/// Opens the journal, discarding any previous records
+	void beginJournal();
+
+	/// Records the current position of atom i unless it was recorded since beginJournal()
+	void journalAtom(size_t i)
+	{
+		if( m_Journalling && (m_JournalMark[i] != m_JournalEpoch) ) journalAtomCore(i);
+	}
+
+	/// Restores the recorded positions and closes the journal
+	void rollbackJournal();
+
+	/// Keeps the current positions and closes the journal
+	void commitJournal();
+
+	/// Exchanges the recorded positions with the current ones. Calling it a second time 
+	/// restores the current structure, which allows the old structure to be evaluated
+	/// without closing the journal.
+	void swapJournal();
+
+	/// true between beginJournal() and rollbackJournal()/commitJournal()
+	bool isJournalling() const { return m_Journalling; }
+
+	/// The atoms recorded since beginJournal(), in the order they were recorded
+	const std::vector<size_t>& journalAtoms() const { return m_JournalAtom; }
+	/// @}
+
+private:
+	void journalAtomCore(size_t i);
+
+	bool m_Journalling;
+	unsigned m_JournalEpoch;              ///< identifies the current journal in m_JournalMark
+	std::vector<unsigned> m_JournalMark;  ///< per atom: epoch of the journal which recorded it
+	std::vector<size_t> m_JournalAtom;
+	std::vector<Maths::dvector> m_JournalPos;
+
+public:
+
 	// This should be replaced with an array of atom IDENTIFICATION Numbers -
 	// infact these would aready be in the atom array;
 	
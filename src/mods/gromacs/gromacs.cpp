@@ -7,6 +7,14 @@ extern "C" {
 }
 #include "gromacs.h"
 
+#include <climits>
+#include <algorithm>
+
+// OpenMP headers for multi-core parallelisation
+#ifdef HAVE_OPENMP
+	#include <omp.h>
+#endif
+
 namespace IO 
 {
 
@@ -203,112 +211,300 @@ void OutputFile_XTC::save( WorkSpace &_wspace){
 	////////////////////////////////////////////////////////////////////
 
 
-	int InTra_XTC::open(){
-		delete xdrs; // just in case - to prevent a memory leak;
-		xdrs = new XDR;
-		if (xdropen(xdrs, filename.c_str() ,"r") == 0) {
-			throw( IOException("ERROR opening " + filename + " for reading") );	
+	namespace
+	{
+		const int XTC_Magic = 1995;
+		const size_t XTC_FrameHeader = 4 * 4 + 9 * 4; // magic, natoms, step, time and the box, ahead of the coordinates
+
+		const char XTC_IndexMagic[8] = { 'P','D','X','T','C','I','D','X' };
+		const int XTC_IndexVersion = 1;
+		const int XTC_IndexByteOrder = 0x01020304;
+
+		// xdr stores big endian ints and floats
+		inline int xtcInt( const unsigned char *_p )
+		{
+			return (int)(((unsigned int)_p[0] << 24) | ((unsigned int)_p[1] << 16) | ((unsigned int)_p[2] << 8) | (unsigned int)_p[3]);
 		}
-		return 0;
-	}
 
-	int InTra_XTC::close(){
-		if(!xdrclose(xdrs) ){ 
-			throw( IOException("ERROR closing " + filename) );
+		inline float xtcFloat( const unsigned char *_p )
+		{
+			unsigned int u = (unsigned int)xtcInt(_p);
+			float f;
+			memcpy( &f, &u, sizeof(float) );
+			return f;
 		}
-		return 0;
 	}
 
-	bool InTra_XTC::readNext( SnapShot &ss ){
-		if(xdrs == NULL){
-			throw( IOException("ERROR reading  " + filename + " for XTC trajectory") );	
-		}
+	InTra_XTC::InTra_XTC(const std::string& _filename, bool _UseIndexFile):
+		InputTrajectory_RandomAccess( _filename ),
+		m_IndexedBytes(0),
+		m_UseIndexFile(_UseIndexFile),
+		m_IndexFile(_filename + ".pdidx"),
+		currentPos(0),
+		m_ReadAhead(16),
+		m_BufferStart(0)
+	{
+		remap();
+	}
 
-		int XTC_magic = 0;                 // xtc format magic number - expecting 1995 here
-		int XTC_natoms = 0; 
-		int XTC_step = 0; 
-		float XTC_time = 0.0;
+	void InTra_XTC::remap()
+	{
+		m_Map = counted_ptr<IO::MappedFile>( new IO::MappedFile( filename ) );
+		m_Buffer.clear();
 
-		// write magic number, natoms (constant), step number and time into trajectory
-		if (!xdr_int(xdrs, &XTC_magic))    return true; 
-		if (!xdr_int(xdrs, &XTC_natoms))   throw( IOException("ERROR reading number of atoms from " + filename) );	
-		if (!xdr_int(xdrs, &XTC_step))     throw( IOException("ERROR reading step number from " + filename) );	
-		if (!xdr_float(xdrs, &XTC_time))   throw( IOException("ERROR reading time stamp from " + filename) );	
+		// the file must have been replaced if it is now shorter than what was indexed
+		size_t frameSize;
+		if( m_IndexedBytes > m_Map->size() || 
+			(m_FrameOffset.size() > 0 && !( isFrameAt( m_FrameOffset.back(), frameSize ) && m_FrameOffset.back() + frameSize == m_IndexedBytes )) )
+		{
+			m_FrameOffset.clear();
+			m_IndexedBytes = 0;
+		}
 
-		// test the data:
-		if (XTC_magic != 1995)             throw( IOException("ERROR reading " + filename + ". Magic number is not 1995 as expected - are you using a newer/older format of XTC ?")  );
-		if (XTC_natoms < 0)                throw( IOException("ERROR reading " + filename + ". THe number of atoms is negative. Is the file corrupt ?")  ); 
+		if( m_UseIndexFile && m_FrameOffset.size() == 0 )
+		{
+			loadIndex();
+		}
 
-		// Now read the box vectors
-		Maths::dvector A(0,0,0),B(0,0,0),C(0,0,0);
-		float XTC_box[3][3];
+		size_t indexed = m_FrameOffset.size();
+		buildIndex();
+		if( m_UseIndexFile && m_FrameOffset.size() != indexed )
+		{
+			saveIndex();
+		}
+	}
 
-		ss = SnapShot( XTC_natoms );
+	bool InTra_XTC::isFrameAt( size_t _Offset, size_t& _FrameSize ) const
+	{
+		const size_t filesize = m_Map->size();
+		if( _Offset + XTC_FrameHeader + 4 > filesize ) return false;
+		const unsigned char *frame = (const unsigned char*)m_Map->data() + _Offset;
+		if( xtcInt( frame ) != XTC_Magic ) return false;
+		int coordSize = xtc3dfsize( frame + XTC_FrameHeader, (unsigned int)std::min( filesize - _Offset - XTC_FrameHeader, (size_t)UINT_MAX ) );
+		if( coordSize == 0 ) return false;
+		_FrameSize = XTC_FrameHeader + (size_t)coordSize;
+		return true;
+	}
 
-		int i,j;
-		for(i=0; i<3; i++)
+	void InTra_XTC::buildIndex()
+	{
+		const size_t filesize = m_Map->size();
+		size_t offset = m_IndexedBytes;
+		size_t frameSize;
+		while( offset < filesize )
 		{
-			for(j=0; j<3; j++)
+			if( !isFrameAt( offset, frameSize ) )
 			{
-				if (!xdr_float(xdrs, &XTC_box[i][j]))
-				{ 
-					throw( IOException("ERROR reading from box vectors to " + filename) );	
+				if( offset + 4 <= filesize && xtcInt( (const unsigned char*)m_Map->data() + offset ) != XTC_Magic )
+				{
+					throw( IOException("ERROR reading " + filename + ". Magic number is not 1995 as expected - are you using a newer/older format of XTC ?") );
 				}
+				break; // the last frame is incomplete, it may still be being written
 			}
+			m_FrameOffset.push_back( offset );
+			offset += frameSize;
 		}
+		m_IndexedBytes = offset;
+	}
 
-		A.x = XTC_box[0][0];
-		A.y = XTC_box[0][1];
-		A.z = XTC_box[0][2];
-		B.x = XTC_box[1][0];
-		B.y = XTC_box[1][1];
-		B.z = XTC_box[1][2];
-		C.x = XTC_box[2][0];
-		C.y = XTC_box[2][1];
-		C.z = XTC_box[2][2];
-		ss.A = A;
-		ss.B = B;
-		ss.C = C;
+	bool InTra_XTC::loadIndex()
+	{
+		FILE *file = fopen( m_IndexFile.c_str(), "rb" );
+		if( file == NULL ) return false;
+
+		char magic[8];
+		int version = 0, byteOrder = 0;
+		unsigned long long indexedBytes = 0, frames = 0;
+		bool ok = 
+			1 == fread( magic, sizeof(magic), 1, file ) && 0 == memcmp( magic, XTC_IndexMagic, sizeof(magic) ) &&
+			1 == fread( &version, sizeof(int), 1, file ) && version == XTC_IndexVersion &&
+			1 == fread( &byteOrder, sizeof(int), 1, file ) && byteOrder == XTC_IndexByteOrder &&
+			1 == fread( &indexedBytes, sizeof(indexedBytes), 1, file ) && indexedBytes <= m_Map->size() &&
+			1 == fread( &frames, sizeof(frames), 1, file ) && frames * (XTC_FrameHeader + 4) <= indexedBytes;
+
+		std::vector<unsigned long long> offsets;
+		if( ok && frames > 0 )
+		{
+			offsets.resize( (size_t)frames );
+			ok = frames == fread( &offsets[0], sizeof(unsigned long long), (size_t)frames, file );
+		}
+		fclose( file );
 
-		// put coordinates into a linear array in the form of xyzxyzxyz..xyz
+		// The index must describe this file: the first frame at 0, and the last one ending where the index does
+		size_t frameSize;
+		if( ok && frames > 0 )
+		{
+			ok = offsets[0] == 0 && isFrameAt( (size_t)offsets.back(), frameSize ) && offsets.back() + frameSize == indexedBytes;
+		}
+		// ... and every frame in between must lie after the previous one, within the indexed bytes
+		for( size_t i = 1; ok && i < offsets.size(); i++ )
+		{
+			ok = offsets[i] >= offsets[i-1] + XTC_FrameHeader + 4 && offsets[i] < indexedBytes;
+		}
+		if( !ok ) return false;
 
-		float *coordinate_array = new float [XTC_natoms * 3];
-		for(i=0; i<XTC_natoms; i++)
+		m_FrameOffset.assign( offsets.begin(), offsets.end() );
+		m_IndexedBytes = (size_t)indexedBytes;
+		return true;
+	}
+
+	void InTra_XTC::saveIndex() const
+	{
+		// Write to a temporary and rename it into place, so that concurrent jobs never see a partial index.
+		// Failing to save is not an error, the directory may well be read-only.
+		std::string tempFile = IO::tempFilenameFor( m_IndexFile );
+
+		FILE *file = fopen( tempFile.c_str(), "wb" );
+		if( file == NULL ) return;
+
+		unsigned long long indexedBytes = m_IndexedBytes;
+		unsigned long long frames = m_FrameOffset.size();
+		std::vector<unsigned long long> offsets( m_FrameOffset.begin(), m_FrameOffset.end() );
+		bool ok = 
+			1 == fwrite( XTC_IndexMagic, sizeof(XTC_IndexMagic), 1, file ) &&
+			1 == fwrite( &XTC_IndexVersion, sizeof(int), 1, file ) &&
+			1 == fwrite( &XTC_IndexByteOrder, sizeof(int), 1, file ) &&
+			1 == fwrite( &indexedBytes, sizeof(indexedBytes), 1, file ) &&
+			1 == fwrite( &frames, sizeof(frames), 1, file ) &&
+			( frames == 0 || frames == fwrite( &offsets[0], sizeof(unsigned long long), offsets.size(), file ) );
+		ok = ( 0 == fclose( file ) ) && ok;
+		if( ok ) IO::replaceFile( tempFile, m_IndexFile );
+		else remove( tempFile.c_str() );
+	}
+
+	void InTra_XTC::decodeFrame( size_t _Entry, SnapShot &ss, std::vector<float>& _Coords ) const
+	{
+		// the index may come from a file on disk, never trust it to point inside the mapping
+		if( m_FrameOffset[_Entry] + XTC_FrameHeader > m_IndexedBytes )
+		{
+			throw( IOException("ERROR reading frame " + int2str((int)_Entry) + " from " + filename + ". The frame lies outside of the file - is the index out of date ?") );
+		}
+		const unsigned char *frame = (const unsigned char*)m_Map->data() + m_FrameOffset[_Entry];
+		const size_t available = m_IndexedBytes - m_FrameOffset[_Entry];
+		if( xtcInt( frame ) != XTC_Magic )
 		{
-			coordinate_array[i*3 + 0] = 0;  // convert from nano meters
-			coordinate_array[i*3 + 1] = 0;
-			coordinate_array[i*3 + 2] = 0;
+			throw( IOException("ERROR reading frame " + int2str((int)_Entry) + " from " + filename + ". Magic number is not 1995 as expected - is the index out of date ?") );
 		}
 
-		// now read the coordinates from the file using 
-		// Frans van Hoesel's compression algorithm
-		float prec = XTC_Precision;
-		if (xdr3dfcoord(xdrs, coordinate_array, &XTC_natoms, &prec) == 0) {
-			fprintf(stderr,"error while writing coordinates\n");
+		int XTC_natoms = xtcInt( frame + 4 );
+		if (XTC_natoms < 0) throw( IOException("ERROR reading " + filename + ". THe number of atoms is negative. Is the file corrupt ?")  ); 
+		if( ss.nAtoms() != XTC_natoms ) ss = SnapShot( XTC_natoms );
+
+		const unsigned char *box = frame + 16;
+		ss.A.setTo( xtcFloat(box),      xtcFloat(box + 4),  xtcFloat(box + 8) );
+		ss.B.setTo( xtcFloat(box + 12), xtcFloat(box + 16), xtcFloat(box + 20) );
+		ss.C.setTo( xtcFloat(box + 24), xtcFloat(box + 28), xtcFloat(box + 32) );
+
+		_Coords.resize( 3 * XTC_natoms );
+		float prec = 0.0f;
+		if( 0 == xtc3dfdecode( frame + XTC_FrameHeader, (unsigned int)std::min( available - XTC_FrameHeader, (size_t)UINT_MAX ),
+			_Coords.size() > 0 ? &_Coords[0] : NULL, XTC_natoms, &prec ) )
+		{
+			throw( IOException("ERROR reading coordinates of frame " + int2str((int)_Entry) + " from " + filename) );
 		}
-		for(i=0; i<XTC_natoms; i++)
+
+		for( int i = 0; i < XTC_natoms; i++ )
 		{
-			ss.atom[i].p.x = coordinate_array[i*3 + 0]*10;  // convert from nano meters
-			ss.atom[i].p.y = coordinate_array[i*3 + 1]*10;
-			ss.atom[i].p.z = coordinate_array[i*3 + 2]*10;
+			SnapShotAtom &atom = ss.atom[i];
+			atom.p.setTo( _Coords[i*3 + 0]*10, _Coords[i*3 + 1]*10, _Coords[i*3 + 2]*10 ); // convert from nano meters
+			atom.f.zero();
+			atom.v.zero();
 		}
+	}
 
-		delete [] coordinate_array;
+	void InTra_XTC::readRandomAccess( SnapShot &ss, size_t entry )
+	{
+		if( entry >= nEntries() ) throw( OutOfRangeException("InTra_XTC: Entry request is outside of tra range") );
+		std::vector<float> coords;
+		decodeFrame( entry, ss, coords );
+	}
+
+	void InTra_XTC::readRange( size_t _First, size_t _Count, std::vector<SnapShot>& _Frames ) const
+	{
+		if( _First + _Count > nEntries() ) throw( OutOfRangeException("InTra_XTC: readRange() is outside of tra range") );
+		_Frames.resize( _Count );
+
+		// exceptions cannot leave a parallel region, the first one is rethrown afterwards
+		std::string error;
+		const int count = (int)_Count;
+#ifdef HAVE_OPENMP
+		#pragma omp parallel
+#endif
+		{
+			std::vector<float> coords;
+#ifdef HAVE_OPENMP
+			#pragma omp for schedule(dynamic,1)
+#endif
+			for( int i = 0; i < count; i++ )
+			{
+				try
+				{
+					decodeFrame( _First + i, _Frames[i], coords );
+				}
+				catch( ExceptionBase &ex )
+				{
+#ifdef HAVE_OPENMP
+					#pragma omp critical(InTra_XTC_readRange)
+#endif
+					{
+						if( error.size() == 0 ) error = ex.getMessage();
+					}
+				}
+				catch( ... )
+				{
+#ifdef HAVE_OPENMP
+					#pragma omp critical(InTra_XTC_readRange)
+#endif
+					{
+						if( error.size() == 0 ) error = "ERROR reading frame " + int2str((int)(_First + i)) + " from " + filename;
+					}
+				}
+			}
+		}
+		if( error.size() > 0 ) throw( IOException(error) );
+	}
+
+	size_t InTra_XTC::nEntries() const
+	{
+		return m_FrameOffset.size();
+	}
+
+	void InTra_XTC::setReadAhead( size_t _Frames )
+	{
+		m_ReadAhead = std::max( (size_t)1, _Frames );
+		m_Buffer.clear();
+	}
+
+	bool InTra_XTC::readNext( SnapShot &ss ){
+		if( isEndOfFile() ) return true;
+
+		if( currentPos < m_BufferStart || currentPos >= m_BufferStart + m_Buffer.size() )
+		{
+			m_BufferStart = currentPos;
+			readRange( currentPos, std::min( m_ReadAhead, nEntries() - currentPos ), m_Buffer );
+		}
+		ss = m_Buffer[currentPos - m_BufferStart];
+		currentPos++;
 
 		return false;
 	}
 
 	bool InTra_XTC::skip()
 	{
-		// naiive implementation of skip. just read and discard result.
-		SnapShot ss;
-		readNext(ss);	
+		// no need to decode anything, the frame offsets are known
+		if( isEndOfFile() ) return true;
+		currentPos++;
 		return false;
 	}
 
 	bool InTra_XTC::isEndOfFile() const
 	{
-		return (bool)feof( (FILE *) xdrs->x_private );
+		return currentPos >= nEntries();
+	}
+
+	void InTra_XTC::reset()
+	{
+		currentPos = 0;
 	}
 
 
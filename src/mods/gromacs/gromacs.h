@@ -7,6 +7,11 @@
 #include "mmlib/fileio/intra.h"
 #include "mmlib/workspace/workspace.h"
 #include "mmlib/workspace/space.h"
+#include "mmlib/workspace/snapshot.h"
+#include "mmlib/tools/io.h"
+#include "mmlib/tools/counted_ptr.h"
+
+#include <vector>
 
 #include "rpcxdr.h"
 
@@ -154,35 +159,65 @@ mymolecule.save( OutputFile_XTC("test.pdb") );
 
 
 
-	class PD_API InTra_XTC: public InputTrajectory
+	//-------------------------------------------------
+	//
+	/// \brief Reads GROMACS XTC trajectories, sequentially or in random order
+	///
+	/// \details The file is memory mapped (see IO::MappedFile) and the offset of every frame is indexed
+	/// when it is opened. Only the frame headers and the sizes of the compressed coordinate blocks are 
+	/// read for that, nothing is decompressed. The index is saved next to the trajectory as 
+	/// "<filename>.pdidx" and reused when the same file is opened again; if frames have been appended 
+	/// in the meantime only those are indexed. Any frame can then be decompressed directly.
+	///
+	/// Frames are decoded with xtc3dfdecode(), which keeps no state between calls, so readRandomAccess()
+	/// may be called from several threads at once and readRange() decodes a block of frames on all 
+	/// available threads. readNext() decodes ReadAhead frames at a time in the same way.
+	/// Clones share the mapping and the index.
+	///
+	class PD_API InTra_XTC: public InputTrajectory_RandomAccess
 	{
 	public:
-
-		InTra_XTC(const std::string& _filename):
-		InputTrajectory( _filename)
-		{
-		  xdrs = NULL;
-		  open();
-		}
-
-		virtual ~InTra_XTC () 
-		{ 
-		  close();  
-		}
+		InTra_XTC(const std::string& _filename, bool _UseIndexFile = true);
 
 		virtual InTra_XTC* clone() const { return new InTra_XTC(*this); }
 
 		virtual bool readNext( SnapShot &ss );
 		virtual bool skip();
 		virtual bool isEndOfFile() const;
-		virtual void reset(){ close(); open(); };
-	protected:
-		virtual int open();
-		virtual int close();
+		virtual void reset();
 
-	private:
+		virtual void readRandomAccess( SnapShot &ss, size_t entry );
+		virtual size_t nEntries() const;
 
-		XDR *xdrs;
+		/// Decodes the entries _First to _First+_Count-1 into _Frames, several frames at a time
+		void readRange( size_t _First, size_t _Count, std::vector<SnapShot>& _Frames ) const;
+
+		/// Maps the file again and indexes any frames appended since it was opened
+		void remap();
+
+		/// The number of frames readNext() decodes in one go (default 16)
+		void setReadAhead( size_t _Frames );
+
+		const std::string& getIndexFilename() const { return m_IndexFile; }
+
+	protected:
+		void buildIndex();
+		bool loadIndex();
+		void saveIndex() const;
+		bool isFrameAt( size_t _Offset, size_t& _FrameSize ) const;
+		void decodeFrame( size_t _Entry, SnapShot &ss, std::vector<float>& _Coords ) const;
+
+		counted_ptr<IO::MappedFile> m_Map;
+		std::vector<size_t> m_FrameOffset; ///< the offset of each frame from the start of the file
+		size_t m_IndexedBytes; ///< the end of the last indexed frame
+
+		bool m_UseIndexFile;
+		std::string m_IndexFile;
+
+		size_t currentPos;
+		size_t m_ReadAhead;
+		size_t m_BufferStart; ///< the entry held in m_Buffer[0]
+		std::vector<SnapShot> m_Buffer;
 	};
 
 
@@ -145,6 +145,13 @@
  |	way, because it invites people to use the other xdr 
  |	routines.
  |
+ | int xtc3dfsize(const unsigned char *src, unsigned int srclen)
+ | int xtc3dfdecode(const unsigned char *src, unsigned int srclen,
+ |	float *fp, int size, float *precision)
+ |	Size and decode a block written by xdr3dfcoord that is already
+ |	held in memory. Unlike xdr3dfcoord these keep no state between
+ |	calls, so several threads may decode different blocks at once.
+ |
  |	frans van hoesel hoesel@chem.rug.nl
 */	
 
@@ -160,6 +167,7 @@
 #include "rpcxdr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "xdrf.h"
 
 			
@@ -1242,5 +1250,223 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision) {
 	return 1;
 }
 
+/*___________________________________________________________________________
+ |
+ | xtc_getint, xtc_getfloat - read a big endian (xdr) int or float
+ |
+*/
+
+static int xtc_getint(const unsigned char *p) {
+    return (int)(((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+	    ((unsigned int)p[2] << 8) | (unsigned int)p[3]);
+}
+
+static float xtc_getfloat(const unsigned char *p) {
+    unsigned int u = (unsigned int)xtc_getint(p);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/*___________________________________________________________________________
+ |
+ | xtc3dfsize - the size of a block written by xdr3dfcoord
+ |
+ | src points to the start of the block (the number of coordinates), of
+ | which srclen bytes are available. Returns the number of bytes the block
+ | occupies, or 0 if srclen is too short to tell or the block is invalid.
+ | Nothing is decoded, so this is cheap enough to index a whole file.
+ |
+*/
+
+int xtc3dfsize(const unsigned char *src, unsigned int srclen) {
+    int lsize, nbytes;
+    unsigned int total;
+
+    if (srclen < 4) return 0;
+    lsize = xtc_getint(src);
+    if (lsize < 0) return 0;
+    if (lsize <= 9) {
+	total = 4 + 3 * 4 * (unsigned int)lsize;
+    } else {
+	/* size, precision, minint[3], maxint[3], smallidx, byte count */
+	if (srclen < 40) return 0;
+	nbytes = xtc_getint(src + 36);
+	if (nbytes < 0) return 0;
+	total = 40 + (((unsigned int)nbytes + 3) & ~3u); /* xdr_opaque pads to 4 bytes */
+    }
+    return (total <= srclen) ? (int)total : 0;
+}
+
+/*___________________________________________________________________________
+ |
+ | xtc3dfdecode - decode a block written by xdr3dfcoord from memory
+ |
+ | This is the reading half of xdr3dfcoord, working on a block that has
+ | already been read (or mapped) into memory rather than on an xdr stream.
+ | All scratch space is local, so it is reentrant. fp must hold size
+ | coordinate triplets and size must match the number stored in the block.
+ | Returns the number of bytes consumed, or 0 on error.
+ |
+*/
+
+#define XTC_DECODE_PAD 128 /* slack for reading past the end of corrupt data */
+
+int xtc3dfdecode(const unsigned char *src, unsigned int srclen,
+	float *fp, int size, float *precision) {
+
+    int minint[3], maxint[3], *lip;
+    int smallidx;
+    unsigned sizeint[3], sizesmall[3], bitsizeint[3] = {0, 0, 0};
+    int flag, k;
+    int small, smaller, i, is_smaller, run;
+    float *lfp;
+    int tmp, *thiscoord, prevcoord[3];
+    int *ip, *buf;
+    int lsize, nbytes, total;
+    unsigned int bitsize;
+    float inv_precision;
+
+    total = xtc3dfsize(src, srclen);
+    if (total == 0) return 0;
+    lsize = xtc_getint(src);
+    if (lsize != size) return 0;
+    if (lsize <= 9) {
+	for (i = 0; i < 3 * lsize; i++) {
+	    fp[i] = xtc_getfloat(src + 4 + 4 * i);
+	}
+	return total;
+    }
+
+    *precision = xtc_getfloat(src + 4);
+    for (k = 0; k < 3; k++) {
+	minint[k] = xtc_getint(src + 8 + 4 * k);
+	maxint[k] = xtc_getint(src + 20 + 4 * k);
+    }
+    smallidx = xtc_getint(src + 32);
+    nbytes = xtc_getint(src + 36);
+    if (smallidx < FIRSTIDX || smallidx >= (int)LASTIDX) return 0;
+
+    sizeint[0] = maxint[0] - minint[0]+1;
+    sizeint[1] = maxint[1] - minint[1]+1;
+    sizeint[2] = maxint[2] - minint[2]+1;
+
+    /* check if one of the sizes is to big to be multiplied */
+    if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff) {
+	bitsizeint[0] = sizeofint(sizeint[0]);
+	bitsizeint[1] = sizeofint(sizeint[1]);
+	bitsizeint[2] = sizeofint(sizeint[2]);
+	bitsize = 0; /* flag the use of large sizes */
+    } else {
+	bitsize = sizeofints(3, sizeint);
+    }
+
+    smaller = magicints[MAX(FIRSTIDX, smallidx-1)] / 2;
+    small = magicints[smallidx] / 2;
+    sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
+
+    ip = (int *)malloc(3 * lsize * sizeof(*ip));
+    buf = (int *)calloc(3 + (nbytes + XTC_DECODE_PAD) / sizeof(*buf) + 1, sizeof(*buf));
+    if (ip == NULL || buf == NULL) {
+	free(ip);
+	free(buf);
+	return 0;
+    }
+    memcpy(&(buf[3]), src + 40, nbytes);
+    buf[0] = buf[1] = buf[2] = 0;
+
+    lfp = fp;
+    inv_precision = 1.0 / * precision;
+    run = 0;
+    i = 0;
+    lip = ip;
+    while ( i < lsize ) {
+	thiscoord = (int *)(lip) + i * 3;
+
+	if (bitsize == 0) {
+	    thiscoord[0] = receivebits(buf, bitsizeint[0]);
+	    thiscoord[1] = receivebits(buf, bitsizeint[1]);
+	    thiscoord[2] = receivebits(buf, bitsizeint[2]);
+	} else {
+	    receiveints(buf, 3, bitsize, sizeint, thiscoord);
+	}
+
+	i++;
+	thiscoord[0] += minint[0];
+	thiscoord[1] += minint[1];
+	thiscoord[2] += minint[2];
+
+	prevcoord[0] = thiscoord[0];
+	prevcoord[1] = thiscoord[1];
+	prevcoord[2] = thiscoord[2];
+
+
+	flag = receivebits(buf, 1);
+	is_smaller = 0;
+	if (flag == 1) {
+	    run = receivebits(buf, 5);
+	    is_smaller = run % 3;
+	    run -= is_smaller;
+	    is_smaller--;
+	}
+	if (i + run / 3 > lsize || smallidx + is_smaller < FIRSTIDX ||
+		smallidx + is_smaller >= (int)LASTIDX) {
+	    break; /* corrupt data */
+	}
+	if (run > 0) {
+	    thiscoord += 3;
+	    for (k = 0; k < run; k+=3) {
+		receiveints(buf, 3, smallidx, sizesmall, thiscoord);
+		i++;
+		thiscoord[0] += prevcoord[0] - small;
+		thiscoord[1] += prevcoord[1] - small;
+		thiscoord[2] += prevcoord[2] - small;
+		if (k == 0) {
+		    /* interchange first with second atom for better
+		     * compression of water molecules
+		     */
+		    tmp = thiscoord[0]; thiscoord[0] = prevcoord[0];
+		    prevcoord[0] = tmp;
+		    tmp = thiscoord[1]; thiscoord[1] = prevcoord[1];
+		    prevcoord[1] = tmp;
+		    tmp = thiscoord[2]; thiscoord[2] = prevcoord[2];
+		    prevcoord[2] = tmp;
+		    *lfp++ = prevcoord[0] * inv_precision;
+		    *lfp++ = prevcoord[1] * inv_precision;
+		    *lfp++ = prevcoord[2] * inv_precision;
+		} else {
+		    prevcoord[0] = thiscoord[0];
+		    prevcoord[1] = thiscoord[1];
+		    prevcoord[2] = thiscoord[2];
+		}
+		*lfp++ = thiscoord[0] * inv_precision;
+		*lfp++ = thiscoord[1] * inv_precision;
+		*lfp++ = thiscoord[2] * inv_precision;
+	    }
+	} else {
+	    *lfp++ = thiscoord[0] * inv_precision;
+	    *lfp++ = thiscoord[1] * inv_precision;
+	    *lfp++ = thiscoord[2] * inv_precision;		
+	}
+	smallidx += is_smaller;
+	if (is_smaller < 0) {
+	    small = smaller;
+	    if (smallidx > FIRSTIDX) {
+		smaller = magicints[smallidx - 1] /2;
+	    } else {
+		smaller = 0;
+	    }
+	} else if (is_smaller > 0) {
+	    smaller = small;
+	    small = magicints[smallidx] / 2;
+	}
+	sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
+	if (buf[0] > nbytes) {
+	    break; /* ran off the end: corrupt data */
+	}
+    }
+    free(ip);
+    free(buf);
+    return (i == lsize) ? total : 0;
+}
 
-   
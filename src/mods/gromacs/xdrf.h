@@ -7,3 +7,5 @@
 int xdropen(XDR *xdrs, const char *filename, const char *type);
 int xdrclose(XDR *xdrs) ;
 int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision) ;
+int xtc3dfsize(const unsigned char *src, unsigned int srclen) ;
+int xtc3dfdecode(const unsigned char *src, unsigned int srclen, float *fp, int size, float *precision) ;
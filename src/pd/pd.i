@@ -63,12 +63,14 @@ namespace std
 %include "mmlib/maths/maths_vector.h"
 %include "mmlib/maths/graphtheory.h"
 %include "mmlib/maths/fastrandom.h"
+%include "mmlib/maths/rmsbatch.h"
 
 %template(dvector) Maths::Tvector<double>;
 %template(fvector) Maths::Tvector<float>;
 
 %include "mmlib/maths/histogram.h"
 %include "mmlib/tools/statclock.h"
+%include "mmlib/tools/cpufeatures.h"
 %include "mmlib/tools/streamwriter.h"
 %include "mmlib/tools/stringbuilder.h"
 
@@ -127,6 +129,7 @@ namespace std
 %include "mmlib/forcefields/nonbonded.h"
 %include "mmlib/forcefields/nonbonded_ti.h"
 %include "mmlib/forcefields/nonbonded_ti_linear.h"
+%include "mmlib/forcefields/pme.h"
 %include "mmlib/forcefields/ffbonded.h"
 %include "mmlib/forcefields/gbff.h"
 %include "mmlib/forcefields/lcpo.h"
@@ -150,6 +153,7 @@ namespace std
 
 %include "mmlib/protocols/energy.h"
 %include "mmlib/protocols/minimise.h"
+%include "mmlib/protocols/constraints.h"
 %include "mmlib/protocols/md.h"
 %include "mmlib/protocols/rerun.h"
 %include "mmlib/protocols/remd.h"